@@ -32,7 +32,7 @@
 int main(int argc, char **argv) {
     PetscErrorCode ierr = 0;
     int procid, nprocs;
-    Vec mT = NULL, mR = NULL, vxi = NULL, mask = NULL;
+    Vec mT = NULL, mR = NULL, vxi = NULL, mask = NULL, regweight = NULL;
     reg::VecField* v = NULL;
     reg::RegOpt* regopt = NULL;
     reg::ReadWriteReg* readwrite = NULL;
@@ -70,8 +70,10 @@ int main(int argc, char **argv) {
         ierr = reg::ThrowError(err); CHKERRQ(ierr);
     }
 
-    // read reference and template image
+    // read reference and template image (the intensities are
+    // rescaled while reading; see SetReferenceImage)
     if (regopt->m_ReadWriteFlags.readfiles) {
+        regopt->m_ReadWriteFlags.rescaleonread = true;
         if (regopt->m_Verbosity > 1) {
             ierr = reg::DbgMsg("reading reference image"); CHKERRQ(ierr);
         }
@@ -100,30 +102,35 @@ int main(int argc, char **argv) {
         if (regopt->m_Verbosity > 1) {
             ierr = reg::DbgMsg("reading velocity field"); CHKERRQ(ierr);
         }
-        ierr = readwrite->Read(&vxi, regopt->m_FileNames.iv1); CHKERRQ(ierr);
-        ierr = reg::Assert(vxi != NULL, "null pointer"); CHKERRQ(ierr);
-        ierr = VecCopy(vxi, v->m_X1); CHKERRQ(ierr);
-        if (vxi != NULL) {ierr = VecDestroy(&vxi); CHKERRQ(ierr); vxi = NULL;}
-        if (regopt->m_Verbosity > 2) {
-            ierr = reg::ShowValues(v->m_X1); CHKERRQ(ierr);
-        }
-
-        //std::cout << regopt->m_ReadWriteFlags.vx2 << std::endl;
-        ierr = readwrite->Read(&vxi, regopt->m_FileNames.iv2); CHKERRQ(ierr);
-        ierr = reg::Assert(vxi != NULL, "null pointer"); CHKERRQ(ierr);
-        ierr = VecCopy(vxi, v->m_X2); CHKERRQ(ierr);
-        if (vxi != NULL) {ierr = VecDestroy(&vxi); CHKERRQ(ierr); vxi = NULL;}
-        if (regopt->m_Verbosity > 2) {
-            ierr = reg::ShowValues(v->m_X2); CHKERRQ(ierr);
-        }
-
-        //std::cout << regopt->m_ReadWriteFlags.vx3 << std::endl;
-        ierr = readwrite->Read(&vxi, regopt->m_FileNames.iv3); CHKERRQ(ierr);
-        ierr = reg::Assert(vxi != NULL, "null pointer"); CHKERRQ(ierr);
-        ierr = VecCopy(vxi, v->m_X3); CHKERRQ(ierr);
-        if (vxi != NULL) {ierr = VecDestroy(&vxi); CHKERRQ(ierr); vxi = NULL;}
-        if (regopt->m_Verbosity > 2) {
-            ierr = reg::ShowValues(v->m_X3); CHKERRQ(ierr);
+        // all components are stored in a single container
+        if (regopt->m_FileNames.iv1.find(".cvel") != std::string::npos) {
+            ierr = readwrite->Read(v, regopt->m_FileNames.iv1); CHKERRQ(ierr);
+        } else {
+            ierr = readwrite->Read(&vxi, regopt->m_FileNames.iv1); CHKERRQ(ierr);
+            ierr = reg::Assert(vxi != NULL, "null pointer"); CHKERRQ(ierr);
+            ierr = VecCopy(vxi, v->m_X1); CHKERRQ(ierr);
+            if (vxi != NULL) {ierr = VecDestroy(&vxi); CHKERRQ(ierr); vxi = NULL;}
+            if (regopt->m_Verbosity > 2) {
+                ierr = reg::ShowValues(v->m_X1); CHKERRQ(ierr);
+            }
+
+            //std::cout << regopt->m_ReadWriteFlags.vx2 << std::endl;
+            ierr = readwrite->Read(&vxi, regopt->m_FileNames.iv2); CHKERRQ(ierr);
+            ierr = reg::Assert(vxi != NULL, "null pointer"); CHKERRQ(ierr);
+            ierr = VecCopy(vxi, v->m_X2); CHKERRQ(ierr);
+            if (vxi != NULL) {ierr = VecDestroy(&vxi); CHKERRQ(ierr); vxi = NULL;}
+            if (regopt->m_Verbosity > 2) {
+                ierr = reg::ShowValues(v->m_X2); CHKERRQ(ierr);
+            }
+
+            //std::cout << regopt->m_ReadWriteFlags.vx3 << std::endl;
+            ierr = readwrite->Read(&vxi, regopt->m_FileNames.iv3); CHKERRQ(ierr);
+            ierr = reg::Assert(vxi != NULL, "null pointer"); CHKERRQ(ierr);
+            ierr = VecCopy(vxi, v->m_X3); CHKERRQ(ierr);
+            if (vxi != NULL) {ierr = VecDestroy(&vxi); CHKERRQ(ierr); vxi = NULL;}
+            if (regopt->m_Verbosity > 2) {
+                ierr = reg::ShowValues(v->m_X3); CHKERRQ(ierr);
+            }
         }
         ierr = registration->SetInitialGuess(v); CHKERRQ(ierr);
     }
@@ -137,10 +144,22 @@ int main(int argc, char **argv) {
         ierr = reg::Assert(mask != NULL, "null pointer"); CHKERRQ(ierr);
     }
 
+    if (!regopt->m_FileNames.regweight.empty()) {
+        if (regopt->m_Verbosity > 1) {
+            ierr = reg::DbgMsg("reading regularization weight"); CHKERRQ(ierr);
+        }
+        ierr = readwrite->Read(&regweight, regopt->m_FileNames.regweight); CHKERRQ(ierr);
+        ierr = reg::Assert(regweight != NULL, "null pointer"); CHKERRQ(ierr);
+        ierr = registration->SetRegularizationWeight(regweight); CHKERRQ(ierr);
+    }
+
     ierr = registration->SetReadWrite(readwrite); CHKERRQ(ierr);
 
     ierr = registration->Run(); CHKERRQ(ierr);
 
+    // wait for output that is written in the background
+    ierr = readwrite->Flush(); CHKERRQ(ierr);
+
     if (regopt->m_Log.memoryusage) {
         PetscLogDouble mem;
         ierr = PetscMemoryGetMaximumUsage(&mem); CHKERRQ(ierr);
@@ -153,6 +172,7 @@ int main(int argc, char **argv) {
     if (mT != NULL) {ierr = VecDestroy(&mT); CHKERRQ(ierr); mT = NULL;}
     if (mR != NULL) {ierr = VecDestroy(&mR); CHKERRQ(ierr); mR = NULL;}
     if (mask != NULL) {ierr = VecDestroy(&mask); CHKERRQ(ierr); mask = NULL;}
+    if (regweight != NULL) {ierr = VecDestroy(&regweight); CHKERRQ(ierr); regweight = NULL;}
     if (vxi != NULL) {ierr = VecDestroy(&vxi); CHKERRQ(ierr); vxi = NULL;}
     if (regopt != NULL) {delete regopt; regopt = NULL;}
     if (readwrite != NULL) {delete readwrite; readwrite = NULL;}
@@ -29,6 +29,7 @@
 #include "CLAIREInterface.hpp"
 
 PetscErrorCode Resample(reg::RegToolsOpt*);
+PetscErrorCode ResampleStreamed(reg::RegToolsOpt*);
 PetscErrorCode ComputeDefFields(reg::RegToolsOpt*);
 PetscErrorCode ComputeResidual(reg::RegToolsOpt*);
 PetscErrorCode ComputeError(reg::RegToolsOpt*);
@@ -72,7 +73,11 @@ int main(int argc, char **argv) {
     if (regopt->m_RegToolFlags.computedeffields) {
         ierr = ComputeDefFields(regopt); CHKERRQ(ierr);
     } else if (regopt->m_RegToolFlags.resample) {
-        ierr = Resample(regopt); CHKERRQ(ierr);
+        if (regopt->m_ResamplingPara.streamed) {
+            ierr = ResampleStreamed(regopt); CHKERRQ(ierr);
+        } else {
+            ierr = Resample(regopt); CHKERRQ(ierr);
+        }
     } else if (regopt->m_RegToolFlags.deformimage) {
         ierr = TransportImage(regopt); CHKERRQ(ierr);
     } else if (regopt->m_RegToolFlags.tlabelmap) {
@@ -148,31 +153,42 @@ PetscErrorCode ReadData(reg::RegToolsOpt* regopt, reg::ReadWriteReg* rw, reg::Ve
         && !regopt->m_FileNames.iv2.empty()
         && !regopt->m_FileNames.iv3.empty() ) {
 
-        // read velocity components
-        filename.push_back(regopt->m_FileNames.iv1);
-        ierr = rw->ReadR(&vxi, filename); CHKERRQ(ierr);
-        filename.clear();
-        if (!regopt->m_SetupDone) {ierr = regopt->DoSetup(); CHKERRQ(ierr);}
-
-        // allocate container for velocity field
-        try {v = new reg::VecField(regopt);}
-        catch (std::bad_alloc&) {
-            ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
+        if (regopt->m_FileNames.iv1.find(".cvel") != std::string::npos) {
+            // all components are stored in a single container (the
+            // grid is set up from the header if necessary)
+            try {v = new reg::VecField();}
+            catch (std::bad_alloc&) {
+                ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
+            }
+            ierr = v->SetOpt(regopt); CHKERRQ(ierr);
+            ierr = rw->Read(v, regopt->m_FileNames.iv1); CHKERRQ(ierr);
+        } else {
+            // read velocity components
+            filename.push_back(regopt->m_FileNames.iv1);
+            ierr = rw->ReadR(&vxi, filename); CHKERRQ(ierr);
+            filename.clear();
+            if (!regopt->m_SetupDone) {ierr = regopt->DoSetup(); CHKERRQ(ierr);}
+
+            // allocate container for velocity field
+            try {v = new reg::VecField(regopt);}
+            catch (std::bad_alloc&) {
+                ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
+            }
+            ierr = VecCopy(vxi, v->m_X1); CHKERRQ(ierr);
+            if (vxi != NULL) {ierr = VecDestroy(&vxi); CHKERRQ(ierr); vxi = NULL;}
+
+            filename.push_back(regopt->m_FileNames.iv2);
+            ierr = rw->Read(&vxi, filename); CHKERRQ(ierr);
+            filename.clear();
+            ierr = VecCopy(vxi, v->m_X2); CHKERRQ(ierr);
+            if (vxi != NULL) {ierr = VecDestroy(&vxi); CHKERRQ(ierr); vxi = NULL;}
+
+            filename.push_back(regopt->m_FileNames.iv3);
+            ierr = rw->Read(&vxi, filename); CHKERRQ(ierr);
+            filename.clear();
+            ierr = VecCopy(vxi, v->m_X3); CHKERRQ(ierr);
+            if (vxi != NULL) {ierr = VecDestroy(&vxi); CHKERRQ(ierr); vxi = NULL;}
         }
-        ierr = VecCopy(vxi, v->m_X1); CHKERRQ(ierr);
-        if (vxi != NULL) {ierr = VecDestroy(&vxi); CHKERRQ(ierr); vxi = NULL;}
-
-        filename.push_back(regopt->m_FileNames.iv2);
-        ierr = rw->Read(&vxi, filename); CHKERRQ(ierr);
-        filename.clear();
-        ierr = VecCopy(vxi, v->m_X2); CHKERRQ(ierr);
-        if (vxi != NULL) {ierr = VecDestroy(&vxi); CHKERRQ(ierr); vxi = NULL;}
-
-        filename.push_back(regopt->m_FileNames.iv3);
-        ierr = rw->Read(&vxi, filename); CHKERRQ(ierr);
-        filename.clear();
-        ierr = VecCopy(vxi, v->m_X3); CHKERRQ(ierr);
-        if (vxi != NULL) {ierr = VecDestroy(&vxi); CHKERRQ(ierr); vxi = NULL;}
     }
 
     PetscFunctionReturn(ierr);
@@ -567,7 +583,6 @@ PetscErrorCode Resample(reg::RegToolsOpt* regopt) {
             catch (std::bad_alloc&) {
                 ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
             }
-            preproc->ResetGridChangeOps(true);
 
             ss << "resampling: ("<< nx[0] << "," << nx[1] << "," << nx[2] << ")"
                << " -> (" << nxl[0] << "," << nxl[1] << "," << nxl[2] << ")";
@@ -689,6 +704,56 @@ PetscErrorCode Resample(reg::RegToolsOpt* regopt) {
 
 
 
+/********************************************************************
+ * @brief resample scalar field or vector field in z-slabs (the input
+ * is never held in memory; used for images that are too large to be
+ * resampled on the full grid)
+ * @param[in] regopt container for user defined options
+ *******************************************************************/
+PetscErrorCode ResampleStreamed(reg::RegToolsOpt* regopt) {
+    PetscErrorCode ierr = 0;
+    std::stringstream ss;
+    IntType nxl[3];
+    ScalarType scale;
+    reg::ReadWriteReg* readwrite = NULL;
+
+    PetscFunctionBegin;
+
+    regopt->Enter(__func__);
+
+    // allocate class for io
+    try {readwrite = new reg::ReadWriteReg(regopt);}
+    catch (std::bad_alloc&) {
+        ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
+    }
+
+    scale = regopt->m_ResamplingPara.gridscale;
+    for (int i = 0; i < 3; ++i) {
+        nxl[i] = regopt->m_ResamplingPara.nx[i];
+    }
+
+    if (!regopt->m_FileNames.isc.empty()) {
+        ierr = readwrite->Resample(regopt->m_FileNames.isc, regopt->m_FileNames.xsc, nxl, scale); CHKERRQ(ierr);
+    } else {
+        ierr = readwrite->Resample(regopt->m_FileNames.iv1, regopt->m_FileNames.xv1, nxl, scale); CHKERRQ(ierr);
+        ierr = readwrite->Resample(regopt->m_FileNames.iv2, regopt->m_FileNames.xv2, nxl, scale); CHKERRQ(ierr);
+        ierr = readwrite->Resample(regopt->m_FileNames.iv3, regopt->m_FileNames.xv3, nxl, scale); CHKERRQ(ierr);
+    }
+
+    ss << "resampled data to grid (" << nxl[0] << "," << nxl[1] << "," << nxl[2] << ")";
+    ierr = reg::Msg(ss.str()); CHKERRQ(ierr);
+    ss.str(std::string()); ss.clear();
+
+    if (readwrite != NULL) {delete readwrite; readwrite = NULL;}
+
+    regopt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
 /********************************************************************
  * @brief compute values of scalar field
  * @param[in] regopt container for user defined options
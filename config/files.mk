@@ -7,6 +7,7 @@ CPPFILES=$(SRCDIR)/RegOpt.cpp \
 		$(SRCDIR)/Interp3_Plan.cpp \
 		$(SRCDIR)/VecField.cpp \
 		$(SRCDIR)/TenField.cpp \
+		$(SRCDIR)/BlockGzip.cpp \
 		$(SRCDIR)/ReadWriteReg.cpp \
 		$(SRCDIR)/SynProbRegistration.cpp \
 		$(SRCDIR)/DeformationFields.cpp \
@@ -17,6 +18,7 @@ CPPFILES=$(SRCDIR)/RegOpt.cpp \
 		$(SRCDIR)/SemiLagrangian.cpp \
 		$(SRCDIR)/Optimizer.cpp \
 		$(SRCDIR)/KrylovInterface.cpp \
+		$(SRCDIR)/KrylovRecycler.cpp \
 		$(SRCDIR)/TaoInterface.cpp \
 		$(SRCDIR)/CLAIREInterface.cpp \
 		$(SRCDIR)/MultiLevelPyramid.cpp \
@@ -29,6 +31,7 @@ CPPFILES=$(SRCDIR)/RegOpt.cpp \
 		$(SRCDIR)/RegularizationH2SN.cpp \
 		$(SRCDIR)/RegularizationH3.cpp \
 		$(SRCDIR)/RegularizationH3SN.cpp \
+		$(SRCDIR)/RegularizationVarCoeff.cpp \
 		$(SRCDIR)/OptimizationProblem.cpp \
 		$(SRCDIR)/CLAIREBase.cpp \
 		$(SRCDIR)/CLAIRE.cpp \
@@ -90,6 +90,7 @@ CLAIRE_INC += -I./deps/3rdparty
 
 ifeq ($(USENIFTI),yes)
 	CLAIRE_INC += -I$(NIFTI_DIR)/include/nifti
+	CLAIRE_INC += -I$(ZLIB_DIR)/include
 endif
 
 ifeq ($(USEPNETCDF),yes)
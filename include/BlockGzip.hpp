@@ -0,0 +1,58 @@
+/*************************************************************************
+ *  Copyright (c) 2016.
+ *  All rights reserved.
+ *  This file is part of the CLAIRE library.
+ *
+ *  CLAIRE is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  CLAIRE is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with CLAIRE.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+#ifndef _BLOCKGZIP_HPP_
+#define _BLOCKGZIP_HPP_
+
+#include "CLAIREUtils.hpp"
+
+
+
+
+namespace reg {
+
+
+
+
+/*! block compressed gzip files (bgzf); the data is split into blocks
+    of at most 64KB that are deflated independently and stored as
+    individual gzip members; the size of each member is stored in an
+    extra field of the gzip header; this allows us to (de)compress
+    the blocks with many threads; the files are standard gzip files
+    (readable by gzip, zlib and the nifti library) */
+#ifdef REG_HAS_NIFTI
+/*! check if file is a block compressed gzip file */
+PetscErrorCode IsBlockGzipFile(std::string, bool&);
+
+/*! decompress block compressed gzip file (buffer allocated with new[]) */
+PetscErrorCode ReadBlockGzip(std::string, char**, size_t&);
+
+/*! compress header and data into block compressed gzip file */
+PetscErrorCode WriteBlockGzip(std::string, const char*, size_t, const char*, size_t);
+#endif
+
+
+
+
+}  // namespace reg
+
+
+
+
+#endif  // _BLOCKGZIP_HPP_
@@ -60,6 +60,10 @@ class CLAIRE : public CLAIREBase {
         of lagrangian with respect to control variable(s) */
     PetscErrorCode HessianMatVec(Vec, Vec, bool scale = true);
 
+    /*! compute Hessian matvec for a block of vectors (pde sweeps
+        are shared across the vectors in the block) */
+    PetscErrorCode HessianMatVecBlock(Vec*, Vec*, IntType, bool scale = true);
+
     /*! get state variable */
     PetscErrorCode GetStateVariable(Vec&);
 
@@ -90,6 +94,9 @@ class CLAIRE : public CLAIREBase {
     /*! allocate all the memory we need */
     PetscErrorCode InitializeSolver();
 
+    /*! keep state variable for current velocity (parameter continuation) */
+    PetscErrorCode CheckpointState(void);
+
 
  protected:
     /*! init class variables (called by constructor) */
@@ -113,6 +120,9 @@ class CLAIRE : public CLAIREBase {
     /*! solve state equation */
     virtual PetscErrorCode SolveStateEquation(void);
 
+    /*! solve state equation unless it has been solved for current velocity */
+    PetscErrorCode UpdateStateVariable(bool timehistory = true);
+
     /*! solve incremental state equation */
     virtual PetscErrorCode SolveIncStateEquation(void);
 
@@ -176,6 +186,13 @@ class CLAIRE : public CLAIREBase {
     Vec m_IncStateVariable;     ///< time dependent incremental state variable \tilde{m}(x,t)
     Vec m_IncAdjointVariable;   ///< time dependent incremental adjoint variable \tilde{\lambda}(x,t)
 
+    std::vector<VecField*> m_BlockIncVelocityField;  ///< incremental velocity fields (block hessian matvec)
+    std::vector<VecField*> m_BlockWorkVecField;      ///< work vector fields (block hessian matvec)
+    std::vector<Vec> m_BlockIncStateVariable;        ///< incremental state variables (block hessian matvec)
+    std::vector<Vec> m_BlockIncAdjointVariable;      ///< incremental adjoint variables (block hessian matvec)
+
+    SemiLagrangianType* m_InexactSemiLagrangianMethod;  ///< semi-lagrangian method on coarse time grid (inexact hessian)
+
  private:
     /*! compute the initial guess for the velocity field */
     PetscErrorCode ComputeInitialVelocity(void);
@@ -184,6 +201,15 @@ class CLAIRE : public CLAIREBase {
     PetscErrorCode PrecondHessMatVec(Vec, Vec);
     PetscErrorCode PrecondHessMatVecSym(Vec, Vec);
 
+    /*! block hessian matvec (gauss-newton, semi-lagrangian) */
+    PetscErrorCode BlockHessMatVec(Vec*, Vec*, IntType);
+    PetscErrorCode SolveIncStateEquationSLBlock(IntType);
+    PetscErrorCode SolveIncAdjointEquationGNSLBlock(IntType);
+    PetscErrorCode ClearBlockVariables(void);
+
+    /*! get time grid coarsening and sl method for inexact hessian matvec */
+    PetscErrorCode SetupInexactHessMatVec(IntType&, SemiLagrangianType*&);
+
     PetscErrorCode StoreStateVariable();
 };
 
@@ -40,6 +40,7 @@
 #include "RegularizationH1SN.hpp"
 #include "RegularizationH2SN.hpp"
 #include "RegularizationH3SN.hpp"
+#include "RegularizationVarCoeff.hpp"
 #include "OptimizationProblem.hpp"
 #include "SemiLagrangian.hpp"
 
@@ -77,6 +78,12 @@ class CLAIREBase : public OptimizationProblem {
     /*! set mask (mask objective) */
     PetscErrorCode GetMask(Vec&);
 
+    /*! set spatially varying weight for regularization operator */
+    PetscErrorCode SetRegularizationWeight(Vec);
+
+    /*! get spatially varying weight for regularization operator */
+    PetscErrorCode GetRegularizationWeight(Vec&);
+
     /*! set cell density c (coupled formulation) */
     PetscErrorCode SetCellDensity(Vec);
 
@@ -165,6 +172,9 @@ class CLAIREBase : public OptimizationProblem {
     /*! function that checks bounds in parameter continuation */
     virtual PetscErrorCode CheckBounds(Vec, bool&);
 
+    /*! keep state variable for current velocity (parameter continuation) */
+    virtual PetscErrorCode CheckpointState(void) = 0;
+
     /*! allocate all the memory we need */
     virtual PetscErrorCode InitializeSolver() = 0;
 
@@ -175,6 +185,12 @@ class CLAIREBase : public OptimizationProblem {
     PetscErrorCode CopyToAllTimePoints(Vec, Vec);
     PetscErrorCode IsVelocityZero(void);
 
+    /*! check if state variable has been computed for current velocity */
+    PetscErrorCode IsStateCached(bool&, bool timehistory = true);
+
+    /*! remember velocity the state variable has been computed for */
+    PetscErrorCode CacheState(bool timehistory = true);
+
     virtual PetscErrorCode ClearVariables(void) = 0;
 
     /*! evaluate l2-gradient */
@@ -197,6 +213,7 @@ class CLAIREBase : public OptimizationProblem {
     Vec m_AuxVariable;             ///< auxilary variable
     Vec m_CellDensity;             ///< cell density
     Vec m_Mask;                    ///< mask for objective functional masking
+    Vec m_RegWeight;               ///< spatially varying weight for regularization operator
 
     VecField* m_VelocityField;      ///< data container for velocity field (control variable)
     VecField* m_IncVelocityField;   ///< data container for incremental velocity field (incremental control variable)
@@ -224,6 +241,15 @@ class CLAIREBase : public OptimizationProblem {
     bool m_VelocityIsZero;
     bool m_StoreTimeHistory;
 
+    VecField* m_StateCacheVelocity;  ///< velocity the state variable has been computed for
+    bool m_StateIsCached;            ///< flag: state variable is valid for m_StateCacheVelocity
+    bool m_StateCacheTimeHistory;    ///< flag: cached state variable includes time history
+    bool m_GradientEvaluated;        ///< flag: gradient evaluated since last objective evaluation
+
+    Vec m_StateCheckpoint;                ///< state variable of last accepted solution (parameter continuation)
+    VecField* m_StateCheckpointVelocity;  ///< velocity of last accepted solution (parameter continuation)
+    bool m_StateCheckpointValid;          ///< flag: checkpoint of state variable is valid
+
     ComplexType *m_x1hat;
     ComplexType *m_x2hat;
     ComplexType *m_x3hat;
@@ -57,6 +57,7 @@ class CLAIREInterface {
     PetscErrorCode SetTemplateImage(Vec);
     PetscErrorCode SetAuxVariable(Vec);
     PetscErrorCode SetMask(Vec);
+    PetscErrorCode SetRegularizationWeight(Vec);
     PetscErrorCode SetCellDensity(Vec);
     PetscErrorCode SetReferenceImage(Vec);
     PetscErrorCode SetSolutionVector(VecField*);
@@ -104,10 +105,12 @@ class CLAIREInterface {
 
     MultiLevelPyramid *m_TemplatePyramid;
     MultiLevelPyramid *m_ReferencePyramid;
+    MultiLevelPyramid *m_RegWeightPyramid;
 
     Vec m_TemplateImage;    ///< original template image (not overwritten)
     Vec m_ReferenceImage;   ///< original reference image (not overwritten)
     Vec m_Mask;             ///< mask image
+    Vec m_RegWeight;        ///< spatially varying regularization weight (not deleted)
     VecField* m_Solution;   ///< initial guess
     Vec m_AuxVariable;      ///< auxilariy variable
     Vec m_CellDensity;      ///< cell density
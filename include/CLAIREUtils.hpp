@@ -120,6 +120,12 @@ PetscErrorCode Rescale(Vec, ScalarType, ScalarType, IntType nc = 1);
 /*! normalize field to [0,1] */
 PetscErrorCode Normalize(Vec, IntType nc = 1);
 
+/*! normalize field to [0,1] for given range of each component */
+PetscErrorCode Normalize(Vec, IntType, const ScalarType*, const ScalarType*);
+
+/*! compute range of each component (single reduction) */
+PetscErrorCode ComputeRange(Vec, IntType, ScalarType*, ScalarType*);
+
 /*! clip field to [0,1] */
 PetscErrorCode Clip(Vec, IntType nc = 1);
 
@@ -129,6 +135,11 @@ PetscErrorCode EnsurePartitionOfUnity(Vec, IntType);
 /*! ensure partition of unity */
 PetscErrorCode ComputeBackGround(Vec, Vec, IntType);
 
+/*! eigen decomposition of small dense symmetric matrix (jacobi method) */
+PetscErrorCode SymmetricEigenDecomposition(std::vector<ScalarType>&,
+                                           std::vector<ScalarType>&,
+                                           std::vector<ScalarType>&, int);
+
 PetscErrorCode GetFileName(std::string&, std::string);
 
 PetscErrorCode GetFileName(std::string&, std::string&, std::string&, std::string);
@@ -214,6 +225,19 @@ inline IntType GetLinearIndex(IntType i, IntType j, IntType k, IntType isize[3])
 
 
 
+/********************************************************************
+ * @brief map value to [0,1] given the (global) range [xmin,xmax]
+ * of the data; negative values are set to zero (see Normalize)
+ *******************************************************************/
+inline ScalarType NormalizeValue(ScalarType x, ScalarType xmin, ScalarType xmax) {
+    const ScalarType xlow = xmin > 0.0 ? xmin : 0.0;
+    const ScalarType y = ((x > xlow ? x : xlow) - xlow) / (xmax != 0.0 ? xmax : 1.0);
+    return y < 1.0 ? y : 1.0;
+}
+
+
+
+
 /********************************************************************
  * @brief check wave numbers
  *******************************************************************/
@@ -36,6 +36,7 @@ namespace reg {
 
 // mat vec for two level preconditioner
 PetscErrorCode KrylovMonitor(KSP,PetscInt,PetscReal,void*);
+PetscErrorCode KrylovConvergenceTest(KSP,PetscInt,PetscReal,KSPConvergedReason*,void*);
 PetscErrorCode DispKSPConvReason(KSPConvergedReason);
 
 PetscErrorCode InvertPrecondKrylovMonitor(KSP,PetscInt,PetscReal,void*);
@@ -46,6 +47,8 @@ PetscErrorCode ProjectGradient(KSP,Vec,void*);
 PetscErrorCode PreKrylovSolve(KSP,Vec,Vec,void*);
 PetscErrorCode PostKrylovSolve(KSP,Vec,Vec,void*);
 
+PetscErrorCode UpdateHessMatVecFidelity(RegOpt*,IntType,ScalarType);
+
 
 
 
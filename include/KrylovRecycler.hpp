@@ -0,0 +1,103 @@
+/*************************************************************************
+ *  Copyright (c) 2016.
+ *  All rights reserved.
+ *  This file is part of the CLAIRE library.
+ *
+ *  CLAIRE is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  CLAIRE is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with CLAIRE. If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+#ifndef _KRYLOVRECYCLER_HPP_
+#define _KRYLOVRECYCLER_HPP_
+
+#include "RegOpt.hpp"
+#include "CLAIREUtils.hpp"
+
+
+
+
+namespace reg {
+
+
+
+
+/*! recycling of approximate low eigenmodes of the (reduced space)
+    hessian across krylov solves; the hessian matvecs of a solve are
+    recorded; after the solve we extract ritz vectors from the span of
+    the recorded directions and the current basis; the basis is used
+    to deflate the next solve (initial guess and deflation projector
+    applied after the preconditioner) */
+class KrylovRecycler {
+ public:
+    typedef KrylovRecycler Self;
+
+    KrylovRecycler(void);
+    KrylovRecycler(RegOpt*);
+    virtual ~KrylovRecycler(void);
+
+    /*! delete recycled basis */
+    PetscErrorCode Reset(void);
+
+    /*! rescale recycled basis (regularization weight changed) */
+    PetscErrorCode Rescale(ScalarType);
+
+    /*! set preconditioner wrapped by deflation (takes ownership) */
+    PetscErrorCode SetPreconditioner(PC);
+
+    /*! compute initial guess and start recording matvecs */
+    PetscErrorCode PreSolve(Mat, Vec, Vec);
+
+    /*! apply preconditioner followed by deflation projector */
+    PetscErrorCode ApplyPreconditioner(Vec, Vec);
+
+    /*! record input and output of hessian matvec */
+    PetscErrorCode Record(Vec, Vec);
+
+    /*! stop recording and update recycled basis */
+    PetscErrorCode PostSolve(void);
+
+    /*! hessian changed (newton update accepted); H W is recomputed */
+    inline void SetHessianChanged(void) {this->m_UpdateHW = true;}
+
+    inline IntType GetBasisSize(void) {return static_cast<IntType>(this->m_W.size());}
+
+ private:
+    PetscErrorCode Initialize(void);
+    PetscErrorCode ClearMemory(void);
+    PetscErrorCode ClearVectors(std::vector<Vec>&);
+    PetscErrorCode Project(Vec);
+
+    RegOpt* m_Opt;
+
+    std::vector<Vec> m_W;       ///< recycled basis (approximate eigenvectors)
+    std::vector<Vec> m_HW;      ///< hessian applied to recycled basis
+    std::vector<ScalarType> m_Theta;  ///< ritz values associated with recycled basis
+    std::vector<ScalarType> m_EInv;   ///< (pseudo) inverse of W^T H W
+    PC m_PC;                    ///< preconditioner wrapped by deflation projector
+
+    std::vector<Vec> m_V;       ///< recorded krylov directions
+    std::vector<Vec> m_HV;      ///< hessian applied to recorded directions
+    IntType m_NumRecorded;      ///< number of recorded matvecs in current solve
+    bool m_UpdateHW;            ///< flag: hessian changed since H W has been computed
+    bool m_Recording;           ///< flag: record hessian matvecs
+};
+
+
+
+
+}  // namespace reg
+
+
+
+
+#endif  // _KRYLOVRECYCLER_HPP_
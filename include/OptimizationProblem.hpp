@@ -23,6 +23,7 @@
 #include "RegOpt.hpp"
 #include "CLAIREUtils.hpp"
 #include "VecField.hpp"
+#include "KrylovRecycler.hpp"
 
 
 
@@ -48,6 +49,10 @@ class OptimizationProblem {
     inline std::string GetConvergenceMessage(){return this->m_ConvergenceMessage;}
     inline void IncrementIterations() {this->m_Opt->IncrementCounter(ITERATIONS);}
 
+    /*! krylov recycling (set from outside; not deleted) */
+    inline void SetKrylovRecycler(KrylovRecycler* recycler) {this->m_KrylovRecycler = recycler;}
+    inline KrylovRecycler* GetKrylovRecycler(void) {return this->m_KrylovRecycler;}
+
     /*! evaluate objective, gradient and distance measure for initial guess */
     virtual PetscErrorCode InitializeOptimization() = 0;
 
@@ -63,6 +68,10 @@ class OptimizationProblem {
     /*! apply Hessian matvec H\tilde{\vect{x}} */
     virtual PetscErrorCode HessianMatVec(Vec, Vec, bool scale = true) = 0;
 
+    /*! compute Hessian matvec for a block of vectors (default
+        implementation applies the hessian to one vector at a time) */
+    virtual PetscErrorCode HessianMatVecBlock(Vec*, Vec*, IntType, bool scale = true);
+
     /*! evaluate regularization functional for given control variable */
     virtual PetscErrorCode EvaluateRegularizationFunctional(ScalarType*, VecField*) = 0;
 
@@ -87,6 +96,12 @@ class OptimizationProblem {
     /*! get mask (objective masking) */
     virtual PetscErrorCode GetMask(Vec&) = 0;
 
+    /*! set spatially varying weight for regularization operator */
+    virtual PetscErrorCode SetRegularizationWeight(Vec) = 0;
+
+    /*! get spatially varying weight for regularization operator */
+    virtual PetscErrorCode GetRegularizationWeight(Vec&) = 0;
+
     /*! set reference image */
     virtual PetscErrorCode SetReferenceImage(Vec) = 0;
 
@@ -136,6 +151,7 @@ class OptimizationProblem {
     PetscErrorCode ClearMemory(void);
 
     RegOpt* m_Opt;
+    KrylovRecycler* m_KrylovRecycler;
 
  private:
     Vec m_Iterate;
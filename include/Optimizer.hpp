@@ -47,12 +47,17 @@ class Optimizer {
     PetscErrorCode GetSolution(Vec&);
     PetscErrorCode GetSolutionStatus(bool&);
 
+    /*! set regularization weight for next step of parameter continuation
+        (solver objects, recycled basis and preconditioner are kept) */
+    PetscErrorCode SetRegularizationWeight(ScalarType);
+
     PetscErrorCode Finalize();
 
  private:
     PetscErrorCode Initialize(void);
     PetscErrorCode ClearMemory(void);
     PetscErrorCode SetupTao(void);
+    PetscErrorCode SetupInitialHessian(void);
     PetscErrorCode SetInitialGuess(void);
 
     RegOpt* m_Opt;
@@ -66,6 +71,8 @@ class Optimizer {
     Preprocessing* m_PreProc;
     Mat m_MatVec;
     Vec m_Solution; ///< solution vector
+    KrylovRecycler* m_KrylovRecycler;  ///< recycled basis across krylov solves
+    bool m_KeepPrecond;                ///< flag: do not reset preconditioner in next run (parameter continuation)
 };
 
 
@@ -59,6 +59,9 @@ class Preconditioner {
     /*! setup preconditioner */
     PetscErrorCode Reset();
 
+    /*! update preconditioner for new regularization weight */
+    PetscErrorCode Rescale(ScalarType);
+
     /*! apply preconditioner */
     PetscErrorCode MatVec(Vec, Vec);
 
@@ -86,12 +89,37 @@ class Preconditioner {
     /*! setup krylov method for estimating eigenvalues */
     PetscErrorCode SetupKrylovMethodEigEst();
 
+    /*! set interval of chebyshev method */
+    PetscErrorCode SetChebyshevEigenValues(ScalarType, ScalarType);
+
+    /*! update/check cached eigenvalue estimates after chebyshev solve */
+    PetscErrorCode CheckEigValCache(Vec);
+
     /*! apply inverse regularization operator as preconditioner */
     PetscErrorCode ApplySpectralPrecond(Vec, Vec);
 
     /*! apply 2Level PC as preconditioner */
     PetscErrorCode Apply2LevelPrecond(Vec, Vec);
 
+    /*! setup low-rank preconditioner (randomized eigendecomposition) */
+    PetscErrorCode SetupLowRankPrecond();
+    PetscErrorCode ComputeLowRankBasis(std::vector<Vec>&, std::vector<ScalarType>&, bool);
+
+    /*! apply low-rank PC as preconditioner */
+    PetscErrorCode ApplyLowRankPrecond(Vec, Vec);
+
+    /*! clear basis of low-rank preconditioner */
+    PetscErrorCode ClearLowRankBasis();
+
+    /*! setup grid hierarchy below coarse grid (multilevel preconditioner) */
+    PetscErrorCode SetupMultiLevel();
+
+    /*! restrict state, adjoint, and control variable down the grid hierarchy */
+    PetscErrorCode ApplyMultiLevelRestriction();
+
+    /*! apply multilevel cycle on a given level (input x, output y) */
+    PetscErrorCode ApplyCycle(int);
+
     struct CoarseGrid {
         RegOpt* m_Opt;                        ///< registration options (on coarse grid)
         OptProbType* m_OptimizationProblem;   ///< pointer to optimization problem (on coarse level)
@@ -101,10 +129,15 @@ class Preconditioner {
         Vec m_AdjointVariable;                ///< pointer to adjoint variable (on coarse level)
         Vec m_ReferenceImage;                 ///< pointer to adjoint variable (on coarse level)
         Vec m_Mask;                           ///< on coarse level
+        Vec m_RegWeight;                      ///< regularization weight (on coarse level)
         VecField* m_ControlVariable;          ///< pointer to velocity field (on coarse level)
         VecField* m_IncControlVariable;       ///< pointer to velocity field (on coarse level)
         Vec m_WorkScaField1;                  ///< temporary scalar field
         Vec m_WorkScaField2;                  ///< temprary scalar field
+        Vec r;                                ///< residual (multilevel preconditioner)
+        Vec z;                                ///< hessian mat vec (multilevel preconditioner)
+        VecField* m_WorkVecField;             ///< temporary vector field (multilevel preconditioner)
+        Preprocessing* m_PreProc;             ///< frequency filters on this level (multilevel preconditioner)
 
         inline IntType nl(){return this->m_Opt->m_Domain.nl;};
         inline IntType ng(){return this->m_Opt->m_Domain.ng;};
@@ -112,6 +145,18 @@ class Preconditioner {
     };
 
     CoarseGrid* m_CoarseGrid;
+    std::vector<CoarseGrid*> m_MultiLevel;  ///< grids below coarse grid (multilevel preconditioner)
+
+    /*! init and clear coarse grid data */
+    PetscErrorCode InitCoarseGrid(CoarseGrid*);
+    PetscErrorCode ClearCoarseGrid(CoarseGrid*, bool writelog = true);
+
+    /*! residual r = x - H y and smoothing on a level of the hierarchy */
+    PetscErrorCode ComputeResidual(CoarseGrid*, bool zeroguess = false);
+    PetscErrorCode ApplySmoother(CoarseGrid*, ScalarType, int, bool zeroguess = false);
+
+    /*! get level l of grid hierarchy (l = 1 is the coarse grid) */
+    inline CoarseGrid* GetLevel(int l) {return l == 1 ? this->m_CoarseGrid : this->m_MultiLevel[l-2];};
 
     RegOpt* m_Opt;                          ///< registration options
     OptProbType* m_OptimizationProblem;     ///< pointer to optimization problem
@@ -120,6 +165,7 @@ class Preconditioner {
     VecField* m_IncControlVariable;         ///< pointer to velocity field
 
     Vec m_Mask;                             ///< mask (objective masking)
+    Vec m_RegWeight;                        ///< spatially varying regularization weight
     Vec m_ReferenceImage;                   ///< reference image
     Vec m_WorkScaField1;                    ///< temporary scalar field
     Vec m_WorkScaField2;                    ///< temprary scalar field
@@ -134,6 +180,13 @@ class Preconditioner {
     PetscRandom m_RandomNumGen;             ///< random number generated
     KSP m_KrylovMethodEigEst;
 
+    std::vector<Vec> m_LowRankBasis;        ///< dominant eigenvectors of preconditioned hessian (low-rank pc)
+    std::vector<ScalarType> m_LowRankEigVals;   ///< associated eigenvalues (data term only)
+    int m_LowRankAge;                       ///< newton iterations the low-rank pc has been used (-1: invalid)
+
+    bool m_ReadEigVals;                     ///< read back eigenvalue estimates of petsc after chebyshev solve
+    bool m_UseCachedEigVals;                ///< chebyshev method uses cached eigenvalue estimates
+
 };
 
 
@@ -23,6 +23,7 @@
 #include "RegOpt.hpp"
 #include "CLAIREUtils.hpp"
 #include "ReadWriteReg.hpp"
+#include <map>
 
 
 
@@ -31,29 +32,33 @@ namespace reg {
 
 
 
-struct GridData {
-    ComplexType* xhat;
-    ComplexType* yhat;
-    std::vector< std::vector<IntType> > idx;
-    ScalarType* datasend;
-    ScalarType* datarecv;
-    IntType* idxsend;
-    IntType* idxrecv;
-    //accfft_plan* fftplan;
-    accfft_plan_t<ScalarType, ComplexType, FFTWPlanType>* fftplan;  ///< accfft plan
-
-    IntType nx[3];
-    IntType osize[3];
-    IntType ostart[3];
+/* fft plan and spectral buffer for a given grid size
+ * (used by grid change operators); on the grid of m_Opt
+ * we use the plan of m_Opt */
+struct GridChangeFFT {
+    accfft_plan_t<ScalarType, ComplexType, FFTWPlanType>* plan;  ///< accfft plan
+    bool shared;        ///< flag: plan is the plan of m_Opt (not owned)
+    IntType nalloc;     ///< allocation size for spectral coefficients (leased from RegOpt)
+    IntType nx[3];      ///< grid size
+    IntType osize[3];   ///< size of grid in fourier domain for mpi proc
+    IntType ostart[3];  ///< start index in fourier domain for mpi proc
+    ScalarType scale;   ///< scale for fft
+};
 
-    IntType *nsend;
-    IntType *nrecv;
-    IntType *offsetsend;
-    IntType *offsetrecv;
 
-    ScalarType scale;
-    MPI_Request *sendrequest;
-    MPI_Request *recvrequest;
+/* spectral restriction/prolongation operator between a fine and
+ * a coarse grid; the fourier coefficients are exchanged with a
+ * neighborhood collective; the derived data types index directly
+ * into the spectral buffers of the fine and coarse grid */
+struct GridChangeOp {
+    GridChangeFFT* fine;    ///< fft plan on fine grid
+    GridChangeFFT* coarse;  ///< fft plan on coarse grid
+    MPI_Comm comm;          ///< graph communicator (neighbors that exchange coefficients)
+    std::vector<MPI_Datatype> typefine;    ///< coefficients on fine grid (per neighbor)
+    std::vector<MPI_Datatype> typecoarse;  ///< coefficients on coarse grid (per neighbor)
+    std::vector<int> count;                ///< number of elements (per neighbor)
+    std::vector<MPI_Aint> displ;           ///< displacements (per neighbor)
+    IntType lastuse;                       ///< time stamp of last use (cache eviction)
 };
 
 
@@ -77,8 +82,7 @@ class Preprocessing {
     PetscErrorCode Restrict(Vec*, Vec, IntType*, IntType*);
     PetscErrorCode Restrict(VecField*, VecField*, IntType*, IntType*);
 
-    inline void ResetGridChangeOps(bool flag){this->m_ResetGridChangeOps = flag;};
-    PetscErrorCode ComputeGridChangeIndices(IntType*, IntType*);
+    PetscErrorCode ClearGridChangeOps();
 
     PetscErrorCode Labels2MultiCompImage(Vec, Vec);
     PetscErrorCode MultiCompImage2Labels(Vec, Vec);
@@ -88,64 +92,31 @@ class Preprocessing {
     PetscErrorCode Initialize();
 
     PetscErrorCode GaussianSmoothing(Vec, Vec, IntType);
+    PetscErrorCode GaussianSmoothingStencil(Vec, Vec, IntType);
+    PetscErrorCode SetupSmoothingStencil(bool&);
     PetscErrorCode LaplacianSmoothing(Vec, Vec, IntType);
 
-    PetscErrorCode GridChangeCommDataRestrict();
-    PetscErrorCode GridChangeCommDataProlong();
-    PetscErrorCode GridChangeCommIndices();
-    PetscErrorCode SetupGridChangeOps(IntType*, IntType*);
+    PetscErrorCode GetGridChangeOp(GridChangeOp**, IntType*, IntType*);
+    PetscErrorCode GetGridChangeFFT(GridChangeFFT**, IntType*);
+    PetscErrorCode SetupGridChangeOp(GridChangeOp*);
+    PetscErrorCode CreateGridChangeType(MPI_Datatype*, std::vector<int>*, IntType*, MPI_Datatype);
+    PetscErrorCode EvictGridChangeOps(size_t);
+    PetscErrorCode FreeGridChangeOp(GridChangeOp*);
+    PetscErrorCode FreeGridChangeFFT(GridChangeFFT*, bool);
 
     RegOpt* m_Opt;
-    ComplexType* m_xhat;
-    ComplexType* m_yhat;
+    ComplexType* m_xhat;  ///< spectral data (leased from m_Opt)
     ReadWriteType* m_ReadWrite;
 
-    std::vector< std::vector<IntType> > m_IndicesF;
-    std::vector< std::vector<IntType> > m_IndicesC;
-
-    ScalarType* m_FourierCoeffSendF;
-    ScalarType* m_FourierCoeffSendC;
-    ScalarType* m_FourierCoeffRecvF;
-    ScalarType* m_FourierCoeffRecvC;
-
-    IntType* m_FourierIndicesSendF;
-    IntType* m_FourierIndicesSendC;
-    IntType* m_FourierIndicesRecvF;
-    IntType* m_FourierIndicesRecvC;
-
-    accfft_plan_t<ScalarType, ComplexType, FFTWPlanType>* m_FFTFinePlan;  ///< accfft plan
-    accfft_plan_t<ScalarType, ComplexType, FFTWPlanType>* m_FFTCoarsePlan;  ///< accfft plan
-    //accfft_plan* m_FFTFinePlan;
-    //accfft_plan* m_FFTCoarsePlan;
-
-    ComplexType* m_XHatFine;
-    ComplexType* m_XHatCoarse;
-
-    IntType m_nxC[3];
-    IntType m_nxF[3];
-    IntType m_osizeC[3];
-    IntType m_osizeF[3];
-    IntType m_ostartC[3];
-    IntType m_ostartF[3];
-
-/*  IntType *m_NumSend;
-    IntType *m_NumRecv; */
-    IntType *m_NumSend;
-    IntType *m_NumRecv;
-    IntType *m_OffsetSend;
-    IntType *m_OffsetRecv;
-    IntType m_nAllocSend;
-    IntType m_nAllocRecv;
-
-    ScalarType m_FFTFineScale;
-    ScalarType m_FFTCoarseScale;
-    MPI_Request *m_SendRequest;
-    MPI_Request *m_RecvRequest;
-
-    bool m_GridChangeOpsSet;
-    bool m_ResetGridChangeOps;
-    bool m_IndicesCommunicated;
-    bool m_GridChangeIndicesComputed;
+    ScalarType* m_GhostData;   ///< scalar field padded with ghost points (real space smoothing)
+    ScalarType* m_GhostWork;   ///< work buffer for separable real space smoothing
+    IntType m_nAllocGhost;     ///< allocation size for ghost buffers (in bytes)
+    int m_SmoothRadius[3];     ///< radius of smoothing stencil (in grid points)
+    std::vector<ScalarType> m_SmoothKernel[3];  ///< 1d gaussian kernels
+
+    std::map<std::vector<IntType>, GridChangeFFT*> m_GridChangeFFT;  ///< fft plans (key: grid size)
+    std::map<std::vector<IntType>, GridChangeOp*> m_GridChangeOps;   ///< grid change operators (key: fine and coarse grid size)
+    IntType m_GridChangeStamp;  ///< counter for uses of grid change operators
 
 //    int *m_LabelValues;
 //    int m_NoLabel;
@@ -29,6 +29,12 @@
 #include "pnetcdf.h"
 #endif
 
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <sys/types.h>
+
 #include "RegOpt.hpp"
 #include "VecField.hpp"
 
@@ -76,6 +82,9 @@ class ReadWriteReg {
     PetscErrorCode Read(Vec*, std::string);
     PetscErrorCode Read(VecField*, std::string, std::string, std::string);
 
+    /*! read all components of vector field from container (*.cvel) */
+    PetscErrorCode Read(VecField*, std::string);
+
     /*! write reference image */
     PetscErrorCode WriteR(Vec, std::string, bool multicomponent = false);
 
@@ -85,6 +94,17 @@ class ReadWriteReg {
     PetscErrorCode Write(Vec, std::string, bool multicomponent = false);
     PetscErrorCode Write(VecField*, std::string);
 
+    /*! write records j0,...,j0+nr-1 of time series to a single file
+        (netcdf; the file is created for j0 = 0) */
+    PetscErrorCode WriteTimeSeries(Vec, std::string, IntType, IntType j0 = 0);
+    PetscErrorCode WriteTimeSeries(VecField*, std::string, IntType j0 = 0);
+
+    /*! resample image in z-slabs (bounded memory; uncompressed nifti) */
+    PetscErrorCode Resample(std::string, std::string, IntType*, ScalarType scale = -1.0);
+
+    /*! wait until all asynchronous output has been written */
+    PetscErrorCode Flush();
+
  private:
     PetscErrorCode Initialize();
     PetscErrorCode ClearMemory();
@@ -97,11 +117,21 @@ class ReadWriteReg {
 #ifdef REG_HAS_PNETCDF
     PetscErrorCode ReadNC(Vec*);
     PetscErrorCode WriteNC(Vec);
+    PetscErrorCode WriteTimeSeriesNC(Vec, IntType, IntType);
 #endif
 
+    PetscErrorCode GetIOHints(MPI_Info*);
+
     PetscErrorCode ReadBIN(Vec*);
     PetscErrorCode WriteBIN(Vec);
 
+    PetscErrorCode ReadRAW(Vec*);
+    PetscErrorCode WriteRAW(Vec);
+
+    PetscErrorCode ReadCVEL(VecField*);
+    PetscErrorCode WriteCVEL(VecField*);
+    PetscErrorCode GetCoefficientBlock(IntType*, std::vector<IntType>&, std::vector<int>&, std::vector<int>&);
+
     PetscErrorCode ReadNetCDF(Vec);
     PetscErrorCode ReadTimeSeriesNetCDF(Vec);
     PetscErrorCode ReadBlockNetCDF(Vec, int*);
@@ -112,15 +142,45 @@ class ReadWriteReg {
 
     PetscErrorCode CollectSizes();
 
+    /*! store intensity range of components read from file */
+    PetscErrorCode AddIntensityRange(std::vector<ScalarType>&, bool);
+
+    /*! rescale components that have not been rescaled while reading */
+    PetscErrorCode ApplyNormalization(Vec, ScalarType&, ScalarType&);
+
+    /*! snapshot of local data written by background thread; the data
+        consists of segments of equal length written at the given
+        offsets of an existing file */
+    struct AsyncWriteJob {
+        std::string filename;
+        std::vector<char> data;
+        std::vector<off_t> offset;
+        size_t seglength;
+    };
+
+    PetscErrorCode EnqueueWrite(AsyncWriteJob*);
+    PetscErrorCode FlushPending(std::string);
+    PetscErrorCode StopAsyncWriter();
+    void AsyncWriter();
+
 #ifdef REG_HAS_NIFTI
+    PetscErrorCode ReadNIIHeader(nifti_image**, std::string);
+    PetscErrorCode FreeNIIHeader(nifti_image**);
+    bool IsParallelReadable(nifti_image*);
     PetscErrorCode ReadNII(Vec*);
+    PetscErrorCode ReadNII(Vec*, std::vector<std::string>);
     PetscErrorCode ReadNII(VecField*);
-    PetscErrorCode ReadNII(nifti_image*);
-    template <typename T> PetscErrorCode ReadNII(nifti_image*);
+    PetscErrorCode ReadNII(nifti_image*, ScalarType*);
+    template <typename T> PetscErrorCode ReadNII(nifti_image*, ScalarType*);
+    PetscErrorCode ReadNIIParallel(nifti_image*, Vec, ScalarType*);
+    template <typename T> PetscErrorCode ReadNIIParallel(nifti_image*, Vec, MPI_Datatype, ScalarType*);
 
     PetscErrorCode WriteNII(Vec);
     PetscErrorCode WriteNII(nifti_image**);
     template <typename T> PetscErrorCode WriteNII(nifti_image**, Vec);
+    template <typename T> PetscErrorCode WriteNIIParallel(Vec, MPI_Offset);
+    template <typename T> PetscErrorCode WriteNIIAsync(Vec, MPI_Offset);
+    PetscErrorCode WriteNIIBlockGzip(nifti_image*);
 
     PetscErrorCode GetComponentType(nifti_image*, DataType&);;
     PetscErrorCode AllocateImage(nifti_image**, Vec);
@@ -141,7 +201,19 @@ class ReadWriteReg {
     ScalarType* m_Data;
     IntType m_nx[3];
 
+    bool m_NormalizeOnRead;                     ///< rescale intensities to [0,1] when reading nifti images
+    std::vector<ScalarType> m_IntensityMin;     ///< intensity range of components read from file
+    std::vector<ScalarType> m_IntensityMax;
+
     std::string m_FileName;
+
+    std::thread m_AsyncThread;                  ///< background thread for output
+    std::mutex m_AsyncMutex;                    ///< protects queue
+    std::condition_variable m_AsyncCondition;   ///< signals changes of queue
+    std::deque<AsyncWriteJob*> m_AsyncQueue;    ///< pending output (front is being written)
+    size_t m_AsyncBytes;                        ///< memory of pending output
+    int m_AsyncErrors;                          ///< number of failed writes
+    bool m_AsyncStop;                           ///< flag: stop background thread
 };
 
 
@@ -20,6 +20,8 @@
 #ifndef _REGOPT_H_
 #define _REGOPT_H_
 
+#include <map>
+
 // local includes
 #include "CLAIREUtils.hpp"
 
@@ -69,6 +71,15 @@ enum DMType {
 
 
 
+// flags for gaussian smoothing of image data
+enum SmoothType {
+    AUTOSMOOTH,      ///< select filter based on width of kernel
+    SPECTRALSMOOTH,  ///< apply filter in spectral domain (FFT)
+    STENCILSMOOTH,   ///< apply filter as separable stencil in real space
+};
+
+
+
 enum ParaContType {
     PCONTOFF,
     PCONTBINSEARCH,
@@ -112,6 +123,7 @@ enum OptMeth {
     GAUSSNEWTON,  ///< Gauss-Newton approximation
     FULLNEWTON,   ///< full Newton
     GRADDESCENT,  ///< gradient descent (gradient in sobolev space)
+    QUASINEWTON,  ///< limited memory BFGS (initial hessian: regularization operator)
 };
 
 
@@ -119,6 +131,8 @@ enum OptMeth {
 enum PrecondMeth {
     INVREG,    ///< inverse regularization operator
     TWOLEVEL,  ///< 2 level preconditioner
+    LOWRANK,   ///< low-rank (randomized eigendecomposition) preconditioner
+    MULTILEVEL,  ///< multilevel (v-/w-cycle) preconditioner
     NOPC,      ///< no preconditioner
 };
 
@@ -138,6 +152,7 @@ enum KrylovMethodType {
     CHEB,    ///< chebyshev method
     GMRES,   ///< gmres
     FGMRES,  ///< flexible gmres
+    PIPECG,  ///< pipelined cg (overlaps global reductions with matvecs)
 };
 
 
@@ -228,9 +243,21 @@ enum StopCondType{
 };
 
 
+/*! encoding of velocity field container (*.cvel) */
+enum VelEncodingType {
+    VELNONE,        ///< write components to separate files (no container)
+    VELFULL,        ///< full precision
+    VELSPECTRAL,    ///< band-limited (fourier coefficients below cutoff)
+    VELQUANTIZED,   ///< quantized with error bound
+};
+
+
 struct ReadWriteFlags {
     bool readfiles;           ///< internal flag to indicate that we read files
     bool readvelocity;        ///< internal flag to indicate that we read velocities
+    bool rescaleonread;       ///< rescale reference and template image to [0,1] when they are read (see applyrescaling)
+    bool normalizedref;       ///< internal flag to indicate that reference image has been rescaled to [0,1] when it was read
+    bool normalizedtemp;      ///< internal flag to indicate that template image has been rescaled to [0,1] when it was read
     bool timeseries;          ///< write time series to file (debug only; creates a lot of output)
     bool iterates;            ///< write iterates to file
     bool defgrad;             ///< write deformation gradient to file
@@ -244,6 +271,13 @@ struct ReadWriteFlags {
     bool deftemplate;         ///< write deformed/transported template
     bool deffield;            ///< write deformation field (displacement field)
     bool velocity;            ///< write velocity field
+    bool asyncio;             ///< write output asynchronously (background thread)
+    IntType asynciomem;       ///< bound for memory of pending asynchronous output (in MB)
+    IntType iostripes;        ///< number of stripes (storage targets) for parallel output (0: file system default)
+    IntType iostripesize;     ///< stripe size for parallel output (in MB; 0: file system default)
+    VelEncodingType velencoding;  ///< write velocity field to a single container (*.cvel)
+    ScalarType velcutoff;     ///< cutoff frequency for band-limited velocity (fraction of nyquist frequency)
+    ScalarType veltolerance;  ///< error bound for quantized velocity (relative to max abs value of component)
 };
 
 
@@ -259,6 +293,7 @@ struct FileNames {
     std::vector < std::string > mt;     ///< template image file name
     std::vector < std::string > mr;     ///< reference image file name
     std::string mask;                   ///< mask for objective
+    std::string regweight;              ///< spatially varying weight for regularization operator
     std::string isc;                    ///< filename for input scalar field
     std::string xsc;                    ///< filename for output scalar field
     std::string extension;              ///< identifier for file extension
@@ -327,8 +362,24 @@ struct KrylovMethod {
     int reesteigvals;               ///< flag to reestimate eigenvalues every Krylov(i=1)- or Newton(i=2)-iteration (default: 0)
     bool monitorpcsolver;           ///< flag to monitor PC solver
     bool eigvalsestimated;          ///< flag if eigenvalues have already been estimated
+    ScalarType eigvals[2];          ///< cached estimates for extremal eigenvalues (min, max) of (coarse grid) hessian in preconditioner
+    ScalarType eigvalsbeta;         ///< regularization weight for cached eigenvalue estimates (<= 0: cache is empty)
     bool checkhesssymmetry;         ///< check symmetry of hessian operator
     ScalarType hessshift;           ///< perturbation to hessian operator
+    IntType nrecycle;               ///< number of approximate eigenvectors recycled across krylov solves (0: off)
+    IntType lrrank;                 ///< rank of low-rank preconditioner
+    IntType lroversample;           ///< oversampling for randomized range finder (low-rank preconditioner)
+    IntType lrreuse;                ///< number of newton iterations the low-rank preconditioner is reused
+    int mglevels;                   ///< number of grids in multilevel preconditioner (including fine grid)
+    int mgcycle;                    ///< number of coarse grid corrections per level (1: v-cycle; 2: w-cycle)
+    int mgsmooth;                   ///< number of pre- and post-smoothing steps (multilevel preconditioner)
+    ScalarType mgcoarsetol;         ///< relative tolerance for solve on coarsest grid (multilevel preconditioner)
+    int hessblocksize;              ///< max number of vectors processed at once in block hessian matvec
+    int hessmaxstride;              ///< max coarsening factor for time step in inexact hessian matvecs (1: exact)
+    int hessstride;                 ///< current coarsening factor for time step in hessian matvec
+    ScalarType r0norm;              ///< initial residual norm of current krylov solve
+    ScalarType rnorm0;              ///< initial residual norm in convergence test (inexact hessian)
+    ScalarType rtargetnorm;         ///< target for recursive residual after a failed true residual check (<= 0: none)
 };
 
 
@@ -400,6 +451,8 @@ struct Monitor {
 struct RegNorm {
     ScalarType beta[4];  ///< regularization parameter
     RegNormType type;    ///< flag for regularization norm
+    ScalarType pcgtol;   ///< tolerance for inversion of variable coefficient operator
+    IntType pcgmaxit;    ///< max number of iterations for inversion of variable coefficient operator
 };
 
 
@@ -420,6 +473,10 @@ struct FourierTransform {
     IntType nalloc;     ///< size for allocation in fourier domain
     IntType osize[3];   ///< size of grid in fourier domain for mpi proc
     IntType ostart[3];  ///< start index in fourier domain for mpi proc
+    bool usewisdom;     ///< flag: import/export fftw wisdom (plans) from/to file
+    std::string wisdompath;  ///< path (prefix) for fftw wisdom files
+    std::map<IntType, std::vector<ComplexType*> > workspace;  ///< spectral work arrays that are not leased (one pool per allocation size)
+    std::map<ComplexType*, IntType> leases;                   ///< leased spectral work arrays and their allocation size
 };
 
 
@@ -569,6 +626,17 @@ class RegOpt {
     PetscErrorCode EnableFastSolve();
     PetscErrorCode ResetDM(DMType type);
 
+    /* persistent fftw plans (wisdom) */
+    PetscErrorCode ImportFFTWisdom(int*);
+    PetscErrorCode ExportFFTWisdom(int*);
+
+    /* spectral work arrays (owned by this class; leased and released) */
+    PetscErrorCode GetSpectralWorkspace(ComplexType**);
+    PetscErrorCode GetSpectralWorkspace(ComplexType**, IntType);
+    PetscErrorCode ReleaseSpectralWorkspace(ComplexType**);
+    PetscErrorCode ClearSpectralWorkspace(IntType);
+    PetscErrorCode ClearSpectralWorkspace();
+
     RegModel m_RegModel {};              ///< flag for particular registration model
     Domain m_Domain {};                  ///< parameters for spatial domain
     GridCont m_GridCont {};              ///< flags for grid continuation
@@ -587,6 +655,7 @@ class RegOpt {
     FileNames m_FileNames {};            ///< file names for input/output
     Logger m_Log {};                     ///< log
     ScalarType m_Sigma[3];               ///< standard deviation for gaussian smoothing
+    SmoothType m_SmoothType;             ///< method to apply gaussian smoothing
 
     bool m_SetupDone;
     bool m_StoreCheckPoints;
@@ -617,6 +686,7 @@ class RegOpt {
     PetscErrorCode WriteKSPLog();
     PetscErrorCode WriteConvergenceLog();
     PetscErrorCode WriteFinalResidualLog();
+    PetscErrorCode GetFFTWisdomFileName(std::string&, int*);
 
     enum TimerValue {LOG = 0, MIN, MAX, AVG, NVALTYPES};
 
@@ -31,6 +31,7 @@ namespace reg {
 struct ResamplingPara {
     ScalarType gridscale;
     IntType nx[3];
+    bool streamed;              ///< resample in z-slabs (bounded memory; input is not held in memory)
 };
 
 
@@ -0,0 +1,87 @@
+/*************************************************************************
+ *  Copyright (c) 2016.
+ *  All rights reserved.
+ *  This file is part of the CLAIRE library.
+ *
+ *  CLAIRE is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  CLAIRE is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with CLAIRE. If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+#ifndef _REGULARIZATIONVARCOEFF_H_
+#define _REGULARIZATIONVARCOEFF_H_
+
+#include "Regularization.hpp"
+
+
+
+
+namespace reg {
+
+
+
+
+/*! H1-type regularization with spatially varying weight w(x), i.e.,
+    A[v] = beta_0 (-div(w grad v) + beta_1 v); the operator is applied
+    matrix free (spectral derivatives, pointwise weight) and inverted
+    with a PCG method preconditioned by the constant coefficient
+    (spectral) inverse */
+class RegularizationVarCoeff : public Regularization {
+ public:
+    typedef Regularization SuperClass;
+    typedef RegularizationVarCoeff Self;
+
+    RegularizationVarCoeff(void);
+    RegularizationVarCoeff(RegOpt*);
+    ~RegularizationVarCoeff(void);
+
+    /*! set spatially varying weight (not deleted) */
+    PetscErrorCode SetWeight(Vec);
+
+    /*! set constant coefficient operator (used as preconditioner; deleted) */
+    PetscErrorCode SetPreconditioner(Regularization*);
+
+    virtual PetscErrorCode EvaluateFunctional(ScalarType*, VecField*);
+    virtual PetscErrorCode EvaluateGradient(VecField*, VecField*);
+    virtual PetscErrorCode HessianMatVec(VecField*, VecField*);
+    virtual PetscErrorCode ApplyInverse(VecField*, VecField*, bool applysqrt = false);
+    virtual PetscErrorCode GetExtremeEigValsInvOp(ScalarType&, ScalarType&);
+
+ protected:
+    PetscErrorCode Initialize(void);
+    PetscErrorCode ClearMemory(void);
+
+    /*! apply operator beta_0 (-div(w grad v) + beta_1 v) */
+    PetscErrorCode ApplyOperator(VecField*, VecField*, bool addnullspace = false);
+
+    /*! inner product of two vector fields */
+    PetscErrorCode InnerProduct(ScalarType&, VecField*, VecField*);
+
+    Regularization* m_ConstCoeffReg;  ///< constant coefficient operator (preconditioner)
+    Vec m_Weight;                     ///< spatially varying weight
+
+    VecField* m_GradV;  ///< gradient of individual component of v
+    VecField* m_PCGr;   ///< residual for pcg
+    VecField* m_PCGz;   ///< preconditioned residual for pcg
+    VecField* m_PCGp;   ///< search direction for pcg
+    VecField* m_PCGq;   ///< operator applied to search direction
+};
+
+
+
+
+}  // end of namespace
+
+
+
+
+#endif
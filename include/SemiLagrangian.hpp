@@ -56,6 +56,9 @@ class SemiLagrangian {
                                        ScalarType*, ScalarType*, ScalarType*,
                                        std::string);
 
+    /*! interpolate a block of scalar fields (one communication per block) */
+    virtual PetscErrorCode Interpolate(ScalarType**, ScalarType**, int, std::string);
+
     /*! set coordinate vector */
     PetscErrorCode SetQueryPoints(ScalarType*, ScalarType*, ScalarType*, std::string);
 
@@ -64,6 +67,9 @@ class SemiLagrangian {
     PetscErrorCode SetReadWrite(ReadWriteReg*);
     PetscErrorCode SetWorkVecField(VecField*);
 
+    /*! set scale for time step of trajectory (coarse time grid) */
+    PetscErrorCode SetTimeStepScale(ScalarType);
+
  protected:
     PetscErrorCode Initialize();
     PetscErrorCode ClearMemory();
@@ -71,6 +77,7 @@ class SemiLagrangian {
     virtual PetscErrorCode CommunicateCoord(std::string);
     PetscErrorCode ComputeTrajectoryRK2(VecField*, std::string);
     PetscErrorCode ComputeTrajectoryRK4(VecField*, std::string);
+    PetscErrorCode IsTrajectoryCached(bool&, VecField*, int);
 
     RegOpt* m_Opt;
 
@@ -81,10 +88,16 @@ class SemiLagrangian {
     Interp3_Plan* m_StatePlan;
 
     ScalarType* m_X;
+    ScalarType* m_XBlock;
     ScalarType* m_ScaFieldGhost;
     ScalarType* m_VecFieldGhost;
+    ScalarType* m_BlockFieldGhost;
+
+    ScalarType m_TimeStepScale; ///< scale for time step used to compute trajectory
 
-    int m_Dofs[2];
+    VecField* m_TrajectoryVelocity; ///< velocity the cached characteristics were computed for
+    bool m_TrajectoryIsCached[2];   ///< characteristic is valid (0: state, 1: adjoint)
+    std::vector<int> m_Dofs;    ///< number of dofs for each version of interpolation plan
 
     struct GhostPoints {
         int isize[3];
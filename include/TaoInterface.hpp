@@ -43,6 +43,8 @@ PetscErrorCode ConstructHessian(Tao, Vec, Mat*, Mat*, MatStructure*, void*);
 PetscErrorCode EvaluateHessian(Tao, Vec, Mat, Mat, void*);
 PetscErrorCode HessianMatVec(Mat, Vec, Vec);
 PetscErrorCode PrecondMatVec(PC, Vec, Vec);
+PetscErrorCode DeflatedPrecondMatVec(PC, Vec, Vec);
+PetscErrorCode InitialHessianMatVec(PC, Vec, Vec);
 
 PetscErrorCode CheckConvergenceGrad(Tao, void*);
 PetscErrorCode CheckConvergenceGradObj(Tao, void*);
@@ -0,0 +1,357 @@
+/*************************************************************************
+ *  Copyright (c) 2016.
+ *  All rights reserved.
+ *  This file is part of the CLAIRE library.
+ *
+ *  CLAIRE is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  CLAIRE is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with CLAIRE.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+#ifndef _BLOCKGZIP_CPP_
+#define _BLOCKGZIP_CPP_
+
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include "BlockGzip.hpp"
+
+#ifdef REG_HAS_NIFTI
+#include "zlib.h"
+#endif
+
+
+
+
+namespace reg {
+
+
+
+
+#ifdef REG_HAS_NIFTI
+
+// maximal size of a compressed block (including header and footer)
+static const size_t BGZFMaxBlockSize = 65536;
+
+// maximal size of uncompressed data per block (guarantees that the
+// deflated data fits into a block)
+static const size_t BGZFMaxInputSize = 65280;
+
+// size of header (with bgzf extra field) and footer (crc32 and isize)
+static const size_t BGZFHeaderSize = 18;
+static const size_t BGZFFooterSize = 8;
+
+// empty block that marks the end of the file
+static const unsigned char BGZFEOFBlock[28] = {
+    0x1f, 0x8b, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff,
+    0x06, 0x00, 0x42, 0x43, 0x02, 0x00, 0x1b, 0x00, 0x03, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+
+
+
+
+/********************************************************************
+ * @brief read little endian integers from byte buffer
+ *******************************************************************/
+static inline size_t GetUInt16(const unsigned char* p) {
+    return static_cast<size_t>(p[0]) | (static_cast<size_t>(p[1]) << 8);
+}
+static inline size_t GetUInt32(const unsigned char* p) {
+    return  static_cast<size_t>(p[0])        | (static_cast<size_t>(p[1]) << 8)
+         | (static_cast<size_t>(p[2]) << 16) | (static_cast<size_t>(p[3]) << 24);
+}
+static inline void SetUInt32(unsigned char* p, size_t v) {
+    p[0] = static_cast<unsigned char>(v & 0xff);
+    p[1] = static_cast<unsigned char>((v >> 8) & 0xff);
+    p[2] = static_cast<unsigned char>((v >> 16) & 0xff);
+    p[3] = static_cast<unsigned char>((v >> 24) & 0xff);
+}
+
+
+
+
+/********************************************************************
+ * @brief parse gzip header of a block; returns false if the block
+ * is not a bgzf block; on success, we return the size of the
+ * header and the total size of the block
+ *******************************************************************/
+static bool ParseBlockHeader(const unsigned char* p, size_t n, size_t& hsize, size_t& bsize) {
+    size_t xlen, k;
+
+    if (n < BGZFHeaderSize) return false;
+
+    // gzip magic, deflate, extra field set
+    if (p[0] != 0x1f || p[1] != 0x8b || p[2] != 0x08 || (p[3] & 0x04) == 0) return false;
+
+    // bgzf blocks only carry the extra field
+    if ((p[3] & 0x1a) != 0) return false;
+
+    xlen = GetUInt16(p + 10);
+    hsize = 12 + xlen;
+    if (n < hsize) return false;
+
+    // search for subfield 'BC' that contains the block size
+    k = 12;
+    while (k + 4 <= hsize) {
+        size_t slen = GetUInt16(p + k + 2);
+        if (p[k] == 66 && p[k+1] == 67 && slen == 2 && k + 6 <= hsize) {
+            bsize = GetUInt16(p + k + 4) + 1;
+            return bsize >= hsize + BGZFFooterSize;
+        }
+        k += 4 + slen;
+    }
+
+    return false;
+}
+
+
+
+
+/********************************************************************
+ * @brief deflate a single block (called within parallel region; no
+ * petsc calls); returns size of compressed block (0 on failure)
+ *******************************************************************/
+static size_t CompressBlock(const char* in, size_t nin, unsigned char* out) {
+    z_stream zs;
+    size_t bsize;
+    uLong crc;
+
+    std::memset(&zs, 0, sizeof(zs));
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) return 0;
+
+    zs.next_in   = reinterpret_cast<Bytef*>(const_cast<char*>(in));
+    zs.avail_in  = static_cast<uInt>(nin);
+    zs.next_out  = reinterpret_cast<Bytef*>(out + BGZFHeaderSize);
+    zs.avail_out = static_cast<uInt>(BGZFMaxBlockSize - BGZFHeaderSize - BGZFFooterSize);
+
+    if (deflate(&zs, Z_FINISH) != Z_STREAM_END) {
+        deflateEnd(&zs);
+        return 0;
+    }
+    bsize = BGZFHeaderSize + zs.total_out + BGZFFooterSize;
+    deflateEnd(&zs);
+
+    // gzip header with bgzf extra field (block size - 1)
+    std::memcpy(out, BGZFEOFBlock, BGZFHeaderSize);
+    out[16] = static_cast<unsigned char>((bsize - 1) & 0xff);
+    out[17] = static_cast<unsigned char>(((bsize - 1) >> 8) & 0xff);
+
+    // footer: crc32 and size of uncompressed data
+    crc = crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef*>(in), static_cast<uInt>(nin));
+    SetUInt32(out + bsize - 8, static_cast<size_t>(crc));
+    SetUInt32(out + bsize - 4, nin);
+
+    return bsize;
+}
+
+
+
+
+/********************************************************************
+ * @brief inflate a single block (called within parallel region; no
+ * petsc calls); returns false on failure
+ *******************************************************************/
+static bool DecompressBlock(const unsigned char* in, size_t hsize, size_t bsize, char* out, size_t nout) {
+    z_stream zs;
+    uLong crc;
+    bool success;
+
+    std::memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, -15) != Z_OK) return false;
+
+    zs.next_in   = const_cast<Bytef*>(in + hsize);
+    zs.avail_in  = static_cast<uInt>(bsize - hsize - BGZFFooterSize);
+    zs.next_out  = reinterpret_cast<Bytef*>(out);
+    zs.avail_out = static_cast<uInt>(nout);
+
+    success = (inflate(&zs, Z_FINISH) == Z_STREAM_END) && (zs.total_out == nout);
+    inflateEnd(&zs);
+    if (!success) return false;
+
+    crc = crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef*>(out), static_cast<uInt>(nout));
+    return static_cast<size_t>(crc) == GetUInt32(in + bsize - 8);
+}
+
+
+
+
+/********************************************************************
+ * @brief check if file is a block compressed gzip file
+ *******************************************************************/
+PetscErrorCode IsBlockGzipFile(std::string filename, bool& isbgzf) {
+    PetscErrorCode ierr = 0;
+    unsigned char header[BGZFHeaderSize];
+    size_t hsize, bsize;
+    std::ifstream ifs;
+
+    PetscFunctionBegin;
+
+    isbgzf = false;
+
+    ifs.open(filename.c_str(), std::ifstream::in | std::ifstream::binary);
+    if (ifs.is_open()) {
+        ifs.read(reinterpret_cast<char*>(header), BGZFHeaderSize);
+        if (ifs.gcount() == static_cast<std::streamsize>(BGZFHeaderSize)) {
+            isbgzf = ParseBlockHeader(header, BGZFHeaderSize, hsize, bsize);
+        }
+        ifs.close();
+    }
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief decompress block compressed gzip file; we locate the
+ * blocks (block size is stored in the header and the size of the
+ * uncompressed data in the footer) and inflate them in parallel
+ *******************************************************************/
+PetscErrorCode ReadBlockGzip(std::string filename, char** data, size_t& n) {
+    PetscErrorCode ierr = 0;
+    std::ifstream ifs;
+    std::vector<unsigned char> buffer;
+    std::vector<size_t> blockoffset, headersize, blocksize, dataoffset;
+    size_t nbytes, k, hsize, bsize;
+    long nblocks;
+    int failed = 0;
+    std::string msg;
+
+    PetscFunctionBegin;
+
+    // read compressed file
+    ifs.open(filename.c_str(), std::ifstream::in | std::ifstream::binary | std::ifstream::ate);
+    msg = "could not open file " + filename;
+    ierr = Assert(ifs.is_open(), msg); CHKERRQ(ierr);
+    nbytes = static_cast<size_t>(ifs.tellg());
+    ifs.seekg(0, std::ifstream::beg);
+    try {buffer.resize(nbytes);}
+    catch (std::bad_alloc& err) {
+        ierr = reg::ThrowError(err); CHKERRQ(ierr);
+    }
+    ifs.read(reinterpret_cast<char*>(buffer.data()), nbytes);
+    ierr = Assert(ifs.gcount() == static_cast<std::streamsize>(nbytes), "read failed"); CHKERRQ(ierr);
+    ifs.close();
+
+    // locate blocks
+    k = 0; n = 0;
+    while (k < nbytes) {
+        msg = "corrupted block in " + filename;
+        ierr = Assert(ParseBlockHeader(&buffer[k], nbytes - k, hsize, bsize), msg); CHKERRQ(ierr);
+        ierr = Assert(k + bsize <= nbytes, msg); CHKERRQ(ierr);
+        blockoffset.push_back(k);
+        headersize.push_back(hsize);
+        blocksize.push_back(bsize);
+        dataoffset.push_back(n);
+        n += GetUInt32(&buffer[k + bsize - 4]);
+        k += bsize;
+    }
+    nblocks = static_cast<long>(blockoffset.size());
+
+    try {*data = new char[n > 0 ? n : 1];}
+    catch (std::bad_alloc& err) {
+        ierr = reg::ThrowError(err); CHKERRQ(ierr);
+    }
+
+    // inflate blocks
+#pragma omp parallel for schedule(dynamic) reduction(+:failed)
+    for (long i = 0; i < nblocks; ++i) {
+        size_t nout = (i + 1 < nblocks ? dataoffset[i+1] : n) - dataoffset[i];
+        if (nout == 0) continue;
+        if (!DecompressBlock(&buffer[blockoffset[i]], headersize[i], blocksize[i], *data + dataoffset[i], nout)) {
+            failed += 1;
+        }
+    }
+
+    if (failed != 0) {
+        delete [] *data; *data = NULL;
+        msg = "decompression of " + filename + " failed";
+        ierr = ThrowError(msg); CHKERRQ(ierr);
+    }
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief compress header and data into block compressed gzip file;
+ * the blocks are deflated in parallel and written in batches (to
+ * limit the size of the output buffer)
+ *******************************************************************/
+PetscErrorCode WriteBlockGzip(std::string filename, const char* header, size_t nheader,
+                                                    const char* data, size_t ndata) {
+    PetscErrorCode ierr = 0;
+    std::ofstream ofs;
+    unsigned char* buffer = NULL;
+    std::vector<size_t> nout;
+    long nblocks, nbatch;
+    int failed = 0;
+    std::string msg;
+    const char* segment[2] = {header, data};
+    size_t nsegment[2] = {nheader, ndata};
+
+    PetscFunctionBegin;
+
+    nbatch = 256;
+    try {buffer = new unsigned char[nbatch*BGZFMaxBlockSize];}
+    catch (std::bad_alloc& err) {
+        ierr = reg::ThrowError(err); CHKERRQ(ierr);
+    }
+    nout.resize(nbatch);
+
+    ofs.open(filename.c_str(), std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+    msg = "could not open file " + filename;
+    ierr = Assert(ofs.is_open(), msg); CHKERRQ(ierr);
+
+    for (int s = 0; s < 2; ++s) {
+        const char* in = segment[s];
+        nblocks = static_cast<long>((nsegment[s] + BGZFMaxInputSize - 1) / BGZFMaxInputSize);
+        for (long b = 0; b < nblocks; b += nbatch) {
+            long nb = std::min(nbatch, nblocks - b);
+#pragma omp parallel for schedule(dynamic) reduction(+:failed)
+            for (long i = 0; i < nb; ++i) {
+                size_t offset = static_cast<size_t>(b + i)*BGZFMaxInputSize;
+                size_t nin = std::min(BGZFMaxInputSize, nsegment[s] - offset);
+                nout[i] = CompressBlock(in + offset, nin, buffer + i*BGZFMaxBlockSize);
+                if (nout[i] == 0) failed += 1;
+            }
+            if (failed != 0) break;
+            for (long i = 0; i < nb; ++i) {
+                ofs.write(reinterpret_cast<const char*>(buffer + i*BGZFMaxBlockSize), nout[i]);
+            }
+        }
+    }
+    ofs.write(reinterpret_cast<const char*>(BGZFEOFBlock), sizeof(BGZFEOFBlock));
+    ofs.close();
+
+    if (buffer != NULL) {delete [] buffer; buffer = NULL;}
+
+    msg = "compression of " + filename + " failed";
+    ierr = Assert(failed == 0, msg); CHKERRQ(ierr);
+
+    PetscFunctionReturn(ierr);
+}
+
+#endif  // REG_HAS_NIFTI
+
+
+
+
+}  // namespace reg
+
+
+
+
+#endif  // _BLOCKGZIP_CPP_
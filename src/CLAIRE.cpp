@@ -77,6 +77,8 @@ PetscErrorCode CLAIRE::Initialize() {
     this->m_IncStateVariable = NULL;    ///< incremental state variable
     this->m_IncAdjointVariable = NULL;  ///< incremental adjoint variable
 
+    this->m_InexactSemiLagrangianMethod = NULL;
+
     PetscFunctionReturn(ierr);
 }
 
@@ -93,6 +95,11 @@ PetscErrorCode CLAIRE::ClearMemory(void) {
     // delete all variables
     ierr = this->ClearVariables(); CHKERRQ(ierr);
 
+    if (this->m_InexactSemiLagrangianMethod != NULL) {
+        delete this->m_InexactSemiLagrangianMethod;
+        this->m_InexactSemiLagrangianMethod = NULL;
+    }
+
     PetscFunctionReturn(ierr);
 }
 
@@ -124,6 +131,34 @@ PetscErrorCode CLAIRE::ClearVariables(void) {
         this->m_IncAdjointVariable = NULL;
     }
 
+    ierr = this->ClearBlockVariables(); CHKERRQ(ierr);
+
+    this->m_StateIsCached = false;
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief clean up containers for block hessian matvec
+ *******************************************************************/
+PetscErrorCode CLAIRE::ClearBlockVariables(void) {
+    PetscErrorCode ierr = 0;
+    PetscFunctionBegin;
+
+    for (size_t k = 0; k < this->m_BlockIncVelocityField.size(); ++k) {
+        delete this->m_BlockIncVelocityField[k];
+        delete this->m_BlockWorkVecField[k];
+        ierr = VecDestroy(&this->m_BlockIncStateVariable[k]); CHKERRQ(ierr);
+        ierr = VecDestroy(&this->m_BlockIncAdjointVariable[k]); CHKERRQ(ierr);
+    }
+    this->m_BlockIncVelocityField.clear();
+    this->m_BlockWorkVecField.clear();
+    this->m_BlockIncStateVariable.clear();
+    this->m_BlockIncAdjointVariable.clear();
+
     PetscFunctionReturn(ierr);
 }
 
@@ -471,8 +506,8 @@ PetscErrorCode CLAIRE::SetFinalAdjoint(Vec l1) {
     nl = this->m_Opt->m_Domain.nl;
     ng = this->m_Opt->m_Domain.ng;
 
-    // we do not store the time history for a gauss-newton approximation
-    if (this->m_Opt->m_OptPara.method == GAUSSNEWTON) {
+    // we only store the time history for full newton
+    if (this->m_Opt->m_OptPara.method != FULLNEWTON) {
         nt = 0;
     }
 
@@ -621,6 +656,9 @@ PetscErrorCode CLAIRE::SetStateVariable(Vec m) {
     }
     ierr = VecCopy(m, this->m_StateVariable); CHKERRQ(ierr);
 
+    // state does not (necessarily) belong to current velocity
+    this->m_StateIsCached = false;
+
     // if semi lagrangian pde solver is used,
     // we have to initialize it here
     if (this->m_Opt->m_PDESolver.type == SL) {
@@ -762,9 +800,13 @@ PetscErrorCode CLAIRE::EvaluateDistanceMeasure(ScalarType* D) {
 
     ierr = Assert(this->m_ReferenceImage != NULL, "null pointer"); CHKERRQ(ierr);
 
-    // compute solution of state equation
-    ierr = this->SolveStateEquation(); CHKERRQ(ierr);
+    // compute solution of state equation (unless we have done so for
+    // the current velocity); if the gradient has not been evaluated
+    // since the last objective evaluation, we are backtracking in a
+    // line search and only need m(t=1)
+    ierr = this->UpdateStateVariable(this->m_GradientEvaluated); CHKERRQ(ierr);
     ierr = Assert(this->m_StateVariable != NULL, "null pointer"); CHKERRQ(ierr);
+    this->m_GradientEvaluated = false;
 
     // allocate distance measure
     if (this->m_Opt->m_Distance.reset) {
@@ -879,7 +921,6 @@ PetscErrorCode CLAIRE::EvaluateGradient(Vec g, Vec v) {
     if (this->m_Opt->m_Verbosity > 2) {
         ierr = DbgMsg("evaluating gradient"); CHKERRQ(ierr);
     }
-    ierr = Assert(this->m_StateVariable != NULL, "null pointer"); CHKERRQ(ierr);
 
     // allocate
     if (this->m_VelocityField == NULL) {
@@ -909,6 +950,13 @@ PetscErrorCode CLAIRE::EvaluateGradient(Vec g, Vec v) {
         ierr = this->m_VelocityField->SetComponents(v); CHKERRQ(ierr);
     }
 
+    // the adjoint and hessian need the time history of the state; we
+    // only solve the state equation if we have not done so for the
+    // current velocity (e.g., for the accepted step of a line search)
+    ierr = this->UpdateStateVariable(true); CHKERRQ(ierr);
+    ierr = Assert(this->m_StateVariable != NULL, "null pointer"); CHKERRQ(ierr);
+    this->m_GradientEvaluated = true;
+
     if (this->m_Opt->m_Verbosity > 2) {
         ierr = this->m_VelocityField->Norm(nvx1, nvx2, nvx3); CHKERRQ(ierr);
         ss  << "||v||_2 = (" << std::scientific
@@ -1542,6 +1590,239 @@ PetscErrorCode CLAIRE::PrecondHessMatVecSym(Vec Hvtilde, Vec vtilde) {
 
 
 
+/********************************************************************
+ * @brief applies the hessian to a block of vectors; for the gauss-
+ * newton approximation with the semi-lagrangian method, the pde
+ * solves for all vectors of a block are done in a single sweep
+ * through time; this way, the gradients of the state variable, the
+ * interpolation of these gradients and the characteristic are
+ * shared and the interpolation of the incremental variables is done
+ * with one communication per block; otherwise we apply the hessian
+ * to one vector at a time
+ * @param[out] Hvtilde hessian applied to vectors
+ * @param[in] vtilde incremental velocity fields
+ * @param[in] n number of vectors
+ * @param[in] scale flag to switch on scaling by lebesgue measure
+ *******************************************************************/
+PetscErrorCode CLAIRE::HessianMatVecBlock(Vec* Hvtilde, Vec* vtilde, IntType n, bool scale) {
+    PetscErrorCode ierr = 0;
+    IntType nb = 0;
+    ScalarType hd;
+    bool useblock;
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    useblock = (this->m_Opt->m_PDESolver.type == SL)
+            && (this->m_Opt->m_OptPara.method == GAUSSNEWTON)
+            && (this->m_Opt->m_RegModel != STOKES)
+            && (this->m_Opt->m_KrylovMethod.hessblocksize > 1)
+            && (n > 1);
+
+    // the zero velocity case is cheap (no pde solves)
+    if (useblock) {
+        ierr = this->IsVelocityZero(); CHKERRQ(ierr);
+        useblock = !this->m_VelocityIsZero;
+    }
+
+    if (!useblock) {
+        ierr = SuperClass::HessianMatVecBlock(Hvtilde, vtilde, n, scale); CHKERRQ(ierr);
+        this->m_Opt->Exit(__func__);
+        PetscFunctionReturn(ierr);
+    }
+
+    if (this->m_Opt->m_Verbosity > 2) {
+        ierr = DbgMsg("computing block hessian matvec"); CHKERRQ(ierr);
+    }
+
+    ierr = this->m_Opt->StartTimer(HMVEXEC); CHKERRQ(ierr);
+
+    hd = this->m_Opt->GetLebesgueMeasure();
+    for (IntType i = 0; i < n; i += nb) {
+        nb = std::min(static_cast<IntType>(this->m_Opt->m_KrylovMethod.hessblocksize), n - i);
+
+        ierr = this->BlockHessMatVec(Hvtilde + i, vtilde + i, nb); CHKERRQ(ierr);
+
+        for (IntType k = 0; k < nb; ++k) {
+            // scale by lebesgue measure
+            if (scale == false) {
+                ierr = VecScale(Hvtilde[i+k], 1.0/hd); CHKERRQ(ierr);
+            }
+            // increment matvecs
+            this->m_Opt->IncrementCounter(HESSMATVEC);
+        }
+    }
+
+    // stop hessian matvec timer
+    ierr = this->m_Opt->StopTimer(HMVEXEC); CHKERRQ(ierr);
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief applies the hessian to a block of (at most hessblocksize)
+ * vectors; supports all hessian operators (default, preconditioned
+ * and symmetrically preconditioned)
+ *******************************************************************/
+PetscErrorCode CLAIRE::BlockHessMatVec(Vec* Hvtilde, Vec* vtilde, IntType nb) {
+    PetscErrorCode ierr = 0;
+    IntType nl, ng, nc;
+    ScalarType hd;
+    VecField* v = NULL;
+    Vec x = NULL;
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    nc = this->m_Opt->m_Domain.nc;
+    nl = this->m_Opt->m_Domain.nl;
+    ng = this->m_Opt->m_Domain.ng;
+
+    if (this->m_WorkVecField1 == NULL) {
+        try {this->m_WorkVecField1 = new VecField(this->m_Opt);}
+        catch (std::bad_alloc& err) {
+            ierr = reg::ThrowError(err); CHKERRQ(ierr);
+        }
+    }
+    if (this->m_WorkVecField2 == NULL) {
+        try {this->m_WorkVecField2 = new VecField(this->m_Opt);}
+        catch (std::bad_alloc& err) {
+            ierr = reg::ThrowError(err); CHKERRQ(ierr);
+        }
+    }
+    if (this->m_WorkVecField5 == NULL) {
+        try {this->m_WorkVecField5 = new VecField(this->m_Opt);}
+        catch (std::bad_alloc& err) {
+            ierr = reg::ThrowError(err); CHKERRQ(ierr);
+        }
+    }
+    if (this->m_Regularization == NULL) {
+        ierr = this->SetupRegularization(); CHKERRQ(ierr);
+    }
+
+    // allocate containers for all vectors of the block (only gauss
+    // newton; no need to store the time history)
+    while (static_cast<IntType>(this->m_BlockIncVelocityField.size()) < nb) {
+        try {v = new VecField(this->m_Opt);}
+        catch (std::bad_alloc& err) {
+            ierr = reg::ThrowError(err); CHKERRQ(ierr);
+        }
+        this->m_BlockIncVelocityField.push_back(v); v = NULL;
+        try {v = new VecField(this->m_Opt);}
+        catch (std::bad_alloc& err) {
+            ierr = reg::ThrowError(err); CHKERRQ(ierr);
+        }
+        this->m_BlockWorkVecField.push_back(v); v = NULL;
+        ierr = VecCreate(x, nc*nl, nc*ng); CHKERRQ(ierr);
+        this->m_BlockIncStateVariable.push_back(x); x = NULL;
+        ierr = VecCreate(x, nc*nl, nc*ng); CHKERRQ(ierr);
+        this->m_BlockIncAdjointVariable.push_back(x); x = NULL;
+    }
+
+    // parse input
+    for (IntType k = 0; k < nb; ++k) {
+        switch (this->m_Opt->m_KrylovMethod.matvectype) {
+            case DEFAULTMATVEC:
+            case PRECONDMATVEC:
+            {
+                ierr = this->m_BlockIncVelocityField[k]->SetComponents(vtilde[k]); CHKERRQ(ierr);
+                break;
+            }
+            case PRECONDMATVECSYM:
+            {
+                // apply (\beta\D{A})^{-1/2} to incremental velocity field
+                ierr = this->m_WorkVecField5->SetComponents(vtilde[k]); CHKERRQ(ierr);
+                ierr = this->m_Regularization->ApplyInverse(this->m_BlockIncVelocityField[k],
+                                                            this->m_WorkVecField5, true); CHKERRQ(ierr);
+                break;
+            }
+            default:
+            {
+                ierr = ThrowError("operator not implemented"); CHKERRQ(ierr);
+                break;
+            }
+        }
+    }
+
+    // compute \tilde{m}_1 for all vectors
+    ierr = this->SolveIncStateEquationSLBlock(nb); CHKERRQ(ierr);
+
+    // compute \tilde{\lambda}_1 for all vectors
+    if (this->m_DistanceMeasure == NULL) {
+        ierr = this->SetupDistanceMeasure(); CHKERRQ(ierr);
+    }
+    ierr = this->m_DistanceMeasure->SetReferenceImage(this->m_ReferenceImage); CHKERRQ(ierr);
+    ierr = this->m_DistanceMeasure->SetStateVariable(this->m_StateVariable); CHKERRQ(ierr);
+    for (IntType k = 0; k < nb; ++k) {
+        ierr = this->m_DistanceMeasure->SetIncStateVariable(this->m_BlockIncStateVariable[k]); CHKERRQ(ierr);
+        ierr = this->m_DistanceMeasure->SetIncAdjointVariable(this->m_BlockIncAdjointVariable[k]); CHKERRQ(ierr);
+        ierr = this->m_DistanceMeasure->SetFinalConditionIAE(); CHKERRQ(ierr);
+    }
+    ierr = this->m_DistanceMeasure->SetIncStateVariable(this->m_IncStateVariable); CHKERRQ(ierr);
+    ierr = this->m_DistanceMeasure->SetIncAdjointVariable(this->m_IncAdjointVariable); CHKERRQ(ierr);
+
+    // compute \tilde{\lambda}(x,t) and incremental body force for all vectors
+    ierr = this->SolveIncAdjointEquationGNSLBlock(nb); CHKERRQ(ierr);
+
+    hd = this->m_Opt->GetLebesgueMeasure();
+    for (IntType k = 0; k < nb; ++k) {
+        // apply K[\tilde{b}] and scale by hd
+        ierr = this->m_WorkVecField2->Copy(this->m_BlockWorkVecField[k]); CHKERRQ(ierr);
+        ierr = this->ApplyProjection(); CHKERRQ(ierr);
+        ierr = this->m_WorkVecField2->Scale(hd); CHKERRQ(ierr);
+
+        switch (this->m_Opt->m_KrylovMethod.matvectype) {
+            case DEFAULTMATVEC:
+            {
+                // \D{H}\vect{\tilde{v}} = \beta*\D{A}[\vect{\tilde{v}}] + \D{K}[\vect{\tilde{b}}]
+                ierr = this->m_Regularization->HessianMatVec(this->m_WorkVecField1,
+                                                             this->m_BlockIncVelocityField[k]); CHKERRQ(ierr);
+                ierr = this->m_WorkVecField1->AXPY(1.0, this->m_WorkVecField2); CHKERRQ(ierr);
+                ierr = this->m_WorkVecField1->GetComponents(Hvtilde[k]); CHKERRQ(ierr);
+                break;
+            }
+            case PRECONDMATVEC:
+            {
+                // \D{H}\vect{\tilde{v}} = \vect{\tilde{v}} + (\beta \D{A})^{-1} \D{K}[\vect{\tilde{b}}]
+                ierr = this->m_Regularization->ApplyInverse(this->m_WorkVecField1,
+                                                            this->m_WorkVecField2, false); CHKERRQ(ierr);
+                ierr = this->m_WorkVecField2->WAXPY(hd, this->m_BlockIncVelocityField[k],
+                                                    this->m_WorkVecField1); CHKERRQ(ierr);
+                ierr = this->m_WorkVecField2->GetComponents(Hvtilde[k]); CHKERRQ(ierr);
+                break;
+            }
+            case PRECONDMATVECSYM:
+            {
+                // \D{H}\vect{\tilde{v}} = \vect{\tilde{v}} + (\beta \D{A})^{-1/2}\D{K}[\vect{\tilde{b}}](\beta \D{A})^{-1/2}
+                ierr = this->m_Regularization->ApplyInverse(this->m_WorkVecField1,
+                                                            this->m_WorkVecField2, true); CHKERRQ(ierr);
+                ierr = this->m_WorkVecField5->SetComponents(vtilde[k]); CHKERRQ(ierr);
+                ierr = this->m_WorkVecField5->Scale(hd); CHKERRQ(ierr);
+                ierr = this->m_WorkVecField5->AXPY(1.0, this->m_WorkVecField1); CHKERRQ(ierr);
+                ierr = this->m_WorkVecField5->GetComponents(Hvtilde[k]); CHKERRQ(ierr);
+                break;
+            }
+            default:
+            {
+                ierr = ThrowError("operator not implemented"); CHKERRQ(ierr);
+                break;
+            }
+        }
+    }
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
 /********************************************************************
  * @brief compute initial condition given some initial guess for
  * the state variable $m$ and the adjoint variable $\lambda$
@@ -1819,30 +2100,36 @@ PetscErrorCode CLAIRE::StoreStateVariable() {
     }
     ierr = Assert(this->m_ReadWrite != NULL, "null pointer"); CHKERRQ(ierr);
 
-    // store time history
-    ierr = GetRawPointer(this->m_StateVariable, &p_m); CHKERRQ(ierr);
-    // store individual time points
-    for (IntType j = 0; j <= nt; ++j) {
-        for (IntType k = 0; k < nc; ++k) {
-            ierr = GetRawPointer(this->m_WorkScaField1, &p_mj); CHKERRQ(ierr);
-            try {std::copy(p_m+j*nl*nc + k*nl, p_m+j*nl*nc + (k+1)*nl, p_mj);}
-            catch (std::exception& err) {
-                ierr = ThrowError(err); CHKERRQ(ierr);
-            }
-            ierr = RestoreRawPointer(this->m_WorkScaField1, &p_mj); CHKERRQ(ierr);
-            // write out
-            ss.str(std::string()); ss.clear();
+    if (ext == ".nc") {
+        // netcdf: store time history in a single file
+        ss << "state-variable" << ext;
+        ierr = this->m_ReadWrite->WriteTimeSeries(this->m_StateVariable, ss.str(), nt+1); CHKERRQ(ierr);
+    } else {
+        // store time history
+        ierr = GetRawPointer(this->m_StateVariable, &p_m); CHKERRQ(ierr);
+        // store individual time points
+        for (IntType j = 0; j <= nt; ++j) {
+            for (IntType k = 0; k < nc; ++k) {
+                ierr = GetRawPointer(this->m_WorkScaField1, &p_mj); CHKERRQ(ierr);
+                try {std::copy(p_m+j*nl*nc + k*nl, p_m+j*nl*nc + (k+1)*nl, p_mj);}
+                catch (std::exception& err) {
+                    ierr = ThrowError(err); CHKERRQ(ierr);
+                }
+                ierr = RestoreRawPointer(this->m_WorkScaField1, &p_mj); CHKERRQ(ierr);
+                // write out
+                ss.str(std::string()); ss.clear();
 
-            if (nc > 1) {
-                ss << "state-variable-k=" << std::setw(3) << std::setfill('0')  << k
-                   << "-j=" << std::setw(3) << std::setfill('0') << j << ext;
-            } else {
-                ss << "state-variable-j=" << std::setw(3) << std::setfill('0') << j << ext;
-            }
-            ierr = this->m_ReadWrite->Write(this->m_WorkScaField1, ss.str()); CHKERRQ(ierr);
-        }  // for number of vector components
-    }  // for number of time points
-    ierr = RestoreRawPointer(this->m_StateVariable, &p_m); CHKERRQ(ierr);
+                if (nc > 1) {
+                    ss << "state-variable-k=" << std::setw(3) << std::setfill('0')  << k
+                       << "-j=" << std::setw(3) << std::setfill('0') << j << ext;
+                } else {
+                    ss << "state-variable-j=" << std::setw(3) << std::setfill('0') << j << ext;
+                }
+                ierr = this->m_ReadWrite->Write(this->m_WorkScaField1, ss.str()); CHKERRQ(ierr);
+            }  // for number of vector components
+        }  // for number of time points
+        ierr = RestoreRawPointer(this->m_StateVariable, &p_m); CHKERRQ(ierr);
+    }
 
 
     this->m_Opt->Exit(__func__);
@@ -1975,6 +2262,9 @@ PetscErrorCode CLAIRE::SolveStateEquation() {
       else DbgMsg("state            : nullptr");
     }
 
+    // remember velocity we solved for
+    ierr = this->CacheState(this->m_StoreTimeHistory); CHKERRQ(ierr);
+
     // increment counter
     this->m_Opt->IncrementCounter(PDESOLVE);
 
@@ -1986,6 +2276,117 @@ PetscErrorCode CLAIRE::SolveStateEquation() {
 
 
 
+/********************************************************************
+ * @brief solve the state equation unless we have solved it for the
+ * current velocity already; if we do not need the time history
+ * (e.g., trial steps of a line search), we only compute m(t=1)
+ * (semi-lagrangian solver for transport equation only)
+ * @param[in] timehistory flag: we need the time history of m
+ *******************************************************************/
+PetscErrorCode CLAIRE::UpdateStateVariable(bool timehistory) {
+    PetscErrorCode ierr = 0;
+    bool cached = false;
+    PetscBool equal1 = PETSC_FALSE, equal2 = PETSC_FALSE, equal3 = PETSC_FALSE;
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    ierr = this->IsStateCached(cached, timehistory); CHKERRQ(ierr);
+
+    // fall back to the checkpoint of the last accepted solution (parameter
+    // continuation); the checkpoint always includes the time history
+    if (!cached && this->m_StateCheckpointValid && this->m_StateVariable != NULL) {
+        ierr = VecEqual(this->m_VelocityField->m_X1, this->m_StateCheckpointVelocity->m_X1, &equal1); CHKERRQ(ierr);
+        ierr = VecEqual(this->m_VelocityField->m_X2, this->m_StateCheckpointVelocity->m_X2, &equal2); CHKERRQ(ierr);
+        ierr = VecEqual(this->m_VelocityField->m_X3, this->m_StateCheckpointVelocity->m_X3, &equal3); CHKERRQ(ierr);
+        if (equal1 && equal2 && equal3) {
+            ierr = VecCopy(this->m_StateCheckpoint, this->m_StateVariable); CHKERRQ(ierr);
+            // the incremental state equation reuses the characteristic of
+            // the state equation; it has to match the restored state
+            if (this->m_Opt->m_PDESolver.type == SL) {
+                if (this->m_SemiLagrangianMethod == NULL) {
+                    try {this->m_SemiLagrangianMethod = new SemiLagrangianType(this->m_Opt);}
+                    catch (std::bad_alloc& err) {
+                        ierr = reg::ThrowError(err); CHKERRQ(ierr);
+                    }
+                }
+                if (this->m_WorkVecField1 == NULL) {
+                    try {this->m_WorkVecField1 = new VecField(this->m_Opt);}
+                    catch (std::bad_alloc& err) {
+                        ierr = reg::ThrowError(err); CHKERRQ(ierr);
+                    }
+                }
+                ierr = this->m_SemiLagrangianMethod->SetWorkVecField(this->m_WorkVecField1); CHKERRQ(ierr);
+                ierr = this->m_SemiLagrangianMethod->ComputeTrajectory(this->m_VelocityField, "state"); CHKERRQ(ierr);
+            }
+            ierr = this->CacheState(true); CHKERRQ(ierr);
+            cached = true;
+            if (this->m_Opt->m_Verbosity > 2) {
+                ierr = DbgMsg("state variable restored from checkpoint"); CHKERRQ(ierr);
+            }
+        }
+    }
+
+    if (!cached) {
+        // we always store the time history if we write it to file
+        // or if the solver does not support in-place time stepping
+        if (this->m_Opt->m_PDESolver.type != SL
+            || this->m_Opt->m_PDESolver.pdetype != TRANSPORTEQ
+            || this->m_Opt->m_ReadWriteFlags.timeseries) {
+            timehistory = true;
+        }
+        this->m_StoreTimeHistory = timehistory;
+        ierr = this->SolveStateEquation(); CHKERRQ(ierr);
+        this->m_StoreTimeHistory = true;
+    }
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief keep a copy of the state variable for the current velocity
+ * field (if it has been computed for it); used in parameter
+ * continuation to keep the state of the last accepted solution alive
+ * across steps (the next step is warm started from this solution)
+ *******************************************************************/
+PetscErrorCode CLAIRE::CheckpointState() {
+    PetscErrorCode ierr = 0;
+    bool cached = false;
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    ierr = this->IsStateCached(cached, true); CHKERRQ(ierr);
+    this->m_StateCheckpointValid = false;
+
+    if (cached) {
+        if (this->m_StateCheckpoint == NULL) {
+            ierr = VecDuplicate(this->m_StateVariable, &this->m_StateCheckpoint); CHKERRQ(ierr);
+        }
+        if (this->m_StateCheckpointVelocity == NULL) {
+            try {this->m_StateCheckpointVelocity = new VecField(this->m_Opt);}
+            catch (std::bad_alloc& err) {
+                ierr = reg::ThrowError(err); CHKERRQ(ierr);
+            }
+        }
+        ierr = VecCopy(this->m_StateVariable, this->m_StateCheckpoint); CHKERRQ(ierr);
+        ierr = this->m_StateCheckpointVelocity->Copy(this->m_VelocityField); CHKERRQ(ierr);
+        this->m_StateCheckpointValid = true;
+    }
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
 /********************************************************************
  * @brief solve the forward problem (state equation)
  * \p_t m + \igrad m\cdot\vect{v} = 0
@@ -2115,7 +2516,7 @@ PetscErrorCode CLAIRE::SolveStateEquationRK2(void) {
  *******************************************************************/
 PetscErrorCode CLAIRE::SolveStateEquationSL(void) {
     PetscErrorCode ierr = 0;
-    IntType nl, nc, nt, l, lnext;
+    IntType nl, nc, nt, l, lnext, lfinal;
     ScalarType *p_m = NULL;
     bool store = true;
     std::stringstream ss;
@@ -2125,12 +2526,18 @@ PetscErrorCode CLAIRE::SolveStateEquationSL(void) {
     this->m_Opt->Enter(__func__);
 
     // flag to identify if we store the time history
-    store = this->m_Opt->m_RegFlags.runinversion;
+    store = this->m_Opt->m_RegFlags.runinversion && this->m_StoreTimeHistory;
 
     nt = this->m_Opt->m_Domain.nt;
     nc = this->m_Opt->m_Domain.nc;
     nl = this->m_Opt->m_Domain.nl;
 
+    // if we do not store the time history, we overwrite m in place; for
+    // the inversion the state is still allocated for all time points,
+    // and we march in the slot of m(t=1), where the distance measure
+    // expects it
+    lfinal = (this->m_Opt->m_RegFlags.runinversion && !store) ? nt*nl*nc : 0;
+
     if (this->m_SemiLagrangianMethod == NULL) {
         try {this->m_SemiLagrangianMethod = new SemiLagrangianType(this->m_Opt);}
         catch (std::bad_alloc& err) {
@@ -2150,11 +2557,17 @@ PetscErrorCode CLAIRE::SolveStateEquationSL(void) {
 
     // get state variable m
     ierr = GetRawPointerReadWrite(this->m_StateVariable, &p_m); CHKERRQ(ierr);
+    if (lfinal != 0) {
+        try {std::copy(p_m, p_m+nl*nc, p_m+lfinal);}
+        catch (std::exception& err) {
+            ierr = ThrowError(err); CHKERRQ(ierr);
+        }
+    }
     for (IntType j = 0; j < nt; ++j) {  // for all time points
         if (store) {
             l = j*nl*nc; lnext = (j+1)*nl*nc;
         } else {
-            l = 0; lnext = 0;
+            l = lfinal; lnext = lfinal;
         }
         for (IntType k = 0; k < nc; ++k) {  // for all image components
             // compute m(X,t^{j+1}) (interpolate state variable)
@@ -3146,7 +3559,7 @@ PetscErrorCode CLAIRE::SolveIncStateEquationRK2(void) {
  *******************************************************************/
 PetscErrorCode CLAIRE::SolveIncStateEquationSL(void) {
     PetscErrorCode ierr = 0;
-    IntType nl, ng, nt, nc, lm, lmnext, lmt, lmtnext;
+    IntType nl, ng, nt, nc, ts, lm, lmnext, lmt, lmtnext;
     std::bitset<3> XYZ; XYZ[0] = 1; XYZ[1] = 1; XYZ[2] = 1;
     ScalarType ht, hthalf;
     ScalarType *p_gm1 = NULL, *p_gm2 = NULL, *p_gm3 = NULL,
@@ -3155,6 +3568,7 @@ PetscErrorCode CLAIRE::SolveIncStateEquationSL(void) {
                      *p_vtildex1 = NULL, *p_vtildex2 = NULL, *p_vtildex3 = NULL;
     double timer[NFFTTIMERS] = {0};
     bool fullnewton = false;
+    SemiLagrangianType* slmethod = NULL;
     PetscFunctionBegin;
 
     this->m_Opt->Enter(__func__);
@@ -3163,8 +3577,6 @@ PetscErrorCode CLAIRE::SolveIncStateEquationSL(void) {
     nc = this->m_Opt->m_Domain.nc;
     nl = this->m_Opt->m_Domain.nl;
     ng = this->m_Opt->m_Domain.ng;
-    ht = this->m_Opt->GetTimeStepSize();
-    hthalf = 0.5*ht;
 
     ierr = Assert(this->m_StateVariable != NULL, "null pointer"); CHKERRQ(ierr);
     ierr = Assert(this->m_IncStateVariable != NULL, "null pointer"); CHKERRQ(ierr);
@@ -3197,6 +3609,11 @@ PetscErrorCode CLAIRE::SolveIncStateEquationSL(void) {
     if (this->m_Opt->m_OptPara.method == FULLNEWTON) {   // gauss newton
         fullnewton = true;
     }
+
+    // coarsen time grid for inexact hessian matvecs (ts = 1: exact)
+    ierr = this->SetupInexactHessMatVec(ts, slmethod); CHKERRQ(ierr);
+    ht = static_cast<ScalarType>(ts)*this->m_Opt->GetTimeStepSize();
+    hthalf = 0.5*ht;
     
     ierr = this->m_VelocityField->DebugInfo("velocity", __LINE__, __FILE__); CHKERRQ(ierr);
     ierr = this->m_IncVelocityField->DebugInfo("inc velocity", __LINE__, __FILE__); CHKERRQ(ierr);
@@ -3210,15 +3627,15 @@ PetscErrorCode CLAIRE::SolveIncStateEquationSL(void) {
     ierr = GetRawPointer(this->m_WorkScaField1, &p_mx); CHKERRQ(ierr);
     ierr = this->m_WorkVecField1->GetArrays(p_gm1, p_gm2, p_gm3); CHKERRQ(ierr);
 
-    ierr = this->m_SemiLagrangianMethod->Interpolate(this->m_WorkVecField2, this->m_IncVelocityField, "state"); CHKERRQ(ierr);
+    ierr = slmethod->Interpolate(this->m_WorkVecField2, this->m_IncVelocityField, "state"); CHKERRQ(ierr);
     
     ierr = this->m_WorkVecField2->DebugInfo("work vec", __LINE__, __FILE__); CHKERRQ(ierr);
 
     ierr = this->m_WorkVecField2->GetArraysRead(p_vtildex1, p_vtildex2, p_vtildex3); CHKERRQ(ierr);
     ierr = this->m_IncVelocityField->GetArraysRead(p_vtilde1, p_vtilde2, p_vtilde3); CHKERRQ(ierr);
 
-    for (IntType j = 0; j < nt; ++j) {  // for all time points
-        lm = j*nl*nc; lmnext = (j+1)*nl*nc;
+    for (IntType j = 0; j < nt/ts; ++j) {  // for all time points
+        lm = j*ts*nl*nc; lmnext = (j+1)*ts*nl*nc;
         if (fullnewton) {   // full newton
             lmt = j*nl*nc; lmtnext = (j+1)*nl*nc;
         } else {
@@ -3227,7 +3644,7 @@ PetscErrorCode CLAIRE::SolveIncStateEquationSL(void) {
 
         for (IntType k = 0; k < nc; ++k) {  // for all image components
             // interpolate incremental adjoint variable \tilde{m}^j(X)
-            ierr = this->m_SemiLagrangianMethod->Interpolate(p_mtilde + lmtnext + k*nl, p_mtilde + lmt + k*nl, "state"); CHKERRQ(ierr);
+            ierr = slmethod->Interpolate(p_mtilde + lmtnext + k*nl, p_mtilde + lmt + k*nl, "state"); CHKERRQ(ierr);
             // interpolate m
 //            ierr = this->m_SemiLagrangianMethod->Interpolate(p_mx, p_m + lm + k*nl, "state"); CHKERRQ(ierr);
 
@@ -3244,7 +3661,7 @@ PetscErrorCode CLAIRE::SolveIncStateEquationSL(void) {
             this->m_Opt->StopTimer(FFTSELFEXEC);
             this->m_Opt->IncrementCounter(FFT, FFTGRAD);
 
-            ierr = this->m_SemiLagrangianMethod->Interpolate(p_gm1, p_gm2, p_gm3, p_gm1, p_gm2, p_gm3, "state"); CHKERRQ(ierr);
+            ierr = slmethod->Interpolate(p_gm1, p_gm2, p_gm3, p_gm1, p_gm2, p_gm3, "state"); CHKERRQ(ierr);
 
             // first part of time integration
 #pragma omp parallel
@@ -3848,7 +4265,7 @@ PetscErrorCode CLAIRE::SolveIncAdjointEquationFNRK2(void) {
  *******************************************************************/
 PetscErrorCode CLAIRE::SolveIncAdjointEquationGNSL(void) {
     PetscErrorCode ierr = 0;
-    IntType nl, ng, nc, nt, ll, lm;
+    IntType nl, ng, nc, nt, ts, ll, lm;
     ScalarType *p_ltilde = NULL, *p_ltildex = NULL, *p_m = NULL,
                 *p_divv = NULL, *p_divvx = NULL,
                 *p_v1 = NULL, *p_v2 = NULL, *p_v3 = NULL,
@@ -3857,6 +4274,7 @@ PetscErrorCode CLAIRE::SolveIncAdjointEquationGNSL(void) {
     ScalarType ht, hthalf, ltilde, ltildex, rhs0, rhs1, scale;
     std::bitset<3> xyz; xyz[0] = 1; xyz[1] = 1; xyz[2] = 1;
     double timer[NFFTTIMERS] = {0};
+    SemiLagrangianType* slmethod = NULL;
 
     PetscFunctionBegin;
 
@@ -3869,9 +4287,6 @@ PetscErrorCode CLAIRE::SolveIncAdjointEquationGNSL(void) {
     nc = this->m_Opt->m_Domain.nc;
     nl = this->m_Opt->m_Domain.nl;
     ng = this->m_Opt->m_Domain.ng;
-    ht = this->m_Opt->GetTimeStepSize();
-    scale = ht;
-    hthalf = 0.5*ht;
 
     if (this->m_WorkScaField1 == NULL) {
         ierr = VecCreate(this->m_WorkScaField1, nl, ng); CHKERRQ(ierr);
@@ -3904,6 +4319,12 @@ PetscErrorCode CLAIRE::SolveIncAdjointEquationGNSL(void) {
         ierr = this->m_SemiLagrangianMethod->ComputeTrajectory(this->m_VelocityField, "adjoint"); CHKERRQ(ierr);
     }
 
+    // coarsen time grid for inexact hessian matvecs (ts = 1: exact)
+    ierr = this->SetupInexactHessMatVec(ts, slmethod); CHKERRQ(ierr);
+    ht = static_cast<ScalarType>(ts)*this->m_Opt->GetTimeStepSize();
+    scale = ht;
+    hthalf = 0.5*ht;
+
     // compute divergence of velocity field
     ierr = GetRawPointer(this->m_WorkScaField1, &p_divv); CHKERRQ(ierr);
     ierr = this->m_VelocityField->GetArrays(p_v1, p_v2, p_v3); CHKERRQ(ierr);
@@ -3926,7 +4347,7 @@ PetscErrorCode CLAIRE::SolveIncAdjointEquationGNSL(void) {
 
 
     ierr = GetRawPointer(this->m_WorkScaField2, &p_divvx); CHKERRQ(ierr);
-    ierr = this->m_SemiLagrangianMethod->Interpolate(p_divvx, p_divv, "adjoint"); CHKERRQ(ierr);
+    ierr = slmethod->Interpolate(p_divvx, p_divv, "adjoint"); CHKERRQ(ierr);
 
     ierr = GetRawPointer(this->m_StateVariable, &p_m); CHKERRQ(ierr);
     ierr = GetRawPointer(this->m_IncAdjointVariable, &p_ltilde); CHKERRQ(ierr);
@@ -3937,12 +4358,12 @@ PetscErrorCode CLAIRE::SolveIncAdjointEquationGNSL(void) {
     ierr = this->m_WorkVecField2->SetValue(0.0); CHKERRQ(ierr);
     ierr = this->m_WorkVecField2->GetArrays(p_bt1, p_bt2, p_bt3); CHKERRQ(ierr);
 
-    for (IntType j = 0; j < nt; ++j) {
-        lm = (nt-j)*nc*nl;
+    for (IntType j = 0; j < nt/ts; ++j) {
+        lm = (nt-j*ts)*nc*nl;
         if (j == 0) scale *= 0.5;
         for (IntType k = 0; k < nc; ++k) {
             ll = k*nl;
-            ierr = this->m_SemiLagrangianMethod->Interpolate(p_ltildex, p_ltilde + ll, "adjoint"); CHKERRQ(ierr);
+            ierr = slmethod->Interpolate(p_ltildex, p_ltilde + ll, "adjoint"); CHKERRQ(ierr);
 
             // compute gradient of m^j
             this->m_Opt->StartTimer(FFTSELFEXEC);
@@ -4017,6 +4438,366 @@ PetscErrorCode CLAIRE::SolveIncAdjointEquationGNSL(void) {
 
 
 
+/********************************************************************
+ * @brief solve the incremental state equation for a block of
+ * incremental velocity fields (gauss-newton; only the final
+ * time point is stored); the gradient of the state variable and
+ * its interpolation are computed once per time step for all
+ * vectors in the block
+ *******************************************************************/
+PetscErrorCode CLAIRE::SolveIncStateEquationSLBlock(IntType nb) {
+    PetscErrorCode ierr = 0;
+    IntType nl, nt, nc, ts, lm, lmnext;
+    std::bitset<3> XYZ; XYZ[0] = 1; XYZ[1] = 1; XYZ[2] = 1;
+    ScalarType ht, hthalf;
+    ScalarType *p_gm1 = NULL, *p_gm2 = NULL, *p_gm3 = NULL, *p_m = NULL;
+    std::vector<ScalarType*> p_vt(3*nb, NULL), p_vtx(3*nb, NULL), p_mt(nb, NULL), p_mtk(nb, NULL);
+    double timer[NFFTTIMERS] = {0};
+    SemiLagrangianType* slmethod = NULL;
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    nt = this->m_Opt->m_Domain.nt;
+    nc = this->m_Opt->m_Domain.nc;
+    nl = this->m_Opt->m_Domain.nl;
+
+    ierr = Assert(this->m_StateVariable != NULL, "null pointer"); CHKERRQ(ierr);
+    ierr = Assert(static_cast<IntType>(this->m_BlockIncStateVariable.size()) >= nb, "size mismatch"); CHKERRQ(ierr);
+
+    if (this->m_SemiLagrangianMethod == NULL) {
+        try {this->m_SemiLagrangianMethod = new SemiLagrangianType(this->m_Opt);}
+        catch (std::bad_alloc& err) {
+            ierr = reg::ThrowError(err); CHKERRQ(ierr);
+        }
+        ierr = this->m_SemiLagrangianMethod->SetWorkVecField(this->m_WorkVecField1); CHKERRQ(ierr);
+        ierr = this->m_SemiLagrangianMethod->ComputeTrajectory(this->m_VelocityField, "state"); CHKERRQ(ierr);
+    }
+
+    // coarsen time grid for inexact hessian matvecs (ts = 1: exact)
+    ierr = this->SetupInexactHessMatVec(ts, slmethod); CHKERRQ(ierr);
+    ht = static_cast<ScalarType>(ts)*this->m_Opt->GetTimeStepSize();
+    hthalf = 0.5*ht;
+
+    ierr = this->m_Opt->StartTimer(PDEEXEC); CHKERRQ(ierr);
+
+    for (IntType k = 0; k < nb; ++k) {
+        ierr = VecSet(this->m_BlockIncStateVariable[k], 0.0); CHKERRQ(ierr);
+        ierr = GetRawPointer(this->m_BlockIncStateVariable[k], &p_mt[k]); CHKERRQ(ierr);
+        ierr = this->m_BlockIncVelocityField[k]->GetArrays(p_vt[3*k], p_vt[3*k+1], p_vt[3*k+2]); CHKERRQ(ierr);
+        ierr = this->m_BlockWorkVecField[k]->GetArrays(p_vtx[3*k], p_vtx[3*k+1], p_vtx[3*k+2]); CHKERRQ(ierr);
+    }
+
+    // interpolate \tilde{v}(X) for all vectors at once
+    ierr = slmethod->Interpolate(p_vtx.data(), p_vt.data(),
+                                 static_cast<int>(3*nb), "state"); CHKERRQ(ierr);
+
+    ierr = GetRawPointer(this->m_StateVariable, &p_m); CHKERRQ(ierr);
+    ierr = this->m_WorkVecField1->GetArrays(p_gm1, p_gm2, p_gm3); CHKERRQ(ierr);
+
+    for (IntType j = 0; j < nt/ts; ++j) {  // for all time points
+        lm = j*ts*nl*nc; lmnext = (j+1)*ts*nl*nc;
+
+        for (IntType c = 0; c < nc; ++c) {  // for all image components
+            // interpolate incremental state variable \tilde{m}^j(X) for all vectors
+            for (IntType k = 0; k < nb; ++k) p_mtk[k] = p_mt[k] + c*nl;
+            ierr = slmethod->Interpolate(p_mtk.data(), p_mtk.data(),
+                                         static_cast<int>(nb), "state"); CHKERRQ(ierr);
+
+            // compute gradient for state variable (shared by all vectors)
+            this->m_Opt->StartTimer(FFTSELFEXEC);
+            accfft_grad_t(p_gm1, p_gm2, p_gm3, p_m + lm + c*nl, this->m_Opt->m_FFT.plan, &XYZ, timer);
+            this->m_Opt->StopTimer(FFTSELFEXEC);
+            this->m_Opt->IncrementCounter(FFT, FFTGRAD);
+
+            ierr = slmethod->Interpolate(p_gm1, p_gm2, p_gm3, p_gm1, p_gm2, p_gm3, "state"); CHKERRQ(ierr);
+
+            // first part of time integration
+            for (IntType k = 0; k < nb; ++k) {
+                ScalarType *p_mtilde = p_mtk[k];
+                const ScalarType *p_vx1 = p_vtx[3*k], *p_vx2 = p_vtx[3*k+1], *p_vx3 = p_vtx[3*k+2];
+#pragma omp parallel
+{
+#pragma omp for
+                for (IntType i = 0; i < nl; ++i) {
+                    p_mtilde[i] -= hthalf*(p_gm1[i]*p_vx1[i] + p_gm2[i]*p_vx2[i] + p_gm3[i]*p_vx3[i]);
+                }
+}  // omp
+            }
+
+            // compute gradient for state variable at next time time point
+            this->m_Opt->StartTimer(FFTSELFEXEC);
+            accfft_grad_t(p_gm1, p_gm2, p_gm3, p_m + lmnext + c*nl, this->m_Opt->m_FFT.plan, &XYZ, timer);
+            this->m_Opt->StopTimer(FFTSELFEXEC);
+            this->m_Opt->IncrementCounter(FFT, FFTGRAD);
+
+            // second part of time integration
+            for (IntType k = 0; k < nb; ++k) {
+                ScalarType *p_mtilde = p_mtk[k];
+                const ScalarType *p_v1 = p_vt[3*k], *p_v2 = p_vt[3*k+1], *p_v3 = p_vt[3*k+2];
+#pragma omp parallel
+{
+#pragma omp for
+                for (IntType i = 0; i < nl; ++i) {
+                    p_mtilde[i] -= hthalf*(p_gm1[i]*p_v1[i] + p_gm2[i]*p_v2[i] + p_gm3[i]*p_v3[i]);
+                }
+}  // omp
+            }
+        }  // for all image components
+    }  // for all time points
+
+    ierr = this->m_WorkVecField1->RestoreArrays(p_gm1, p_gm2, p_gm3); CHKERRQ(ierr);
+    ierr = RestoreRawPointer(this->m_StateVariable, &p_m); CHKERRQ(ierr);
+    for (IntType k = 0; k < nb; ++k) {
+        ierr = this->m_BlockWorkVecField[k]->RestoreArrays(p_vtx[3*k], p_vtx[3*k+1], p_vtx[3*k+2]); CHKERRQ(ierr);
+        ierr = this->m_BlockIncVelocityField[k]->RestoreArrays(p_vt[3*k], p_vt[3*k+1], p_vt[3*k+2]); CHKERRQ(ierr);
+        ierr = RestoreRawPointer(this->m_BlockIncStateVariable[k], &p_mt[k]); CHKERRQ(ierr);
+    }
+
+    this->m_Opt->IncreaseFFTTimers(timer);
+
+    ierr = this->m_Opt->StopTimer(PDEEXEC); CHKERRQ(ierr);
+
+    // increment counter
+    for (IntType k = 0; k < nb; ++k) this->m_Opt->IncrementCounter(PDESOLVE);
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief solve the incremental adjoint equation for a block of
+ * vectors (gauss-newton); the final conditions have to be set; the
+ * incremental body forces are stored in the block work vector fields
+ *******************************************************************/
+PetscErrorCode CLAIRE::SolveIncAdjointEquationGNSLBlock(IntType nb) {
+    PetscErrorCode ierr = 0;
+    IntType nl, ng, nc, nt, ts, ll, lm;
+    ScalarType *p_m = NULL, *p_divv = NULL, *p_divvx = NULL,
+                *p_v1 = NULL, *p_v2 = NULL, *p_v3 = NULL,
+                *p_gradm1 = NULL, *p_gradm2 = NULL, *p_gradm3 = NULL;
+    std::vector<ScalarType*> p_lt(nb, NULL), p_ltk(nb, NULL), p_ltx(nb, NULL), p_bt(3*nb, NULL);
+    ScalarType ht, hthalf, scale;
+    std::bitset<3> xyz; xyz[0] = 1; xyz[1] = 1; xyz[2] = 1;
+    double timer[NFFTTIMERS] = {0};
+    SemiLagrangianType* slmethod = NULL;
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    ierr = Assert(this->m_StateVariable != NULL, "null pointer"); CHKERRQ(ierr);
+    ierr = Assert(this->m_VelocityField != NULL, "null pointer"); CHKERRQ(ierr);
+    ierr = Assert(static_cast<IntType>(this->m_BlockIncAdjointVariable.size()) >= nb, "size mismatch"); CHKERRQ(ierr);
+
+    nt = this->m_Opt->m_Domain.nt;
+    nc = this->m_Opt->m_Domain.nc;
+    nl = this->m_Opt->m_Domain.nl;
+    ng = this->m_Opt->m_Domain.ng;
+
+    if (this->m_WorkScaField1 == NULL) {
+        ierr = VecCreate(this->m_WorkScaField1, nl, ng); CHKERRQ(ierr);
+    }
+    if (this->m_WorkScaField2 == NULL) {
+        ierr = VecCreate(this->m_WorkScaField2, nl, ng); CHKERRQ(ierr);
+    }
+
+    if (this->m_SemiLagrangianMethod == NULL) {
+        try {this->m_SemiLagrangianMethod = new SemiLagrangianType(this->m_Opt);}
+        catch (std::bad_alloc& err) {
+            ierr = reg::ThrowError(err); CHKERRQ(ierr);
+        }
+        ierr = this->m_SemiLagrangianMethod->SetWorkVecField(this->m_WorkVecField1); CHKERRQ(ierr);
+        ierr = this->m_SemiLagrangianMethod->ComputeTrajectory(this->m_VelocityField, "adjoint"); CHKERRQ(ierr);
+    }
+
+    // coarsen time grid for inexact hessian matvecs (ts = 1: exact)
+    ierr = this->SetupInexactHessMatVec(ts, slmethod); CHKERRQ(ierr);
+    ht = static_cast<ScalarType>(ts)*this->m_Opt->GetTimeStepSize();
+    scale = ht;
+    hthalf = 0.5*ht;
+
+    ierr = this->m_Opt->StartTimer(PDEEXEC); CHKERRQ(ierr);
+
+    // compute divergence of velocity field and evaluate at X (shared)
+    ierr = GetRawPointer(this->m_WorkScaField1, &p_divv); CHKERRQ(ierr);
+    ierr = this->m_VelocityField->GetArrays(p_v1, p_v2, p_v3); CHKERRQ(ierr);
+    this->m_Opt->StartTimer(FFTSELFEXEC);
+    accfft_divergence_t(p_divv, p_v1, p_v2, p_v3, this->m_Opt->m_FFT.plan, timer);
+    this->m_Opt->StopTimer(FFTSELFEXEC);
+    ierr = this->m_VelocityField->RestoreArrays(p_v1, p_v2, p_v3); CHKERRQ(ierr);
+    this->m_Opt->IncrementCounter(FFT, FFTDIV);
+
+    ierr = GetRawPointer(this->m_WorkScaField2, &p_divvx); CHKERRQ(ierr);
+    ierr = slmethod->Interpolate(p_divvx, p_divv, "adjoint"); CHKERRQ(ierr);
+
+    // the incremental state variables are no longer needed; we use
+    // them as buffers for \tilde{\lambda}(X)
+    for (IntType k = 0; k < nb; ++k) {
+        ierr = GetRawPointer(this->m_BlockIncAdjointVariable[k], &p_lt[k]); CHKERRQ(ierr);
+        ierr = GetRawPointer(this->m_BlockIncStateVariable[k], &p_ltx[k]); CHKERRQ(ierr);
+        ierr = this->m_BlockWorkVecField[k]->SetValue(0.0); CHKERRQ(ierr);
+        ierr = this->m_BlockWorkVecField[k]->GetArrays(p_bt[3*k], p_bt[3*k+1], p_bt[3*k+2]); CHKERRQ(ierr);
+    }
+
+    ierr = GetRawPointer(this->m_StateVariable, &p_m); CHKERRQ(ierr);
+    ierr = this->m_WorkVecField1->GetArrays(p_gradm1, p_gradm2, p_gradm3); CHKERRQ(ierr);
+
+    for (IntType j = 0; j < nt/ts; ++j) {
+        lm = (nt-j*ts)*nc*nl;
+        if (j == 0) scale *= 0.5;
+        for (IntType c = 0; c < nc; ++c) {
+            ll = c*nl;
+
+            // interpolate \tilde{\lambda} for all vectors at once
+            for (IntType k = 0; k < nb; ++k) p_ltk[k] = p_lt[k] + ll;
+            ierr = slmethod->Interpolate(p_ltx.data(), p_ltk.data(),
+                                         static_cast<int>(nb), "adjoint"); CHKERRQ(ierr);
+
+            // compute gradient of m^j (shared by all vectors)
+            this->m_Opt->StartTimer(FFTSELFEXEC);
+            accfft_grad_t(p_gradm1, p_gradm2, p_gradm3, p_m + lm + c*nl, this->m_Opt->m_FFT.plan, &xyz, timer);
+            this->m_Opt->StopTimer(FFTSELFEXEC);
+            this->m_Opt->IncrementCounter(FFT, FFTGRAD);
+
+            for (IntType k = 0; k < nb; ++k) {
+                ScalarType *p_ltilde = p_ltk[k], *p_ltildex = p_ltx[k],
+                           *p_bt1 = p_bt[3*k], *p_bt2 = p_bt[3*k+1], *p_bt3 = p_bt[3*k+2];
+#pragma omp parallel
+{
+#pragma omp for
+                for (IntType i = 0; i < nl; ++i) {
+                    ScalarType ltilde  = p_ltilde[i];    // get \tilde{\lambda}(x)
+                    ScalarType ltildex = p_ltildex[i];   // get \tilde{\lambda}(X) (interpolated)
+
+                    // scale div(v)(X) by \tilde{\lambda}(X)
+                    ScalarType rhs0 = ltildex*p_divvx[i];
+
+                    // scale div(v) by \tilde{\lambda}*
+                    ScalarType rhs1 = (ltildex + ht*rhs0)*p_divv[i];
+
+                    // final rk2 step
+                    p_ltilde[i] = ltildex + hthalf*(rhs0 + rhs1);
+
+                    p_bt1[i] += scale*p_gradm1[i]*ltilde/static_cast<ScalarType>(nc);
+                    p_bt2[i] += scale*p_gradm2[i]*ltilde/static_cast<ScalarType>(nc);
+                    p_bt3[i] += scale*p_gradm3[i]*ltilde/static_cast<ScalarType>(nc);
+                }
+}  // omp
+            }
+        }  // for all image components
+        if (j == 0) scale *= 2.0;
+    }  // for all time points
+
+    // compute body force for last time point t = 0 (i.e., for j = nt)
+    for (IntType c = 0; c < nc; ++c) {  // for all image components
+        ll = c*nl; lm = c*nl;
+
+        // compute gradient of m (for incremental body force)
+        this->m_Opt->StartTimer(FFTSELFEXEC);
+        accfft_grad_t(p_gradm1, p_gradm2, p_gradm3, p_m + lm, this->m_Opt->m_FFT.plan, &xyz, timer);
+        this->m_Opt->StopTimer(FFTSELFEXEC);
+        this->m_Opt->IncrementCounter(FFT, FFTGRAD);
+
+        for (IntType k = 0; k < nb; ++k) {
+            ScalarType *p_ltilde = p_lt[k] + ll,
+                       *p_bt1 = p_bt[3*k], *p_bt2 = p_bt[3*k+1], *p_bt3 = p_bt[3*k+2];
+#pragma omp parallel
+{
+#pragma omp for
+            for (IntType i = 0; i < nl; ++i) {  // for all grid points
+                ScalarType ltilde = p_ltilde[i];
+                // compute bodyforce
+                p_bt1[i] += 0.5*scale*p_gradm1[i]*ltilde/static_cast<ScalarType>(nc);
+                p_bt2[i] += 0.5*scale*p_gradm2[i]*ltilde/static_cast<ScalarType>(nc);
+                p_bt3[i] += 0.5*scale*p_gradm3[i]*ltilde/static_cast<ScalarType>(nc);
+            }
+}  // omp
+        }
+    }
+
+    ierr = this->m_WorkVecField1->RestoreArrays(p_gradm1, p_gradm2, p_gradm3); CHKERRQ(ierr);
+    ierr = RestoreRawPointer(this->m_StateVariable, &p_m); CHKERRQ(ierr);
+    for (IntType k = 0; k < nb; ++k) {
+        ierr = this->m_BlockWorkVecField[k]->RestoreArrays(p_bt[3*k], p_bt[3*k+1], p_bt[3*k+2]); CHKERRQ(ierr);
+        ierr = RestoreRawPointer(this->m_BlockIncStateVariable[k], &p_ltx[k]); CHKERRQ(ierr);
+        ierr = RestoreRawPointer(this->m_BlockIncAdjointVariable[k], &p_lt[k]); CHKERRQ(ierr);
+    }
+    ierr = RestoreRawPointer(this->m_WorkScaField2, &p_divvx); CHKERRQ(ierr);
+    ierr = RestoreRawPointer(this->m_WorkScaField1, &p_divv); CHKERRQ(ierr);
+
+    // increment fft timer
+    this->m_Opt->IncreaseFFTTimers(timer);
+
+    ierr = this->m_Opt->StopTimer(PDEEXEC); CHKERRQ(ierr);
+
+    // increment counter
+    for (IntType k = 0; k < nb; ++k) this->m_Opt->IncrementCounter(PDESOLVE);
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief get the coarsening factor for the time grid and the
+ * semi-lagrangian method used in the hessian matvec; if the factor
+ * ts is larger than one (inexact hessian matvec), the incremental
+ * equations are solved with time step ts*ht (every ts-th time point
+ * of the state variable is used); this is only supported for the
+ * gauss-newton approximation (the incremental state variable is
+ * not stored at intermediate time points)
+ *******************************************************************/
+PetscErrorCode CLAIRE::SetupInexactHessMatVec(IntType& ts, SemiLagrangianType*& slmethod) {
+    PetscErrorCode ierr = 0;
+    IntType nt;
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    nt = this->m_Opt->m_Domain.nt;
+    ts = static_cast<IntType>(this->m_Opt->m_KrylovMethod.hessstride);
+    slmethod = this->m_SemiLagrangianMethod;
+
+    if ((this->m_Opt->m_OptPara.method != GAUSSNEWTON)
+     || (this->m_Opt->m_RegModel == STOKES)) {
+        ts = 1;
+    }
+
+    // coarse time grid has to be nested
+    while (ts > 1 && (nt % ts) != 0) ts /= 2;
+
+    if (ts > 1) {
+        if (this->m_InexactSemiLagrangianMethod == NULL) {
+            try {this->m_InexactSemiLagrangianMethod = new SemiLagrangianType(this->m_Opt);}
+            catch (std::bad_alloc& err) {
+                ierr = reg::ThrowError(err); CHKERRQ(ierr);
+            }
+            ierr = this->m_InexactSemiLagrangianMethod->SetWorkVecField(this->m_WorkVecField1); CHKERRQ(ierr);
+        }
+
+        // characteristics are only recomputed if the velocity or the
+        // coarsening changed (cached in the semi-lagrangian method)
+        ierr = this->m_InexactSemiLagrangianMethod->SetTimeStepScale(static_cast<ScalarType>(ts)); CHKERRQ(ierr);
+        ierr = this->m_InexactSemiLagrangianMethod->ComputeTrajectory(this->m_VelocityField, "state"); CHKERRQ(ierr);
+        ierr = this->m_InexactSemiLagrangianMethod->ComputeTrajectory(this->m_VelocityField, "adjoint"); CHKERRQ(ierr);
+        slmethod = this->m_InexactSemiLagrangianMethod;
+    }
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
 /********************************************************************
  * @brief solve the incremental adjoint problem (incremental
  * adjoint equation)
@@ -4240,8 +5021,9 @@ PetscErrorCode CLAIRE::Finalize(VecField* v) {
         ierr = VecNorm(this->m_WorkScaFieldMC, NORM_INFINITY, &value); CHKERRQ(ierr);
         this->m_Opt->LogFinalResidual(1, value);
 
-        // deformed template out (compute solution of state equation)
-        ierr = this->SolveStateEquation(); CHKERRQ(ierr);
+        // deformed template out (compute solution of state equation;
+        // in general, we have done so for the final iterate already)
+        ierr = this->UpdateStateVariable(false); CHKERRQ(ierr);
 
         // copy memory for m_1
         ierr = GetRawPointer(this->m_WorkScaFieldMC, &p_m1); CHKERRQ(ierr);
@@ -4338,9 +5120,14 @@ PetscErrorCode CLAIRE::Finalize(VecField* v) {
         ierr = RestoreRawPointer(this->m_ReferenceImage, &p_mr); CHKERRQ(ierr);
     }
 
-    // write velocity field to file
+    // write velocity field to file (all components to a single
+    // container if the user has selected an encoding)
     if (this->m_Opt->m_ReadWriteFlags.velocity) {
-        ierr = this->m_ReadWrite->Write(this->m_VelocityField, "velocity-field" + ext); CHKERRQ(ierr);
+        if (this->m_Opt->m_ReadWriteFlags.velencoding != VELNONE) {
+            ierr = this->m_ReadWrite->Write(this->m_VelocityField, "velocity-field.cvel"); CHKERRQ(ierr);
+        } else {
+            ierr = this->m_ReadWrite->Write(this->m_VelocityField, "velocity-field" + ext); CHKERRQ(ierr);
+        }
     }
 
     // write norm of velocity field to file
@@ -76,6 +76,7 @@ PetscErrorCode CLAIREBase::Initialize() {
     this->m_ReferenceImage = NULL;
 
     this->m_Mask = NULL;
+    this->m_RegWeight = NULL;
 
     // temporary internal variables (all of these have to be deleted)
     this->m_WorkScaField1 = NULL;
@@ -108,6 +109,15 @@ PetscErrorCode CLAIREBase::Initialize() {
     this->m_VelocityIsZero = false;          ///< flag: is velocity zero
     this->m_StoreTimeHistory = true;         ///< flag: store time history (needed for inversion)
 
+    this->m_StateCacheVelocity = NULL;       ///< velocity the state variable has been computed for
+    this->m_StateIsCached = false;           ///< flag: state variable is valid for cached velocity
+    this->m_StateCacheTimeHistory = false;   ///< flag: cached state includes time history
+    this->m_GradientEvaluated = true;        ///< flag: gradient evaluated since last objective evaluation
+
+    this->m_StateCheckpoint = NULL;          ///< state variable of last accepted solution
+    this->m_StateCheckpointVelocity = NULL;  ///< velocity of last accepted solution
+    this->m_StateCheckpointValid = false;    ///< flag: checkpoint is valid
+
     this->m_DeleteControlVariable = true;    ///< flag: clear memory for control variable
     this->m_DeleteIncControlVariable = true; ///< flag: clear memory for incremental control variable
 
@@ -210,18 +220,26 @@ PetscErrorCode CLAIREBase::ClearMemory() {
         this->m_WorkVecField5 = NULL;
     }
 
-    if (this->m_x1hat != NULL) {
-        accfft_free(this->m_x1hat);
-        this->m_x1hat = NULL;
+    if (this->m_StateCacheVelocity != NULL) {
+        delete this->m_StateCacheVelocity;
+        this->m_StateCacheVelocity = NULL;
     }
-    if (this->m_x2hat != NULL) {
-        accfft_free(this->m_x2hat);
-        this->m_x2hat = NULL;
+    this->m_StateIsCached = false;
+
+    if (this->m_StateCheckpoint != NULL) {
+        ierr = VecDestroy(&this->m_StateCheckpoint); CHKERRQ(ierr);
+        this->m_StateCheckpoint = NULL;
     }
-    if (this->m_x3hat != NULL) {
-        accfft_free(this->m_x3hat);
-        this->m_x3hat = NULL;
+    if (this->m_StateCheckpointVelocity != NULL) {
+        delete this->m_StateCheckpointVelocity;
+        this->m_StateCheckpointVelocity = NULL;
     }
+    this->m_StateCheckpointValid = false;
+
+    // spectral data is borrowed from the work arrays in m_Opt
+    this->m_x1hat = NULL;
+    this->m_x2hat = NULL;
+    this->m_x3hat = NULL;
 
     PetscFunctionReturn(ierr);
 }
@@ -230,23 +248,22 @@ PetscErrorCode CLAIREBase::ClearMemory() {
 
 
 /********************************************************************
- * @brief set read write operator
+ * @brief get containers for spectral data (leased from the spectral
+ * work arrays in m_Opt; we keep them for the lifetime of the problem,
+ * which lives on a single grid)
  *******************************************************************/
 PetscErrorCode CLAIREBase::SetupSpectralData() {
     PetscErrorCode ierr = 0;
-    IntType nalloc;
     PetscFunctionBegin;
 
-    nalloc = this->m_Opt->m_FFT.nalloc;
-
     if (this->m_x1hat == NULL) {
-        this->m_x1hat = reinterpret_cast<ComplexType*>(accfft_alloc(nalloc));
+        ierr = this->m_Opt->GetSpectralWorkspace(&this->m_x1hat); CHKERRQ(ierr);
     }
     if (this->m_x2hat == NULL) {
-        this->m_x2hat = reinterpret_cast<ComplexType*>(accfft_alloc(nalloc));
+        ierr = this->m_Opt->GetSpectralWorkspace(&this->m_x2hat); CHKERRQ(ierr);
     }
     if (this->m_x3hat == NULL) {
-        this->m_x3hat = reinterpret_cast<ComplexType*>(accfft_alloc(nalloc));
+        ierr = this->m_Opt->GetSpectralWorkspace(&this->m_x3hat); CHKERRQ(ierr);
     }
 
     PetscFunctionReturn(ierr);
@@ -311,6 +328,8 @@ PetscErrorCode CLAIREBase::SetTemplateImage(Vec mT) {
 
     // assign pointer
     this->m_TemplateImage = mT;
+    this->m_StateIsCached = false;
+    this->m_StateCheckpointValid = false;
     if (this->m_Opt->m_RegFlags.registerprobmaps) {
         ierr = EnsurePartitionOfUnity(this->m_TemplateImage, this->m_Opt->m_Domain.nc); CHKERRQ(ierr);
         ierr = ShowValues(this->m_TemplateImage, this->m_Opt->m_Domain.nc); CHKERRQ(ierr);
@@ -440,6 +459,55 @@ PetscErrorCode CLAIREBase::SetMask(Vec mask) {
 
 
 
+/********************************************************************
+ * @brief set spatially varying weight for regularization operator
+ * (enters as A[v] = -div(w grad v); not deleted)
+ *******************************************************************/
+PetscErrorCode CLAIREBase::SetRegularizationWeight(Vec w) {
+    PetscErrorCode ierr = 0;
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    ierr = Assert(w != NULL, "null pointer"); CHKERRQ(ierr);
+
+    // assign pointer
+    this->m_RegWeight = w;
+
+    // reset regularization model
+    if (this->m_Regularization != NULL) {
+        delete this->m_Regularization;
+        this->m_Regularization = NULL;
+    }
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief get spatially varying weight for regularization operator
+ * (can be a null pointer)
+ *******************************************************************/
+PetscErrorCode CLAIREBase::GetRegularizationWeight(Vec& w) {
+    PetscErrorCode ierr = 0;
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    w = this->m_RegWeight;
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
 /********************************************************************
  * @brief set auxilary variable
  *******************************************************************/
@@ -604,6 +672,77 @@ PetscErrorCode CLAIREBase::IsVelocityZero() {
 
 
 
+/********************************************************************
+ * @brief check if the state variable has been computed for the
+ * current velocity field (the state is cached for the velocity of
+ * the last forward solve)
+ * @param[out] cached true if state is valid for current velocity
+ * @param[in] timehistory flag: we need the full time history (if
+ * false, m(t=1) is sufficient)
+ *******************************************************************/
+PetscErrorCode CLAIREBase::IsStateCached(bool& cached, bool timehistory) {
+    PetscErrorCode ierr = 0;
+    PetscBool equal1 = PETSC_FALSE, equal2 = PETSC_FALSE, equal3 = PETSC_FALSE;
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    cached = false;
+    ierr = Assert(this->m_VelocityField != NULL, "null pointer"); CHKERRQ(ierr);
+
+    if (this->m_StateIsCached && this->m_StateCacheVelocity != NULL) {
+        if (this->m_StateCacheTimeHistory || !timehistory) {
+            ierr = VecEqual(this->m_VelocityField->m_X1, this->m_StateCacheVelocity->m_X1, &equal1); CHKERRQ(ierr);
+            ierr = VecEqual(this->m_VelocityField->m_X2, this->m_StateCacheVelocity->m_X2, &equal2); CHKERRQ(ierr);
+            ierr = VecEqual(this->m_VelocityField->m_X3, this->m_StateCacheVelocity->m_X3, &equal3); CHKERRQ(ierr);
+            cached = equal1 && equal2 && equal3;
+        }
+    }
+
+    if (this->m_Opt->m_Verbosity > 2 && cached) {
+        ierr = DbgMsg("state variable cached for current velocity"); CHKERRQ(ierr);
+    }
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief remember the velocity field the state variable has been
+ * computed for
+ * @param[in] timehistory flag: state includes full time history
+ *******************************************************************/
+PetscErrorCode CLAIREBase::CacheState(bool timehistory) {
+    PetscErrorCode ierr = 0;
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    ierr = Assert(this->m_VelocityField != NULL, "null pointer"); CHKERRQ(ierr);
+
+    if (this->m_StateCacheVelocity == NULL) {
+        try {this->m_StateCacheVelocity = new VecField(this->m_Opt);}
+        catch (std::bad_alloc& err) {
+            ierr = reg::ThrowError(err); CHKERRQ(ierr);
+        }
+    }
+    ierr = this->m_StateCacheVelocity->Copy(this->m_VelocityField); CHKERRQ(ierr);
+
+    this->m_StateIsCached = true;
+    this->m_StateCacheTimeHistory = timehistory;
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
 /********************************************************************
  * @brief allocate regularization model
  *******************************************************************/
@@ -700,6 +839,8 @@ PetscErrorCode CLAIREBase::SetupDistanceMeasure() {
  *******************************************************************/
 PetscErrorCode CLAIREBase::SetupRegularization() {
     PetscErrorCode ierr = 0;
+    IntType ng;
+    RegularizationVarCoeff* regvc = NULL;
     PetscFunctionBegin;
 
     this->m_Opt->Enter(__func__);
@@ -782,6 +923,26 @@ PetscErrorCode CLAIREBase::SetupRegularization() {
                                                    this->m_x2hat,
                                                    this->m_x3hat); CHKERRQ(ierr);
 
+    // spatially varying weight: the constant coefficient operator
+    // serves as preconditioner for the variable coefficient operator;
+    // the weight has to live on the current grid (it is restricted
+    // for grid continuation and for the coarse grid preconditioners)
+    if (this->m_RegWeight != NULL) {
+        ierr = VecGetSize(this->m_RegWeight, &ng); CHKERRQ(ierr);
+        ierr = Assert(ng == this->m_Opt->m_Domain.ng, "size of regularization weight does not match grid"); CHKERRQ(ierr);
+
+        try {regvc = new RegularizationVarCoeff(this->m_Opt);}
+        catch (std::bad_alloc&) {
+            ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
+        }
+        ierr = regvc->SetSpectralData(this->m_x1hat,
+                                      this->m_x2hat,
+                                      this->m_x3hat); CHKERRQ(ierr);
+        ierr = regvc->SetPreconditioner(this->m_Regularization); CHKERRQ(ierr);
+        ierr = regvc->SetWeight(this->m_RegWeight); CHKERRQ(ierr);
+        this->m_Regularization = regvc;
+    }
+
     this->m_Opt->Exit(__func__);
 
     PetscFunctionReturn(ierr);
@@ -84,18 +84,10 @@ PetscErrorCode CLAIREDivReg::ClearMemory() {
     PetscErrorCode ierr = 0;
     PetscFunctionBegin;
 
-    if (this->m_x1hat != NULL) {
-        accfft_free(this->m_x1hat);
-        this->m_x1hat = NULL;
-    }
-    if (this->m_x2hat != NULL) {
-        accfft_free(this->m_x2hat);
-        this->m_x2hat = NULL;
-    }
-    if (this->m_x3hat != NULL) {
-        accfft_free(this->m_x3hat);
-        this->m_x3hat = NULL;
-    }
+    // spectral data is borrowed from the work arrays in m_Opt
+    this->m_x1hat = NULL;
+    this->m_x2hat = NULL;
+    this->m_x3hat = NULL;
 
     PetscFunctionReturn(ierr);
 }
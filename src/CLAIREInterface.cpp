@@ -77,11 +77,13 @@ PetscErrorCode CLAIREInterface::Initialize(void) {
     this->m_RegProblem = NULL;
 
     this->m_Mask = NULL;
+    this->m_RegWeight = NULL;
     this->m_TemplateImage = NULL;
     this->m_ReferenceImage = NULL;
 
     this->m_TemplatePyramid = NULL;
     this->m_ReferencePyramid = NULL;
+    this->m_RegWeightPyramid = NULL;
 
     this->m_Solution = NULL;
 
@@ -148,6 +150,11 @@ PetscErrorCode CLAIREInterface::ClearMemory(void) {
         this->m_TemplatePyramid = NULL;
     }
 
+    if (this->m_RegWeightPyramid != NULL) {
+        delete this->m_RegWeightPyramid;
+        this->m_RegWeightPyramid = NULL;
+    }
+
     // if we did not read/set the images, we can
     // destroy the containers
     if (!this->m_IsReferenceSet) {
@@ -262,10 +269,12 @@ PetscErrorCode CLAIREInterface::SetReferenceImage(Vec mR) {
 
     nc = this->m_Opt->m_Domain.nc;
 
-    // by default we rescale the intensity range to [0,1]
-    if (this->m_Opt->m_RegFlags.applyrescaling) {
+    // by default we rescale the intensity range to [0,1] (unless
+    // this has been done when the image was read)
+    if (this->m_Opt->m_RegFlags.applyrescaling && !this->m_Opt->m_ReadWriteFlags.normalizedref) {
         ierr = Normalize(mR, nc); CHKERRQ(ierr);
     }
+    this->m_Opt->m_ReadWriteFlags.normalizedref = false;
 
 //    ierr = ShowValues(mR, nc); CHKERRQ(ierr);
 
@@ -295,6 +304,23 @@ PetscErrorCode CLAIREInterface::SetMask(Vec mask) {
 
 
 
+/********************************************************************
+ * @brief set spatially varying weight for the regularization
+ * operator (has to live on the finest grid)
+ *******************************************************************/
+PetscErrorCode CLAIREInterface::SetRegularizationWeight(Vec w) {
+    PetscErrorCode ierr = 0;
+    PetscFunctionBegin;
+
+    ierr = Assert(w != NULL, "null pointer"); CHKERRQ(ierr);
+    this->m_RegWeight = w;
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
 /********************************************************************
  * @brief set template image
  * we normalize the intensity values to [0,1]
@@ -308,10 +334,12 @@ PetscErrorCode CLAIREInterface::SetTemplateImage(Vec mT) {
 
     nc = this->m_Opt->m_Domain.nc;
 
-    // by default we rescale the intensity range to [0,1]
-    if (this->m_Opt->m_RegFlags.applyrescaling) {
+    // by default we rescale the intensity range to [0,1] (unless
+    // this has been done when the image was read)
+    if (this->m_Opt->m_RegFlags.applyrescaling && !this->m_Opt->m_ReadWriteFlags.normalizedtemp) {
         ierr = Normalize(mT, nc); CHKERRQ(ierr);
     }
+    this->m_Opt->m_ReadWriteFlags.normalizedtemp = false;
 
 //    ierr = ShowValues(mT, nc); CHKERRQ(ierr);
 
@@ -532,13 +560,13 @@ PetscErrorCode CLAIREInterface::SetupSolver() {
     // set up optimization/registration problem
     ierr = this->SetupRegProblem(); CHKERRQ(ierr);
 
-    // reset/setup preprocessing
-    if (this->m_PreProc != NULL) {
-        delete this->m_PreProc; this->m_PreProc = NULL;
-    }
-    try {this->m_PreProc = new Preprocessing(this->m_Opt);}
-    catch (std::bad_alloc& err) {
-        ierr = reg::ThrowError(err); CHKERRQ(ierr);
+    // setup preprocessing (we keep it across levels; it caches the
+    // grid change operators)
+    if (this->m_PreProc == NULL) {
+        try {this->m_PreProc = new Preprocessing(this->m_Opt);}
+        catch (std::bad_alloc& err) {
+            ierr = reg::ThrowError(err); CHKERRQ(ierr);
+        }
     }
 
     if (this->m_Opt->m_KrylovMethod.pctype != NOPC) {
@@ -634,6 +662,9 @@ PetscErrorCode CLAIREInterface::SetupData(Vec& mR, Vec& mT) {
             ierr = this->m_PreProc->Smooth(mask, this->m_Mask); CHKERRQ(ierr); */
             ierr = this->m_RegProblem->SetMask(this->m_Mask); CHKERRQ(ierr);
         }
+        if (this->m_RegWeight != NULL) {
+            ierr = this->m_RegProblem->SetRegularizationWeight(this->m_RegWeight); CHKERRQ(ierr);
+        }
 
     } else {
         // set up synthetic test problem
@@ -1003,7 +1034,7 @@ PetscErrorCode CLAIREInterface::RunSolverRegParaContBinarySearch() {
     // we hit tolerance
     stop = false; level = 0;
     while (level < maxsteps) {
-        this->m_Opt->m_RegNorm.beta[0] = beta;
+        ierr = this->m_Optimizer->SetRegularizationWeight(beta); CHKERRQ(ierr);
         //this->m_Opt->InitialGradNormSet(false);
 
         ss << std::scientific << std::setw(3)
@@ -1049,6 +1080,8 @@ PetscErrorCode CLAIREInterface::RunSolverRegParaContBinarySearch() {
             betastar = beta;
             // if we got here, the solution is valid
             ierr = this->m_Solution->SetComponents(x); CHKERRQ(ierr);
+            // keep state of accepted solution (next step is warm started from it)
+            ierr = this->m_RegProblem->CheckpointState(); CHKERRQ(ierr);
             // reduce beta
             beta *= betascale;
         }
@@ -1091,7 +1124,7 @@ PetscErrorCode CLAIREInterface::RunSolverRegParaContBinarySearch() {
 
     while (!stop) {
         // set regularization parameter
-        this->m_Opt->m_RegNorm.beta[0] = beta;
+        ierr = this->m_Optimizer->SetRegularizationWeight(beta); CHKERRQ(ierr);
 
         // display regularization parameter to user
         ss << std::setw(3) << "level " << level << " ( betav="
@@ -1129,6 +1162,8 @@ PetscErrorCode CLAIREInterface::RunSolverRegParaContBinarySearch() {
 
                 // if we got here, the solution is valid
                 ierr = this->m_Solution->SetComponents(x); CHKERRQ(ierr);
+                // keep state of accepted solution (next step is warm started from it)
+                ierr = this->m_RegProblem->CheckpointState(); CHKERRQ(ierr);
             }
         } else {
             ierr = WrngMsg("solver did not converge"); CHKERRQ(ierr);
@@ -1233,7 +1268,7 @@ PetscErrorCode CLAIREInterface::RunSolverRegParaContReductSearch() {
     level = 0;
     while (level < maxsteps) {
         // set regularization weight
-        this->m_Opt->m_RegNorm.beta[0] = beta;
+        ierr = this->m_Optimizer->SetRegularizationWeight(beta); CHKERRQ(ierr);
 
         // display message to user
         ss << std::scientific << std::setw(3) << "level " << level << " (beta=" << beta << ")";
@@ -1260,6 +1295,8 @@ PetscErrorCode CLAIREInterface::RunSolverRegParaContReductSearch() {
 
         // if we got here, the solution is valid
         ierr = this->m_Solution->SetComponents(x); CHKERRQ(ierr);
+        // keep state of accepted solution (next step is warm started from it)
+        ierr = this->m_RegProblem->CheckpointState(); CHKERRQ(ierr);
 
         beta *= betascale; // reduce beta
 
@@ -1332,7 +1369,7 @@ PetscErrorCode CLAIREInterface::RunSolverRegParaContReduction() {
 
     while (beta > betastar) {
         // set regularization weight
-        this->m_Opt->m_RegNorm.beta[0] = beta;
+        ierr = this->m_Optimizer->SetRegularizationWeight(beta); CHKERRQ(ierr);
 
         // display message to user
         ss << std::scientific << std::setw(3) << "level "
@@ -1351,7 +1388,7 @@ PetscErrorCode CLAIREInterface::RunSolverRegParaContReduction() {
     beta = betastar;
 
     // set regularization weight
-    this->m_Opt->m_RegNorm.beta[0] = beta;
+    ierr = this->m_Optimizer->SetRegularizationWeight(beta); CHKERRQ(ierr);
 
     // display message to user
     ss << std::scientific << std::setw(3)
@@ -1513,7 +1550,7 @@ PetscErrorCode CLAIREInterface::RunSolverGridCont() {
     std::stringstream ss;
     std::string ext;
     IntType nl, ng, isize[3], nx[3];
-    Vec mT = NULL, mR = NULL, xstar = NULL;
+    Vec mT = NULL, mR = NULL, w = NULL, xstar = NULL;
     VecField *v = NULL;
     ScalarType greltol, tolscale = 10;
     bool solve;
@@ -1529,7 +1566,6 @@ PetscErrorCode CLAIREInterface::RunSolverGridCont() {
             ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
         }
     }
-    this->m_PreProc->ResetGridChangeOps(true);
 
     if (!this->m_IsTemplateSet && !this->m_IsReferenceSet) {
         // do the setup
@@ -1576,6 +1612,26 @@ PetscErrorCode CLAIREInterface::RunSolverGridCont() {
     ierr = this->m_TemplatePyramid->SetPreProc(this->m_PreProc); CHKERRQ(ierr);
     ierr = this->m_TemplatePyramid->DoSetup(this->m_TemplateImage); CHKERRQ(ierr);
 
+    // allocate multilevel pyramid for regularization weight (we
+    // restrict log(w), so that the weight stays positive)
+    if (this->m_RegWeight != NULL) {
+        if (this->m_Opt->m_Verbosity > 2) {
+            ierr = DbgMsg("setup: regularization weight multilevel pyramid"); CHKERRQ(ierr);
+        }
+        if (this->m_RegWeightPyramid == NULL) {
+            try {this->m_RegWeightPyramid = new MultiLevelPyramid(this->m_Opt);}
+            catch (std::bad_alloc&) {
+                ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
+            }
+        }
+        ierr = VecDuplicate(this->m_RegWeight, &w); CHKERRQ(ierr);
+        ierr = VecCopy(this->m_RegWeight, w); CHKERRQ(ierr);
+        ierr = VecLog(w); CHKERRQ(ierr);
+        ierr = this->m_RegWeightPyramid->SetPreProc(this->m_PreProc); CHKERRQ(ierr);
+        ierr = this->m_RegWeightPyramid->DoSetup(w); CHKERRQ(ierr);
+        ierr = VecDestroy(&w); CHKERRQ(ierr); w = NULL;
+    }
+
     // get grid size
     for (int i = 0; i < 3; ++i) {
         nx[i] = this->m_Opt->m_GridCont.nx[0][i];
@@ -1681,6 +1737,14 @@ PetscErrorCode CLAIREInterface::RunSolverGridCont() {
             ierr = this->m_RegProblem->SetTemplateImage(mT); CHKERRQ(ierr);
             ierr = this->m_RegProblem->SetReferenceImage(mR); CHKERRQ(ierr);
 
+            // set regularization weight for current level
+            if (this->m_RegWeightPyramid != NULL) {
+                if (w != NULL) {ierr = VecDestroy(&w); CHKERRQ(ierr); w = NULL;}
+                ierr = this->m_RegWeightPyramid->GetLevel(&w, level); CHKERRQ(ierr);
+                ierr = VecExp(w); CHKERRQ(ierr);
+                ierr = this->m_RegProblem->SetRegularizationWeight(w); CHKERRQ(ierr);
+            }
+
             // compute initial gradient, objective and
             // distance mesure for zero velocity field
             ierr = this->m_RegProblem->InitializeOptimization(); CHKERRQ(ierr);
@@ -1728,6 +1792,7 @@ PetscErrorCode CLAIREInterface::RunSolverGridCont() {
     if (v != NULL) {delete v; v = NULL;};
     if (mR != NULL) {ierr = VecDestroy(&mR); CHKERRQ(ierr); mR = NULL;}
     if (mT != NULL) {ierr = VecDestroy(&mT); CHKERRQ(ierr); mT = NULL;}
+    if (w != NULL) {ierr = VecDestroy(&w); CHKERRQ(ierr); w = NULL;}
 
     PetscFunctionReturn(ierr);
 }
@@ -1760,7 +1825,6 @@ PetscErrorCode CLAIREInterface::ProlongVelocityField(VecField*& v, int level) {
             ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
         }
     }
-    this->m_PreProc->ResetGridChangeOps(true);
 
     // get number of grid points for current level
     for (int i = 0; i < 3; ++i) {
@@ -1788,8 +1852,6 @@ PetscErrorCode CLAIREInterface::ProlongVelocityField(VecField*& v, int level) {
     }
     ierr = v->Copy(v_f); CHKERRQ(ierr);
 
-    this->m_PreProc->ResetGridChangeOps(false);
-
     if (v_f != NULL) {delete v_f; v_f = NULL;}
 
     this->m_Opt->Exit(__func__);
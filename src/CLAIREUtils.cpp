@@ -486,88 +486,117 @@ PetscErrorCode VecCreate(Vec& x, IntType nl, IntType ng) {
 
 
 
+/********************************************************************
+ * @brief compute range (min and max values across all ranks) of
+ * each component of x; the min and max values of all components are
+ * reduced at once (we reduce the negative min values with a max
+ * reduction)
+ *******************************************************************/
+PetscErrorCode ComputeRange(Vec x, IntType nc, ScalarType* xmin, ScalarType* xmax) {
+    PetscErrorCode ierr = 0;
+    ScalarType *p_x = NULL;
+    std::vector<ScalarType> range;
+    IntType nl;
+    int rval;
+
+    PetscFunctionBegin;
+
+    try {range.resize(2*nc);}
+    catch (std::bad_alloc& err) {
+        ierr = ThrowError(err); CHKERRQ(ierr);
+    }
+
+    // compute local size from input vector
+    ierr = VecGetLocalSize(x, &nl); CHKERRQ(ierr);
+    nl /= nc;
+
+    ierr = VecGetArray(x, &p_x); CHKERRQ(ierr);
+    for (IntType k = 0; k < nc; ++k) {
+        ScalarType xlow = std::numeric_limits<ScalarType>::max();
+        ScalarType xhigh = std::numeric_limits<ScalarType>::lowest();
+#pragma omp parallel for reduction(min:xlow) reduction(max:xhigh)
+        for (IntType i = 0; i < nl; ++i) {
+            if (p_x[k*nl + i] < xlow) xlow = p_x[k*nl + i];
+            if (p_x[k*nl + i] > xhigh) xhigh = p_x[k*nl + i];
+        }
+        range[k] = -xlow;
+        range[nc + k] = xhigh;
+    }
+    ierr = VecRestoreArray(x, &p_x); CHKERRQ(ierr);
+
+    rval = MPI_Allreduce(MPI_IN_PLACE, range.data(), static_cast<int>(2*nc), MPIU_REAL, MPI_MAX, PETSC_COMM_WORLD);
+    ierr = MPIERRQ(rval); CHKERRQ(ierr);
+
+    for (IntType k = 0; k < nc; ++k) {
+        xmin[k] = -range[k];
+        xmax[k] = range[nc + k];
+    }
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
 /********************************************************************
  * @brief rescale data to [0,1]
  *******************************************************************/
 PetscErrorCode Normalize(Vec x, IntType nc) {
     PetscErrorCode ierr = 0;
-    ScalarType xmin, xmax, xmin_g, xmax_g, *p_x = NULL;
-    IntType nl, l;
-    int rval;
+    std::vector<ScalarType> xmin, xmax;
     std::stringstream ss;
 
     PetscFunctionBegin;
 
-    if (nc == 1) {
-        // get max and min values
-        ierr = VecMin(x, NULL, &xmin); CHKERRQ(ierr);
-        ierr = VecMax(x, NULL, &xmax); CHKERRQ(ierr);
+    try {xmin.resize(nc); xmax.resize(nc);}
+    catch (std::bad_alloc& err) {
+        ierr = ThrowError(err); CHKERRQ(ierr);
+    }
 
-        if (xmin < 0.0) {
+    // get max and min values
+    ierr = ComputeRange(x, nc, xmin.data(), xmax.data()); CHKERRQ(ierr);
+
+    for (IntType k = 0; k < nc; ++k) {
+        if (xmin[k] < 0.0) {
             ss << "negative values in input data detected "
-               << xmin << " (setting to zero)";
+               << xmin[k] << " (setting to zero)";
             ierr = WrngMsg(ss.str()); CHKERRQ(ierr);
             ss.clear(); ss.str(std::string());
-
-            // compute local size from input vector
-            ierr = VecGetLocalSize(x, &nl); CHKERRQ(ierr);
-
-            xmin = 0.0; // resetting
-            ierr = VecGetArray(x, &p_x); CHKERRQ(ierr);
-            for (IntType i = 0; i < nc*nl; ++i) {
-                if (p_x[i] < 0.0) p_x[i] = 0.0;
-            }
-            ierr = VecRestoreArray(x, &p_x); CHKERRQ(ierr);
         }
+    }
 
-        ierr = VecShift(x, -xmin); CHKERRQ(ierr);
-        ierr = VecScale(x, 1.0/xmax); CHKERRQ(ierr);
-    } else {
-        // compute local size from input vector
-        ierr = VecGetLocalSize(x, &nl); CHKERRQ(ierr);
-        nl /= nc;
-        ierr = VecGetArray(x, &p_x); CHKERRQ(ierr);
-        for (IntType k = 0; k < nc; ++k) {
-            xmin = std::numeric_limits<ScalarType>::max();
-            xmax = std::numeric_limits<ScalarType>::min();
+    ierr = Normalize(x, nc, xmin.data(), xmax.data()); CHKERRQ(ierr);
 
-            // get min and max values
-            for (IntType i = 0; i < nl; ++i) {
-                l = k*nl + i;
-                if (p_x[l] < xmin) {xmin = p_x[l];}
-                if (p_x[l] > xmax) {xmax = p_x[l];}
-            }
+    PetscFunctionReturn(ierr);
+}
 
-            // get min accross all procs
-            rval = MPI_Allreduce(&xmin, &xmin_g, 1, MPIU_REAL, MPI_MIN, PETSC_COMM_WORLD);
-            ierr = Assert(rval == MPI_SUCCESS, "mpi reduce returned error"); CHKERRQ(ierr);
 
-            // get max accross all procs
-            rval = MPI_Allreduce(&xmax, &xmax_g, 1, MPIU_REAL, MPI_MAX, PETSC_COMM_WORLD);
-            ierr = Assert(rval == MPI_SUCCESS, "mpi reduce returned error"); CHKERRQ(ierr);
 
-            if (xmin_g < 0.0) {
-                ss << "negative values in input data detected "
-                   << xmin << " (setting to zero)";
-                ierr = WrngMsg(ss.str()); CHKERRQ(ierr);
-                ss.clear(); ss.str(std::string());
 
-                xmin_g = 0.0; // resetting
-                for (IntType i = 0; i < nl; ++i) {
-                    if (p_x[k*nl + i] < 0.0) p_x[k*nl + i] = 0.0;
-                }
-            }
+/********************************************************************
+ * @brief rescale data to [0,1] for given range of each component
+ * (single pass over the data; negative values are set to zero)
+ *******************************************************************/
+PetscErrorCode Normalize(Vec x, IntType nc, const ScalarType* xmin, const ScalarType* xmax) {
+    PetscErrorCode ierr = 0;
+    ScalarType *p_x = NULL;
+    IntType nl;
 
-            // make sure we do not devide by zero
-            xmax_g = (xmax_g != 0.0) ? xmax_g : 1.0;
+    PetscFunctionBegin;
 
-            // apply shift and scale
-            for (IntType i = 0; i < nl; ++i) {
-                p_x[k*nl + i] = (p_x[k*nl + i] - xmin_g) / xmax_g;
-            }
-        }  // for all components
-        ierr = VecRestoreArray(x, &p_x); CHKERRQ(ierr);
-    }  // if else
+    // compute local size from input vector
+    ierr = VecGetLocalSize(x, &nl); CHKERRQ(ierr);
+    nl /= nc;
+
+    ierr = VecGetArray(x, &p_x); CHKERRQ(ierr);
+    for (IntType k = 0; k < nc; ++k) {
+        const ScalarType xlow = xmin[k], xhigh = xmax[k];
+#pragma omp parallel for
+        for (IntType i = 0; i < nl; ++i) {
+            p_x[k*nl + i] = NormalizeValue(p_x[k*nl + i], xlow, xhigh);
+        }
+    }  // for all components
+    ierr = VecRestoreArray(x, &p_x); CHKERRQ(ierr);
 
     PetscFunctionReturn(ierr);
 }
@@ -897,6 +926,72 @@ std::vector<int> String2Vec(const std::string & str, std::string sep) {
 }
 
 
+/********************************************************************
+ * @brief eigen decomposition of small dense symmetric matrix
+ * (cyclic jacobi method); the matrices we use this for are tiny
+ * (dimension of a low-dimensional subspace), so there is no need
+ * for lapack
+ * @param a symmetric matrix (row major; overwritten)
+ * @param v eigenvectors (row major; column j is j-th eigenvector)
+ * @param lambda eigenvalues
+ * @param n size of matrix
+ *******************************************************************/
+PetscErrorCode SymmetricEigenDecomposition(std::vector<ScalarType>& a,
+                                           std::vector<ScalarType>& v,
+                                           std::vector<ScalarType>& lambda,
+                                           int n) {
+    PetscErrorCode ierr = 0;
+    ScalarType off, nrm, theta, tr, c, s, akp, akq;
+    PetscFunctionBegin;
+
+    v.assign(n*n, 0.0);
+    for (int i = 0; i < n; ++i) v[i*n + i] = 1.0;
+
+    nrm = 0.0;
+    for (int i = 0; i < n*n; ++i) nrm += a[i]*a[i];
+
+    for (int sweep = 0; sweep < 100; ++sweep) {
+        off = 0.0;
+        for (int p = 0; p < n; ++p) {
+            for (int q = p+1; q < n; ++q) off += a[p*n + q]*a[p*n + q];
+        }
+        if (off <= std::numeric_limits<ScalarType>::epsilon()*std::numeric_limits<ScalarType>::epsilon()*nrm) break;
+
+        for (int p = 0; p < n; ++p) {
+            for (int q = p+1; q < n; ++q) {
+                if (a[p*n + q] == 0.0) continue;
+                theta = (a[q*n + q] - a[p*n + p])/(2.0*a[p*n + q]);
+                tr = (theta >= 0.0 ? 1.0 : -1.0)/(std::abs(theta) + std::sqrt(theta*theta + 1.0));
+                c = 1.0/std::sqrt(tr*tr + 1.0);
+                s = tr*c;
+                for (int k = 0; k < n; ++k) {
+                    akp = a[k*n + p]; akq = a[k*n + q];
+                    a[k*n + p] = c*akp - s*akq;
+                    a[k*n + q] = s*akp + c*akq;
+                }
+                for (int k = 0; k < n; ++k) {
+                    akp = a[p*n + k]; akq = a[q*n + k];
+                    a[p*n + k] = c*akp - s*akq;
+                    a[q*n + k] = s*akp + c*akq;
+                }
+                for (int k = 0; k < n; ++k) {
+                    akp = v[k*n + p]; akq = v[k*n + q];
+                    v[k*n + p] = c*akp - s*akq;
+                    v[k*n + q] = s*akp + c*akq;
+                }
+            }
+        }
+    }
+
+    lambda.resize(n);
+    for (int i = 0; i < n; ++i) lambda[i] = a[i*n + i];
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
 /********************************************************************
  * @brief return/restore raw pointers for vector for write/read purpose
  *******************************************************************/
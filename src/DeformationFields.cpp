@@ -671,8 +671,12 @@ PetscErrorCode DeformationFields::ComputeDetDefGradSL() {
     // store time series
     if (this->m_Opt->m_ReadWriteFlags.timeseries) {
         ss.str(std::string()); ss.clear();
-        ss << "det-deformation-grad-j=" << std::setw(3) << std::setfill('0') << 0 << ext;
-        ierr = this->m_ReadWrite->Write(this->m_WorkScaField1, ss.str()); CHKERRQ(ierr);
+        if (ext == ".nc") {  // all time points in single file
+            ierr = this->m_ReadWrite->WriteTimeSeries(this->m_WorkScaField1, "det-deformation-grad" + ext, 1, 0); CHKERRQ(ierr);
+        } else {
+            ss << "det-deformation-grad-j=" << std::setw(3) << std::setfill('0') << 0 << ext;
+            ierr = this->m_ReadWrite->Write(this->m_WorkScaField1, ss.str()); CHKERRQ(ierr);
+        }
     }
 
     // get pointers
@@ -716,8 +720,12 @@ PetscErrorCode DeformationFields::ComputeDetDefGradSL() {
         if (this->m_Opt->m_ReadWriteFlags.timeseries) {
             ierr = RestoreRawPointer(this->m_WorkScaField1, &p_jac); CHKERRQ(ierr);
             ss.str(std::string()); ss.clear();
-            ss << "det-deformation-grad-j=" << std::setw(3) << std::setfill('0') << j+1 << ext;
-            ierr = this->m_ReadWrite->Write(this->m_WorkScaField1, ss.str()); CHKERRQ(ierr);
+            if (ext == ".nc") {  // all time points in single file
+                ierr = this->m_ReadWrite->WriteTimeSeries(this->m_WorkScaField1, "det-deformation-grad" + ext, 1, j+1); CHKERRQ(ierr);
+            } else {
+                ss << "det-deformation-grad-j=" << std::setw(3) << std::setfill('0') << j+1 << ext;
+                ierr = this->m_ReadWrite->Write(this->m_WorkScaField1, ss.str()); CHKERRQ(ierr);
+            }
             ierr = GetRawPointer(this->m_WorkScaField1, &p_jac); CHKERRQ(ierr);
         }
     }  // for all time points
@@ -1497,8 +1505,12 @@ PetscErrorCode DeformationFields::ComputeDeformationMapSLRK2() {
     if (this->m_Opt->m_ReadWriteFlags.timeseries ) {
         ierr = Assert(this->m_ReadWrite != NULL, "null pointer"); CHKERRQ(ierr);
         ss.str(std::string()); ss.clear();
-        ss << "deformation-map-j=" << std::setw(3) << std::setfill('0') << 0 << ext;
-        ierr = this->m_ReadWrite->Write(this->m_WorkVecField1,ss.str()); CHKERRQ(ierr);
+        if (ext == ".nc") {  // all time points in single file
+            ierr = this->m_ReadWrite->WriteTimeSeries(this->m_WorkVecField1, "deformation-map" + ext, 0); CHKERRQ(ierr);
+        } else {
+            ss << "deformation-map-j=" << std::setw(3) << std::setfill('0') << 0 << ext;
+            ierr = this->m_ReadWrite->Write(this->m_WorkVecField1, ss.str()); CHKERRQ(ierr);
+        }
     }
 
 
@@ -1559,8 +1571,12 @@ PetscErrorCode DeformationFields::ComputeDeformationMapSLRK2() {
             ierr = Assert(this->m_ReadWrite != NULL, "null pointer"); CHKERRQ(ierr);
             ierr = this->m_WorkVecField1->RestoreArrays(p_y1, p_y2, p_y3); CHKERRQ(ierr);
             ss.str(std::string()); ss.clear();
-            ss << "deformation-map-j=" << std::setw(3) << std::setfill('0') << j+1 << ext;
-            ierr = this->m_ReadWrite->Write(this->m_WorkVecField1, ss.str()); CHKERRQ(ierr);
+            if (ext == ".nc") {  // all time points in single file
+                ierr = this->m_ReadWrite->WriteTimeSeries(this->m_WorkVecField1, "deformation-map" + ext, j+1); CHKERRQ(ierr);
+            } else {
+                ss << "deformation-map-j=" << std::setw(3) << std::setfill('0') << j+1 << ext;
+                ierr = this->m_ReadWrite->Write(this->m_WorkVecField1, ss.str()); CHKERRQ(ierr);
+            }
             ierr = this->m_WorkVecField1->GetArrays(p_y1, p_y2, p_y3); CHKERRQ(ierr);
         }
     } // for all time points
@@ -1614,8 +1630,12 @@ PetscErrorCode DeformationFields::ComputeDeformationMapSLRK4() {
     if (this->m_Opt->m_ReadWriteFlags.timeseries ) {
         ierr = Assert(this->m_ReadWrite != NULL, "null pointer"); CHKERRQ(ierr);
         ss.str(std::string()); ss.clear();
-        ss << "deformation-map-j=" << std::setw(3) << std::setfill('0') << 0 << ext;
-        ierr = this->m_ReadWrite->Write(this->m_WorkVecField1,ss.str()); CHKERRQ(ierr);
+        if (ext == ".nc") {  // all time points in single file
+            ierr = this->m_ReadWrite->WriteTimeSeries(this->m_WorkVecField1, "deformation-map" + ext, 0); CHKERRQ(ierr);
+        } else {
+            ss << "deformation-map-j=" << std::setw(3) << std::setfill('0') << 0 << ext;
+            ierr = this->m_ReadWrite->Write(this->m_WorkVecField1, ss.str()); CHKERRQ(ierr);
+        }
     }
 
     nt = this->m_Opt->m_Domain.nt;
@@ -1717,8 +1737,12 @@ PetscErrorCode DeformationFields::ComputeDeformationMapSLRK4() {
             ierr = Assert(this->m_ReadWrite != NULL, "null pointer"); CHKERRQ(ierr);
             ierr = this->m_WorkVecField1->RestoreArrays(p_y1, p_y2, p_y3); CHKERRQ(ierr);
             ss.str(std::string()); ss.clear();
-            ss << "deformation-map-j=" << std::setw(3) << std::setfill('0') << j+1 << ext;
-            ierr = this->m_ReadWrite->Write(this->m_WorkVecField1, ss.str()); CHKERRQ(ierr);
+            if (ext == ".nc") {  // all time points in single file
+                ierr = this->m_ReadWrite->WriteTimeSeries(this->m_WorkVecField1, "deformation-map" + ext, j+1); CHKERRQ(ierr);
+            } else {
+                ss << "deformation-map-j=" << std::setw(3) << std::setfill('0') << j+1 << ext;
+                ierr = this->m_ReadWrite->Write(this->m_WorkVecField1, ss.str()); CHKERRQ(ierr);
+            }
             ierr = this->m_WorkVecField1->GetArrays(p_y1, p_y2, p_y3); CHKERRQ(ierr);
         }
     }  // for all time points
@@ -62,6 +62,152 @@ PetscErrorCode KrylovMonitor(KSP krylovmethod, IntType it,
 
     optprob->GetOptions()->m_KrylovMethod.iter = it;
 
+    // adapt fidelity of hessian matvec to current residual
+    if (optprob->GetOptions()->m_KrylovMethod.hessmaxstride > 1) {
+        ierr = UpdateHessMatVecFidelity(optprob->GetOptions(), it, rnorm); CHKERRQ(ierr);
+    }
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/****************************************************************************
+ * @brief set the fidelity of the (inexact) hessian matvec; the time grid
+ * of the incremental equations is coarsened by a factor ts during the
+ * first krylov iterations; the factor is halved as the relative residual
+ * approaches the tolerance (the matvecs have to be more accurate as the
+ * residual decreases); we never coarsen again within one solve; the
+ * last part of the solve uses exact matvecs
+ * @para[in] opt registration options
+ * @para[in] it current krylov iteration
+ * @para[in] rnorm norm of current residual
+ ****************************************************************************/
+PetscErrorCode UpdateHessMatVecFidelity(RegOpt* opt, IntType it, ScalarType rnorm) {
+    PetscErrorCode ierr = 0;
+    ScalarType relres, reltol, progress;
+    int ts, nlevels, level;
+    std::stringstream ss;
+    PetscFunctionBegin;
+
+    if (it == 0 || opt->m_KrylovMethod.r0norm <= 0.0) {
+        opt->m_KrylovMethod.r0norm = rnorm;
+        PetscFunctionReturn(ierr);
+    }
+
+    relres = rnorm/opt->m_KrylovMethod.r0norm;
+    reltol = opt->m_KrylovMethod.reltol;
+
+    // progress towards tolerance (on a log scale; in [0,1])
+    progress = 1.0;
+    if (relres > 0.0 && relres < 1.0 && reltol > 0.0 && reltol < 1.0) {
+        progress = std::log(relres)/std::log(reltol);
+    } else if (relres >= 1.0) {
+        progress = 0.0;
+    }
+    progress = std::max(static_cast<ScalarType>(0.0), std::min(static_cast<ScalarType>(1.0), progress));
+
+    // number of coarsening levels (the max factor is a power of two)
+    nlevels = 0;
+    for (ts = opt->m_KrylovMethod.hessmaxstride; ts > 1; ts /= 2) ++nlevels;
+
+    level = static_cast<int>(std::floor(progress*static_cast<ScalarType>(nlevels + 1)));
+    ts = level > nlevels ? 1 : (opt->m_KrylovMethod.hessmaxstride >> level);
+    ts = std::max(1, std::min(ts, opt->m_KrylovMethod.hessstride));
+
+    if (ts != opt->m_KrylovMethod.hessstride) {
+        if (opt->m_Verbosity > 1) {
+            ss << "inexact hessian: time step coarsening " << opt->m_KrylovMethod.hessstride
+               << " -> " << ts << " (relres=" << std::scientific << relres << ")";
+            ierr = DbgMsg(ss.str()); CHKERRQ(ierr);
+        }
+        opt->m_KrylovMethod.hessstride = ts;
+    }
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/****************************************************************************
+ * @brief convergence test for krylov method with inexact hessian matvecs;
+ * the flexible methods only tolerate a varying preconditioner; with a
+ * varying operator the recursively updated residual drifts away from the
+ * true residual b - Hx; if the recursive residual meets the tolerance, we
+ * switch to exact matvecs and compute the true residual once; if the true
+ * residual does not meet the tolerance we keep iterating and tighten the
+ * target for the recursive residual by the observed gap
+ * @para[in] krylovmethod pointer to krylov method
+ * @para[in] it current krylov iteration
+ * @para[in] rnorm norm of (recursively updated) residual
+ * @para[out] reason convergence reason
+ ****************************************************************************/
+PetscErrorCode KrylovConvergenceTest(KSP krylovmethod, IntType it, ScalarType rnorm,
+                                     KSPConvergedReason* reason, void* ptr) {
+    PetscErrorCode ierr = 0;
+    ScalarType reltol, abstol, divtol, tol, truenorm;
+    IntType maxit;
+    OptimizationProblem* optprob = NULL;
+    RegOpt* opt = NULL;
+    Vec r = NULL;
+    std::stringstream ss;
+
+    PetscFunctionBegin;
+
+    optprob = reinterpret_cast<OptimizationProblem*>(ptr);
+    ierr = Assert(optprob != NULL, "null pointer"); CHKERRQ(ierr);
+    opt = optprob->GetOptions();
+
+    *reason = KSP_CONVERGED_ITERATING;
+
+    if (PetscIsInfOrNanReal(rnorm)) {
+        *reason = KSP_DIVERGED_NANORINF;
+        PetscFunctionReturn(ierr);
+    }
+
+    ierr = KSPGetTolerances(krylovmethod, &reltol, &abstol, &divtol, &maxit); CHKERRQ(ierr);
+
+    if (it == 0) {
+        opt->m_KrylovMethod.rnorm0 = rnorm;
+        opt->m_KrylovMethod.rtargetnorm = 0.0;
+    }
+    tol = PetscMax(reltol*opt->m_KrylovMethod.rnorm0, abstol);
+
+    if (divtol > 0.0 && rnorm > divtol*opt->m_KrylovMethod.rnorm0) {
+        *reason = KSP_DIVERGED_DTOL;
+        PetscFunctionReturn(ierr);
+    }
+
+    // recursive residual has not yet reached the (tightened) target
+    if (rnorm > tol) PetscFunctionReturn(ierr);
+    if (opt->m_KrylovMethod.rtargetnorm > 0.0 && rnorm > opt->m_KrylovMethod.rtargetnorm) {
+        PetscFunctionReturn(ierr);
+    }
+
+    // compute true residual with exact hessian matvec
+    opt->m_KrylovMethod.hessstride = 1;
+    ierr = KSPBuildResidual(krylovmethod, NULL, NULL, &r); CHKERRQ(ierr);
+    ierr = VecNorm(r, NORM_2, &truenorm); CHKERRQ(ierr);
+    ierr = VecDestroy(&r); CHKERRQ(ierr);
+
+    if (opt->m_Verbosity > 1) {
+        ss << "inexact hessian: ||r||_2 = " << std::scientific << rnorm
+           << " (recursive), " << truenorm << " (true)";
+        ierr = DbgMsg(ss.str()); CHKERRQ(ierr);
+    }
+
+    if (truenorm <= tol) {
+        *reason = truenorm <= abstol ? KSP_CONVERGED_ATOL : KSP_CONVERGED_RTOL;
+    } else if (!PetscIsInfOrNanReal(truenorm)) {
+        // the recursive residual underestimates the true residual;
+        // continue (with exact matvecs) until the gap is closed
+        opt->m_KrylovMethod.rtargetnorm = rnorm*tol/truenorm;
+    } else {
+        *reason = KSP_DIVERGED_NANORINF;
+    }
+
     PetscFunctionReturn(ierr);
 }
 
@@ -84,6 +230,7 @@ PetscErrorCode PreKrylovSolve(KSP krylovmethod, Vec b, Vec x, void* ptr) {
     std::stringstream ss;
     std::string msg;
     OptimizationProblem* optprob = NULL;
+    Mat hessian = NULL;
 
     PetscFunctionBegin;
 
@@ -180,6 +327,19 @@ PetscErrorCode PreKrylovSolve(KSP krylovmethod, Vec b, Vec x, void* ptr) {
         ierr = optprob->HessianSymmetryCheck(); CHKERRQ(ierr);
     }
 
+    // set up deflation with recycled basis from previous solves (before
+    // we switch to the inexact hessian; we deflate the exact hessian)
+    if (optprob->GetKrylovRecycler() != NULL) {
+        ierr = KSPGetOperators(krylovmethod, &hessian, NULL); CHKERRQ(ierr);
+        ierr = optprob->GetKrylovRecycler()->PreSolve(hessian, b, x); CHKERRQ(ierr);
+    }
+
+    // start with reduced fidelity for hessian matvecs (inexact newton
+    // krylov); the fidelity is increased in the krylov monitor
+    optprob->GetOptions()->m_KrylovMethod.hessstride = optprob->GetOptions()->m_KrylovMethod.hessmaxstride;
+    optprob->GetOptions()->m_KrylovMethod.r0norm = 0.0;
+    optprob->GetOptions()->m_KrylovMethod.rtargetnorm = 0.0;
+
     PetscFunctionReturn(ierr);
 }
 
@@ -207,6 +367,14 @@ PetscErrorCode PostKrylovSolve(KSP krylovmethod, Vec b, Vec x, void* ptr) {
     optprob = reinterpret_cast<OptimizationProblem*>(ptr);
     ierr = Assert(optprob != NULL, "null pointer"); CHKERRQ(ierr);
 
+    // update recycled basis (before the solution is postprocessed)
+    if (optprob->GetKrylovRecycler() != NULL) {
+        ierr = optprob->GetKrylovRecycler()->PostSolve(); CHKERRQ(ierr);
+    }
+
+    // switch back to exact hessian matvecs
+    optprob->GetOptions()->m_KrylovMethod.hessstride = 1;
+
     // apply hessian
     ierr = optprob->PostKrylovSolve(b, x); CHKERRQ(ierr);
 
@@ -522,6 +690,15 @@ PetscErrorCode InvertPrecondPreKrylovSolve(KSP krylovmethod, Vec b,
         }
     }
 
+    // for the multilevel preconditioner we only invert the hessian
+    // on the coarsest level; the solve is cheap and we use a fixed
+    // tolerance to keep the cycle (nearly) a fixed linear operator
+    if (precond->GetOptions()->m_KrylovMethod.pctype == MULTILEVEL
+     && precond->GetOptions()->m_KrylovMethod.pcsolver != CHEB) {
+        reltol = precond->GetOptions()->m_KrylovMethod.mgcoarsetol;
+        maxits = 1E3;
+    }
+
     reltol = std::max(reltol, lowerbound);  // make sure tolerance is non-zero
     reltol = std::min(reltol, upperbound);   // make sure tolerance smaller than 0.25
 
@@ -0,0 +1,550 @@
+/*************************************************************************
+ *  Copyright (c) 2016.
+ *  All rights reserved.
+ *  This file is part of the CLAIRE library.
+ *
+ *  CLAIRE is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  CLAIRE is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with CLAIRE.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+#ifndef _KRYLOVRECYCLER_CPP_
+#define _KRYLOVRECYCLER_CPP_
+
+#include <limits>
+#include <algorithm>
+#include "KrylovRecycler.hpp"
+
+
+
+
+namespace reg {
+
+
+
+
+/********************************************************************
+ * @brief default constructor
+ *******************************************************************/
+KrylovRecycler::KrylovRecycler() {
+    this->Initialize();
+}
+
+
+
+
+/********************************************************************
+ * @brief constructor
+ *******************************************************************/
+KrylovRecycler::KrylovRecycler(RegOpt* opt) {
+    this->Initialize();
+    this->m_Opt = opt;
+}
+
+
+
+
+/********************************************************************
+ * @brief default destructor
+ *******************************************************************/
+KrylovRecycler::~KrylovRecycler() {
+    this->ClearMemory();
+    if (this->m_PC != NULL) {
+        PCDestroy(&this->m_PC);
+        this->m_PC = NULL;
+    }
+}
+
+
+
+
+/********************************************************************
+ * @brief init variables
+ *******************************************************************/
+PetscErrorCode KrylovRecycler::Initialize() {
+    PetscFunctionBegin;
+
+    this->m_Opt = NULL;
+    this->m_PC = NULL;
+    this->m_UpdateHW = false;
+    this->m_NumRecorded = 0;
+    this->m_Recording = false;
+
+    PetscFunctionReturn(0);
+}
+
+
+
+
+/********************************************************************
+ * @brief clean up
+ *******************************************************************/
+PetscErrorCode KrylovRecycler::ClearMemory() {
+    PetscErrorCode ierr = 0;
+    PetscFunctionBegin;
+
+    ierr = this->ClearVectors(this->m_W); CHKERRQ(ierr);
+    ierr = this->ClearVectors(this->m_HW); CHKERRQ(ierr);
+    ierr = this->ClearVectors(this->m_V); CHKERRQ(ierr);
+    ierr = this->ClearVectors(this->m_HV); CHKERRQ(ierr);
+    this->m_Theta.clear();
+    this->m_EInv.clear();
+
+    this->m_UpdateHW = false;
+    this->m_NumRecorded = 0;
+    this->m_Recording = false;
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief destroy all vectors in container
+ *******************************************************************/
+PetscErrorCode KrylovRecycler::ClearVectors(std::vector<Vec>& x) {
+    PetscErrorCode ierr = 0;
+    PetscFunctionBegin;
+
+    for (size_t i = 0; i < x.size(); ++i) {
+        if (x[i] != NULL) {
+            ierr = VecDestroy(&x[i]); CHKERRQ(ierr);
+            x[i] = NULL;
+        }
+    }
+    x.clear();
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief delete recycled basis (e.g., if the problem size changes)
+ *******************************************************************/
+PetscErrorCode KrylovRecycler::Reset() {
+    PetscErrorCode ierr = 0;
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    ierr = this->ClearMemory(); CHKERRQ(ierr);
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief rescale the recycled basis after the regularization weight
+ * changed (parameter continuation); we only update the regularization
+ * part of H W (for the analytically preconditioned hessian
+ * H = I + (1/beta) M we use H W = W + scale*(H W - W)); the data part
+ * is assumed to be unchanged, so H W is an approximation (it is
+ * recomputed after the next accepted newton update)
+ * @param scale ratio between old and new regularization weight
+ *******************************************************************/
+PetscErrorCode KrylovRecycler::Rescale(ScalarType scale) {
+    PetscErrorCode ierr = 0;
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    // H W = W + scale*(H W - W)
+    for (size_t i = 0; i < this->m_W.size(); ++i) {
+        ierr = VecAXPBY(this->m_HW[i], 1.0 - scale, scale, this->m_W[i]); CHKERRQ(ierr);
+        this->m_Theta[i] = 1.0 + scale*(this->m_Theta[i] - 1.0);
+    }
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief set the preconditioner that is wrapped by the deflation
+ * projector (see ApplyPreconditioner); we take ownership
+ * @param pc preconditioner (shell or none)
+ *******************************************************************/
+PetscErrorCode KrylovRecycler::SetPreconditioner(PC pc) {
+    PetscErrorCode ierr = 0;
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    if (this->m_PC != NULL) {
+        ierr = PCDestroy(&this->m_PC); CHKERRQ(ierr);
+        this->m_PC = NULL;
+    }
+    this->m_PC = pc;
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief set up deflation for the current hessian; we reuse the stored
+ * H W (computed from the matvecs of the last solve and updated if the
+ * regularization weight changes); we only apply the hessian to the
+ * recycled basis if a newton update has been accepted since H W was
+ * computed; we compute E = W^T H W and its inverse, and set the
+ * initial guess x_0 = W E^{-1} W^T b (the initial residual is
+ * orthogonal to W); afterwards we start recording the hessian matvecs
+ * @param H hessian operator of the krylov method
+ * @param b right hand side
+ * @param x initial guess
+ *******************************************************************/
+PetscErrorCode KrylovRecycler::PreSolve(Mat H, Vec b, Vec x) {
+    PetscErrorCode ierr = 0;
+    IntType n, nw, k;
+    std::vector<ScalarType> e, q, lambda, alpha, beta;
+    ScalarType lmax, tol;
+    std::stringstream ss;
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    ierr = Assert(H != NULL, "null pointer"); CHKERRQ(ierr);
+    ierr = Assert(b != NULL, "null pointer"); CHKERRQ(ierr);
+    ierr = Assert(x != NULL, "null pointer"); CHKERRQ(ierr);
+
+    // problem size has changed (grid continuation); basis is invalid
+    if (!this->m_V.empty() || !this->m_W.empty()) {
+        ierr = VecGetSize(b, &n); CHKERRQ(ierr);
+        ierr = VecGetSize(this->m_W.empty() ? this->m_V[0] : this->m_W[0], &nw); CHKERRQ(ierr);
+        if (n != nw) {
+            ierr = this->ClearMemory(); CHKERRQ(ierr);
+        }
+    }
+
+    // wrapped preconditioner is applied to the current hessian
+    if (this->m_PC != NULL) {
+        ierr = PCSetOperators(this->m_PC, H, H); CHKERRQ(ierr);
+    }
+
+    k = static_cast<IntType>(this->m_W.size());
+    this->m_EInv.clear();
+    if (k == 0) {
+        ierr = VecSet(x, 0.0); CHKERRQ(ierr);
+    } else {
+        // H W for current hessian (newton update accepted) and E = W^T H W
+        e.resize(k*k);
+        if (this->m_UpdateHW) {
+            for (IntType i = 0; i < k; ++i) {
+                ierr = MatMult(H, this->m_W[i], this->m_HW[i]); CHKERRQ(ierr);
+            }
+        }
+        for (IntType i = 0; i < k; ++i) {
+            ierr = VecMDot(this->m_W[i], k, this->m_HW.data(), &e[i*k]); CHKERRQ(ierr);
+        }
+        for (IntType i = 0; i < k; ++i) {
+            for (IntType j = i+1; j < k; ++j) {
+                e[i*k + j] = 0.5*(e[i*k + j] + e[j*k + i]);
+                e[j*k + i] = e[i*k + j];
+            }
+        }
+
+        // pseudo inverse E^{-1} = Q Lambda^{-1} Q^T (we drop directions
+        // for which the hessian is not positive definite)
+        ierr = SymmetricEigenDecomposition(e, q, lambda, static_cast<int>(k)); CHKERRQ(ierr);
+        lmax = 0.0;
+        for (IntType i = 0; i < k; ++i) lmax = std::max(lmax, lambda[i]);
+        tol = 1E3*std::numeric_limits<ScalarType>::epsilon()*lmax;
+        this->m_EInv.assign(k*k, 0.0);
+        for (IntType l = 0; l < k; ++l) {
+            if (lambda[l] <= tol) continue;
+            for (IntType i = 0; i < k; ++i) {
+                for (IntType j = 0; j < k; ++j) {
+                    this->m_EInv[i*k + j] += q[i*k + l]*q[j*k + l]/lambda[l];
+                }
+            }
+        }
+
+        // x_0 = W E^{-1} W^T b
+        alpha.resize(k); beta.assign(k, 0.0);
+        ierr = VecMDot(b, k, this->m_W.data(), alpha.data()); CHKERRQ(ierr);
+        for (IntType i = 0; i < k; ++i) {
+            for (IntType j = 0; j < k; ++j) {
+                beta[i] += this->m_EInv[i*k + j]*alpha[j];
+            }
+        }
+        ierr = VecSet(x, 0.0); CHKERRQ(ierr);
+        ierr = VecMAXPY(x, k, beta.data(), this->m_W.data()); CHKERRQ(ierr);
+
+        if (this->m_Opt->m_Verbosity > 1) {
+            ss << "krylov recycling: deflating hessian system (basis size " << k << ")";
+            ierr = DbgMsg(ss.str()); CHKERRQ(ierr);
+            ss.clear(); ss.str(std::string());
+        }
+    }
+
+    this->m_UpdateHW = false;
+    this->m_NumRecorded = 0;
+    this->m_Recording = true;
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief apply the deflation projector P = I - W E^{-1} (H W)^T,
+ * E = W^T H W, to a vector (in place)
+ * @param x vector to be projected
+ *******************************************************************/
+PetscErrorCode KrylovRecycler::Project(Vec x) {
+    PetscErrorCode ierr = 0;
+    IntType k;
+    std::vector<ScalarType> alpha, beta;
+    PetscFunctionBegin;
+
+    k = static_cast<IntType>(this->m_W.size());
+    if (k == 0 || static_cast<IntType>(this->m_EInv.size()) != k*k) {
+        PetscFunctionReturn(ierr);
+    }
+
+    // x = x - W E^{-1} (H W)^T x
+    alpha.resize(k); beta.assign(k, 0.0);
+    ierr = VecMDot(x, k, this->m_HW.data(), alpha.data()); CHKERRQ(ierr);
+    for (IntType i = 0; i < k; ++i) {
+        for (IntType j = 0; j < k; ++j) {
+            beta[i] -= this->m_EInv[i*k + j]*alpha[j];
+        }
+    }
+    ierr = VecMAXPY(x, k, beta.data(), this->m_W.data()); CHKERRQ(ierr);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief apply the preconditioner followed by the deflation
+ * projector, i.e., Px = (I - W E^{-1} (H W)^T) M^{-1} x; together
+ * with the initial guess set in PreSolve this yields the deflated
+ * krylov method (the recycled directions are removed from the
+ * search space)
+ * @param px preconditioned vector
+ * @param x input vector
+ *******************************************************************/
+PetscErrorCode KrylovRecycler::ApplyPreconditioner(Vec px, Vec x) {
+    PetscErrorCode ierr = 0;
+    PetscFunctionBegin;
+
+    if (this->m_PC != NULL) {
+        ierr = PCApply(this->m_PC, x, px); CHKERRQ(ierr);
+    } else {
+        ierr = VecCopy(x, px); CHKERRQ(ierr);
+    }
+    ierr = this->Project(px); CHKERRQ(ierr);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief record input and output of hessian matvec; we only keep
+ * the first few directions of every solve (the extremal part of
+ * the spectrum is resolved first by the krylov method)
+ * @param x input of hessian matvec
+ * @param hx output of hessian matvec
+ *******************************************************************/
+PetscErrorCode KrylovRecycler::Record(Vec x, Vec hx) {
+    PetscErrorCode ierr = 0;
+    IntType nmax;
+    PetscFunctionBegin;
+
+    if (!this->m_Recording) PetscFunctionReturn(ierr);
+
+    // reduced fidelity matvecs (inexact hessian) do not belong to the
+    // hessian we deflate
+    if (this->m_Opt->m_KrylovMethod.hessstride > 1) PetscFunctionReturn(ierr);
+
+    nmax = 2*this->m_Opt->m_KrylovMethod.nrecycle + 10;
+    if (this->m_NumRecorded >= nmax) PetscFunctionReturn(ierr);
+
+    if (static_cast<IntType>(this->m_V.size()) <= this->m_NumRecorded) {
+        this->m_V.push_back(NULL);
+        this->m_HV.push_back(NULL);
+        ierr = VecDuplicate(x, &this->m_V.back()); CHKERRQ(ierr);
+        ierr = VecDuplicate(hx, &this->m_HV.back()); CHKERRQ(ierr);
+    }
+
+    ierr = VecCopy(x, this->m_V[this->m_NumRecorded]); CHKERRQ(ierr);
+    ierr = VecCopy(hx, this->m_HV[this->m_NumRecorded]); CHKERRQ(ierr);
+    this->m_NumRecorded++;
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief update recycled basis; we compute ritz pairs of the
+ * hessian in the span Z of the current basis and the recorded
+ * directions (Rayleigh-Ritz; generalized eigenvalue problem
+ * Z^T H Z y = theta Z^T Z y) and keep the ritz vectors that belong
+ * to the smallest ritz values; the hessian changes from one newton
+ * step to the next, so H W is recomputed after the next accepted
+ * newton update
+ *******************************************************************/
+PetscErrorCode KrylovRecycler::PostSolve() {
+    PetscErrorCode ierr = 0;
+    IntType nz, nw, nr, k, r;
+    std::vector<Vec> z, hz, w, hw;
+    std::vector<ScalarType> m, g, q, lambda, t, gt, u, theta, y, coeff;
+    std::vector<int> idx;
+    ScalarType lmax, tol;
+    std::stringstream ss;
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    this->m_Recording = false;
+
+    nw = static_cast<IntType>(this->m_W.size());
+    nr = this->m_NumRecorded;
+    nz = nw + nr;
+    k  = this->m_Opt->m_KrylovMethod.nrecycle;
+
+    if (nr == 0 || k <= 0) {
+        this->m_Opt->Exit(__func__);
+        PetscFunctionReturn(ierr);
+    }
+
+    // assemble search space
+    for (IntType i = 0; i < nw; ++i) {z.push_back(this->m_W[i]); hz.push_back(this->m_HW[i]);}
+    for (IntType i = 0; i < nr; ++i) {z.push_back(this->m_V[i]); hz.push_back(this->m_HV[i]);}
+
+    // gram matrix M = Z^T Z and projected hessian G = Z^T H Z
+    m.resize(nz*nz); g.resize(nz*nz);
+    for (IntType i = 0; i < nz; ++i) {
+        ierr = VecMDot(z[i], nz, z.data(), &m[i*nz]); CHKERRQ(ierr);
+        ierr = VecMDot(z[i], nz, hz.data(), &g[i*nz]); CHKERRQ(ierr);
+    }
+    for (IntType i = 0; i < nz; ++i) {
+        for (IntType j = i+1; j < nz; ++j) {
+            g[i*nz + j] = 0.5*(g[i*nz + j] + g[j*nz + i]);
+            g[j*nz + i] = g[i*nz + j];
+        }
+    }
+
+    // orthonormalize search space: T = Q Lambda^{-1/2} (drop
+    // directions that are (numerically) linearly dependent)
+    ierr = SymmetricEigenDecomposition(m, q, lambda, nz); CHKERRQ(ierr);
+    lmax = 0.0;
+    for (IntType i = 0; i < nz; ++i) lmax = std::max(lmax, lambda[i]);
+    tol = 1E3*std::numeric_limits<ScalarType>::epsilon()*lmax;
+    for (IntType i = 0; i < nz; ++i) {
+        if (lambda[i] > tol) idx.push_back(static_cast<int>(i));
+    }
+    r = static_cast<IntType>(idx.size());
+    if (r == 0) {
+        this->m_Opt->Exit(__func__);
+        PetscFunctionReturn(ierr);
+    }
+    t.resize(nz*r);
+    for (IntType i = 0; i < nz; ++i) {
+        for (IntType j = 0; j < r; ++j) {
+            t[i*r + j] = q[i*nz + idx[j]]/std::sqrt(lambda[idx[j]]);
+        }
+    }
+
+    // projected hessian in orthonormal basis: T^T G T
+    gt.assign(r*r, 0.0);
+    for (IntType a = 0; a < r; ++a) {
+        for (IntType b = 0; b < r; ++b) {
+            ScalarType value = 0.0;
+            for (IntType i = 0; i < nz; ++i) {
+                for (IntType j = 0; j < nz; ++j) {
+                    value += t[i*r + a]*g[i*nz + j]*t[j*r + b];
+                }
+            }
+            gt[a*r + b] = value;
+        }
+    }
+    ierr = SymmetricEigenDecomposition(gt, u, theta, static_cast<int>(r)); CHKERRQ(ierr);
+
+    // sort ritz values (ascending); only keep positive ones
+    idx.resize(r);
+    for (IntType i = 0; i < r; ++i) idx[i] = static_cast<int>(i);
+    std::sort(idx.begin(), idx.end(), [&theta](int a, int b) {return theta[a] < theta[b];});
+
+    // ritz vectors W = Z T U and H W = (H Z) T U
+    coeff.resize(nz);
+    for (IntType l = 0; l < r && static_cast<IntType>(w.size()) < k; ++l) {
+        if (theta[idx[l]] <= 0.0) continue;
+        for (IntType i = 0; i < nz; ++i) {
+            coeff[i] = 0.0;
+            for (IntType j = 0; j < r; ++j) {
+                coeff[i] += t[i*r + j]*u[j*r + idx[l]];
+            }
+        }
+        w.push_back(NULL); hw.push_back(NULL);
+        ierr = VecDuplicate(z[0], &w.back()); CHKERRQ(ierr);
+        ierr = VecDuplicate(hz[0], &hw.back()); CHKERRQ(ierr);
+        ierr = VecSet(w.back(), 0.0); CHKERRQ(ierr);
+        ierr = VecSet(hw.back(), 0.0); CHKERRQ(ierr);
+        ierr = VecMAXPY(w.back(), nz, coeff.data(), z.data()); CHKERRQ(ierr);
+        ierr = VecMAXPY(hw.back(), nz, coeff.data(), hz.data()); CHKERRQ(ierr);
+        y.push_back(theta[idx[l]]);
+    }
+
+    // replace basis
+    ierr = this->ClearVectors(this->m_W); CHKERRQ(ierr);
+    ierr = this->ClearVectors(this->m_HW); CHKERRQ(ierr);
+    this->m_W = w;
+    this->m_HW = hw;
+    this->m_Theta = y;
+    this->m_UpdateHW = false;
+
+    if (this->m_Opt->m_Verbosity > 1 && !this->m_Theta.empty()) {
+        ss << "krylov recycling: basis size " << this->m_W.size()
+           << ", ritz values in [" << std::scientific << this->m_Theta.front()
+           << ", " << this->m_Theta.back() << "]";
+        ierr = DbgMsg(ss.str()); CHKERRQ(ierr);
+        ss.clear(); ss.str(std::string());
+    }
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+}  // namespace reg
+
+
+
+
+#endif  // _KRYLOVRECYCLER_CPP_
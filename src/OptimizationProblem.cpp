@@ -71,6 +71,7 @@ PetscErrorCode OptimizationProblem::Initialize(void) {
 
     this->m_Opt = NULL;
     this->m_Iterate = NULL;
+    this->m_KrylovRecycler = NULL;
 
     PetscFunctionReturn(0);
 }
@@ -430,6 +431,32 @@ PetscErrorCode OptimizationProblem::DerivativeCheckHessianFD() {
 
 
 
+/********************************************************************
+ * @brief apply hessian to a block of vectors; this is the fallback
+ * that applies the hessian to one vector at a time (overwritten by
+ * problems that can share work across the vectors in a block)
+ * @param[out] Hx hessian applied to input vectors
+ * @param[in] x input vectors
+ * @param[in] n number of vectors
+ *******************************************************************/
+PetscErrorCode OptimizationProblem::HessianMatVecBlock(Vec* Hx, Vec* x, IntType n, bool scale) {
+    PetscErrorCode ierr = 0;
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    for (IntType i = 0; i < n; ++i) {
+        ierr = this->HessianMatVec(Hx[i], x[i], scale); CHKERRQ(ierr);
+    }
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
 /********************************************************************
  * @brief check symmetry of hessian
  * the idea is to use the identity
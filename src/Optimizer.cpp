@@ -82,6 +82,8 @@ PetscErrorCode Optimizer::Initialize(void) {
 
     this->m_KrylovMethod = NULL;
     this->m_OptimizationProblem = NULL;
+    this->m_KrylovRecycler = NULL;
+    this->m_KeepPrecond = false;
 
     PetscFunctionReturn(ierr);
 }
@@ -113,6 +115,11 @@ PetscErrorCode Optimizer::ClearMemory(void) {
         this->m_MatVec = NULL;
     }
 
+    if (this->m_KrylovRecycler != NULL) {
+        delete this->m_KrylovRecycler;
+        this->m_KrylovRecycler = NULL;
+    }
+
     PetscFunctionReturn(ierr);
 }
 
@@ -238,7 +245,7 @@ PetscErrorCode Optimizer::SetupTao() {
     ScalarType gatol, grtol, gttol, reltol, abstol, divtol;
     IntType maxit;
     void* optprob;
-    PC preconditioner;
+    PC preconditioner, pc;
     TaoLineSearch linesearch;
     PetscFunctionBegin;
     this->m_Opt->Enter(__func__);
@@ -256,8 +263,34 @@ PetscErrorCode Optimizer::SetupTao() {
     }
 
     std::string method = "nls";
+    if (this->m_Opt->m_OptPara.method == QUASINEWTON) {
+        method = "lmvm";
+    }
     ierr = TaoCreate(PETSC_COMM_WORLD, &this->m_Tao); CHKERRQ(ierr);
-    ierr = TaoSetType(this->m_Tao, "nls"); CHKERRQ(ierr);
+    ierr = TaoSetType(this->m_Tao, method.c_str()); CHKERRQ(ierr);
+
+    optprob = reinterpret_cast<void*>(this->m_OptimizationProblem);
+
+    // limited memory bfgs: no hessian matvecs and no krylov solves; we
+    // seed the quasi-newton approximation with the regularization
+    // operator (i.e., the initial inverse hessian is the inverse of the
+    // regularization operator); tao applies the initial hessian through
+    // a ksp (operator H0); we use a single application of a shell pc
+    // (preonly), so the operator itself is never applied; the ksp only
+    // exists after tao has been set up, so we configure it directly
+    // afterwards (see SetupInitialHessian); we do not touch the global
+    // options database (the setup of the ksp falls back to PCNONE for
+    // the shell operator)
+    if (strcmp(method.c_str(), "lmvm") == 0) {
+        if (this->m_MatVec != NULL) {
+            ierr = MatDestroy(&this->m_MatVec); CHKERRQ(ierr);
+            this->m_MatVec = NULL;
+        }
+        ierr = MatCreateShell(PETSC_COMM_WORLD, nlu, nlu, ngu, ngu, optprob, &this->m_MatVec); CHKERRQ(ierr);
+        ierr = MatSetOption(this->m_MatVec, MAT_SYMMETRIC, PETSC_TRUE); CHKERRQ(ierr);
+        ierr = TaoLMVMSetH0(this->m_Tao, this->m_MatVec); CHKERRQ(ierr);
+        ierr = TaoSetFromOptions(this->m_Tao); CHKERRQ(ierr);
+    }
 
     // get the ksp of the optimizer and set options
     ierr = TaoGetKSP(this->m_Tao, &this->m_KrylovMethod); CHKERRQ(ierr);
@@ -292,7 +325,24 @@ PetscErrorCode Optimizer::SetupTao() {
         maxit  = this->m_Opt->m_KrylovMethod.maxiter;    // 1000;
         maxit  = std::max(static_cast<IntType>(0), maxit-1);
         ierr = KSPSetTolerances(this->m_KrylovMethod, reltol, abstol, divtol, maxit); CHKERRQ(ierr);
-        ierr = KSPSetInitialGuessNonzero(this->m_KrylovMethod, PETSC_FALSE); CHKERRQ(ierr);
+
+        // krylov recycling: the recycled basis survives across newton
+        // iterations and continuation steps; the initial guess is set
+        // in the presolve (deflated initial residual) and the basis is
+        // projected out after the preconditioner (see below)
+        if (this->m_Opt->m_KrylovMethod.nrecycle > 0) {
+            if (this->m_KrylovRecycler == NULL) {
+                try {this->m_KrylovRecycler = new KrylovRecycler(this->m_Opt);}
+                catch (std::bad_alloc&) {
+                    ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
+                }
+            }
+            this->m_OptimizationProblem->SetKrylovRecycler(this->m_KrylovRecycler);
+            ierr = KSPSetInitialGuessNonzero(this->m_KrylovMethod, PETSC_TRUE); CHKERRQ(ierr);
+        } else {
+            this->m_OptimizationProblem->SetKrylovRecycler(NULL);
+            ierr = KSPSetInitialGuessNonzero(this->m_KrylovMethod, PETSC_FALSE); CHKERRQ(ierr);
+        }
 //        ierr = KSPSetInitialGuessNonzero(this->m_KrylovMethod, PETSC_TRUE); CHKERRQ(ierr);
 
         // KSP_NORM_UNPRECONDITIONED unpreconditioned norm: ||b-Ax||_2)
@@ -311,17 +361,34 @@ PetscErrorCode Optimizer::SetupTao() {
             ierr = KSPSetType(this->m_KrylovMethod, KSPFCG); CHKERRQ(ierr);
         } else if (this->m_Opt->m_KrylovMethod.solver == FGMRES) {
             ierr = KSPSetType(this->m_KrylovMethod, KSPFGMRES); CHKERRQ(ierr);
+        } else if (this->m_Opt->m_KrylovMethod.solver == PIPECG) {
+            // pipelined cg: the dot products and the residual norm of an
+            // iteration are fused into a single non-blocking reduction,
+            // which is overlapped with the application of the
+            // preconditioner and the hessian matvec; the residual norm
+            // passed to the monitor is the unpreconditioned one (as for
+            // the other methods)
+            ierr = KSPSetType(this->m_KrylovMethod, KSPPIPECG); CHKERRQ(ierr);
         } else {
             ierr = ThrowError("interface for solver not provided"); CHKERRQ(ierr);
         }
 
+        // the inexact hessian changes during the solve (see RegOpt); the
+        // recursive residual is verified against the true residual
+        if (this->m_Opt->m_KrylovMethod.hessmaxstride > 1) {
+            ierr = Assert(this->m_Opt->m_KrylovMethod.solver == FCG
+                       || this->m_Opt->m_KrylovMethod.solver == FGMRES,
+                          "inexact hessian is only supported for fpcg/fgmres"); CHKERRQ(ierr);
+            ierr = KSPSetConvergenceTest(this->m_KrylovMethod, KrylovConvergenceTest, this->m_OptimizationProblem, NULL); CHKERRQ(ierr);
+        }
+
         // apply projection operator to gradient and
         // solution if needed (two-level preconditioner)
         ierr = KSPSetPostSolve(this->m_KrylovMethod, PostKrylovSolve, this->m_OptimizationProblem); CHKERRQ(ierr);
         ierr = KSPSetPreSolve(this->m_KrylovMethod, PreKrylovSolve, this->m_OptimizationProblem); CHKERRQ(ierr);
 
-        // set krylov monitor
-        if (this->m_Opt->m_Verbosity > 0) {  /// || (this->m_Opt->GetLogger()->IsEnabled(LOGKSPRES))) {
+        // set krylov monitor (also needed to control inexact hessian matvecs)
+        if (this->m_Opt->m_Verbosity > 0 || this->m_Opt->m_KrylovMethod.hessmaxstride > 1) {  /// || (this->m_Opt->GetLogger()->IsEnabled(LOGKSPRES))) {
             ierr = KSPMonitorSet(this->m_KrylovMethod, KrylovMonitor, this->m_OptimizationProblem, NULL); CHKERRQ(ierr);
         }
 
@@ -329,24 +396,34 @@ PetscErrorCode Optimizer::SetupTao() {
         ierr = KSPGetPC(this->m_KrylovMethod, &preconditioner); CHKERRQ(ierr);
         ierr = KSPSetFromOptions(this->m_KrylovMethod); CHKERRQ(ierr);
 
+        // krylov recycling: the preconditioner is wrapped by the
+        // deflation projector of the recycled basis
+        pc = preconditioner;
+        if (this->m_KrylovRecycler != NULL && this->m_Opt->m_KrylovMethod.nrecycle > 0) {
+            ierr = PCCreate(PETSC_COMM_WORLD, &pc); CHKERRQ(ierr);
+            ierr = this->m_KrylovRecycler->SetPreconditioner(pc); CHKERRQ(ierr);
+            ierr = PCSetType(preconditioner, PCSHELL); CHKERRQ(ierr);
+            ierr = PCShellSetApply(preconditioner, DeflatedPrecondMatVec); CHKERRQ(ierr);
+            ierr = PCShellSetContext(preconditioner, this->m_KrylovRecycler); CHKERRQ(ierr);
+        }
+
         // switch between different preconditioners
         if (this->m_Opt->m_KrylovMethod.pctype == NOPC) {
-            ierr = PCSetType(preconditioner, PCNONE); CHKERRQ(ierr);
+            ierr = PCSetType(pc, PCNONE); CHKERRQ(ierr);
         } else {
             ierr = Assert(this->m_Precond != NULL, "null pointer"); CHKERRQ(ierr);
 
             // we have to create a shell object for the preconditioner,
             // since our solver is matrix free
-            ierr = PCSetType(preconditioner, PCSHELL); CHKERRQ(ierr);
-            ierr = PCShellSetApply(preconditioner, PrecondMatVec); CHKERRQ(ierr);
-            ierr = PCShellSetContext(preconditioner, this->m_Precond); CHKERRQ(ierr);
+            ierr = PCSetType(pc, PCSHELL); CHKERRQ(ierr);
+            ierr = PCShellSetApply(pc, PrecondMatVec); CHKERRQ(ierr);
+            ierr = PCShellSetContext(pc, this->m_Precond); CHKERRQ(ierr);
+
 //            ierr = PCShellSetName(taokktpc,"kktpc"); CHKERRQ(ierr);
 //            ierr = PCShellSetSetUp(preconditioner, PrecondSetup); CHKERRQ(ierr);
         }
     }
 
-    optprob = reinterpret_cast<void*>(this->m_OptimizationProblem);
-
     // set the routine to evaluate the objective and compute the gradient
     ierr = TaoSetObjectiveRoutine(this->m_Tao, EvaluateObjective, optprob); CHKERRQ(ierr);
     ierr = TaoSetGradientRoutine(this->m_Tao, EvaluateGradient, optprob); CHKERRQ(ierr);
@@ -419,10 +496,17 @@ PetscErrorCode Optimizer::SetupTao() {
     ierr = TaoSetMaximumIterations(this->m_Tao, this->m_Opt->m_OptPara.maxiter-1); CHKERRQ(ierr);
     ierr = TaoSetFunctionLowerBound(this->m_Tao, 1E-6); CHKERRQ(ierr);
 
-    ierr = MatCreateShell(PETSC_COMM_WORLD, nlu, nlu, ngu, ngu, optprob, &this->m_MatVec); CHKERRQ(ierr);
-    ierr = MatShellSetOperation(this->m_MatVec, MATOP_MULT, (void(*)(void))HessianMatVec); CHKERRQ(ierr);
-    ierr = MatSetOption(this->m_MatVec, MAT_SYMMETRIC, PETSC_TRUE); CHKERRQ(ierr);
-    ierr = TaoSetHessianRoutine(this->m_Tao, this->m_MatVec, this->m_MatVec, EvaluateHessian, optprob); CHKERRQ(ierr);
+    // the hessian is only needed for newton type methods
+    if (this->m_KrylovMethod != NULL) {
+        if (this->m_MatVec != NULL) {
+            ierr = MatDestroy(&this->m_MatVec); CHKERRQ(ierr);
+            this->m_MatVec = NULL;
+        }
+        ierr = MatCreateShell(PETSC_COMM_WORLD, nlu, nlu, ngu, ngu, optprob, &this->m_MatVec); CHKERRQ(ierr);
+        ierr = MatShellSetOperation(this->m_MatVec, MATOP_MULT, (void(*)(void))HessianMatVec); CHKERRQ(ierr);
+        ierr = MatSetOption(this->m_MatVec, MAT_SYMMETRIC, PETSC_TRUE); CHKERRQ(ierr);
+        ierr = TaoSetHessianRoutine(this->m_Tao, this->m_MatVec, this->m_MatVec, EvaluateHessian, optprob); CHKERRQ(ierr);
+    }
 
     this->m_Opt->Exit(__func__);
     PetscFunctionReturn(0);
@@ -431,6 +515,40 @@ PetscErrorCode Optimizer::SetupTao() {
 
 
 
+/********************************************************************
+ * @brief set up the initial hessian of the limited memory bfgs method
+ * (single application of the inverse of the regularization operator)
+ *******************************************************************/
+PetscErrorCode Optimizer::SetupInitialHessian() {
+    PetscErrorCode ierr = 0;
+    KSP ksp = NULL;
+    PC pc = NULL;
+    void* optprob;
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    ierr = Assert(this->m_Tao != NULL, "null pointer"); CHKERRQ(ierr);
+
+    ierr = TaoLMVMGetH0KSP(this->m_Tao, &ksp); CHKERRQ(ierr);
+    ierr = Assert(ksp != NULL, "ksp for initial hessian not set up"); CHKERRQ(ierr);
+
+    optprob = reinterpret_cast<void*>(this->m_OptimizationProblem);
+
+    ierr = KSPSetType(ksp, KSPPREONLY); CHKERRQ(ierr);
+    ierr = KSPGetPC(ksp, &pc); CHKERRQ(ierr);
+    ierr = PCSetType(pc, PCSHELL); CHKERRQ(ierr);
+    ierr = PCShellSetApply(pc, InitialHessianMatVec); CHKERRQ(ierr);
+    ierr = PCShellSetContext(pc, optprob); CHKERRQ(ierr);
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
 /********************************************************************
  * @brief run the optimizer (main interface; calls specific functions
  * according to user settings (parameter continuation, grid
@@ -482,11 +600,17 @@ PetscErrorCode Optimizer::Run(bool presolve) {
     ierr = this->SetInitialGuess(); CHKERRQ(ierr);
     ierr = TaoSetUp(this->m_Tao); CHKERRQ(ierr);
 
-    if (this->m_Opt->m_KrylovMethod.pctype != NOPC) {
+    // the ksp for the initial hessian only exists after the setup
+    if (this->m_Opt->m_OptPara.method == QUASINEWTON) {
+        ierr = this->SetupInitialHessian(); CHKERRQ(ierr);
+    }
+
+    if (this->m_Opt->m_KrylovMethod.pctype != NOPC && !this->m_KeepPrecond) {
         // in case we call the optimizer/solver several times
         // we have to make sure that the preconditioner is reset
         ierr = this->m_Precond->Reset(); CHKERRQ(ierr);
     }
+    this->m_KeepPrecond = false;
 
     // solve optimization problem
     ierr = this->m_Opt->StartTimer(T2SEXEC); CHKERRQ(ierr);
@@ -514,6 +638,53 @@ PetscErrorCode Optimizer::Run(bool presolve) {
 
 
 
+/********************************************************************
+ * @brief set the regularization weight for the next step of the
+ * parameter continuation; tao, the krylov method, the recycled basis
+ * and the preconditioner are kept alive across steps; for the
+ * analytically preconditioned hessian H = I + (1/beta) M, we rescale
+ * the recycled basis and the preconditioner instead of recomputing
+ * them; the next run is warm started from the current solution
+ * @param beta regularization weight for next step
+ *******************************************************************/
+PetscErrorCode Optimizer::SetRegularizationWeight(ScalarType beta) {
+    PetscErrorCode ierr = 0;
+    ScalarType betaold, scale;
+    bool precondmatvec;
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    betaold = this->m_Opt->m_RegNorm.beta[0];
+    this->m_Opt->m_RegNorm.beta[0] = beta;
+
+    if (betaold > 0.0 && beta > 0.0 && betaold != beta) {
+        scale = betaold/beta;
+        precondmatvec = (this->m_Opt->m_KrylovMethod.matvectype == PRECONDMATVEC)
+                     || (this->m_Opt->m_KrylovMethod.matvectype == PRECONDMATVECSYM);
+
+        if (this->m_KrylovRecycler != NULL) {
+            if (precondmatvec) {
+                ierr = this->m_KrylovRecycler->Rescale(scale); CHKERRQ(ierr);
+            } else {
+                ierr = this->m_KrylovRecycler->Reset(); CHKERRQ(ierr);
+            }
+        }
+
+        if (this->m_Precond != NULL && precondmatvec) {
+            ierr = this->m_Precond->Rescale(scale); CHKERRQ(ierr);
+            this->m_KeepPrecond = true;
+        }
+    }
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
 /********************************************************************
  * @brief get the solution
  * @param x vector to hold solution
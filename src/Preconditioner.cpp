@@ -20,6 +20,7 @@
 #ifndef _PRECONDREG_CPP_
 #define _PRECONDREG_CPP_
 
+#include <algorithm>
 #include "Preconditioner.hpp"
 #include "petscksp.h"
 
@@ -79,34 +80,23 @@ PetscErrorCode Preconditioner::Initialize() {
     this->m_ControlVariable = NULL;     ///< control variable on fine grid
     this->m_IncControlVariable = NULL;  ///< incremental control variable on fine grid
     this->m_Mask = NULL;                ///< objective masking
+    this->m_RegWeight = NULL;           ///< regularization weight
     this->m_ReferenceImage = NULL;      ///< objective masking
 
     this->m_WorkVecField = NULL;        ///< temporary vector field
     this->m_WorkScaField1 = NULL;       ///< temporary scalar field
     this->m_WorkScaField2 = NULL;       ///< temporary scalar field
 
+    this->m_LowRankAge = -1;            ///< low-rank preconditioner not computed
+    this->m_ReadEigVals = false;        ///< no eigenvalue estimates to read back
+    this->m_UseCachedEigVals = false;   ///< chebyshev method does not use cached estimates
+
     try {this->m_CoarseGrid = new CoarseGrid();}
     catch (std::bad_alloc&) {
         ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
     }
 
-    this->m_CoarseGrid->m_Opt = NULL;                   ///< options for coarse grid
-    this->m_CoarseGrid->m_OptimizationProblem = NULL;   ///< options for coarse grid
-    this->m_CoarseGrid->m_StateVariable = NULL;         ///< state variable on coarse grid
-    this->m_CoarseGrid->m_AdjointVariable = NULL;       ///< adjoint variable on coarse grid
-    this->m_CoarseGrid->m_ControlVariable = NULL;       ///< control variable on coarse grid
-    this->m_CoarseGrid->m_IncControlVariable = NULL;    ///< incremental control variable on coarse grid
-    this->m_CoarseGrid->m_Mask = NULL;                  ///< mask (objective masking)
-    this->m_CoarseGrid->m_ReferenceImage = NULL;        ///< reference image
-
-    this->m_CoarseGrid->x = NULL;    ///< container for input to hessian matvec on coarse grid
-    this->m_CoarseGrid->y = NULL;    ///< container for hessian matvec on coarse grid
-
-    this->m_CoarseGrid->m_WorkScaField1 = NULL;         ///< temporary scalar field (coarse level)
-    this->m_CoarseGrid->m_WorkScaField2 = NULL;         ///< temporary scalar field (coarse level)
-    this->m_CoarseGrid->setupdone = false;
-
-
+    ierr = this->InitCoarseGrid(this->m_CoarseGrid); CHKERRQ(ierr);
 
     PetscFunctionReturn(ierr);
 }
@@ -138,27 +128,14 @@ PetscErrorCode Preconditioner::ClearMemory() {
         this->m_MatVecEigEst = NULL;
     }
 
-
-    if (this->m_CoarseGrid->x != NULL) {
-        ierr = VecDestroy(&this->m_CoarseGrid->x); CHKERRQ(ierr);
-        this->m_CoarseGrid->x = NULL;
-    }
-    if (this->m_CoarseGrid->y != NULL) {
-        ierr = VecDestroy(&this->m_CoarseGrid->y); CHKERRQ(ierr);
-        this->m_CoarseGrid->y = NULL;
-    }
-    if (this->m_CoarseGrid->m_StateVariable != NULL) {
-        ierr = VecDestroy(&this->m_CoarseGrid->m_StateVariable); CHKERRQ(ierr);
-        this->m_CoarseGrid->m_StateVariable = NULL;
-    }
-    if (this->m_CoarseGrid->m_AdjointVariable != NULL) {
-        ierr = VecDestroy(&this->m_CoarseGrid->m_AdjointVariable); CHKERRQ(ierr);
-        this->m_CoarseGrid->m_AdjointVariable = NULL;
-    }
-    if (this->m_CoarseGrid->m_ReferenceImage != NULL) {
-        ierr = VecDestroy(&this->m_CoarseGrid->m_ReferenceImage); CHKERRQ(ierr);
-        this->m_CoarseGrid->m_ReferenceImage = NULL;
+    // clear grid hierarchy (coarsest level first)
+    for (size_t l = this->m_MultiLevel.size(); l > 0; --l) {
+        ierr = this->ClearCoarseGrid(this->m_MultiLevel[l-1], false); CHKERRQ(ierr);
+        delete this->m_MultiLevel[l-1];
     }
+    this->m_MultiLevel.clear();
+
+    ierr = this->ClearCoarseGrid(this->m_CoarseGrid); CHKERRQ(ierr);
 
     if (this->m_WorkVecField != NULL) {
         delete this->m_WorkVecField;
@@ -172,20 +149,6 @@ PetscErrorCode Preconditioner::ClearMemory() {
         ierr = VecDestroy(&this->m_WorkScaField2); CHKERRQ(ierr);
         this->m_WorkScaField2 = NULL;
     }
-    if (this->m_CoarseGrid->m_WorkScaField1 != NULL) {
-        ierr = VecDestroy(&this->m_CoarseGrid->m_WorkScaField1); CHKERRQ(ierr);
-        this->m_CoarseGrid->m_WorkScaField1 = NULL;
-    }
-    if (this->m_CoarseGrid->m_WorkScaField2 != NULL) {
-        ierr = VecDestroy(&this->m_CoarseGrid->m_WorkScaField2); CHKERRQ(ierr);
-        this->m_CoarseGrid->m_WorkScaField2 = NULL;
-    }
-
-    if (this->m_CoarseGrid->m_OptimizationProblem != NULL) {
-//        this->m_CoarseGrid->m_OptimizationProblem->GetOptions()->WriteLogFile(true);
-        delete this->m_CoarseGrid->m_OptimizationProblem;
-        this->m_CoarseGrid->m_OptimizationProblem = NULL;
-    }
 
     if (this->m_ControlVariable != NULL) {
         delete this->m_ControlVariable;
@@ -196,27 +159,13 @@ PetscErrorCode Preconditioner::ClearMemory() {
         this->m_IncControlVariable = NULL;
     }
 
-    if (this->m_CoarseGrid->m_ControlVariable != NULL) {
-        delete this->m_CoarseGrid->m_ControlVariable;
-        this->m_CoarseGrid->m_ControlVariable = NULL;
-    }
-    if (this->m_CoarseGrid->m_IncControlVariable != NULL) {
-        delete this->m_CoarseGrid->m_IncControlVariable;
-        this->m_CoarseGrid->m_IncControlVariable = NULL;
-    }
-
-    if (this->m_CoarseGrid->m_Opt != NULL) {
-        this->m_CoarseGrid->m_Opt->ProcessTimers();
-        this->m_CoarseGrid->m_Opt->WriteLogFile(true);
-        delete this->m_CoarseGrid->m_Opt;
-        this->m_CoarseGrid->m_Opt = NULL;
-    }
-
     if (this->m_RandomNumGen != NULL) {
         ierr = PetscRandomDestroy(&this->m_RandomNumGen); CHKERRQ(ierr);
         this->m_RandomNumGen = NULL;
     }
 
+    ierr = this->ClearLowRankBasis(); CHKERRQ(ierr);
+
     delete this->m_CoarseGrid;
 
     PetscFunctionReturn(ierr);
@@ -226,10 +175,133 @@ PetscErrorCode Preconditioner::ClearMemory() {
 
 
 /********************************************************************
- * @brief set the optimization problem (this is a general purpose
- * implementation; the user can set different optimization problems
- * and we can solve them)
+ * @brief init variables of a grid in the hierarchy
  *******************************************************************/
+PetscErrorCode Preconditioner::InitCoarseGrid(CoarseGrid* grid) {
+    PetscErrorCode ierr = 0;
+    PetscFunctionBegin;
+
+    ierr = Assert(grid != NULL, "null pointer"); CHKERRQ(ierr);
+
+    grid->m_Opt = NULL;                   ///< options for coarse grid
+    grid->m_OptimizationProblem = NULL;   ///< options for coarse grid
+    grid->m_StateVariable = NULL;         ///< state variable on coarse grid
+    grid->m_AdjointVariable = NULL;       ///< adjoint variable on coarse grid
+    grid->m_ControlVariable = NULL;       ///< control variable on coarse grid
+    grid->m_IncControlVariable = NULL;    ///< incremental control variable on coarse grid
+    grid->m_Mask = NULL;                  ///< mask (objective masking)
+    grid->m_RegWeight = NULL;             ///< regularization weight
+    grid->m_ReferenceImage = NULL;        ///< reference image
+
+    grid->x = NULL;    ///< container for input to hessian matvec on coarse grid
+    grid->y = NULL;    ///< container for hessian matvec on coarse grid
+    grid->r = NULL;    ///< residual (multilevel preconditioner)
+    grid->z = NULL;    ///< hessian matvec (multilevel preconditioner)
+
+    grid->m_WorkScaField1 = NULL;         ///< temporary scalar field (coarse level)
+    grid->m_WorkScaField2 = NULL;         ///< temporary scalar field (coarse level)
+    grid->m_WorkVecField = NULL;          ///< temporary vector field (coarse level)
+    grid->m_PreProc = NULL;               ///< frequency filters (coarse level)
+    grid->setupdone = false;
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief clear memory of a grid in the hierarchy
+ *******************************************************************/
+PetscErrorCode Preconditioner::ClearCoarseGrid(CoarseGrid* grid, bool writelog) {
+    PetscErrorCode ierr = 0;
+    PetscFunctionBegin;
+
+    if (grid == NULL) PetscFunctionReturn(ierr);
+
+    if (grid->x != NULL) {
+        ierr = VecDestroy(&grid->x); CHKERRQ(ierr);
+        grid->x = NULL;
+    }
+    if (grid->y != NULL) {
+        ierr = VecDestroy(&grid->y); CHKERRQ(ierr);
+        grid->y = NULL;
+    }
+    if (grid->r != NULL) {
+        ierr = VecDestroy(&grid->r); CHKERRQ(ierr);
+        grid->r = NULL;
+    }
+    if (grid->z != NULL) {
+        ierr = VecDestroy(&grid->z); CHKERRQ(ierr);
+        grid->z = NULL;
+    }
+    if (grid->m_StateVariable != NULL) {
+        ierr = VecDestroy(&grid->m_StateVariable); CHKERRQ(ierr);
+        grid->m_StateVariable = NULL;
+    }
+    if (grid->m_AdjointVariable != NULL) {
+        ierr = VecDestroy(&grid->m_AdjointVariable); CHKERRQ(ierr);
+        grid->m_AdjointVariable = NULL;
+    }
+    if (grid->m_ReferenceImage != NULL) {
+        ierr = VecDestroy(&grid->m_ReferenceImage); CHKERRQ(ierr);
+        grid->m_ReferenceImage = NULL;
+    }
+    if (grid->m_WorkScaField1 != NULL) {
+        ierr = VecDestroy(&grid->m_WorkScaField1); CHKERRQ(ierr);
+        grid->m_WorkScaField1 = NULL;
+    }
+    if (grid->m_WorkScaField2 != NULL) {
+        ierr = VecDestroy(&grid->m_WorkScaField2); CHKERRQ(ierr);
+        grid->m_WorkScaField2 = NULL;
+    }
+
+    if (grid->m_OptimizationProblem != NULL) {
+        delete grid->m_OptimizationProblem;
+        grid->m_OptimizationProblem = NULL;
+    }
+    if (grid->m_Mask != NULL) {
+        ierr = VecDestroy(&grid->m_Mask); CHKERRQ(ierr);
+        grid->m_Mask = NULL;
+    }
+    if (grid->m_RegWeight != NULL) {
+        ierr = VecDestroy(&grid->m_RegWeight); CHKERRQ(ierr);
+        grid->m_RegWeight = NULL;
+    }
+
+    if (grid->m_ControlVariable != NULL) {
+        delete grid->m_ControlVariable;
+        grid->m_ControlVariable = NULL;
+    }
+    if (grid->m_IncControlVariable != NULL) {
+        delete grid->m_IncControlVariable;
+        grid->m_IncControlVariable = NULL;
+    }
+    if (grid->m_WorkVecField != NULL) {
+        delete grid->m_WorkVecField;
+        grid->m_WorkVecField = NULL;
+    }
+    if (grid->m_PreProc != NULL) {
+        delete grid->m_PreProc;
+        grid->m_PreProc = NULL;
+    }
+
+    if (grid->m_Opt != NULL) {
+        if (writelog) {
+            grid->m_Opt->ProcessTimers();
+            grid->m_Opt->WriteLogFile(true);
+        }
+        delete grid->m_Opt;
+        grid->m_Opt = NULL;
+    }
+    grid->setupdone = false;
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
 PetscErrorCode Preconditioner::SetProblem(Preconditioner::OptProbType* optprob) {
     PetscErrorCode ierr = 0;
     PetscFunctionBegin;
@@ -302,6 +374,20 @@ PetscErrorCode Preconditioner::Reset() {
             this->m_Opt->m_KrylovMethod.eigvalsestimated = false;
             break;
         }
+        case MULTILEVEL:
+        {
+            // same as for two-level preconditioner (the restricted
+            // variables are recomputed in the setup phase)
+            this->m_Opt->m_KrylovMethod.eigvalsestimated = false;
+            break;
+        }
+        case LOWRANK:
+        {
+            // the hessian (and the regularization weight in case we
+            // do parameter continuation) changed; force recomputation
+            this->m_LowRankAge = -1;
+            break;
+        }
         default:
         {
             ierr = ThrowError("preconditioner not defined"); CHKERRQ(ierr);
@@ -317,6 +403,76 @@ PetscErrorCode Preconditioner::Reset() {
 
 
 
+/********************************************************************
+ * @brief update the preconditioner after the regularization weight
+ * changed (parameter continuation; the optimizer keeps the
+ * preconditioner instead of resetting it); the data term of the
+ * analytically preconditioned hessian scales with 1/beta
+ * @param scale ratio between old and new regularization weight
+ *******************************************************************/
+PetscErrorCode Preconditioner::Rescale(ScalarType scale) {
+    PetscErrorCode ierr = 0;
+
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    switch(this->m_Opt->m_KrylovMethod.pctype) {
+        case NOPC:
+        case INVREG:
+        {
+            // no need to do anything
+            break;
+        }
+        case TWOLEVEL:
+        case MULTILEVEL:
+        {
+            // rescale the cached eigenvalue estimates of the chebyshev
+            // method (lambda = 1 + (lambda_old - 1)*scale); without an
+            // estimate (or chebyshev method) we estimate when the
+            // preconditioner is applied next
+            if (this->m_Opt->m_KrylovMethod.pcsolver == CHEB
+                && this->m_Opt->m_KrylovMethod.eigvalsbeta > 0.0
+                && this->m_KrylovMethod != NULL) {
+                for (int i = 0; i < 2; ++i) {
+                    this->m_Opt->m_KrylovMethod.eigvals[i]
+                        = 1.0 + (this->m_Opt->m_KrylovMethod.eigvals[i] - 1.0)*scale;
+                }
+                this->m_Opt->m_KrylovMethod.eigvalsbeta = this->m_Opt->m_RegNorm.beta[0];
+                ierr = this->SetChebyshevEigenValues(this->m_Opt->m_KrylovMethod.eigvals[0],
+                                                     this->m_Opt->m_KrylovMethod.eigvals[1]); CHKERRQ(ierr);
+                this->m_ReadEigVals = false;
+                this->m_UseCachedEigVals = true;
+                this->m_Opt->m_KrylovMethod.eigvalsestimated = true;
+            } else {
+                this->m_Opt->m_KrylovMethod.eigvalsestimated = false;
+            }
+            break;
+        }
+        case LOWRANK:
+        {
+            // the eigenvectors of the data term do not change; we
+            // keep the basis (and its age) and rescale the eigenvalues
+            for (size_t i = 0; i < this->m_LowRankEigVals.size(); ++i) {
+                this->m_LowRankEigVals[i] *= scale;
+            }
+            break;
+        }
+        default:
+        {
+            ierr = ThrowError("preconditioner not defined"); CHKERRQ(ierr);
+            break;
+        }
+    }
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
 /********************************************************************
  * @brief setup phase of preconditioner
  *******************************************************************/
@@ -333,6 +489,18 @@ PetscErrorCode Preconditioner::DoSetup() {
     if (this->m_Opt->m_KrylovMethod.pctype == TWOLEVEL) {
         // apply restriction to adjoint, state and control variable
         ierr = this->ApplyRestriction(); CHKERRQ(ierr);
+    } else if (this->m_Opt->m_KrylovMethod.pctype == MULTILEVEL) {
+        // apply restriction to adjoint, state and control variable
+        // on all levels of the grid hierarchy (once per newton step)
+        ierr = this->ApplyRestriction(); CHKERRQ(ierr);
+        ierr = this->ApplyMultiLevelRestriction(); CHKERRQ(ierr);
+    } else if (this->m_Opt->m_KrylovMethod.pctype == LOWRANK) {
+        // the low-rank approximation is reused across several
+        // newton iterations (its construction is expensive)
+        if (this->m_LowRankAge < 0 || this->m_LowRankAge >= this->m_Opt->m_KrylovMethod.lrreuse) {
+            ierr = this->SetupLowRankPrecond(); CHKERRQ(ierr);
+        }
+        this->m_LowRankAge++;
     }
     this->m_Opt->m_KrylovMethod.pcsetupdone = true;
 
@@ -490,6 +658,19 @@ PetscErrorCode Preconditioner::SetupCoarseGrid() {
     //ierr = VecView(this->m_CoarseGrid->m_ReferenceImage); CHKERRQ(ierr);
     ierr = this->m_CoarseGrid->m_OptimizationProblem->SetReferenceImage(this->m_CoarseGrid->m_ReferenceImage); CHKERRQ(ierr);
 
+    // restrict spatially varying regularization weight (we restrict
+    // log(w), so that the weight stays positive)
+    ierr = this->m_OptimizationProblem->GetRegularizationWeight(this->m_RegWeight); CHKERRQ(ierr);
+    if (this->m_RegWeight != NULL) {
+        ierr = VecCreate(this->m_CoarseGrid->m_RegWeight, nlc, ngc); CHKERRQ(ierr);
+        ierr = VecCopy(this->m_RegWeight, this->m_WorkScaField1); CHKERRQ(ierr);
+        ierr = VecLog(this->m_WorkScaField1); CHKERRQ(ierr);
+        ierr = this->m_PreProc->Restrict(&this->m_CoarseGrid->m_RegWeight,
+                                         this->m_WorkScaField1, nxc, nx); CHKERRQ(ierr);
+        ierr = VecExp(this->m_CoarseGrid->m_RegWeight); CHKERRQ(ierr);
+        ierr = this->m_CoarseGrid->m_OptimizationProblem->SetRegularizationWeight(this->m_CoarseGrid->m_RegWeight); CHKERRQ(ierr);
+    }
+
     // switch flag
     this->m_CoarseGrid->setupdone = true;
 
@@ -528,6 +709,16 @@ PetscErrorCode Preconditioner::MatVec(Vec Px, Vec x) {
             ierr = this->Apply2LevelPrecond(Px, x); CHKERRQ(ierr);
             break;
         }
+        case MULTILEVEL:
+        {
+            ierr = this->Apply2LevelPrecond(Px, x); CHKERRQ(ierr);
+            break;
+        }
+        case LOWRANK:
+        {
+            ierr = this->ApplyLowRankPrecond(Px, x); CHKERRQ(ierr);
+            break;
+        }
         default:
         {
             ierr = ThrowError("preconditioner not defined"); CHKERRQ(ierr);
@@ -583,6 +774,7 @@ PetscErrorCode Preconditioner::Apply2LevelPrecond(Vec Px, Vec x) {
     PetscFunctionBegin;
     ScalarType pct, value;
     IntType nxc[3], nx[3];
+    CoarseGrid* coarsest = NULL;
     this->m_Opt->Enter(__func__);
 
     // do allocation of coarse grid
@@ -590,9 +782,24 @@ PetscErrorCode Preconditioner::Apply2LevelPrecond(Vec Px, Vec x) {
         ierr = this->SetupCoarseGrid(); CHKERRQ(ierr);
     }
 
-    // do setup
+    // for the multilevel preconditioner we have to allocate the
+    // grid hierarchy and restrict the variables before we enter the
+    // cycle (the smoother applies the hessian on intermediate levels)
+    if (this->m_Opt->m_KrylovMethod.pctype == MULTILEVEL) {
+        if (this->m_MultiLevel.empty()) {
+            ierr = this->SetupMultiLevel(); CHKERRQ(ierr);
+        }
+        if (!this->m_Opt->m_KrylovMethod.pcsetupdone) {
+            ierr = this->DoSetup(); CHKERRQ(ierr);
+        }
+        coarsest = this->GetLevel(this->m_Opt->m_KrylovMethod.mglevels - 1);
+    } else {
+        coarsest = this->m_CoarseGrid;
+    }
+
+    // do setup (krylov method operates on coarsest level)
     if (this->m_KrylovMethod == NULL) {
-        ierr = this->SetupKrylovMethod(this->m_CoarseGrid->nl(), this->m_CoarseGrid->ng()); CHKERRQ(ierr);
+        ierr = this->SetupKrylovMethod(coarsest->nl(), coarsest->ng()); CHKERRQ(ierr);
     }
 
     // check if all the necessary pointers have been initialized
@@ -638,7 +845,12 @@ PetscErrorCode Preconditioner::Apply2LevelPrecond(Vec Px, Vec x) {
 
     // invert preconditioner
     ierr = this->m_Opt->StartTimer(PMVEXEC); CHKERRQ(ierr);
-    ierr = KSPSolve(this->m_KrylovMethod, this->m_CoarseGrid->x, this->m_CoarseGrid->y); CHKERRQ(ierr);
+    if (this->m_Opt->m_KrylovMethod.pctype == MULTILEVEL) {
+        ierr = this->ApplyCycle(1); CHKERRQ(ierr);
+    } else {
+        ierr = KSPSolve(this->m_KrylovMethod, this->m_CoarseGrid->x, this->m_CoarseGrid->y); CHKERRQ(ierr);
+        ierr = this->CheckEigValCache(this->m_CoarseGrid->x); CHKERRQ(ierr);
+    }
     ierr = this->m_Opt->StopTimer(PMVEXEC); CHKERRQ(ierr);
 
     // inspect pc solver
@@ -677,6 +889,328 @@ PetscErrorCode Preconditioner::Apply2LevelPrecond(Vec Px, Vec x) {
 
 
 
+/********************************************************************
+ * @brief setup of low-rank preconditioner; we compute the dominant
+ * eigenpairs (lambda_i, u_i) of the data term K of the symmetrically
+ * preconditioned (gauss-newton) hessian I + K (with K = A^{-1/2} H_d
+ * A^{-1/2}, where A is the regularization operator); if the grid
+ * scale is larger than one, the eigenpairs are computed on the
+ * coarse grid and the eigenvectors are prolonged to the fine grid
+ *******************************************************************/
+PetscErrorCode Preconditioner::SetupLowRankPrecond() {
+    PetscErrorCode ierr = 0;
+    IntType nx[3], nxc[3], k, nq;
+    int hessstride;
+    std::vector<Vec> u;
+    std::vector<ScalarType> lambda, h;
+    ScalarType nrm0, nrm;
+    Vec y = NULL;
+    std::stringstream ss;
+    bool coarse;
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    ierr = Assert(this->m_OptimizationProblem != NULL, "null pointer"); CHKERRQ(ierr);
+
+    ierr = this->ClearLowRankBasis(); CHKERRQ(ierr);
+
+    // the basis is reused across newton iterations; we do not
+    // want to use inexact hessian matvecs to compute it
+    hessstride = this->m_Opt->m_KrylovMethod.hessstride;
+    this->m_Opt->m_KrylovMethod.hessstride = 1;
+
+    coarse = this->m_Opt->m_KrylovMethod.pcgridscale > 1.0;
+    if (coarse) {
+        ierr = Assert(this->m_PreProc != NULL, "null pointer"); CHKERRQ(ierr);
+
+        // do allocation of coarse grid
+        if (!this->m_CoarseGrid->setupdone) {
+            ierr = this->SetupCoarseGrid(); CHKERRQ(ierr);
+        }
+        // restrict state, adjoint, and control variable
+        ierr = this->ApplyRestriction(); CHKERRQ(ierr);
+
+        ierr = this->ComputeLowRankBasis(u, this->m_LowRankEigVals, true); CHKERRQ(ierr);
+
+        for (int i = 0; i < 3; ++i) {
+            nx[i]  = this->m_Opt->m_Domain.nx[i];
+            nxc[i] = this->m_CoarseGrid->m_Opt->m_Domain.nx[i];
+        }
+
+        // prolong eigenvectors to fine grid; the spectral prolongation
+        // (truncation/zero padding of the coefficients) does not preserve
+        // orthogonality, so we re-orthonormalize the prolonged basis
+        // (classical gram-schmidt with reorthogonalization; the low-rank
+        // inverse requires an orthonormal basis)
+        k = static_cast<IntType>(u.size());
+        lambda = this->m_LowRankEigVals;
+        this->m_LowRankEigVals.clear();
+        h.resize(k);
+        for (IntType i = 0; i < k; ++i) {
+            ierr = VecCreate(y, 3*this->m_Opt->m_Domain.nl, 3*this->m_Opt->m_Domain.ng); CHKERRQ(ierr);
+            ierr = this->m_CoarseGrid->m_IncControlVariable->SetComponents(u[i]); CHKERRQ(ierr);
+            ierr = this->m_PreProc->Prolong(this->m_IncControlVariable,
+                                            this->m_CoarseGrid->m_IncControlVariable, nx, nxc); CHKERRQ(ierr);
+            ierr = this->m_IncControlVariable->GetComponents(y); CHKERRQ(ierr);
+            ierr = VecDestroy(&u[i]); CHKERRQ(ierr);
+
+            ierr = VecNorm(y, NORM_2, &nrm0); CHKERRQ(ierr);
+            nq = static_cast<IntType>(this->m_LowRankBasis.size());
+            for (int pass = 0; pass < 2 && nq > 0; ++pass) {
+                ierr = VecMDot(y, nq, this->m_LowRankBasis.data(), h.data()); CHKERRQ(ierr);
+                for (IntType j = 0; j < nq; ++j) h[j] = -h[j];
+                ierr = VecMAXPY(y, nq, h.data(), this->m_LowRankBasis.data()); CHKERRQ(ierr);
+            }
+            ierr = VecNorm(y, NORM_2, &nrm); CHKERRQ(ierr);
+
+            // drop directions that are (numerically) in the span of the basis
+            if (nrm > 1E3*std::numeric_limits<ScalarType>::epsilon()*nrm0 && nrm > 0.0) {
+                ierr = VecScale(y, 1.0/nrm); CHKERRQ(ierr);
+                this->m_LowRankBasis.push_back(y);
+                this->m_LowRankEigVals.push_back(lambda[i]);
+            } else {
+                ierr = VecDestroy(&y); CHKERRQ(ierr);
+            }
+            y = NULL;
+        }
+    } else {
+        ierr = this->ComputeLowRankBasis(this->m_LowRankBasis, this->m_LowRankEigVals, false); CHKERRQ(ierr);
+    }
+    this->m_Opt->m_KrylovMethod.hessstride = hessstride;
+
+    if (this->m_Opt->m_Verbosity > 1) {
+        ss << "low-rank preconditioner: rank " << this->m_LowRankBasis.size();
+        if (!this->m_LowRankEigVals.empty()) {
+            ss << "; eigenvalues in [" << std::scientific
+               << this->m_LowRankEigVals.back() << ","
+               << this->m_LowRankEigVals.front() << "]";
+        }
+        ierr = DbgMsg(ss.str()); CHKERRQ(ierr);
+        ss.clear(); ss.str(std::string());
+    }
+
+    this->m_LowRankAge = 0;
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief compute dominant eigenpairs of the data term of the
+ * preconditioned hessian using a (two pass) randomized range finder
+ * with oversampling; the range is orthonormalized (classical
+ * gram-schmidt with reorthogonalization) and the eigenpairs are
+ * recovered from the projected operator Q^T K Q
+ * @param[out] u eigenvectors (sorted by decreasing eigenvalue)
+ * @param[out] lambda eigenvalues (decreasing)
+ * @param[in] coarse flag: use hessian on coarse grid
+ *******************************************************************/
+PetscErrorCode Preconditioner::ComputeLowRankBasis(std::vector<Vec>& u,
+                                                   std::vector<ScalarType>& lambda,
+                                                   bool coarse) {
+    PetscErrorCode ierr = 0;
+    IntType nl, ng, ns, nq, k;
+    OptProbType* optprob = NULL;
+    Vec y = NULL;
+    std::vector<Vec> q, omega, z;
+    std::vector<ScalarType> b, v, theta, h;
+    std::vector<int> idx;
+    ScalarType nrm0, nrm, tol;
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    if (coarse) {
+        optprob = this->m_CoarseGrid->m_OptimizationProblem;
+        nl = this->m_CoarseGrid->nl();
+        ng = this->m_CoarseGrid->ng();
+    } else {
+        optprob = this->m_OptimizationProblem;
+        nl = this->m_Opt->m_Domain.nl;
+        ng = this->m_Opt->m_Domain.ng;
+    }
+    ierr = Assert(optprob != NULL, "null pointer"); CHKERRQ(ierr);
+
+    ns = this->m_Opt->m_KrylovMethod.lrrank + this->m_Opt->m_KrylovMethod.lroversample;
+
+    if (this->m_RandomNumGen == NULL) {
+        ierr = PetscRandomCreate(PETSC_COMM_WORLD, &this->m_RandomNumGen); CHKERRQ(ierr);
+        ierr = PetscRandomSetInterval(this->m_RandomNumGen, -1.0, 1.0); CHKERRQ(ierr);
+    }
+
+    // range finder: Y = K Omega = (H - I) Omega for random Omega; we
+    // do not apply the scaling by the lebesgue measure, i.e., the
+    // preconditioned hessian is I + K; the samples are independent,
+    // so we apply the hessian to all of them at once (block matvec)
+    omega.resize(ns, NULL);
+    z.resize(ns, NULL);
+    for (IntType j = 0; j < ns; ++j) {
+        ierr = VecCreate(omega[j], 3*nl, 3*ng); CHKERRQ(ierr);
+        ierr = VecCreate(z[j], 3*nl, 3*ng); CHKERRQ(ierr);
+        ierr = VecSetRandom(omega[j], this->m_RandomNumGen); CHKERRQ(ierr);
+    }
+    ierr = optprob->HessianMatVecBlock(z.data(), omega.data(), ns, false); CHKERRQ(ierr);
+
+    h.resize(ns);
+    for (IntType j = 0; j < ns; ++j) {
+        y = z[j]; z[j] = NULL;
+        ierr = VecAXPY(y, -1.0, omega[j]); CHKERRQ(ierr);
+        this->m_Opt->IncrementCounter(PCMATVEC);
+
+        // orthogonalize against current basis (twice is enough)
+        ierr = VecNorm(y, NORM_2, &nrm0); CHKERRQ(ierr);
+        nq = static_cast<IntType>(q.size());
+        for (int pass = 0; pass < 2 && nq > 0; ++pass) {
+            ierr = VecMDot(y, nq, q.data(), h.data()); CHKERRQ(ierr);
+            for (IntType i = 0; i < nq; ++i) h[i] = -h[i];
+            ierr = VecMAXPY(y, nq, h.data(), q.data()); CHKERRQ(ierr);
+        }
+        ierr = VecNorm(y, NORM_2, &nrm); CHKERRQ(ierr);
+
+        // drop directions that are (numerically) in the span of Q
+        if (nrm > 1E3*std::numeric_limits<ScalarType>::epsilon()*nrm0 && nrm > 0.0) {
+            ierr = VecScale(y, 1.0/nrm); CHKERRQ(ierr);
+            q.push_back(y);
+        } else {
+            ierr = VecDestroy(&y); CHKERRQ(ierr);
+        }
+        y = NULL;
+    }
+    nq = static_cast<IntType>(q.size());
+
+    // projected operator B = Q^T K Q (we reuse omega to store K Q)
+    ierr = optprob->HessianMatVecBlock(omega.data(), q.data(), nq, false); CHKERRQ(ierr);
+    b.resize(nq*nq);
+    for (IntType j = 0; j < nq; ++j) {
+        ierr = VecAXPY(omega[j], -1.0, q[j]); CHKERRQ(ierr);
+        ierr = VecMDot(omega[j], nq, q.data(), &b[j*nq]); CHKERRQ(ierr);
+        this->m_Opt->IncrementCounter(PCMATVEC);
+    }
+    for (IntType i = 0; i < nq; ++i) {
+        for (IntType j = i+1; j < nq; ++j) {
+            b[i*nq + j] = 0.5*(b[i*nq + j] + b[j*nq + i]);
+            b[j*nq + i] = b[i*nq + j];
+        }
+    }
+
+    if (nq > 0) {
+        ierr = SymmetricEigenDecomposition(b, v, theta, static_cast<int>(nq)); CHKERRQ(ierr);
+    }
+
+    // keep the lrrank largest positive eigenvalues (K is positive
+    // semi-definite for the gauss-newton approximation)
+    for (IntType i = 0; i < nq; ++i) idx.push_back(static_cast<int>(i));
+    std::sort(idx.begin(), idx.end(), [&theta](int i, int j) {return theta[i] > theta[j];});
+    tol = nq > 0 ? 1E3*std::numeric_limits<ScalarType>::epsilon()*std::abs(theta[idx[0]]) : 0.0;
+    k = 0;
+    while (k < nq && k < this->m_Opt->m_KrylovMethod.lrrank && theta[idx[k]] > tol) ++k;
+
+    // eigenvectors u_j = Q v_j
+    u.resize(k);
+    lambda.resize(k);
+    for (IntType j = 0; j < k; ++j) {
+        for (IntType i = 0; i < nq; ++i) h[i] = v[i*nq + idx[j]];
+        ierr = VecCreate(u[j], 3*nl, 3*ng); CHKERRQ(ierr);
+        ierr = VecSet(u[j], 0.0); CHKERRQ(ierr);
+        ierr = VecMAXPY(u[j], nq, h.data(), q.data()); CHKERRQ(ierr);
+        lambda[j] = theta[idx[j]];
+    }
+
+    // clear memory
+    for (IntType i = 0; i < nq; ++i) {
+        ierr = VecDestroy(&q[i]); CHKERRQ(ierr);
+    }
+    for (IntType i = 0; i < ns; ++i) {
+        if (omega[i] != NULL) {ierr = VecDestroy(&omega[i]); CHKERRQ(ierr);}
+        if (z[i] != NULL) {ierr = VecDestroy(&z[i]); CHKERRQ(ierr);}
+    }
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief apply low-rank preconditioner; given the eigenpairs of K,
+ * the inverse of I + U Lambda U^T is (sherman-morrison-woodbury)
+ * I - U diag(lambda_i/(1+lambda_i)) U^T; we account for the scaling
+ * of the hessian by the lebesgue measure
+ *******************************************************************/
+PetscErrorCode Preconditioner::ApplyLowRankPrecond(Vec Px, Vec x) {
+    PetscErrorCode ierr = 0;
+    IntType k;
+    std::vector<ScalarType> h;
+    ScalarType hd;
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    // setup (once per newton iteration)
+    if (!this->m_Opt->m_KrylovMethod.pcsetupdone) {
+        ierr = this->DoSetup(); CHKERRQ(ierr);
+    }
+
+    // start timer
+    ierr = this->m_Opt->StartTimer(PMVEXEC); CHKERRQ(ierr);
+
+    ierr = VecCopy(x, Px); CHKERRQ(ierr);
+
+    k = static_cast<IntType>(this->m_LowRankBasis.size());
+    if (k > 0) {
+        h.resize(k);
+        ierr = VecMDot(x, k, this->m_LowRankBasis.data(), h.data()); CHKERRQ(ierr);
+        for (IntType i = 0; i < k; ++i) {
+            h[i] *= -this->m_LowRankEigVals[i]/(1.0 + this->m_LowRankEigVals[i]);
+        }
+        ierr = VecMAXPY(Px, k, h.data(), this->m_LowRankBasis.data()); CHKERRQ(ierr);
+    }
+
+    hd = this->m_Opt->GetLebesgueMeasure();
+    ierr = VecScale(Px, 1.0/hd); CHKERRQ(ierr);
+
+    // stop timer
+    ierr = this->m_Opt->StopTimer(PMVEXEC); CHKERRQ(ierr);
+
+    // increment counter
+    this->m_Opt->IncrementCounter(PCMATVEC);
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief clear basis of low-rank preconditioner
+ *******************************************************************/
+PetscErrorCode Preconditioner::ClearLowRankBasis() {
+    PetscErrorCode ierr = 0;
+    PetscFunctionBegin;
+
+    for (size_t i = 0; i < this->m_LowRankBasis.size(); ++i) {
+        if (this->m_LowRankBasis[i] != NULL) {
+            ierr = VecDestroy(&this->m_LowRankBasis[i]); CHKERRQ(ierr);
+        }
+    }
+    this->m_LowRankBasis.clear();
+    this->m_LowRankEigVals.clear();
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
 /********************************************************************
  * @brief applies the restriction operator to the state, adjoint,
  * and control variable (setup phase of 2level preconditioner)
@@ -832,6 +1366,411 @@ PetscErrorCode Preconditioner::ApplyRestriction() {
 
 
 
+/********************************************************************
+ * @brief setup of grid hierarchy for multilevel preconditioner; the
+ * coarse grid of the two-level scheme is level 1; we coarsen it
+ * further by the grid scale until we reach the coarsest level;
+ * the options, the optimization problems, and the restricted
+ * reference images are set up once and kept for all newton steps
+ *******************************************************************/
+PetscErrorCode Preconditioner::SetupMultiLevel() {
+    PetscErrorCode ierr = 0;
+    IntType nt, nc, nl, ng, nx[3], nxc[3];
+    ScalarType scale, value;
+    int nlevels;
+    CoarseGrid *lev = NULL, *prev = NULL;
+    std::stringstream ss;
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    ierr = Assert(this->m_CoarseGrid->setupdone, "coarse grid not set up"); CHKERRQ(ierr);
+    ierr = Assert(this->m_PreProc != NULL, "null pointer"); CHKERRQ(ierr);
+
+    nt = this->m_Opt->m_Domain.nt;
+    nc = this->m_Opt->m_Domain.nc;
+    scale = this->m_Opt->m_KrylovMethod.pcgridscale;
+    nlevels = this->m_Opt->m_KrylovMethod.mglevels;
+
+    // levels 2,...,nlevels-1 (level 0 is the fine grid)
+    for (int l = 2; l < nlevels; ++l) {
+        prev = this->GetLevel(l-1);
+
+        try {lev = new CoarseGrid();}
+        catch (std::bad_alloc&) {
+            ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
+        }
+        ierr = this->InitCoarseGrid(lev); CHKERRQ(ierr);
+        this->m_MultiLevel.push_back(lev);
+
+        // copy options of previous level and coarsen grid
+        try {lev->m_Opt = new RegOpt(*prev->m_Opt);}
+        catch (std::bad_alloc&) {
+            ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
+        }
+        for (int i = 0; i < 3; ++i) {
+            nx[i]  = prev->m_Opt->m_Domain.nx[i];
+            value  = static_cast<ScalarType>(nx[i])/scale;
+            nxc[i] = static_cast<IntType>(std::ceil(value));
+            lev->m_Opt->m_Domain.nx[i] = nxc[i];
+        }
+        ierr = lev->m_Opt->DoSetup(false); CHKERRQ(ierr);
+
+        if (this->m_Opt->m_Verbosity > 2) {
+            ss  << "setup of preconditioner (level " << l << ") "
+                << "nx: (" << nxc[0] << "," << nxc[1] << "," << nxc[2] << ")";
+            ierr = DbgMsg(ss.str()); CHKERRQ(ierr);
+            ss.str(std::string()); ss.clear();
+        }
+
+        // allocate class for registration
+        if (this->m_Opt->m_RegModel == COMPRESSIBLE) {
+            try {lev->m_OptimizationProblem = new CLAIRE(lev->m_Opt);}
+            catch (std::bad_alloc&) {
+                ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
+            }
+        } else if (this->m_Opt->m_RegModel == STOKES) {
+            try {lev->m_OptimizationProblem = new CLAIREStokes(lev->m_Opt);}
+            catch (std::bad_alloc&) {
+                ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
+            }
+        } else if (this->m_Opt->m_RegModel == RELAXEDSTOKES) {
+            try {lev->m_OptimizationProblem = new CLAIREDivReg(lev->m_Opt);}
+            catch (std::bad_alloc&) {
+                ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
+            }
+        } else {
+            ierr = ThrowError("registration model not defined"); CHKERRQ(ierr);
+        }
+
+        nl = lev->nl();
+        ng = lev->ng();
+
+        ierr = VecCreate(lev->m_StateVariable, (nt+1)*nc*nl, (nt+1)*nc*ng); CHKERRQ(ierr);
+        if (this->m_Opt->m_OptPara.method == FULLNEWTON) {
+            ierr = VecCreate(lev->m_AdjointVariable, (nt+1)*nc*nl, (nt+1)*nc*ng); CHKERRQ(ierr);
+        } else {
+            ierr = VecCreate(lev->m_AdjointVariable, nc*nl, nc*ng); CHKERRQ(ierr);
+        }
+        ierr = VecCreate(lev->m_WorkScaField1, nl, ng); CHKERRQ(ierr);
+        ierr = VecCreate(lev->m_WorkScaField2, nl, ng); CHKERRQ(ierr);
+
+        try {lev->m_ControlVariable = new VecField(lev->m_Opt);}
+        catch (std::bad_alloc&) {
+            ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
+        }
+        try {lev->m_IncControlVariable = new VecField(lev->m_Opt);}
+        catch (std::bad_alloc&) {
+            ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
+        }
+
+        ierr = VecCreate(lev->x, 3*nl, 3*ng); CHKERRQ(ierr);
+        ierr = VecCreate(lev->y, 3*nl, 3*ng); CHKERRQ(ierr);
+
+        if (this->m_Mask != NULL) {
+            ierr = VecCreate(lev->m_Mask, nl, ng); CHKERRQ(ierr);
+        }
+
+        // restrict reference image from previous level
+        ierr = VecCreate(lev->m_ReferenceImage, nl, ng); CHKERRQ(ierr);
+        ierr = this->m_PreProc->Restrict(&lev->m_ReferenceImage,
+                                         prev->m_ReferenceImage, nxc, nx); CHKERRQ(ierr);
+        ierr = lev->m_OptimizationProblem->SetReferenceImage(lev->m_ReferenceImage); CHKERRQ(ierr);
+
+        // restrict regularization weight from previous level (log(w))
+        if (prev->m_RegWeight != NULL) {
+            ierr = VecCreate(lev->m_RegWeight, nl, ng); CHKERRQ(ierr);
+            ierr = VecCopy(prev->m_RegWeight, prev->m_WorkScaField1); CHKERRQ(ierr);
+            ierr = VecLog(prev->m_WorkScaField1); CHKERRQ(ierr);
+            ierr = this->m_PreProc->Restrict(&lev->m_RegWeight,
+                                             prev->m_WorkScaField1, nxc, nx); CHKERRQ(ierr);
+            ierr = VecExp(lev->m_RegWeight); CHKERRQ(ierr);
+            ierr = lev->m_OptimizationProblem->SetRegularizationWeight(lev->m_RegWeight); CHKERRQ(ierr);
+        }
+
+        lev->setupdone = true;
+    }
+
+    // work space for smoother and residual on all but the coarsest level
+    for (int l = 1; l < nlevels-1; ++l) {
+        lev = this->GetLevel(l);
+        nl = lev->nl();
+        ng = lev->ng();
+        if (lev->r == NULL) {
+            ierr = VecCreate(lev->r, 3*nl, 3*ng); CHKERRQ(ierr);
+        }
+        if (lev->z == NULL) {
+            ierr = VecCreate(lev->z, 3*nl, 3*ng); CHKERRQ(ierr);
+        }
+        if (lev->m_WorkVecField == NULL) {
+            try {lev->m_WorkVecField = new VecField(lev->m_Opt);}
+            catch (std::bad_alloc&) {
+                ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
+            }
+        }
+        // frequency filters have to be applied with the fft plan
+        // of the current level
+        if (lev->m_PreProc == NULL) {
+            try {lev->m_PreProc = new Preprocessing(lev->m_Opt);}
+            catch (std::bad_alloc&) {
+                ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
+            }
+        }
+    }
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief applies the restriction operator to the state, adjoint,
+ * and control variable from level 1 down to the coarsest level
+ * (setup phase of multilevel preconditioner; the variables on
+ * level 1 are set in ApplyRestriction)
+ *******************************************************************/
+PetscErrorCode Preconditioner::ApplyMultiLevelRestriction() {
+    PetscErrorCode ierr = 0;
+    IntType nt, nc, nl_f, nl_c, l_f, l_c, nx_f[3], nx_c[3];
+    ScalarType *p_m = NULL, *p_mcoarse = NULL, *p_mj = NULL, *p_mjcoarse = NULL;
+    bool restrictadjoint;
+    CoarseGrid *lev = NULL, *prev = NULL;
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    nt = this->m_Opt->m_Domain.nt;
+    nc = this->m_Opt->m_Domain.nc;
+
+    for (size_t k = 0; k < this->m_MultiLevel.size(); ++k) {
+        prev = this->GetLevel(static_cast<int>(k)+1);
+        lev  = this->m_MultiLevel[k];
+
+        for (int i = 0; i < 3; ++i) {
+            nx_f[i] = prev->m_Opt->m_Domain.nx[i];
+            nx_c[i] = lev->m_Opt->m_Domain.nx[i];
+        }
+        nl_f = prev->nl();
+        nl_c = lev->nl();
+
+        // if parameter continuation is enabled, parse regularization weight
+        if (this->m_Opt->m_ParaCont.enabled) {
+            lev->m_Opt->m_RegNorm.beta[0] = this->m_Opt->m_RegNorm.beta[0];
+            lev->m_Opt->m_RegNorm.beta[1] = this->m_Opt->m_RegNorm.beta[1];
+            lev->m_Opt->m_RegNorm.beta[2] = this->m_Opt->m_RegNorm.beta[2];
+        }
+
+        // restrict control variable
+        ierr = this->m_PreProc->Restrict(lev->m_ControlVariable,
+                                         prev->m_ControlVariable, nx_c, nx_f); CHKERRQ(ierr);
+
+        // restrict state variable (all time points) and adjoint variable
+        // (all time points for full newton; only t=0 for gauss newton)
+        for (int v = 0; v < 2; ++v) {
+            if (v == 0) {
+                ierr = VecGetArray(prev->m_StateVariable, &p_m); CHKERRQ(ierr);
+                ierr = VecGetArray(lev->m_StateVariable, &p_mcoarse); CHKERRQ(ierr);
+            } else {
+                ierr = VecGetArray(prev->m_AdjointVariable, &p_m); CHKERRQ(ierr);
+                ierr = VecGetArray(lev->m_AdjointVariable, &p_mcoarse); CHKERRQ(ierr);
+            }
+            for (IntType j = 0; j <= nt; ++j) {
+                restrictadjoint = (j == 0) || (this->m_Opt->m_OptPara.method != GAUSSNEWTON);
+                if (v == 1 && !restrictadjoint) break;
+                for (IntType c = 0; c < nc; ++c) {
+                    l_f = j*nl_f*nc + c*nl_f;
+                    l_c = j*nl_c*nc + c*nl_c;
+
+                    ierr = VecGetArray(prev->m_WorkScaField1, &p_mj); CHKERRQ(ierr);
+                    try {std::copy(p_m+l_f, p_m+l_f+nl_f, p_mj);}
+                    catch (std::exception&) {
+                        ierr = ThrowError("copy failed"); CHKERRQ(ierr);
+                    }
+                    ierr = VecRestoreArray(prev->m_WorkScaField1, &p_mj); CHKERRQ(ierr);
+
+                    ierr = this->m_PreProc->Restrict(&lev->m_WorkScaField1,
+                                                     prev->m_WorkScaField1, nx_c, nx_f); CHKERRQ(ierr);
+
+                    ierr = VecGetArray(lev->m_WorkScaField1, &p_mjcoarse); CHKERRQ(ierr);
+                    try {std::copy(p_mjcoarse, p_mjcoarse+nl_c, p_mcoarse+l_c);}
+                    catch (std::exception&) {
+                        ierr = ThrowError("copy failed"); CHKERRQ(ierr);
+                    }
+                    ierr = VecRestoreArray(lev->m_WorkScaField1, &p_mjcoarse); CHKERRQ(ierr);
+                }
+            }
+            if (v == 0) {
+                ierr = VecRestoreArray(lev->m_StateVariable, &p_mcoarse); CHKERRQ(ierr);
+                ierr = VecRestoreArray(prev->m_StateVariable, &p_m); CHKERRQ(ierr);
+            } else {
+                ierr = VecRestoreArray(lev->m_AdjointVariable, &p_mcoarse); CHKERRQ(ierr);
+                ierr = VecRestoreArray(prev->m_AdjointVariable, &p_m); CHKERRQ(ierr);
+            }
+        }
+
+        // parse variables to optimization problem on this level
+        // (we have to set the control variable first)
+        ierr = lev->m_OptimizationProblem->SetControlVariable(lev->m_ControlVariable); CHKERRQ(ierr);
+        ierr = lev->m_OptimizationProblem->SetStateVariable(lev->m_StateVariable); CHKERRQ(ierr);
+        ierr = lev->m_OptimizationProblem->SetAdjointVariable(lev->m_AdjointVariable); CHKERRQ(ierr);
+
+        if (this->m_Mask != NULL) {
+            ierr = this->m_PreProc->Restrict(&lev->m_Mask, prev->m_Mask, nx_c, nx_f); CHKERRQ(ierr);
+            ierr = lev->m_OptimizationProblem->SetMask(lev->m_Mask); CHKERRQ(ierr);
+        }
+    }
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief compute residual r = x - H y on a level of the grid
+ * hierarchy (H is the hessian on that level)
+ *******************************************************************/
+PetscErrorCode Preconditioner::ComputeResidual(CoarseGrid* lev, bool zeroguess) {
+    PetscErrorCode ierr = 0;
+    PetscFunctionBegin;
+
+    if (zeroguess) {
+        ierr = VecCopy(lev->x, lev->r); CHKERRQ(ierr);
+    } else {
+        // no scaling by lebesgue measure (see HessianMatVec)
+        ierr = lev->m_OptimizationProblem->HessianMatVec(lev->z, lev->y, false); CHKERRQ(ierr);
+        this->m_Opt->IncrementCounter(PCMATVEC);
+        ierr = VecWAXPY(lev->r, -1.0, lev->z, lev->x); CHKERRQ(ierr);
+    }
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief smoother for multilevel preconditioner; we apply a
+ * richardson iteration to the high frequency components of the
+ * residual, i.e., y += F_h[x - H y], where F_h is the high-pass
+ * filter that removes the frequencies representable on the next
+ * coarser level; for the (symmetrically) preconditioned hessian
+ * the spectrum in this band clusters around one, so that we do not
+ * need any damping
+ *******************************************************************/
+PetscErrorCode Preconditioner::ApplySmoother(CoarseGrid* lev, ScalarType pct,
+                                             int nsmooth, bool zeroguess) {
+    PetscErrorCode ierr = 0;
+    PetscFunctionBegin;
+
+    for (int i = 0; i < nsmooth; ++i) {
+        ierr = this->ComputeResidual(lev, zeroguess && i == 0); CHKERRQ(ierr);
+
+        // apply high-pass filter to residual
+        ierr = lev->m_WorkVecField->SetComponents(lev->r); CHKERRQ(ierr);
+        ierr = lev->m_PreProc->ApplyRectFreqFilter(lev->m_WorkVecField,
+                                                   lev->m_WorkVecField, pct, false); CHKERRQ(ierr);
+        ierr = lev->m_WorkVecField->GetComponents(lev->r); CHKERRQ(ierr);
+
+        ierr = VecAXPY(lev->y, 1.0, lev->r); CHKERRQ(ierr);
+    }
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief apply multilevel cycle on level l (v-cycle: one coarse grid
+ * correction; w-cycle: two); input is stored in x, output in y of
+ * the grid on level l; on the coarsest level we invert the hessian
+ * with the krylov method of the preconditioner
+ *******************************************************************/
+PetscErrorCode Preconditioner::ApplyCycle(int l) {
+    PetscErrorCode ierr = 0;
+    IntType nx[3], nxc[3];
+    ScalarType pct, value;
+    int nlevels, nsmooth;
+    bool zeroguess;
+    CoarseGrid *lev = NULL, *next = NULL;
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    nlevels = this->m_Opt->m_KrylovMethod.mglevels;
+    nsmooth = this->m_Opt->m_KrylovMethod.mgsmooth;
+    lev = this->GetLevel(l);
+
+    // coarsest level: invert hessian
+    if (l == nlevels-1) {
+        ierr = KSPSolve(this->m_KrylovMethod, lev->x, lev->y); CHKERRQ(ierr);
+        ierr = this->CheckEigValCache(lev->x); CHKERRQ(ierr);
+        this->m_Opt->Exit(__func__);
+        PetscFunctionReturn(ierr);
+    }
+
+    next = this->GetLevel(l+1);
+
+    pct = 0; // set to zero, cause we search for a max
+    for (int i = 0; i < 3; ++i) {
+        nx[i]  = lev->m_Opt->m_Domain.nx[i];
+        nxc[i] = next->m_Opt->m_Domain.nx[i];
+        value  = static_cast<ScalarType>(nxc[i])/static_cast<ScalarType>(nx[i]);
+        pct = value > pct ? value : pct;
+    }
+
+    ierr = VecSet(lev->y, 0.0); CHKERRQ(ierr);
+    zeroguess = true;
+
+    // pre-smoothing
+    if (nsmooth > 0) {
+        ierr = this->ApplySmoother(lev, pct, nsmooth, zeroguess); CHKERRQ(ierr);
+        zeroguess = false;
+    }
+
+    // coarse grid correction
+    for (int c = 0; c < this->m_Opt->m_KrylovMethod.mgcycle; ++c) {
+        ierr = this->ComputeResidual(lev, zeroguess); CHKERRQ(ierr);
+        zeroguess = false;
+
+        // apply low pass filter before we restrict residual
+        ierr = lev->m_WorkVecField->SetComponents(lev->r); CHKERRQ(ierr);
+        ierr = lev->m_PreProc->ApplyRectFreqFilter(lev->m_WorkVecField,
+                                                   lev->m_WorkVecField, pct); CHKERRQ(ierr);
+        ierr = this->m_PreProc->Restrict(next->m_IncControlVariable,
+                                         lev->m_WorkVecField, nxc, nx); CHKERRQ(ierr);
+        ierr = next->m_IncControlVariable->GetComponents(next->x); CHKERRQ(ierr);
+
+        ierr = this->ApplyCycle(l+1); CHKERRQ(ierr);
+
+        // prolong correction and remove aliased high frequencies
+        ierr = next->m_IncControlVariable->SetComponents(next->y); CHKERRQ(ierr);
+        ierr = this->m_PreProc->Prolong(lev->m_WorkVecField,
+                                        next->m_IncControlVariable, nx, nxc); CHKERRQ(ierr);
+        ierr = lev->m_PreProc->ApplyRectFreqFilter(lev->m_WorkVecField,
+                                                   lev->m_WorkVecField, pct); CHKERRQ(ierr);
+        ierr = lev->m_WorkVecField->GetComponents(lev->r); CHKERRQ(ierr);
+
+        ierr = VecAXPY(lev->y, 1.0, lev->r); CHKERRQ(ierr);
+    }
+
+    // post-smoothing
+    ierr = this->ApplySmoother(lev, pct, nsmooth); CHKERRQ(ierr);
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
 /********************************************************************
  * @brief do setup for krylov method
  *******************************************************************/
@@ -963,6 +1902,7 @@ PetscErrorCode Preconditioner::SetupKrylovMethod(IntType nl, IntType ng) {
  *******************************************************************/
 PetscErrorCode Preconditioner::HessianMatVec(Vec Hx, Vec x) {
     PetscErrorCode ierr = 0;
+    int level;
     PetscFunctionBegin;
 
     this->m_Opt->Enter(__func__);
@@ -977,6 +1917,13 @@ PetscErrorCode Preconditioner::HessianMatVec(Vec Hx, Vec x) {
         // the spatial integration in the objective functional (false)
         ierr = this->m_CoarseGrid->m_OptimizationProblem->HessianMatVec(Hx, x, false); CHKERRQ(ierr);
 //        ierr = this->m_CoarseGrid->m_OptimizationProblem->HessianMatVec(Hx, x, true); CHKERRQ(ierr);
+    } else if (this->m_Opt->m_KrylovMethod.pctype == MULTILEVEL) {
+        if (this->m_Opt->m_Verbosity > 2) {
+            ierr = DbgMsg("preconditioner: (H^coarsest + Q^coarsest)[x^coarsest]"); CHKERRQ(ierr);
+        }
+        // the krylov method inverts the hessian on the coarsest level
+        level = this->m_Opt->m_KrylovMethod.mglevels - 1;
+        ierr = this->GetLevel(level)->m_OptimizationProblem->HessianMatVec(Hx, x, false); CHKERRQ(ierr);
     } else {
         ierr = this->m_OptimizationProblem->HessianMatVec(Hx, x); CHKERRQ(ierr);
     }
@@ -996,14 +1943,18 @@ PetscErrorCode Preconditioner::HessianMatVec(Vec Hx, Vec x) {
  * @brief this is an interface to compute the eigenvalues needed
  * when considering a chebyshev method to invert the preconditioner;
  * the eigenvalues are estimated using the Lanczo (KSPCG) or
- * Arnoldi (KSPGMRES) process using a random right hand side vector
+ * Arnoldi (KSPGMRES) process using a random right hand side vector;
+ * the estimates are cached (see CheckEigValCache); for the
+ * analytically preconditioned hessian they are reused (rescaled to
+ * the current regularization weight) instead of re-estimated
  *******************************************************************/
 PetscErrorCode Preconditioner::EstimateEigenValues() {
     PetscErrorCode ierr = 0;
     IntType i, n, neig, nl, ng;
     std::stringstream ss;
     Vec b = NULL, x = NULL;
-    ScalarType *re = NULL, *im = NULL, eigmin, eigmax, emin, emax;
+    ScalarType *re = NULL, *im = NULL, eigmin, eigmax, beta, betac;
+    bool usecache;
 
     PetscFunctionBegin;
 
@@ -1033,7 +1984,33 @@ PetscErrorCode Preconditioner::EstimateEigenValues() {
     }
 
     if (!this->m_Opt->m_KrylovMethod.eigvalsestimated) {
-        if (this->m_Opt->m_KrylovMethod.usepetsceigest) {
+        beta = this->m_Opt->m_RegNorm.beta[0];
+        betac = this->m_Opt->m_KrylovMethod.eigvalsbeta;
+
+        // the cache is only used for the analytically preconditioned
+        // hessian H = I + (beta A)^{-1/2} H_d (beta A)^{-1/2}; its
+        // spectrum does not depend on the grid size and the part that
+        // depends on beta scales with 1/beta; we only re-estimate if
+        // the user asks for it (every krylov or newton iteration) or if
+        // the check of the inner solve dropped the cache (CheckEigValCache)
+        usecache = (betac > 0.0) && (beta > 0.0)
+                && (this->m_Opt->m_KrylovMethod.reesteigvals == 0)
+                && (this->m_Opt->m_KrylovMethod.matvectype == PRECONDMATVEC
+                 || this->m_Opt->m_KrylovMethod.matvectype == PRECONDMATVECSYM);
+
+        this->m_ReadEigVals = false;
+        this->m_UseCachedEigVals = usecache;
+
+        if (usecache) {
+            eigmin = 1.0 + (this->m_Opt->m_KrylovMethod.eigvals[0] - 1.0)*betac/beta;
+            eigmax = 1.0 + (this->m_Opt->m_KrylovMethod.eigvals[1] - 1.0)*betac/beta;
+            if (this->m_Opt->m_Verbosity > 1) {
+                ss << "using cached eigenvalues (" << std::scientific
+                   << eigmin << "," << eigmax << ")";
+                ierr = DbgMsg(ss.str()); CHKERRQ(ierr);
+                ss.str(std::string()); ss.clear();
+            }
+        } else if (this->m_Opt->m_KrylovMethod.usepetsceigest) {
             // use the default PETSC method to estimate the eigenvalues
             if (this->m_Opt->m_Verbosity > 1) {
                 ierr = DbgMsg("estimating eigenvalues (petsc)"); CHKERRQ(ierr);
@@ -1045,16 +2022,23 @@ PetscErrorCode Preconditioner::EstimateEigenValues() {
 //            ierr = KSPChebyshevEstEigSet(this->m_KrylovMethod, PETSC_DECIDE, PETSC_DECIDE,
 //                                                               PETSC_DECIDE, PETSC_DECIDE); CHKERRQ(ierr);
             ierr = KSPChebyshevEstEigSet(this->m_KrylovMethod, 0.0, 0.1, 0.0, 1.1); CHKERRQ(ierr);
+
+            // the estimate is computed within the next solve; we read
+            // it back afterwards to fill the cache (see CheckEigValCache)
+            this->m_ReadEigVals = true;
         } else {
             if (this->m_Opt->m_Verbosity > 1) {
                 ierr = DbgMsg("estimating eigenvalues"); CHKERRQ(ierr);
             }
-            // get sizes
-            nl = this->m_Opt->m_Domain.nl;
-            ng = this->m_Opt->m_Domain.ng;
+            // get sizes (the chebyshev method operates on the coarse
+            // grid for the two-level and on the coarsest grid for the
+            // multilevel preconditioner)
+            ierr = Assert(this->m_MatVec != NULL, "null pointer"); CHKERRQ(ierr);
+            ierr = MatGetLocalSize(this->m_MatVec, &nl, NULL); CHKERRQ(ierr);
+            ierr = MatGetSize(this->m_MatVec, &ng, NULL); CHKERRQ(ierr);
 
-            ierr = VecCreate(x, 3*nl, 3*ng); CHKERRQ(ierr);
-            ierr = VecCreate(b, 3*nl, 3*ng); CHKERRQ(ierr);
+            ierr = VecCreate(x, nl, ng); CHKERRQ(ierr);
+            ierr = VecCreate(b, nl, ng); CHKERRQ(ierr);
 
             // use random right hand side
             if (this->m_RandomNumGen == NULL) {
@@ -1084,10 +2068,16 @@ PetscErrorCode Preconditioner::EstimateEigenValues() {
 
             // clear memory
             ierr = PetscFree2(re, im); CHKERRQ(ierr);
-            ierr = this->m_CoarseGrid->m_OptimizationProblem->EstimateExtremalHessEigVals(emin, emax); CHKERRQ(ierr);
+        }
 
-            ierr = KSPChebyshevSetEigenvalues(this->m_KrylovMethod, eigmax, eigmin); CHKERRQ(ierr);
-        }   // switch between eigenvalue estimators
+        if (!this->m_ReadEigVals) {
+            // update cache (estimates belong to current regularization weight)
+            this->m_Opt->m_KrylovMethod.eigvals[0] = eigmin;
+            this->m_Opt->m_KrylovMethod.eigvals[1] = eigmax;
+            this->m_Opt->m_KrylovMethod.eigvalsbeta = beta;
+
+            ierr = this->SetChebyshevEigenValues(eigmin, eigmax); CHKERRQ(ierr);
+        }
 
         // set flag
         this->m_Opt->m_KrylovMethod.eigvalsestimated = true;
@@ -1102,6 +2092,92 @@ PetscErrorCode Preconditioner::EstimateEigenValues() {
 
 
 
+/********************************************************************
+ * @brief set the interval of the chebyshev method from (estimates
+ * of) the extremal eigenvalues of the hessian; if the estimates
+ * come from petsc's estimator we apply the same transform as in
+ * EstimateEigenValues (we target the upper part of the spectrum)
+ * @param eigmin estimate for smallest eigenvalue
+ * @param eigmax estimate for largest eigenvalue
+ *******************************************************************/
+PetscErrorCode Preconditioner::SetChebyshevEigenValues(ScalarType eigmin, ScalarType eigmax) {
+    PetscErrorCode ierr = 0;
+    PetscFunctionBegin;
+
+    ierr = Assert(this->m_KrylovMethod != NULL, "null pointer"); CHKERRQ(ierr);
+
+    // this also removes the eigenvalue estimator of the chebyshev method
+    if (this->m_Opt->m_KrylovMethod.usepetsceigest) {
+        ierr = KSPChebyshevSetEigenvalues(this->m_KrylovMethod, 1.1*eigmax, 0.1*eigmax); CHKERRQ(ierr);
+    } else {
+        ierr = KSPChebyshevSetEigenvalues(this->m_KrylovMethod, eigmax, eigmin); CHKERRQ(ierr);
+    }
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief update and check the cached eigenvalue estimates after the
+ * chebyshev method has been applied; if petsc estimated the
+ * eigenvalues within the solve, we read the estimates back from the
+ * estimator and store them in the cache; if we used cached estimates,
+ * we check the residual reduction of the inner solve (if the largest
+ * eigenvalue is underestimated, the chebyshev method amplifies the
+ * components of the residual outside of the interval); if the
+ * residual did not decrease we drop the cache, so that the
+ * eigenvalues are re-estimated when the preconditioner is applied next
+ * @param b right hand side of inner solve
+ *******************************************************************/
+PetscErrorCode Preconditioner::CheckEigValCache(Vec b) {
+    PetscErrorCode ierr = 0;
+    KSP kspest = NULL;
+    KSPConvergedReason reason;
+    ScalarType eigmin, eigmax, rnorm, bnorm;
+    std::stringstream ss;
+    PetscFunctionBegin;
+
+    if (this->m_Opt->m_KrylovMethod.pcsolver != CHEB) {
+        PetscFunctionReturn(ierr);
+    }
+
+    if (this->m_ReadEigVals) {
+        this->m_ReadEigVals = false;
+        ierr = KSPChebyshevEstEigGetKSP(this->m_KrylovMethod, &kspest); CHKERRQ(ierr);
+        if (kspest != NULL) {
+            ierr = KSPComputeExtremeSingularValues(kspest, &eigmax, &eigmin); CHKERRQ(ierr);
+            if (this->m_Opt->m_Verbosity > 1) {
+                ss << "caching eigenvalues (petsc) (" << std::scientific
+                   << eigmin << "," << eigmax << ")";
+                ierr = DbgMsg(ss.str()); CHKERRQ(ierr);
+                ss.str(std::string()); ss.clear();
+            }
+            this->m_Opt->m_KrylovMethod.eigvals[0] = eigmin;
+            this->m_Opt->m_KrylovMethod.eigvals[1] = eigmax;
+            this->m_Opt->m_KrylovMethod.eigvalsbeta = this->m_Opt->m_RegNorm.beta[0];
+        }
+    } else if (this->m_UseCachedEigVals) {
+        ierr = KSPGetConvergedReason(this->m_KrylovMethod, &reason); CHKERRQ(ierr);
+        ierr = KSPGetResidualNorm(this->m_KrylovMethod, &rnorm); CHKERRQ(ierr);
+        ierr = VecNorm(b, NORM_2, &bnorm); CHKERRQ(ierr);
+        if (reason < 0 || rnorm >= bnorm) {
+            if (this->m_Opt->m_Verbosity > 1) {
+                ierr = DbgMsg("dropping cached eigenvalue estimates"); CHKERRQ(ierr);
+            }
+            this->m_Opt->m_KrylovMethod.eigvalsbeta = -1.0;
+            this->m_Opt->m_KrylovMethod.eigvalsestimated = false;
+            this->m_UseCachedEigVals = false;
+        }
+    }
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
 /********************************************************************
  * @brief do setup for krylov method to estimate eigenvalues
  *******************************************************************/
@@ -1113,9 +2189,11 @@ PetscErrorCode Preconditioner::SetupKrylovMethodEigEst() {
 
     this->m_Opt->Enter(__func__);
 
-    // get sizes
-    nl = this->m_Opt->m_Domain.nl;
-    ng = this->m_Opt->m_Domain.ng;
+    // get sizes (same operator as for the chebyshev method; it
+    // acts on the coarse or coarsest grid)
+    ierr = Assert(this->m_MatVec != NULL, "null pointer"); CHKERRQ(ierr);
+    ierr = MatGetLocalSize(this->m_MatVec, &nl, NULL); CHKERRQ(ierr);
+    ierr = MatGetSize(this->m_MatVec, &ng, NULL); CHKERRQ(ierr);
 
     // create krylov method
     if (this->m_KrylovMethodEigEst != NULL) {
@@ -1137,10 +2215,10 @@ PetscErrorCode Preconditioner::SetupKrylovMethodEigEst() {
     // set up matvec for preconditioner
     if (this->m_MatVecEigEst != NULL) {
         ierr = MatDestroy(&this->m_MatVecEigEst); CHKERRQ(ierr);
-        this->m_MatVec = NULL;
+        this->m_MatVecEigEst = NULL;
     }
 
-    ierr = MatCreateShell(PETSC_COMM_WORLD, 3*nl, 3*nl, 3*ng, 3*ng, this, &this->m_MatVecEigEst); CHKERRQ(ierr);
+    ierr = MatCreateShell(PETSC_COMM_WORLD, nl, nl, ng, ng, this, &this->m_MatVecEigEst); CHKERRQ(ierr);
     ierr = MatShellSetOperation(this->m_MatVecEigEst, MATOP_MULT, (void(*)(void))InvertPrecondMatVec); CHKERRQ(ierr);
     ierr = KSPSetOperators(this->m_KrylovMethodEigEst, this->m_MatVecEigEst, this->m_MatVecEigEst); CHKERRQ(ierr);
     ierr = MatSetOption(this->m_MatVecEigEst, MAT_SYMMETRIC, PETSC_TRUE); CHKERRQ(ierr);
@@ -21,6 +21,7 @@
 #define _PREPROCESSING_CPP_
 
 #include "Preprocessing.hpp"
+#include "interp3.hpp"
 #include <time.h>
 
 
@@ -69,49 +70,22 @@ PetscErrorCode Preprocessing::Initialize() {
     PetscErrorCode ierr = 0;
     this->m_Opt = NULL;
 
-    this->m_GridChangeOpsSet = false;
-    this->m_ResetGridChangeOps = false;
-    this->m_IndicesCommunicated = false;
-    this->m_GridChangeIndicesComputed = false;
-
     this->m_ReadWrite = NULL;
 
-    this->m_XHatFine = NULL;
-    this->m_XHatCoarse = NULL;
-    this->m_FFTFinePlan = NULL;
-    this->m_FFTCoarsePlan = NULL;
-
-    this->m_FourierCoeffSendF = NULL;
-    this->m_FourierCoeffSendC = NULL;
-
-    this->m_FourierCoeffRecvF = NULL;
-    this->m_FourierCoeffRecvC = NULL;
-
-    this->m_FourierIndicesRecvF = NULL;
-    this->m_FourierIndicesRecvC = NULL;
-
-    this->m_FourierIndicesSendF = NULL;
-    this->m_FourierIndicesSendC = NULL;
-
-    this->m_NumSend = NULL;
-    this->m_NumRecv = NULL;
-
-    this->m_OffsetSend = NULL;
-    this->m_OffsetRecv = NULL;
-
-    this->m_nAllocSend = 0;
-    this->m_nAllocRecv = 0;
-
-    this->m_SendRequest = NULL;
-    this->m_RecvRequest = NULL;
-
     this->m_OverlapMeasures = NULL;
 //    this->m_LabelValues = NULL;
 //    this->m_NoLabel = -99;
 
     this->m_xhat = NULL;
-    this->m_yhat = NULL;
 
+    this->m_GhostData = NULL;
+    this->m_GhostWork = NULL;
+    this->m_nAllocGhost = 0;
+    for (int i = 0; i < 3; ++i) {
+        this->m_SmoothRadius[i] = 0;
+    }
+
+    this->m_GridChangeStamp = 0;
 
     PetscFunctionReturn(ierr);
 }
@@ -125,100 +99,19 @@ PetscErrorCode Preprocessing::Initialize() {
 PetscErrorCode Preprocessing::ClearMemory() {
     PetscErrorCode ierr = 0;
 
-    if (this->m_xhat != NULL) {
-        accfft_free(this->m_xhat);
-        this->m_xhat = NULL;
-    }
-    if (this->m_yhat != NULL) {
-        accfft_free(this->m_yhat);
-        this->m_yhat = NULL;
-    }
-
-    if (this->m_XHatFine != NULL) {
-        accfft_free(this->m_XHatFine);
-        this->m_XHatFine = NULL;
-    }
-    if (this->m_XHatCoarse != NULL) {
-        accfft_free(this->m_XHatCoarse);
-        this->m_XHatCoarse = NULL;
-    }
-
-    if (this->m_FFTFinePlan != NULL) {
-        accfft_destroy_plan(this->m_FFTFinePlan);
-        this->m_FFTFinePlan = NULL;
-    }
-    if (this->m_FFTCoarsePlan != NULL) {
-        accfft_destroy_plan(this->m_FFTCoarsePlan);
-        this->m_FFTCoarsePlan = NULL;
-    }
-
-
-    if (this->m_FourierCoeffSendF != NULL) {
-        delete [] this->m_FourierCoeffSendF;
-        this->m_FourierCoeffSendF = NULL;
-    }
-
-    if (this->m_FourierCoeffSendC != NULL) {
-        delete [] this->m_FourierCoeffSendC;
-        this->m_FourierCoeffSendC = NULL;
-    }
-
-    if (this->m_FourierCoeffRecvF != NULL) {
-        delete [] this->m_FourierCoeffRecvF;
-        this->m_FourierCoeffRecvF = NULL;
-    }
-
-    if (this->m_FourierCoeffRecvC != NULL) {
-        delete [] this->m_FourierCoeffRecvC;
-        this->m_FourierCoeffRecvC = NULL;
-    }
-
-    if (this->m_FourierIndicesRecvF != NULL) {
-        delete [] this->m_FourierIndicesRecvF;
-        this->m_FourierIndicesRecvF = NULL;
-    }
-
-    if (this->m_FourierIndicesRecvC != NULL) {
-        delete [] this->m_FourierIndicesRecvC;
-        this->m_FourierIndicesRecvC = NULL;
-    }
-
-    if (this->m_FourierIndicesSendF != NULL) {
-        delete [] this->m_FourierIndicesSendF;
-        this->m_FourierIndicesSendF = NULL;
-    }
-
-    if (this->m_FourierIndicesSendC != NULL) {
-        delete [] this->m_FourierIndicesSendC;
-        this->m_FourierIndicesSendC = NULL;
-    }
-
-    if (this->m_NumSend != NULL) {
-        delete [] this->m_NumSend;
-        this->m_NumSend = NULL;
-    }
-    if (this->m_NumRecv != NULL) {
-        delete [] this->m_NumRecv;
-        this->m_NumRecv = NULL;
-    }
+    // spectral data is leased from m_Opt (and released after use)
+    this->m_xhat = NULL;
 
-    if (this->m_OffsetSend != NULL) {
-        delete [] this->m_OffsetSend;
-        this->m_OffsetSend = NULL;
+    if (this->m_GhostData != NULL) {
+        accfft_free(this->m_GhostData);
+        this->m_GhostData = NULL;
     }
-    if (this->m_OffsetRecv != NULL) {
-        delete [] this->m_OffsetRecv;
-        this->m_OffsetRecv = NULL;
+    if (this->m_GhostWork != NULL) {
+        accfft_free(this->m_GhostWork);
+        this->m_GhostWork = NULL;
     }
 
-    if (this->m_SendRequest != NULL) {
-        delete [] this->m_SendRequest;
-        this->m_SendRequest = NULL;
-    }
-    if (this->m_RecvRequest != NULL) {
-        delete [] this->m_RecvRequest;
-        this->m_RecvRequest = NULL;
-    }
+    ierr = this->ClearGridChangeOps(); CHKERRQ(ierr);
 
     if (this->m_OverlapMeasures != NULL) {
         delete [] this->m_OverlapMeasures;
@@ -255,25 +148,45 @@ PetscErrorCode Preprocessing::SetReadWrite(Preprocessing::ReadWriteType* readwri
 
 
 /********************************************************************
- * @brief do setup for applying prolongation and restriction
- * operators
+ * @brief get grid change operator for given fine and coarse grid;
+ * operators are cached (keyed by grid sizes) and set up on first use;
+ * we keep the operators for the current and the previous level (grid
+ * continuation) or for all level pairs of the multilevel preconditioner;
+ * the least recently used others are evicted
+ * @param op grid change operator
  * @param nx_f grid size on fine grid
  * @param nx_c grid size on coarse grid
  *******************************************************************/
-PetscErrorCode Preprocessing::SetupGridChangeOps(IntType* nx_f, IntType* nx_c) {
+PetscErrorCode Preprocessing::GetGridChangeOp(GridChangeOp** op, IntType* nx_f, IntType* nx_c) {
     PetscErrorCode ierr = 0;
-    IntType nalloc_c, nalloc_f;
-    int _nx_f[3], _ostart_f[3], _osize_f[3], _isize_f[3], _istart_f[3],
-        _nx_c[3], _ostart_c[3], _osize_c[3], _isize_c[3], _istart_c[3];
-    ScalarType *p_xfd = NULL, *p_xcd = NULL;
-    ComplexType *p_xfdhat = NULL, *p_xcdhat = NULL;
+    std::vector<IntType> key;
+    size_t nkeep;
+    std::map<std::vector<IntType>, GridChangeOp*>::iterator it;
     std::stringstream ss;
-    MPI_Comm mpicomm;
 
     PetscFunctionBegin;
 
     this->m_Opt->Enter(__func__);
 
+    for (int i = 0; i < 3; ++i) {
+        ierr = Assert(nx_c[i] <= nx_f[i], "grid size in grid change operator wrong"); CHKERRQ(ierr);
+        key.push_back(nx_f[i]);
+    }
+    for (int i = 0; i < 3; ++i) {
+        key.push_back(nx_c[i]);
+    }
+
+    it = this->m_GridChangeOps.find(key);
+    if (it != this->m_GridChangeOps.end()) {
+        *op = it->second;
+        (*op)->lastuse = ++this->m_GridChangeStamp;
+        // the plan of m_Opt might have changed (new grid)
+        ierr = this->GetGridChangeFFT(&(*op)->fine, nx_f); CHKERRQ(ierr);
+        ierr = this->GetGridChangeFFT(&(*op)->coarse, nx_c); CHKERRQ(ierr);
+        this->m_Opt->Exit(__func__);
+        PetscFunctionReturn(ierr);
+    }
+
     if (this->m_Opt->m_Verbosity > 2) {
         ss  << "setup gridchange operator ( (" << nx_c[0]
             << "," << nx_c[1] << "," << nx_c[2]
@@ -283,135 +196,413 @@ PetscErrorCode Preprocessing::SetupGridChangeOps(IntType* nx_f, IntType* nx_c) {
         ss.clear(); ss.str(std::string());
     }
 
-    if (this->m_XHatCoarse !=  NULL) {
-        accfft_free(this->m_XHatCoarse);
-        this->m_XHatCoarse = NULL;
-    }
-    if (this->m_XHatFine !=  NULL) {
-        accfft_free(this->m_XHatFine);
-        this->m_XHatFine = NULL;
+    try {*op = new GridChangeOp;}
+    catch (std::bad_alloc&) {
+        ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
     }
-    if (this->m_FFTFinePlan !=  NULL) {
-        accfft_destroy_plan(this->m_FFTFinePlan);
-        this->m_FFTFinePlan = NULL;
-    }
-    if (this->m_FFTCoarsePlan !=  NULL) {
-        accfft_destroy_plan(this->m_FFTCoarsePlan);
-        this->m_FFTCoarsePlan = NULL;
+    (*op)->comm = MPI_COMM_NULL;
+    (*op)->lastuse = ++this->m_GridChangeStamp;
+
+    // get fft plans (shared among all operators on a given grid)
+    ierr = this->GetGridChangeFFT(&(*op)->fine, nx_f); CHKERRQ(ierr);
+    ierr = this->GetGridChangeFFT(&(*op)->coarse, nx_c); CHKERRQ(ierr);
+
+    // set up communication pattern
+    ierr = this->SetupGridChangeOp(*op); CHKERRQ(ierr);
+
+    this->m_GridChangeOps[key] = *op;
+
+    // keep operators for current and previous level (grid continuation);
+    // the multilevel preconditioner cycles through all level pairs
+    nkeep = 2;
+    if (this->m_Opt->m_KrylovMethod.pctype == MULTILEVEL) {
+        nkeep = std::max(nkeep, static_cast<size_t>(2*(this->m_Opt->m_KrylovMethod.mglevels - 1)));
     }
+    ierr = this->EvictGridChangeOps(nkeep); CHKERRQ(ierr);
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief get fft plan for given grid size (plans are cached and
+ * shared among grid change operators); on the grid of m_Opt we use
+ * its plan instead of creating our own; the spectral data is leased
+ * from m_Opt when the operators are applied
+ * @param fft plan
+ * @param nx grid size
+ *******************************************************************/
+PetscErrorCode Preprocessing::GetGridChangeFFT(GridChangeFFT** fft, IntType* nx) {
+    PetscErrorCode ierr = 0;
+    IntType nalloc;
+    int _nx[3], _ostart[3], _osize[3], _isize[3], _istart[3];
+    ScalarType *p_xd = NULL;
+    ComplexType *p_xdhat = NULL;
+    std::vector<IntType> key(nx, nx + 3);
+    std::map<std::vector<IntType>, GridChangeFFT*>::iterator it;
+    bool native;
+    std::stringstream ss;
+
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
 
-    // parse input sizes
     for (int i = 0; i < 3; ++i) {
-        _nx_f[i] = static_cast<int>(nx_f[i]);
-        _nx_c[i] = static_cast<int>(nx_c[i]);
+        _nx[i] = static_cast<int>(nx[i]);
     }
 
-    this->m_FFTFineScale = 1.0;
-    this->m_FFTCoarseScale = 1.0;
+    // grid of m_Opt (plan exists already)
+    native = this->m_Opt->m_FFT.plan != NULL;
     for (int i = 0; i < 3; ++i) {
-        this->m_FFTFineScale *= static_cast<ScalarType>(nx_f[i]);
-        this->m_FFTCoarseScale *= static_cast<ScalarType>(nx_c[i]);
+        native = native && (nx[i] == this->m_Opt->m_Domain.nx[i]);
+    }
+
+    it = this->m_GridChangeFFT.find(key);
+    if (it != this->m_GridChangeFFT.end()) {
+        *fft = it->second;
+    } else {
+        try {*fft = new GridChangeFFT;}
+        catch (std::bad_alloc&) {
+            ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
+        }
+        (*fft)->plan = NULL;
+        (*fft)->shared = false;
+
+        (*fft)->scale = 1.0;
+        for (int i = 0; i < 3; ++i) {
+            (*fft)->nx[i] = nx[i];
+            (*fft)->scale *= static_cast<ScalarType>(nx[i]);
+        }
+        (*fft)->scale = 1.0/(*fft)->scale;
+
+        nalloc = accfft_local_size_dft_r2c_t<ScalarType>(_nx, _isize, _istart, _osize, _ostart,
+                                                         this->m_Opt->m_FFT.mpicomm);
+        for (int i = 0; i < 3; ++i) {
+            (*fft)->osize[i] = static_cast<IntType>(_osize[i]);
+            (*fft)->ostart[i] = static_cast<IntType>(_ostart[i]);
+        }
+
+        // spectral data is leased from m_Opt when the plan is applied
+        (*fft)->nalloc = nalloc;
+
+        this->m_GridChangeFFT[key] = *fft;
+    }
+
+    if (native) {
+        // use plan of m_Opt (it might have been recreated)
+        if (!(*fft)->shared && (*fft)->plan != NULL) {
+            accfft_destroy_plan((*fft)->plan);
+        }
+        (*fft)->plan = this->m_Opt->m_FFT.plan;
+        (*fft)->shared = true;
+    } else if ((*fft)->shared || (*fft)->plan == NULL) {
+        nalloc = accfft_local_size_dft_r2c_t<ScalarType>(_nx, _isize, _istart, _osize, _ostart,
+                                                         this->m_Opt->m_FFT.mpicomm);
+        if (this->m_Opt->m_Verbosity > 2) {
+            ss  << "initializing fft plan (" << nx[0] << "," << nx[1] << "," << nx[2]
+                << "): osize=(" << _osize[0] << "," << _osize[1] << "," << _osize[2]
+                << "); ostart=(" << _ostart[0] << "," << _ostart[1] << "," << _ostart[2]
+                << "); n=" << nalloc;
+            ierr = DbgMsg(ss.str()); CHKERRQ(ierr);
+            ss.clear(); ss.str(std::string());
+        }
+
+        p_xd = reinterpret_cast<ScalarType*>(accfft_alloc(nalloc));
+        ierr = Assert(p_xd != NULL, "allocation failed"); CHKERRQ(ierr);
+
+        p_xdhat = reinterpret_cast<ComplexType*>(accfft_alloc(nalloc));
+        ierr = Assert(p_xdhat != NULL, "allocation failed"); CHKERRQ(ierr);
+
+        ierr = this->m_Opt->ImportFFTWisdom(_nx); CHKERRQ(ierr);
+        (*fft)->plan = accfft_plan_dft_3d_r2c(_nx, p_xd, reinterpret_cast<ScalarType*>(p_xdhat),
+                                              this->m_Opt->m_FFT.mpicomm, ACCFFT_MEASURE);
+        ierr = Assert((*fft)->plan != NULL, "malloc failed"); CHKERRQ(ierr);
+        ierr = this->m_Opt->ExportFFTWisdom(_nx); CHKERRQ(ierr);
+        (*fft)->shared = false;
+
+        if (p_xd != NULL) {accfft_free(p_xd); p_xd = NULL;}
+        if (p_xdhat != NULL) {accfft_free(p_xdhat); p_xdhat = NULL;}
     }
-    this->m_FFTFineScale = 1.0/this->m_FFTFineScale;
-    this->m_FFTCoarseScale = 1.0/this->m_FFTCoarseScale;
 
-    // get communicator
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief set up communication pattern for grid change operator;
+ * for every processor we determine the fourier coefficients on the
+ * local fine grid that are represented on its coarse grid and vice
+ * versa; both lists are ordered lexicographically (the mapping of
+ * the wave numbers is monotone), so that no indices have to be
+ * communicated; we ignore the nyquist frequency nx_i/2 on the
+ * coarse grid, because it's not informative
+ * @param op grid change operator
+ *******************************************************************/
+PetscErrorCode Preprocessing::SetupGridChangeOp(GridChangeOp* op) {
+    PetscErrorCode ierr = 0;
+    int merr, nprocs, nneighbors, nlocal[6];
+    IntType nxhalf_c[3], k_f, k_c, ns, nr;
+    std::vector<int> ofine, ocoarse, neighbors, idxf[3], idxc[3];
+    std::vector<MPI_Datatype> typefine, typecoarse;
+    MPI_Datatype complextype, type;
+    MPI_Comm mpicomm;
+    std::stringstream ss;
+
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
     mpicomm = this->m_Opt->m_FFT.mpicomm;
+    MPI_Comm_size(mpicomm, &nprocs);
 
-    nalloc_c = accfft_local_size_dft_r2c_t<ScalarType>(_nx_c, _isize_c, _istart_c, _osize_c, _ostart_c, mpicomm);
-    nalloc_f = accfft_local_size_dft_r2c_t<ScalarType>(_nx_f, _isize_f, _istart_f, _osize_f, _ostart_f, mpicomm);
-    if (this->m_Opt->m_Verbosity > 2) {
-        ss << "sizes on coarse grid: isize=("
-           << _isize_c[0] << "," << _isize_c[1] << "," << _isize_c[2]
-           << ") istart=(" << _istart_c[0] << "," << _istart_c[1]
-           << "," << _istart_c[2] << ")";
-        ierr = DbgMsg(ss.str()); CHKERRQ(ierr);
-        ss.clear(); ss.str(std::string());
+    for (int i = 0; i < 3; ++i) {
+        nxhalf_c[i] = static_cast<IntType>(std::ceil(static_cast<ScalarType>(op->coarse->nx[i])/2.0));
     }
-    //ierr = Assert(nalloc_c > 0, "alloc problems 1"); CHKERRQ(ierr);
-    //ierr = Assert(nalloc_f > 0, "alloc problems 2"); CHKERRQ(ierr);
 
+    // gather distribution of spectral data on fine and coarse grid
+    ofine.resize(6*nprocs);
+    ocoarse.resize(6*nprocs);
+    for (int i = 0; i < 3; ++i) {
+        nlocal[i]   = static_cast<int>(op->fine->ostart[i]);
+        nlocal[i+3] = static_cast<int>(op->fine->osize[i]);
+    }
+    merr = MPI_Allgather(nlocal, 6, MPI_INT, &ofine[0], 6, MPI_INT, mpicomm);
+    ierr = MPIERRQ(merr); CHKERRQ(ierr);
     for (int i = 0; i < 3; ++i) {
-        this->m_osizeC[i] = static_cast<IntType>(_osize_c[i]);
-        this->m_osizeF[i] = static_cast<IntType>(_osize_f[i]);
-        this->m_ostartC[i] = static_cast<IntType>(_ostart_c[i]);
-        this->m_ostartF[i] = static_cast<IntType>(_ostart_f[i]);
+        nlocal[i]   = static_cast<int>(op->coarse->ostart[i]);
+        nlocal[i+3] = static_cast<int>(op->coarse->osize[i]);
+    }
+    merr = MPI_Allgather(nlocal, 6, MPI_INT, &ocoarse[0], 6, MPI_INT, mpicomm);
+    ierr = MPIERRQ(merr); CHKERRQ(ierr);
+
+    merr = MPI_Type_contiguous(2, MPIU_REAL, &complextype);
+    ierr = MPIERRQ(merr); CHKERRQ(ierr);
+    merr = MPI_Type_commit(&complextype);
+    ierr = MPIERRQ(merr); CHKERRQ(ierr);
+
+    for (int p = 0; p < nprocs; ++p) {
+        ns = 1; nr = 1;
+        for (int i = 0; i < 3; ++i) {
+            // local coefficients on fine grid represented on coarse grid of proc p
+            idxf[i].clear();
+            for (IntType j = 0; j < op->fine->osize[i]; ++j) {
+                k_f = j + op->fine->ostart[i];
+                if (k_f >= nxhalf_c[i] && k_f <= op->fine->nx[i] - nxhalf_c[i]) continue;
+                k_c = k_f <= nxhalf_c[i] ? k_f : op->coarse->nx[i] - op->fine->nx[i] + k_f;
+                if (k_c >= ocoarse[6*p + i] && k_c < ocoarse[6*p + i] + ocoarse[6*p + i + 3]) {
+                    idxf[i].push_back(static_cast<int>(j));
+                }
+            }
+
+            // local coefficients on coarse grid represented on fine grid of proc p
+            idxc[i].clear();
+            for (IntType j = 0; j < op->coarse->osize[i]; ++j) {
+                k_c = j + op->coarse->ostart[i];
+                k_f = k_c < nxhalf_c[i] ? k_c : op->fine->nx[i] - op->coarse->nx[i] + k_c;
+                if (k_f >= nxhalf_c[i] && k_f <= op->fine->nx[i] - nxhalf_c[i]) continue;
+                if (k_f >= ofine[6*p + i] && k_f < ofine[6*p + i] + ofine[6*p + i + 3]) {
+                    idxc[i].push_back(static_cast<int>(j));
+                }
+            }
+            ns *= static_cast<IntType>(idxf[i].size());
+            nr *= static_cast<IntType>(idxc[i].size());
+        }
+
+        // nothing to exchange with proc p
+        if (ns == 0 && nr == 0) continue;
+
+        neighbors.push_back(p);
+
+        ierr = this->CreateGridChangeType(&type, idxf, op->fine->osize, complextype); CHKERRQ(ierr);
+        typefine.push_back(type);
+        ierr = this->CreateGridChangeType(&type, idxc, op->coarse->osize, complextype); CHKERRQ(ierr);
+        typecoarse.push_back(type);
     }
 
+    merr = MPI_Type_free(&complextype);
+    ierr = MPIERRQ(merr); CHKERRQ(ierr);
+
+    // the pattern is symmetric (restriction and prolongation use
+    // the same set of neighbors in both directions)
+    nneighbors = static_cast<int>(neighbors.size());
+    merr = MPI_Dist_graph_create_adjacent(mpicomm, nneighbors, nneighbors > 0 ? &neighbors[0] : NULL, MPI_UNWEIGHTED,
+                                          nneighbors, nneighbors > 0 ? &neighbors[0] : NULL, MPI_UNWEIGHTED,
+                                          MPI_INFO_NULL, 0, &op->comm);
+    ierr = MPIERRQ(merr); CHKERRQ(ierr);
+
+    op->typefine = typefine;
+    op->typecoarse = typecoarse;
+    op->count.assign(nneighbors, 1);
+    op->displ.assign(nneighbors, 0);
+
     if (this->m_Opt->m_Verbosity > 2) {
-        ss  << "coarse: osize=(" << this->m_osizeC[0]
-            << "," << this->m_osizeC[1]
-            << "," << this->m_osizeC[2]
-            << "); ostart=(" << this->m_ostartC[0]
-            << "," << this->m_ostartC[1]
-            << "," << this->m_ostartC[2]
-            << "); n=" << nalloc_c;
-        ierr = DbgMsg(ss.str()); CHKERRQ(ierr);
-        ss.clear(); ss.str(std::string());
-        ss  << "fine: osize=(" << this->m_osizeF[0]
-            << "," << this->m_osizeF[1]
-            << "," << this->m_osizeF[2]
-            << "); ostart=(" << this->m_ostartF[0]
-            << "," << this->m_ostartF[1]
-            << "," << this->m_ostartF[2]
-            << "); n=" << nalloc_f;
+        ss << "gridchange operator: " << nneighbors << " neighbors";
         ierr = DbgMsg(ss.str()); CHKERRQ(ierr);
         ss.clear(); ss.str(std::string());
     }
 
-    if (this->m_XHatCoarse == NULL) {
-        this->m_XHatCoarse = reinterpret_cast<ComplexType*>(accfft_alloc(nalloc_c));
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief create indexed data type for the tensor product of the
+ * local indices in each direction (lexicographic order)
+ * @param type data type (output)
+ * @param idx local indices in each direction
+ * @param osize size of grid in fourier domain for mpi proc
+ * @param complextype data type for complex numbers
+ *******************************************************************/
+PetscErrorCode Preprocessing::CreateGridChangeType(MPI_Datatype* type, std::vector<int>* idx,
+                                                   IntType* osize, MPI_Datatype complextype) {
+    PetscErrorCode ierr = 0;
+    int merr;
+    std::vector<int> displ;
+
+    PetscFunctionBegin;
+
+    displ.reserve(idx[0].size()*idx[1].size()*idx[2].size());
+    for (size_t i1 = 0; i1 < idx[0].size(); ++i1) {
+        for (size_t i2 = 0; i2 < idx[1].size(); ++i2) {
+            for (size_t i3 = 0; i3 < idx[2].size(); ++i3) {
+                displ.push_back(static_cast<int>(GetLinearIndex(idx[0][i1], idx[1][i2], idx[2][i3], osize)));
+            }
+        }
+    }
+
+    merr = MPI_Type_create_indexed_block(static_cast<int>(displ.size()), 1,
+                                         displ.empty() ? NULL : &displ[0], complextype, type);
+    ierr = MPIERRQ(merr); CHKERRQ(ierr);
+    merr = MPI_Type_commit(type);
+    ierr = MPIERRQ(merr); CHKERRQ(ierr);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief clear cached grid change operators and fft plans
+ *******************************************************************/
+PetscErrorCode Preprocessing::ClearGridChangeOps() {
+    PetscErrorCode ierr = 0;
+    std::map<std::vector<IntType>, GridChangeOp*>::iterator itop;
+    std::map<std::vector<IntType>, GridChangeFFT*>::iterator itfft;
+
+    PetscFunctionBegin;
+
+    for (itop = this->m_GridChangeOps.begin(); itop != this->m_GridChangeOps.end(); ++itop) {
+        ierr = this->FreeGridChangeOp(itop->second); CHKERRQ(ierr);
     }
-    ierr = Assert(this->m_XHatCoarse != NULL,"allocation failed"); CHKERRQ(ierr);
+    this->m_GridChangeOps.clear();
 
-    if (this->m_XHatFine == NULL) {
-        this->m_XHatFine = reinterpret_cast<ComplexType*>(accfft_alloc(nalloc_f));
+    for (itfft = this->m_GridChangeFFT.begin(); itfft != this->m_GridChangeFFT.end(); ++itfft) {
+        ierr = this->FreeGridChangeFFT(itfft->second, false); CHKERRQ(ierr);
     }
-    ierr = Assert(this->m_XHatFine != NULL,"allocation failed"); CHKERRQ(ierr);
+    this->m_GridChangeFFT.clear();
+
+    PetscFunctionReturn(ierr);
+}
+
 
-    // allocate plan for fine grid
-    if (this->m_FFTFinePlan == NULL) {
-        if (this->m_Opt->m_Verbosity > 2) {
-            ierr = DbgMsg("initializing fft plan (fine grid)"); CHKERRQ(ierr);
-        }
 
-        p_xfd = reinterpret_cast<ScalarType*>(accfft_alloc(nalloc_f));
-        ierr = Assert(p_xfd != NULL, "allocation failed"); CHKERRQ(ierr);
 
-        p_xfdhat = reinterpret_cast<ComplexType*>(accfft_alloc(nalloc_f));
-        ierr = Assert(p_xfdhat != NULL, "malloc failed"); CHKERRQ(ierr);
+/********************************************************************
+ * @brief evict least recently used grid change operators and the
+ * fft plans that are no longer used by any operator
+ * @param nkeep number of operators to keep
+ *******************************************************************/
+PetscErrorCode Preprocessing::EvictGridChangeOps(size_t nkeep) {
+    PetscErrorCode ierr = 0;
+    std::map<std::vector<IntType>, GridChangeOp*>::iterator itop, itlru;
+    std::map<std::vector<IntType>, GridChangeFFT*>::iterator itfft;
+    bool used;
 
-        this->m_FFTFinePlan = accfft_plan_dft_3d_r2c(_nx_f, p_xfd, reinterpret_cast<ScalarType*>(p_xfdhat),
-                                                     this->m_Opt->m_FFT.mpicomm, ACCFFT_MEASURE);
-        ierr = Assert(this->m_FFTFinePlan != NULL, "malloc failed"); CHKERRQ(ierr);
+    PetscFunctionBegin;
 
-        if (p_xfd != NULL) {accfft_free(p_xfd); p_xfd = NULL;}
-        if (p_xfdhat != NULL) {accfft_free(p_xfdhat); p_xfdhat = NULL;}
+    while (this->m_GridChangeOps.size() > nkeep) {
+        itlru = this->m_GridChangeOps.begin();
+        for (itop = this->m_GridChangeOps.begin(); itop != this->m_GridChangeOps.end(); ++itop) {
+            if (itop->second->lastuse < itlru->second->lastuse) itlru = itop;
+        }
+        ierr = this->FreeGridChangeOp(itlru->second); CHKERRQ(ierr);
+        this->m_GridChangeOps.erase(itlru);
     }
 
-    // allocate plan for coarse grid
-    if (this->m_FFTCoarsePlan == NULL) {
-        if (this->m_Opt->m_Verbosity > 2) {
-            ierr = DbgMsg("initializing fft plan (coarse grid)"); CHKERRQ(ierr);
+    itfft = this->m_GridChangeFFT.begin();
+    while (itfft != this->m_GridChangeFFT.end()) {
+        used = false;
+        for (itop = this->m_GridChangeOps.begin(); itop != this->m_GridChangeOps.end(); ++itop) {
+            if (itop->second->fine == itfft->second || itop->second->coarse == itfft->second) used = true;
         }
-        p_xcd = reinterpret_cast<ScalarType*>(accfft_alloc(nalloc_c));
-        ierr = Assert(p_xcd != NULL, "malloc failed"); CHKERRQ(ierr);
+        if (used) {
+            ++itfft;
+        } else {
+            ierr = this->FreeGridChangeFFT(itfft->second, true); CHKERRQ(ierr);
+            this->m_GridChangeFFT.erase(itfft++);
+        }
+    }
+
+    PetscFunctionReturn(ierr);
+}
+
 
-        p_xcdhat = reinterpret_cast<ComplexType*>(accfft_alloc(nalloc_c));
-        ierr = Assert(p_xcdhat != NULL, "malloc failed"); CHKERRQ(ierr);
 
-        this->m_FFTCoarsePlan = accfft_plan_dft_3d_r2c(_nx_c, p_xcd, reinterpret_cast<ScalarType*>(p_xcdhat),
-                                                       this->m_Opt->m_FFT.mpicomm, ACCFFT_MEASURE);
-        ierr = Assert(this->m_FFTCoarsePlan != NULL, "malloc failed"); CHKERRQ(ierr);
 
-        if (p_xcd != NULL) {accfft_free(p_xcd); p_xcd = NULL;}
-        if (p_xcdhat != NULL) {accfft_free(p_xcdhat); p_xcdhat = NULL;}
+/********************************************************************
+ * @brief free grid change operator
+ *******************************************************************/
+PetscErrorCode Preprocessing::FreeGridChangeOp(GridChangeOp* op) {
+    PetscErrorCode ierr = 0;
+    PetscFunctionBegin;
+
+    for (size_t i = 0; i < op->typefine.size(); ++i) {
+        MPI_Type_free(&op->typefine[i]);
+        MPI_Type_free(&op->typecoarse[i]);
+    }
+    if (op->comm != MPI_COMM_NULL) {
+        MPI_Comm_free(&op->comm);
     }
+    delete op;
+
+    PetscFunctionReturn(ierr);
+}
 
-    // set flag
-    this->m_GridChangeOpsSet = true;
 
-    this->m_Opt->Exit(__func__);
+
+
+/********************************************************************
+ * @brief free fft plan (unless it is the plan of m_Opt); if clearpool
+ * is set, the spectral work arrays for this grid are freed in m_Opt
+ * (not possible when we clean up; m_Opt might be gone already)
+ *******************************************************************/
+PetscErrorCode Preprocessing::FreeGridChangeFFT(GridChangeFFT* fft, bool clearpool) {
+    PetscErrorCode ierr = 0;
+    PetscFunctionBegin;
+
+    // the plan for this grid is destroyed; free the spectral work
+    // arrays for its size (unless it is the grid of m_Opt)
+    if (clearpool && !fft->shared && fft->nalloc != this->m_Opt->m_FFT.nalloc) {
+        ierr = this->m_Opt->ClearSpectralWorkspace(fft->nalloc); CHKERRQ(ierr);
+    }
+    if (fft->plan != NULL && !fft->shared) {
+        accfft_destroy_plan(fft->plan);
+    }
+    fft->plan = NULL;
+    delete fft;
 
     PetscFunctionReturn(ierr);
 }
@@ -754,20 +945,19 @@ PetscErrorCode Preprocessing::Restrict(VecField* vcoarse, VecField* vfine, IntTy
 
 /********************************************************************
  * @brief restrict data
- * @param x input vector
- * @param xcoarse output vector xcoarse = R[x]
+ * @param x_c output vector x_c = R[x_f]
+ * @param x_f input vector
  * @param nx_c number of grid points on coarse grid
- * @param dosetup flag to identify if we have to do the setup step;
- * this is essentially to prevent an additional setup step if we
- * apply this function to each component of a vector field, or a
- * time dependend field; if the parameter is not set, it is true
+ * @param nx_f number of grid points on fine grid
  *******************************************************************/
 PetscErrorCode Preprocessing::Restrict(Vec* x_c, Vec x_f, IntType* nx_c, IntType* nx_f) {
     PetscErrorCode ierr = 0;
-    ScalarType *p_xf = NULL, *p_xc = NULL, scale, coeff[2], value;
-    IntType n, l, k_c[3], i_c[3], nr, os_recv, nyqfreqid[3];
+    int merr;
+    ScalarType *p_xf = NULL, *p_xc = NULL, scale;
+    IntType n;
+    GridChangeOp* op = NULL;
+    ComplexType *xhat_f = NULL, *xhat_c = NULL;
     std::stringstream ss;
-    int rank, nprocs;
     double timer[NFFTTIMERS] = {0};
 
     PetscFunctionBegin;
@@ -781,122 +971,64 @@ PetscErrorCode Preprocessing::Restrict(Vec* x_c, Vec x_f, IntType* nx_c, IntType
         ierr = DbgMsg(ss.str()); CHKERRQ(ierr);
     }
 
-    MPI_Comm_rank(PETSC_COMM_WORLD, &rank);
-    MPI_Comm_size(PETSC_COMM_WORLD, &nprocs);
-
     ierr = Assert(x_f != NULL, "null pointer"); CHKERRQ(ierr);
     ierr = Assert(x_c != NULL, "null pointer"); CHKERRQ(ierr);
 
     if ((nx_c[0] == nx_f[0]) && (nx_c[1] == nx_f[1]) && (nx_c[2] == nx_f[2])) {
         ierr = VecCopy(x_f, *x_c); CHKERRQ(ierr);
+        this->m_Opt->Exit(__func__);
         PetscFunctionReturn(ierr);
     }
 
-    for (int i = 0; i < 3; ++i) {
-        this->m_nxC[i] = nx_c[i];
-        this->m_nxF[i] = nx_f[i];
-        value = static_cast<ScalarType>(nx_c[i])/2.0;
-        nyqfreqid[i] = static_cast<IntType>(std::ceil(value));
-    }
-//    for(int i = 0; i < 3; ++i) {
-//        value = static_cast<ScalarType>(nx_c[i])/2.0;
-//        nxhalf_c[i] = static_cast<IntType>(std::ceil(value));
-//    }
+    // get (cached) grid change operator
+    ierr = this->GetGridChangeOp(&op, nx_f, nx_c); CHKERRQ(ierr);
 
-    // set up fft operators
-    if (this->m_ResetGridChangeOps) {
-        this->m_GridChangeOpsSet = false;
-        this->m_GridChangeIndicesComputed = false;
-    }
-    if (!this->m_GridChangeOpsSet) {
-        ierr = this->SetupGridChangeOps(nx_f, nx_c); CHKERRQ(ierr);
-    }
+    // lease spectral data on both grids
+    ierr = this->m_Opt->GetSpectralWorkspace(&xhat_f, op->fine->nalloc); CHKERRQ(ierr);
+    ierr = this->m_Opt->GetSpectralWorkspace(&xhat_c, op->coarse->nalloc); CHKERRQ(ierr);
 
-    ierr = Assert(this->m_FFTFinePlan != NULL, "null pointer"); CHKERRQ(ierr);
+    // compute fft of data on fine grid
+    ierr = VecGetArray(x_f, &p_xf); CHKERRQ(ierr);
+    accfft_execute_r2c_t(op->fine->plan, p_xf, xhat_f, timer);
+    ierr = VecRestoreArray(x_f, &p_xf); CHKERRQ(ierr);
 
-    n  = this->m_osizeC[0];
-    n *= this->m_osizeC[1];
-    n *= this->m_osizeC[2];
+    n  = op->coarse->osize[0];
+    n *= op->coarse->osize[1];
+    n *= op->coarse->osize[2];
 
 #pragma omp parallel
 {
 #pragma omp for
     // set freqencies to zero
-    for (l = 0; l < n; ++l) {
-        this->m_XHatCoarse[l][0] = 0.0;
-        this->m_XHatCoarse[l][1] = 0.0;
+    for (IntType l = 0; l < n; ++l) {
+        xhat_c[l][0] = 0.0;
+        xhat_c[l][1] = 0.0;
     }
 } // #pragma omp parallel
 
-    // compute fft of data on fine grid
-    ierr = VecGetArray(x_f, &p_xf); CHKERRQ(ierr);
-    accfft_execute_r2c_t(this->m_FFTFinePlan, p_xf, this->m_XHatFine, timer);
-    ierr = VecRestoreArray(x_f, &p_xf); CHKERRQ(ierr);
-
-    // compute indices
-    if (!this->m_GridChangeIndicesComputed) {
-        ierr = this->ComputeGridChangeIndices(nx_f, nx_c); CHKERRQ(ierr);
-    }
-    ierr = this->GridChangeCommDataRestrict(); CHKERRQ(ierr);
-
-    // get grid sizes/fft scales
-    scale = this->m_FFTFineScale;
-
-    // get number of entries we are going to assign
-    for (int p = 0; p < nprocs; ++p) {
-        nr = this->m_NumRecv[p];
-        os_recv = this->m_OffsetRecv[p];
-
-        for (IntType j = 0; j < nr; ++j) {
-            bool outofbounds = false;
-
-            for (int i = 0; i < 3; ++i) {
-//                k_f[i] = this->m_FourierIndicesRecvF[3*j + i + 3*os_recv];
-                k_c[i] = this->m_FourierIndicesRecvC[3*j + i + 3*os_recv] ;
-
-                // get wave number index on coarse grid from index on fine grid
-//                k_c[i] = k_f[i] <= nxhalf_c[i] ? k_f[i] : nx_c[i] - nx_f[i] + k_f[i];
-                i_c[i] = k_c[i] - this->m_ostartC[i];
-
-                if ( (k_c[i] < this->m_ostartC[i]) || (k_c[i] > this->m_ostartC[i] + this->m_osizeC[i]) ) {
-                    outofbounds = true;
-                }
-                if ( (i_c[i] < 0) || (i_c[i] > this->m_osizeC[i]) ) {
-                    outofbounds = true;
-                }
-            }
-            if (outofbounds) {
-                std::cout << i_c[0] << " " << i_c[1] << " " << i_c[2] << std::endl;
-            }
-            if (!outofbounds) {
-                // compute flat index
-                l = GetLinearIndex(i_c[0], i_c[1], i_c[2], this->m_osizeC);
-                bool setvalue = true;
-
-                // check for nyquist frequency
-                for (int i = 0; i < 3; ++i) {
-                    if (i_c[i] == nyqfreqid[i]) {
-                        setvalue = false;
-                    }
-                }
+    // send fourier coefficients on fine grid to coarse grid
+    merr = MPI_Neighbor_alltoallw(xhat_f, op->count.data(), op->displ.data(), op->typefine.data(),
+                                  xhat_c, op->count.data(), op->displ.data(), op->typecoarse.data(), op->comm);
+    ierr = MPIERRQ(merr); CHKERRQ(ierr);
 
-                if (setvalue) {
-                    // get fourier coefficients
-                    coeff[0] = this->m_FourierCoeffRecvF[2*j + 0 + 2*os_recv];
-                    coeff[1] = this->m_FourierCoeffRecvF[2*j + 1 + 2*os_recv];
+    scale = op->fine->scale;
 
-                    // assign values to coarse grid
-                    this->m_XHatCoarse[l][0] = scale*coeff[0];
-                    this->m_XHatCoarse[l][1] = scale*coeff[1];
-                }
-            }
-        }
+#pragma omp parallel
+{
+#pragma omp for
+    for (IntType l = 0; l < n; ++l) {
+        xhat_c[l][0] *= scale;
+        xhat_c[l][1] *= scale;
     }
+} // #pragma omp parallel
 
     ierr = VecGetArray(*x_c, &p_xc); CHKERRQ(ierr);
-    accfft_execute_c2r_t(this->m_FFTCoarsePlan, this->m_XHatCoarse, p_xc, timer);
+    accfft_execute_c2r_t(op->coarse->plan, xhat_c, p_xc, timer);
     ierr = VecRestoreArray(*x_c, &p_xc); CHKERRQ(ierr);
 
+    ierr = this->m_Opt->ReleaseSpectralWorkspace(&xhat_c); CHKERRQ(ierr);
+    ierr = this->m_Opt->ReleaseSpectralWorkspace(&xhat_f); CHKERRQ(ierr);
+
     // set fft timers
     this->m_Opt->IncreaseFFTTimers(timer);
 
@@ -912,697 +1044,11 @@ PetscErrorCode Preprocessing::Restrict(Vec* x_c, Vec x_f, IntType* nx_c, IntType
 
 
 /********************************************************************
- * @brief do setup for applying restriction operator
- * @param nx_c grid size on coarse grid
+ * @brief prolong vector field
+ * @param vcoarse input vector field
+ * @param vfine output vector field vfine = P[vcoarse]
  *******************************************************************/
-PetscErrorCode Preprocessing::ComputeGridChangeIndices(IntType* nx_f, IntType* nx_c) {
-    PetscErrorCode ierr = 0;
-    int rank, nprocs, nowned, ncommunicate, nprocessed, xrank, cart_grid[2], p1, p2;
-    IntType oend_c[3], osc_x2, osc_x3, i_f[3], k_f[3], k_c[3], nxhalf_c[3];
-    ScalarType nc[2];
-    bool locallyowned,oncoarsegrid;
-
-    PetscFunctionBegin;
-
-    this->m_Opt->Enter(__func__);
-
-    MPI_Comm_rank(PETSC_COMM_WORLD,&rank);
-    MPI_Comm_size(PETSC_COMM_WORLD,&nprocs);
-
-    ierr = Assert(nx_c[0] <= nx_f[0], "grid size in restriction wrong"); CHKERRQ(ierr);
-    ierr = Assert(nx_c[1] <= nx_f[1], "grid size in restriction wrong"); CHKERRQ(ierr);
-    ierr = Assert(nx_c[2] <= nx_f[2], "grid size in restriction wrong"); CHKERRQ(ierr);
-
-    // allocate if necessary
-    if (this->m_IndicesC.empty()) {
-        this->m_IndicesC.resize(nprocs);
-    }
-    if (this->m_IndicesF.empty()) {
-        this->m_IndicesF.resize(nprocs);
-    }
-
-    for (int i = 0; i < nprocs; ++i) {
-        if (!this->m_IndicesC[i].empty()) {
-            this->m_IndicesC[i].clear();
-        }
-        if (!this->m_IndicesF[i].empty()) {
-            this->m_IndicesF[i].clear();
-        }
-    }
-
-    for(int i = 0; i < 3; ++i) {
-        nxhalf_c[i] = static_cast<IntType>(std::ceil(static_cast<ScalarType>(nx_c[i])/2.0));
-        oend_c[i] = this->m_ostartC[i] + this->m_osizeC[i];
-    }
-
-    // get cartesian grid (MPI)
-    cart_grid[0] = this->m_Opt->m_CartGridDims[0];
-    cart_grid[1] = this->m_Opt->m_CartGridDims[1];
-
-    nc[0] = static_cast<ScalarType>(nx_c[1]);
-    nc[1] = static_cast<ScalarType>(nx_c[2])/2.0 + 1.0;
-    osc_x2 = static_cast<IntType>(std::ceil(nc[0]/static_cast<ScalarType>(cart_grid[0])));
-    osc_x3 = static_cast<IntType>(std::ceil(nc[1]/static_cast<ScalarType>(cart_grid[1])));
-
-    // for all points on fine grid
-    nowned = 0; ncommunicate = 0; nprocessed = 0;
-    for (i_f[0] = 0; i_f[0] < this->m_osizeF[0]; ++i_f[0]) { // x1
-        for (i_f[1] = 0; i_f[1] < this->m_osizeF[1]; ++i_f[1]) { // x2
-            for (i_f[2] = 0; i_f[2] < this->m_osizeF[2]; ++i_f[2]) { // x3
-                oncoarsegrid = true;
-                for (int i = 0; i < 3; ++i) {
-                    // compute wave number index on fine grid
-                    k_f[i] = i_f[i] + this->m_ostartF[i];
-
-                    // only if current fourier entry is represented in spectral
-                    // domain of coarse grid; we ignore the nyquist frequency nx_i/2
-                    // because it's not informative
-                    if (k_f[i] >= nxhalf_c[i] && k_f[i] <= (nx_f[i]-nxhalf_c[i])) {
-                        oncoarsegrid = false;
-                    }
-                }
-
-                if (oncoarsegrid) {
-                    ++nprocessed;
-                    locallyowned = true;
-                    for (int i = 0; i < 3; ++i) {
-                        // get wave number index on coarse grid from index on fine grid
-                        k_c[i] = k_f[i] <= nxhalf_c[i] ? k_f[i] : nx_c[i] - nx_f[i] + k_f[i];
-
-                        // sanity checks
-                        if ( (k_c[i] < 0.0) || (k_c[i] > nx_c[i]) ) {
-                            std::cout << "index out of bounds" << std::endl;
-                        }
-
-                        // check if represented on current grid
-                        if ( (k_c[i] < this->m_ostartC[i]) || (k_c[i] >= oend_c[i]) ) {
-                            locallyowned = false;
-                        }
-                    }
-
-                    // compute processor id (we do this outside, to check if
-                    // we indeed land on the current processor if the points
-                    // are owned; sanity check)
-                    p1 = static_cast<int>(k_c[1]/osc_x2);
-                    p2 = static_cast<int>(k_c[2]/osc_x3);
-
-                    // compute rank
-                    xrank = p1*cart_grid[1] + p2;
-
-                    if (locallyowned) { // if owned by local processor
-                        // assign computed indices to array (for given rank)
-                        for (int i = 0; i < 3; ++i) {
-                            this->m_IndicesC[rank].push_back(k_c[i]);
-                            this->m_IndicesF[rank].push_back(k_f[i]);
-                        }
-
-                        // check if woned is really owned
-                        if (rank != xrank) {
-                            std::cout << "rank not owned: " << rank << " " << xrank << std::endl;
-                        }
-                        ++nowned;
-                    } else {
-                        // assign computed indices to array (for given rank)
-                        for (int i = 0; i < 3; ++i) {
-                            this->m_IndicesC[xrank].push_back(k_c[i]);
-                            this->m_IndicesF[xrank].push_back(k_f[i]);
-                        }
-
-                        if (rank == xrank) {
-                            std::cout << "rank owned: " << rank << " " << xrank << std::endl;
-                        }
-                        ++ncommunicate;
-                    }
-                }
-            }  // i1
-        }  // i2
-    }  // i3
-
-    MPI_Barrier(PETSC_COMM_WORLD);
-    // do the communication
-    ierr = this->GridChangeCommIndices(); CHKERRQ(ierr);
-
-    this->m_GridChangeIndicesComputed = true;
-
-    this->m_Opt->Exit(__func__);
-
-    PetscFunctionReturn(ierr);
-}
-
-
-
-
-/********************************************************************
- * @brief communicate indices
- *******************************************************************/
-PetscErrorCode Preprocessing::GridChangeCommIndices() {
-    PetscErrorCode ierr = 0;
-    int merr, nprocs, rank, i_recv, i_send;
-    IntType n, k_c[3], k_f[3], os_send, os_recv, nr, ns, n_c, n_f;
-    MPI_Status status;
-    std::stringstream ss;
-
-    PetscFunctionBegin;
-
-    this->m_Opt->Enter(__func__);
-
-    MPI_Comm_rank(PETSC_COMM_WORLD, &rank);
-    MPI_Comm_size(PETSC_COMM_WORLD, &nprocs);
-
-    if (this->m_OffsetSend == NULL) {
-        try{this->m_OffsetSend = new IntType[nprocs];}
-        catch (std::bad_alloc&) {
-            ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
-        }
-    }
-
-    if (this->m_OffsetRecv == NULL) {
-        try{this->m_OffsetRecv = new IntType[nprocs];}
-        catch (std::bad_alloc&) {
-            ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
-        }
-    }
-    if (this->m_NumSend == NULL) {
-        try{this->m_NumSend = new IntType[nprocs];}
-        catch (std::bad_alloc&) {
-            ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
-        }
-    }
-    if (this->m_NumRecv == NULL) {
-        try{this->m_NumRecv = new IntType[nprocs];}
-        catch (std::bad_alloc&) {
-            ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
-        }
-    }
-    if (this->m_SendRequest == NULL) {
-        try{this->m_SendRequest = new MPI_Request[nprocs];}
-        catch (std::bad_alloc&) {
-            ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
-        }
-    }
-    if (this->m_RecvRequest == NULL) {
-        try{this->m_RecvRequest = new MPI_Request[nprocs];}
-        catch (std::bad_alloc&) {
-            ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
-        }
-    }
-
-    // compute size to be allocated
-    for (int p = 0; p < nprocs; ++p) {
-        this->m_NumSend[p] = 0;
-        this->m_NumRecv[p] = 0;
-        if (!this->m_IndicesF[p].empty()) {
-            n_f=this->m_IndicesF[p].size();
-            n_c=this->m_IndicesC[p].size();
-            ierr = Assert(n_f == n_c,"error in setup"); CHKERRQ(ierr);
-            this->m_NumSend[p] = n_f/3;
-        }
-
-    }
-    // communicate the amount of data we will send from one
-    // processor to another (all to all)
-    merr = MPI_Alltoall(&this->m_NumSend[0], 1, MPIU_INT, &this->m_NumRecv[0], 1, MPIU_INT, PETSC_COMM_WORLD);
-    ierr = MPIERRQ(merr); CHKERRQ(ierr);
-
-    ierr = Assert(this->m_NumSend[rank] == this->m_NumRecv[rank], "alltoall error"); CHKERRQ(ierr);
-
-    // now we compute the size of the arrays, we have to allocate locally to
-    // send and recv all the data
-    this->m_nAllocSend = this->m_NumSend[0];
-    this->m_nAllocRecv = this->m_NumRecv[0];
-    this->m_OffsetSend[0] = 0;
-    this->m_OffsetRecv[0] = 0;
-    for (int p = 1; p < nprocs; ++p) {
-        this->m_OffsetSend[p] = this->m_OffsetSend[p-1] + this->m_NumSend[p-1];
-        this->m_OffsetRecv[p] = this->m_OffsetRecv[p-1] + this->m_NumRecv[p-1];
-        this->m_nAllocSend += this->m_NumSend[p];
-        this->m_nAllocRecv += this->m_NumRecv[p];
-    }
-
-    // if we actually need to allocate something
-    if (this->m_nAllocSend > 0) {
-        if (this->m_ResetGridChangeOps) {
-            if (this->m_FourierIndicesSendF != NULL) {
-                delete [] this->m_FourierIndicesSendF;
-                this->m_FourierIndicesSendF=NULL;
-            }
-            if (this->m_FourierIndicesSendC != NULL) {
-                delete [] this->m_FourierIndicesSendC;
-                this->m_FourierIndicesSendC=NULL;
-            }
-        }
-
-        if (this->m_FourierIndicesSendF==NULL) {
-            try{this->m_FourierIndicesSendF = new IntType[this->m_nAllocSend*3];}
-            catch (std::bad_alloc&) {
-                ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
-            }
-        }
-
-        if (this->m_FourierIndicesSendC==NULL) {
-            try{this->m_FourierIndicesSendC = new IntType[this->m_nAllocSend*3];}
-            catch (std::bad_alloc&) {
-                ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
-            }
-        }
-
-        // assign indices accross all procs
-        for (int p = 0; p < nprocs; ++p) {
-            if (this->m_NumSend[p] != 0) {
-                // sanity check
-                n = this->m_IndicesF[p].size()/3;
-
-                if (n != this->m_NumSend[p]) {
-                    ss << "size mismatch " << n << "!=" << this->m_NumSend[p];
-                    ierr = ThrowError(ss.str()); CHKERRQ(ierr);
-                }
-
-                // do the assignment
-                for (IntType j = 0; j < n; ++j) {
-                    // get index
-                    for (int i = 0; i < 3; ++i) {
-                        k_f[i] = this->m_IndicesF[p][j*3 + i];
-                        k_c[i] = this->m_IndicesC[p][j*3 + i];
-                    }
-
-                    // get offset
-                    os_send = this->m_OffsetSend[p];
-
-                    // assign to flat array
-                    this->m_FourierIndicesSendF[3*j+0+3*os_send] = k_f[0];
-                    this->m_FourierIndicesSendF[3*j+1+3*os_send] = k_f[1];
-                    this->m_FourierIndicesSendF[3*j+2+3*os_send] = k_f[2];
-
-                    // assign to flat array
-                    this->m_FourierIndicesSendC[3*j+0+3*os_send] = k_c[0];
-                    this->m_FourierIndicesSendC[3*j+1+3*os_send] = k_c[1];
-                    this->m_FourierIndicesSendC[3*j+2+3*os_send] = k_c[2];
-                }  // for all points
-            }  // if indices are not empty
-        }  // for all procs
-    }  // alloc
-
-    // allocate receiving array
-    if (this->m_nAllocRecv > 0) {
-        if (this->m_ResetGridChangeOps) {
-            if (this->m_FourierIndicesRecvF != NULL) {
-                delete [] this->m_FourierIndicesRecvF;
-                this->m_FourierIndicesRecvF = NULL;
-            }
-
-            if (this->m_FourierIndicesRecvC != NULL) {
-                delete [] this->m_FourierIndicesRecvC;
-                this->m_FourierIndicesRecvC = NULL;
-            }
-        }
-
-        if (this->m_FourierIndicesRecvF == NULL) {
-            try{this->m_FourierIndicesRecvF = new IntType[this->m_nAllocRecv*3];}
-            catch (std::bad_alloc&) {
-                ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
-            }
-        }
-        if (this->m_FourierIndicesRecvC == NULL) {
-            try{this->m_FourierIndicesRecvC = new IntType[this->m_nAllocRecv*3];}
-            catch (std::bad_alloc&) {
-                ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
-            }
-        }
-    } // alloc
-
-    // for all procs, send indices
-    for (int i = 0; i < nprocs; ++i) {
-        i_send = i; i_recv = i;
-        this->m_SendRequest[i_send] = MPI_REQUEST_NULL;
-        this->m_RecvRequest[i_recv] = MPI_REQUEST_NULL;
-
-        ns = this->m_NumSend[i];
-        os_send = this->m_OffsetSend[i];
-        if (ns > 0) {
-            ierr = Assert(&this->m_FourierIndicesSendF[3*os_send] != NULL, "null pointer"); CHKERRQ(ierr);
-            merr = MPI_Isend(&this->m_FourierIndicesSendF[3*os_send],
-                             3*ns, MPIU_INT, i_send, 0, PETSC_COMM_WORLD,
-                             &this->m_SendRequest[i_send]);
-            ierr = MPIERRQ(merr); CHKERRQ(ierr);
-        }
-
-        nr = this->m_NumRecv[i];
-        os_recv = this->m_OffsetRecv[i];
-        if (nr > 0) {
-            ierr = Assert(&this->m_FourierIndicesRecvF[3*os_recv] != NULL, "null pointer"); CHKERRQ(ierr);
-            merr = MPI_Irecv(&this->m_FourierIndicesRecvF[3*os_recv],
-                             3*nr, MPIU_INT, i_recv, 0, PETSC_COMM_WORLD,
-                             &this->m_RecvRequest[i_recv]);
-            ierr = MPIERRQ(merr); CHKERRQ(ierr);
-        }
-    }
-
-    // we have to wait until all communication is
-    // finished before we proceed
-    for (int i = 0; i < nprocs; ++i) {
-        if (this->m_SendRequest[i] != MPI_REQUEST_NULL) {
-            MPI_Wait(&this->m_SendRequest[i], &status);
-        }
-        if (this->m_RecvRequest[i] != MPI_REQUEST_NULL) {
-            MPI_Wait(&this->m_RecvRequest[i], &status);
-        }
-    }
-
-    // for all procs, send indices
-    for (int i = 0; i < nprocs; ++i) {
-        i_send = i; i_recv = i;
-        this->m_SendRequest[i_send] = MPI_REQUEST_NULL;
-        this->m_RecvRequest[i_recv] = MPI_REQUEST_NULL;
-
-        ns = this->m_NumSend[i];
-        os_send = this->m_OffsetSend[i];
-        if (ns > 0) {
-            merr = MPI_Isend(&this->m_FourierIndicesSendC[3*os_send],
-                             3*ns, MPIU_INT, i_send, 0, PETSC_COMM_WORLD,
-                             &this->m_SendRequest[i_send]);
-            ierr = MPIERRQ(merr); CHKERRQ(ierr);
-        }
-
-        nr = this->m_NumRecv[i];
-        os_recv = this->m_OffsetRecv[i];
-        if (nr > 0) {
-            merr = MPI_Irecv(&this->m_FourierIndicesRecvC[3*os_recv],
-                             3*nr, MPIU_INT, i_recv, 0, PETSC_COMM_WORLD,
-                             &this->m_RecvRequest[i_recv]);
-            ierr = MPIERRQ(merr); CHKERRQ(ierr);
-        }
-    }
-
-    // we have to wait until all communication is
-    // finished before we proceed
-    for (int i = 0; i < nprocs; ++i) {
-        if (this->m_SendRequest[i] != MPI_REQUEST_NULL) {
-            MPI_Wait(&this->m_SendRequest[i], &status);
-        }
-        if (this->m_RecvRequest[i] != MPI_REQUEST_NULL) {
-            MPI_Wait(&this->m_RecvRequest[i], &status);
-        }
-    }
-
-    // we only have to communicate these indices once
-    this->m_IndicesCommunicated = true;
-
-    this->m_Opt->Exit(__func__);
-
-    PetscFunctionReturn(0);
-}
-
-
-
-
-/********************************************************************
- * @brief do setup for applying restriction operator
- * @param nx_c grid size on coarse grid
- *******************************************************************/
-PetscErrorCode Preprocessing::GridChangeCommDataRestrict() {
-    PetscErrorCode ierr = 0;
-    int merr,nprocs,rank,i_recv,i_send;
-    IntType n,l,i_f[3],os_send,os_recv,nr,ns;
-    MPI_Status status;
-    std::stringstream ss;
-
-    PetscFunctionBegin;
-
-    this->m_Opt->Enter(__func__);
-
-    MPI_Comm_rank(PETSC_COMM_WORLD,&rank);
-    MPI_Comm_size(PETSC_COMM_WORLD,&nprocs);
-
-    ierr = Assert(this->m_OffsetSend != NULL, "error in setup"); CHKERRQ(ierr);
-    ierr = Assert(this->m_OffsetRecv != NULL, "error in setup"); CHKERRQ(ierr);
-    ierr = Assert(this->m_NumSend != NULL, "error in setup"); CHKERRQ(ierr);
-    ierr = Assert(this->m_NumRecv != NULL, "error in setup"); CHKERRQ(ierr);
-
-    if (this->m_SendRequest == NULL) {
-        try{this->m_SendRequest = new MPI_Request[nprocs];}
-        catch (std::bad_alloc&) {
-            ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
-        }
-    }
-    if (this->m_RecvRequest == NULL) {
-        try{this->m_RecvRequest = new MPI_Request[nprocs];}
-        catch (std::bad_alloc&) {
-            ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
-        }
-    }
-
-
-    // if we actually need to allocate something
-    if (this->m_nAllocSend > 0) {
-        if (this->m_ResetGridChangeOps) {
-            if (this->m_FourierCoeffSendF != NULL) {
-                delete [] this->m_FourierCoeffSendF;
-                this->m_FourierCoeffSendF = NULL;
-            }
-        }
-
-        if (this->m_FourierCoeffSendF == NULL) {
-            try{this->m_FourierCoeffSendF = new ScalarType[this->m_nAllocSend*2];}
-            catch (std::bad_alloc&) {
-                ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
-            }
-        }
-
-        for (int p = 0; p < nprocs; ++p) {
-            n = this->m_NumSend[p];
-            if (n != 0) {
-                os_send = this->m_OffsetSend[p];
-
-                for (IntType j = 0; j < n; ++j) {
-                    for (int i = 0; i < 3; ++i) {
-                        // get index (in local space)
-                        i_f[i] = this->m_FourierIndicesSendF[3*j + i + 3*os_send] - this->m_ostartF[i];
-
-                        // check if we're inside expected range
-                        if ( (i_f[i] >= this->m_osizeF[i]) || (i_f[i] < 0) ) {
-                            std::cout << " r "<< rank << " " << i_f[i]
-                                      << ">=" << this->m_osizeF[i] << "   " << i_f[i]
-                                      << "<0" << std::endl;
-                        }
-                    }
-
-                    // compute flat index
-                    l = GetLinearIndex(i_f[0],i_f[1],i_f[2],this->m_osizeF);
-
-                    // assign values to coarse grid
-                    this->m_FourierCoeffSendF[2*j+0+2*os_send] = this->m_XHatFine[l][0];
-                    this->m_FourierCoeffSendF[2*j+1+2*os_send] = this->m_XHatFine[l][1];
-                }  // for all points
-            }  // if indices are not empty
-        }  // for all procs
-    }
-
-    if (this->m_nAllocRecv > 0) {
-        if (this->m_ResetGridChangeOps) {
-            if (this->m_FourierCoeffRecvF != NULL) {
-                delete [] this->m_FourierCoeffRecvF;
-                this->m_FourierCoeffRecvF=NULL;
-            }
-        }
-        if (this->m_FourierCoeffRecvF == NULL) {
-            try{this->m_FourierCoeffRecvF = new ScalarType[this->m_nAllocRecv*2];}
-            catch (std::bad_alloc&) {
-                ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
-            }
-        }
-    }
-
-
-    // send and recv fourier coefficients on fine grid
-    for (int i = 0; i < nprocs; ++i) {
-        i_send = i; i_recv = i;
-        this->m_SendRequest[i_send] = MPI_REQUEST_NULL;
-        this->m_RecvRequest[i_recv] = MPI_REQUEST_NULL;
-
-        os_send = this->m_OffsetSend[i];
-        ns = this->m_NumSend[i];
-        if (ns > 0) {
-            merr = MPI_Isend(&this->m_FourierCoeffSendF[2*os_send],
-                             2*ns, MPIU_REAL, i_send, 0, PETSC_COMM_WORLD,
-                             &this->m_SendRequest[i_send]);
-            ierr = MPIERRQ(merr); CHKERRQ(ierr);
-        }
-
-        os_recv = this->m_OffsetRecv[i];
-        nr      = this->m_NumRecv[i];
-        if (nr > 0) {
-            merr = MPI_Irecv(&this->m_FourierCoeffRecvF[2*os_recv],
-                             2*nr, MPIU_REAL, i_recv, 0, PETSC_COMM_WORLD,
-                             &this->m_RecvRequest[i_recv]);
-            ierr = MPIERRQ(merr); CHKERRQ(ierr);
-        }
-    }
-
-    for (int i = 0; i < nprocs; ++i) {
-        if (this->m_SendRequest[i] != MPI_REQUEST_NULL) {
-            MPI_Wait(&this->m_SendRequest[i], &status);
-        }
-        if (this->m_RecvRequest[i] != MPI_REQUEST_NULL) {
-            MPI_Wait(&this->m_RecvRequest[i], &status);
-        }
-    }
-
-    this->m_Opt->Exit(__func__);
-
-    PetscFunctionReturn(0);
-}
-
-
-
-
-/********************************************************************
- * @brief communicate data for prolongation (this is the transpose
- * of the restriction operator); we define the restriction as the
- * forward operation and this as the adjoint operation; therefore,
- * we send here, what has been received on the coarse grid
- * @param nx_c grid size on coarse grid
- *******************************************************************/
-PetscErrorCode Preprocessing::GridChangeCommDataProlong() {
-    PetscErrorCode ierr = 0;
-    int merr,nprocs,rank,i_recv,i_send;
-    IntType n,l,i_c[3],os_send,os_recv,nr,ns;
-    MPI_Status status;
-    std::stringstream ss;
-
-    PetscFunctionBegin;
-
-    this->m_Opt->Enter(__func__);
-
-    MPI_Comm_rank(PETSC_COMM_WORLD, &rank);
-    MPI_Comm_size(PETSC_COMM_WORLD, &nprocs);
-
-    ierr = Assert(this->m_NumSend != NULL, "error in setup"); CHKERRQ(ierr);
-    ierr = Assert(this->m_NumRecv != NULL, "error in setup"); CHKERRQ(ierr);
-    ierr = Assert(this->m_OffsetSend != NULL, "error in setup"); CHKERRQ(ierr);
-    ierr = Assert(this->m_OffsetRecv != NULL, "error in setup"); CHKERRQ(ierr);
-
-    if (this->m_SendRequest == NULL) {
-        try{this->m_SendRequest = new MPI_Request[nprocs];}
-        catch (std::bad_alloc&) {
-            ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
-        }
-    }
-    if (this->m_RecvRequest == NULL) {
-        try{this->m_RecvRequest = new MPI_Request[nprocs];}
-        catch (std::bad_alloc&) {
-            ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
-        }
-    }
-
-
-    // if we actually need to allocate something
-    if (this->m_nAllocRecv > 0) {
-        if (this->m_ResetGridChangeOps) {
-            if (this->m_FourierCoeffSendC != NULL) {
-                delete [] this->m_FourierCoeffSendC;
-                this->m_FourierCoeffSendC = NULL;
-            }
-        }
-        if (this->m_FourierCoeffSendC == NULL) {
-            try{this->m_FourierCoeffSendC = new ScalarType[this->m_nAllocRecv*2];}
-            catch (std::bad_alloc&) {
-                ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
-            }
-        }
-
-        for (int p = 0; p < nprocs; ++p) {
-            n = this->m_NumRecv[p];
-
-            if (n != 0) {
-                os_recv = this->m_OffsetRecv[p];
-                for (IntType j = 0; j < n; ++j) {
-                    for (int i = 0; i < 3; ++i) {
-                        // get index (in local space)
-                        i_c[i] = this->m_FourierIndicesRecvC[3*j + i + 3*os_recv] - this->m_ostartC[i];
-
-                        // check if we're inside expected range
-                        if ( (i_c[i] >= this->m_osizeC[i]) || (i_c[i] < 0) ) {
-                            std::cout << " r " << rank << " " << i_c[i]
-                                      << ">=" << this->m_osizeC[i]
-                                      << "   " << i_c[i] << "<0" << std::endl;
-                        }
-                    }
-
-                    // compute flat index
-                    l = GetLinearIndex(i_c[0], i_c[1], i_c[2], this->m_osizeC);
-
-                    // assign values to coarse grid
-                    this->m_FourierCoeffSendC[2*j+0+2*os_recv] = this->m_XHatCoarse[l][0];
-                    this->m_FourierCoeffSendC[2*j+1+2*os_recv] = this->m_XHatCoarse[l][1];
-                }  // for all points
-            }  // if indices are not empty
-        }  // for all procs
-    }
-
-    if (this->m_nAllocSend > 0) {
-        if (this->m_ResetGridChangeOps) {
-            if (this->m_FourierCoeffRecvC != NULL) {
-                delete [] this->m_FourierCoeffRecvC;
-                this->m_FourierCoeffRecvC = NULL;
-            }
-        }
-
-        if (this->m_FourierCoeffRecvC == NULL) {
-            try{this->m_FourierCoeffRecvC = new ScalarType[this->m_nAllocSend*2];}
-            catch (std::bad_alloc&) {
-                ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
-            }
-        }
-    }
-
-    // send and recv fourier coefficients on fine grid
-    for (int i = 0; i < nprocs; ++i) {
-        i_send = i; i_recv = i;
-        this->m_SendRequest[i_send] = MPI_REQUEST_NULL;
-        this->m_RecvRequest[i_recv] = MPI_REQUEST_NULL;
-
-        os_send = this->m_OffsetRecv[i];
-        ns = this->m_NumRecv[i];
-        if (ns > 0) {
-            merr = MPI_Isend(&this->m_FourierCoeffSendC[2*os_send],
-                             2*ns, MPIU_REAL, i_send, 0, PETSC_COMM_WORLD,
-                             &this->m_SendRequest[i_send]);
-            ierr = MPIERRQ(merr); CHKERRQ(ierr);
-        }
-
-        os_recv = this->m_OffsetSend[i];
-        nr      = this->m_NumSend[i];
-        if (nr > 0) {
-            merr = MPI_Irecv(&this->m_FourierCoeffRecvC[2*os_recv],
-                             2*nr, MPIU_REAL, i_recv, 0, PETSC_COMM_WORLD,
-                             &this->m_RecvRequest[i_recv]);
-            ierr = MPIERRQ(merr); CHKERRQ(ierr);
-        }
-    }
-
-    for (int i = 0; i < nprocs; ++i) {
-        if (this->m_SendRequest[i] != MPI_REQUEST_NULL) {
-            MPI_Wait(&this->m_SendRequest[i], &status);
-        }
-        if (this->m_RecvRequest[i] != MPI_REQUEST_NULL) {
-            MPI_Wait(&this->m_RecvRequest[i], &status);
-        }
-    }
-
-    this->m_Opt->Exit(__func__);
-
-    PetscFunctionReturn(0);
-}
-
-
-
-
-/********************************************************************
- * @brief prolong vector field
- * @param vcoarse input vector field
- * @param vfine output vector field vfine = P[vcoarse]
- *******************************************************************/
-PetscErrorCode Preprocessing::Prolong(VecField* v_f, VecField* v_c, IntType* nx_f, IntType* nx_c) {
+PetscErrorCode Preprocessing::Prolong(VecField* v_f, VecField* v_c, IntType* nx_f, IntType* nx_c) {
     PetscErrorCode ierr = 0;
     PetscFunctionBegin;
 
@@ -1624,20 +1070,21 @@ PetscErrorCode Preprocessing::Prolong(VecField* v_f, VecField* v_c, IntType* nx_
 
 
 /********************************************************************
- * @brief prolong scalar field
- * @param x input vector
- * @param xfine output vector xfine = P[x]
+ * @brief prolong scalar field (this is the transpose of the
+ * restriction operator; we send here, what has been received
+ * on the coarse grid)
+ * @param x_f output vector x_f = P[x_c]
+ * @param x_c input vector
  * @param nx_f number of grid points on fine grid
- * @param dosetup flag to identify if we have to do the setup step;
- * this is essentially to prevent an additional setup step if we
- * apply this function to each component of a vector field, or a
- * time dependend field; if the parameter is not set, it is true
+ * @param nx_c number of grid points on coarse grid
  *******************************************************************/
 PetscErrorCode Preprocessing::Prolong(Vec* x_f, Vec x_c, IntType* nx_f, IntType* nx_c) {
     PetscErrorCode ierr = 0;
-    int rank, nprocs;
-    IntType l, n, ns, os_send, k_f[3], i_f[3], nyqfreqid[3];
-    ScalarType *p_xf = NULL, *p_xc = NULL, scale, coeff[2], value;
+    int merr;
+    ScalarType *p_xf = NULL, *p_xc = NULL, scale;
+    IntType n;
+    GridChangeOp* op = NULL;
+    ComplexType *xhat_f = NULL, *xhat_c = NULL;
     std::stringstream ss;
     double timer[NFFTTIMERS] = {0};
 
@@ -1645,9 +1092,6 @@ PetscErrorCode Preprocessing::Prolong(Vec* x_f, Vec x_c, IntType* nx_f, IntType*
 
     this->m_Opt->Enter(__func__);
 
-    MPI_Comm_rank(PETSC_COMM_WORLD, &rank);
-    MPI_Comm_size(PETSC_COMM_WORLD, &nprocs);
-
     ierr = Assert(x_c != NULL, "null pointer"); CHKERRQ(ierr);
     ierr = Assert(x_f != NULL, "null pointer"); CHKERRQ(ierr);
 
@@ -1659,110 +1103,60 @@ PetscErrorCode Preprocessing::Prolong(Vec* x_f, Vec x_c, IntType* nx_f, IntType*
 
     if ( (nx_c[0] == nx_f[0]) && (nx_c[1] == nx_f[1]) && (nx_c[2] == nx_f[2]) ) {
         ierr = VecCopy(x_c, *x_f); CHKERRQ(ierr);
+        this->m_Opt->Exit(__func__);
         PetscFunctionReturn(ierr);
     }
 
-    for (int i = 0; i < 3; ++i) {
-        this->m_nxC[i] = nx_c[i];
-        this->m_nxF[i] = nx_f[i];
-        value = static_cast<ScalarType>(nx_c[i])/2.0;
-        nyqfreqid[i] = static_cast<IntType>(std::ceil(value));
-    }
+    // get (cached) grid change operator
+    ierr = this->GetGridChangeOp(&op, nx_f, nx_c); CHKERRQ(ierr);
 
-    if (this->m_ResetGridChangeOps) {
-        this->m_GridChangeOpsSet = false;
-        this->m_GridChangeIndicesComputed = false;
-    }
+    // lease spectral data on both grids
+    ierr = this->m_Opt->GetSpectralWorkspace(&xhat_c, op->coarse->nalloc); CHKERRQ(ierr);
+    ierr = this->m_Opt->GetSpectralWorkspace(&xhat_f, op->fine->nalloc); CHKERRQ(ierr);
 
-    // set up fft operators
-    if (!this->m_GridChangeOpsSet) {
-        ierr = this->SetupGridChangeOps(nx_f, nx_c); CHKERRQ(ierr);
-    }
+    // compute fft of data on coarse grid
+    ierr = VecGetArray(x_c, &p_xc); CHKERRQ(ierr);
+    accfft_execute_r2c_t(op->coarse->plan, p_xc, xhat_c, timer);
+    ierr = VecRestoreArray(x_c, &p_xc); CHKERRQ(ierr);
 
-    n  = this->m_osizeF[0];
-    n *= this->m_osizeF[1];
-    n *= this->m_osizeF[2];
+    n  = op->fine->osize[0];
+    n *= op->fine->osize[1];
+    n *= op->fine->osize[2];
 
 #pragma omp parallel
 {
-    IntType l;
 #pragma omp for
     // set freqencies to zero
-    for (l = 0; l < n; ++l) {
-        this->m_XHatFine[l][0] = 0.0;
-        this->m_XHatFine[l][1] = 0.0;
+    for (IntType l = 0; l < n; ++l) {
+        xhat_f[l][0] = 0.0;
+        xhat_f[l][1] = 0.0;
     }
 } // pragma omp parallel
 
-    // compute fft of data on fine grid
-    ierr = VecGetArray(x_c, &p_xc); CHKERRQ(ierr);
-    accfft_execute_r2c_t(this->m_FFTCoarsePlan, p_xc, this->m_XHatCoarse, timer);
-    ierr = VecRestoreArray(x_c, &p_xc); CHKERRQ(ierr);
-
-    // compute indices for mapping from coarse grid to fine grid
-    if (!this->m_GridChangeIndicesComputed) {
-        ierr = this->ComputeGridChangeIndices(nx_f, nx_c); CHKERRQ(ierr);
-    }
-    ierr = this->GridChangeCommDataProlong(); CHKERRQ(ierr);
-
-    // get grid sizes/fft scales
-    scale = this->m_FFTCoarseScale;
-
-    // get number of entries we are going to assign
-    for (int p = 0; p < nprocs; ++p) {
-        ns = this->m_NumSend[p];
-        os_send = this->m_OffsetSend[p];
-
-        for (IntType j = 0; j < ns; ++j) {
-            bool outofbounds = false;
-            for (int i = 0; i < 3; ++i) {
-                k_f[i] = this->m_FourierIndicesSendF[3*j + i + 3*os_send] ;
-
-                // get wave number index on coarse grid from index on fine grid
-//                k_c[i] = k_f[i] <= nxhalf_c[i] ? k_f[i] : nx_c[i] - nx_f[i] + k_f[i];
-                i_f[i] = k_f[i] - this->m_ostartF[i];
-
-                if ((k_f[i] < this->m_ostartF[i]) || (k_f[i] > this->m_ostartF[i] + this->m_osizeF[i])) {
-                    outofbounds = true;
-                }
-                if ((i_f[i] < 0) || (i_f[i] > this->m_osizeF[i])) {
-                    outofbounds = true;
-                }
-            }
-            if (outofbounds) {
-                std::cout << i_f[0] << " " << i_f[1] << " " << i_f[2] << std::endl;
-            }
-            if (!outofbounds) {
-
-                bool setvalue = true;
-                for (int i = 0; i < 3; ++i) {
-                    if (i_f[i] == nyqfreqid[i]) {
-                        setvalue = false;
-                    }
-                }
-
-                if (setvalue) {
-                    // compute flat index
-                    l = GetLinearIndex(i_f[0], i_f[1], i_f[2], this->m_osizeF);
+    // send fourier coefficients on coarse grid to fine grid
+    merr = MPI_Neighbor_alltoallw(xhat_c, op->count.data(), op->displ.data(), op->typecoarse.data(),
+                                  xhat_f, op->count.data(), op->displ.data(), op->typefine.data(), op->comm);
+    ierr = MPIERRQ(merr); CHKERRQ(ierr);
 
-                    // get fourier coefficients
-                    coeff[0] = this->m_FourierCoeffRecvC[2*j + 0 + 2*os_send];
-                    coeff[1] = this->m_FourierCoeffRecvC[2*j + 1 + 2*os_send];
+    scale = op->coarse->scale;
 
-                    // assign values to coarse grid
-                    this->m_XHatFine[l][0] = scale*coeff[0];
-                    this->m_XHatFine[l][1] = scale*coeff[1];
-                }
-            }
-        }
+#pragma omp parallel
+{
+#pragma omp for
+    for (IntType l = 0; l < n; ++l) {
+        xhat_f[l][0] *= scale;
+        xhat_f[l][1] *= scale;
     }
-
+} // pragma omp parallel
 
     ierr = VecGetArray(*x_f, &p_xf); CHKERRQ(ierr);
-    accfft_execute_c2r_t(this->m_FFTFinePlan, this->m_XHatFine, p_xf, timer);
+    accfft_execute_c2r_t(op->fine->plan, xhat_f, p_xf, timer);
     ierr = VecRestoreArray(*x_f, &p_xf); CHKERRQ(ierr);
 
-    // set fft timeri
+    ierr = this->m_Opt->ReleaseSpectralWorkspace(&xhat_f); CHKERRQ(ierr);
+    ierr = this->m_Opt->ReleaseSpectralWorkspace(&xhat_c); CHKERRQ(ierr);
+
+    // set fft timers
     this->m_Opt->IncreaseFFTTimers(timer);
 
     // increment counter
@@ -1776,7 +1170,6 @@ PetscErrorCode Preprocessing::Prolong(Vec* x_f, Vec x_c, IntType* nx_f, IntType*
 
 
 
-
 /********************************************************************
  * @brief apply cutoff frequency filter
  * @param xflt output/filtered x
@@ -1811,7 +1204,6 @@ PetscErrorCode Preprocessing::ApplyRectFreqFilter(VecField* vflt, VecField* v, S
  *******************************************************************/
 PetscErrorCode Preprocessing::ApplyRectFreqFilter(Vec xflt, Vec x, ScalarType pct, bool lowpass) {
     PetscErrorCode ierr = 0;
-    IntType nalloc;
     ScalarType *p_x = NULL, *p_xflt = NULL;
     ScalarType nxhalf[3], scale, cfreq[3][2], indicator[2], indic;
     int nx[3];
@@ -1842,13 +1234,8 @@ PetscErrorCode Preprocessing::ApplyRectFreqFilter(Vec xflt, Vec x, ScalarType pc
         indicator[1] = 1;
     }
 
-    // get local pencil size and allocation size
-    nalloc = this->m_Opt->m_FFT.nalloc;
-
-    // allocate
-    if (this->m_xhat == NULL) {
-        this->m_xhat = reinterpret_cast<ComplexType*>(accfft_alloc(nalloc));
-    }
+    // get spectral work array
+    ierr = this->m_Opt->GetSpectralWorkspace(&this->m_xhat); CHKERRQ(ierr);
 
     // get parameters
     for (int i = 0; i < 3; ++i) {
@@ -1913,6 +1300,8 @@ PetscErrorCode Preprocessing::ApplyRectFreqFilter(Vec xflt, Vec x, ScalarType pc
     accfft_execute_c2r(this->m_Opt->m_FFT.plan, this->m_xhat, p_xflt, timer);
     ierr = VecRestoreArray(xflt, &p_xflt); CHKERRQ(ierr);
 
+    ierr = this->m_Opt->ReleaseSpectralWorkspace(&this->m_xhat); CHKERRQ(ierr);
+
     // increment fft timer
     this->m_Opt->IncreaseFFTTimers(timer);
 
@@ -1932,6 +1321,7 @@ PetscErrorCode Preprocessing::ApplyRectFreqFilter(Vec xflt, Vec x, ScalarType pc
  *******************************************************************/
 PetscErrorCode Preprocessing::Smooth(Vec xs, Vec x, IntType nc) {
     PetscErrorCode ierr = 0;
+    bool usestencil = false;
 
     PetscFunctionBegin;
 
@@ -1940,7 +1330,16 @@ PetscErrorCode Preprocessing::Smooth(Vec xs, Vec x, IntType nc) {
     ierr = Assert(x != NULL, "null pointer"); CHKERRQ(ierr);
     ierr = Assert(xs != NULL, "null pointer"); CHKERRQ(ierr);
 
-    ierr = this->GaussianSmoothing(xs, x, nc); CHKERRQ(ierr);
+    // the filter is applied as a separable stencil in real space if the
+    // kernel is narrow (halo exchange with immediate neighbors only);
+    // for wide kernels we apply the filter in the spectral domain
+    ierr = this->SetupSmoothingStencil(usestencil); CHKERRQ(ierr);
+
+    if (usestencil) {
+        ierr = this->GaussianSmoothingStencil(xs, x, nc); CHKERRQ(ierr);
+    } else {
+        ierr = this->GaussianSmoothing(xs, x, nc); CHKERRQ(ierr);
+    }
 
     this->m_Opt->Exit(__func__);
 
@@ -1955,7 +1354,7 @@ PetscErrorCode Preprocessing::Smooth(Vec xs, Vec x, IntType nc) {
  *******************************************************************/
 PetscErrorCode Preprocessing::GaussianSmoothing(Vec xs, Vec x, IntType nc) {
     PetscErrorCode ierr = 0;
-    IntType nalloc, nl;
+    IntType nl;
     std::stringstream ss;
     ScalarType *p_x = NULL, *p_xs = NULL, c[3], scale; //, nx[3];
     int nx[3];
@@ -1970,12 +1369,10 @@ PetscErrorCode Preprocessing::GaussianSmoothing(Vec xs, Vec x, IntType nc) {
 
     // get local pencil size and allocation size
     nl     = this->m_Opt->m_Domain.nl;
-    nalloc = this->m_Opt->m_FFT.nalloc;
     scale  = this->m_Opt->ComputeFFTScale();
 
-    if (this->m_xhat == NULL) {
-        this->m_xhat = reinterpret_cast<ComplexType*>(accfft_alloc(nalloc));
-    }
+    // get spectral work array
+    ierr = this->m_Opt->GetSpectralWorkspace(&this->m_xhat); CHKERRQ(ierr);
 
     if (this->m_Opt->m_Verbosity > 1) {
         ss << "applying smoothing: ("
@@ -2035,6 +1432,7 @@ PetscErrorCode Preprocessing::GaussianSmoothing(Vec xs, Vec x, IntType nc) {
         accfft_execute_c2r(this->m_Opt->m_FFT.plan, this->m_xhat, p_xs + k*nl, timer);
         ierr = VecRestoreArray(xs, &p_xs); CHKERRQ(ierr);
     }
+    ierr = this->m_Opt->ReleaseSpectralWorkspace(&this->m_xhat); CHKERRQ(ierr);
 
     // increment fft timer
     this->m_Opt->IncreaseFFTTimers(timer);
@@ -2048,6 +1446,244 @@ PetscErrorCode Preprocessing::GaussianSmoothing(Vec xs, Vec x, IntType nc) {
 
 
 
+/********************************************************************
+ * @brief setup 1d gaussian kernels for separable smoothing in real
+ * space and decide if we apply the stencil or the spectral filter
+ * @param usestencil flag: apply filter as stencil in real space
+ *******************************************************************/
+PetscErrorCode Preprocessing::SetupSmoothingStencil(bool& usestencil) {
+    PetscErrorCode ierr = 0;
+    int merr, nrmax, nr, isizemin, isizeminloc;
+    ScalarType sigma, wsum, w;
+    std::stringstream ss;
+    // stencil is truncated at nsigma times the standard deviation
+    const ScalarType nsigma = 3.0;
+    // max radius for which the stencil is cheaper than two FFTs
+    const int maxradius = 6;
+
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    nrmax = 0;
+    for (int i = 0; i < 3; ++i) {
+        // sigma is provided by user in # of grid points
+        sigma = this->m_Opt->m_Sigma[i];
+        nr = sigma > 0.0 ? static_cast<int>(std::ceil(nsigma*sigma)) : 0;
+
+        this->m_SmoothRadius[i] = nr;
+        this->m_SmoothKernel[i].resize(2*nr + 1);
+
+        // evaluate and normalize truncated kernel
+        wsum = 0.0;
+        for (int j = -nr; j <= nr; ++j) {
+            w = nr > 0 ? std::exp(-0.5*static_cast<ScalarType>(j*j)/(sigma*sigma)) : 1.0;
+            this->m_SmoothKernel[i][j + nr] = w;
+            wsum += w;
+        }
+        for (int j = 0; j < 2*nr + 1; ++j) {
+            this->m_SmoothKernel[i][j] /= wsum;
+        }
+        nrmax = std::max(nrmax, nr);
+    }
+
+    // the halo exchange only communicates with the immediate neighbors;
+    // the stencil can not be larger than the smallest local pencil
+    isizeminloc = static_cast<int>(this->m_Opt->m_Domain.isize[0]);
+    for (int i = 1; i < 3; ++i) {
+        isizeminloc = std::min(isizeminloc, static_cast<int>(this->m_Opt->m_Domain.isize[i]));
+    }
+    merr = MPI_Allreduce(&isizeminloc, &isizemin, 1, MPI_INT, MPI_MIN, PETSC_COMM_WORLD);
+    ierr = MPIERRQ(merr); CHKERRQ(ierr);
+
+    switch (this->m_Opt->m_SmoothType) {
+        case AUTOSMOOTH:
+        {
+            usestencil = (nrmax <= maxradius) && (nrmax <= isizemin);
+            break;
+        }
+        case SPECTRALSMOOTH:
+        {
+            usestencil = false;
+            break;
+        }
+        case STENCILSMOOTH:
+        {
+            usestencil = nrmax <= isizemin;
+            if (!usestencil) {
+                ss << "stencil radius " << nrmax << " exceeds local grid size "
+                   << isizemin << "; applying smoothing in spectral domain";
+                ierr = WrngMsg(ss.str()); CHKERRQ(ierr);
+                ss.clear(); ss.str(std::string());
+            }
+            break;
+        }
+        default:
+        {
+            ierr = ThrowError("smoothing method not defined"); CHKERRQ(ierr);
+            break;
+        }
+    }
+
+    if (this->m_Opt->m_Verbosity > 2) {
+        ss << "smoothing: " << (usestencil ? "stencil" : "spectral")
+           << " (radius " << this->m_SmoothRadius[0] << ", "
+           << this->m_SmoothRadius[1] << ", " << this->m_SmoothRadius[2] << ")";
+        ierr = DbgMsg(ss.str()); CHKERRQ(ierr);
+        ss.clear(); ss.str(std::string());
+    }
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief apply gaussian smoothing operator to input data; the
+ * filter is applied as a separable, truncated convolution in
+ * real space (requires setup of stencil)
+ *******************************************************************/
+PetscErrorCode Preprocessing::GaussianSmoothingStencil(Vec xs, Vec x, IntType nc) {
+    PetscErrorCode ierr = 0;
+    IntType nl, nalloc;
+    int nghost, isize[3], isize_g[3], istart_g[3];
+    ScalarType *p_x = NULL, *p_xs = NULL;
+    std::stringstream ss;
+
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    ierr = Assert(x != NULL, "null pointer"); CHKERRQ(ierr);
+    ierr = Assert(xs != NULL, "null pointer"); CHKERRQ(ierr);
+
+    nl = this->m_Opt->m_Domain.nl;
+
+    nghost = 0;
+    for (int i = 0; i < 3; ++i) {
+        isize[i] = static_cast<int>(this->m_Opt->m_Domain.isize[i]);
+        nghost = std::max(nghost, this->m_SmoothRadius[i]);
+    }
+
+    if (this->m_Opt->m_Verbosity > 1) {
+        ss << "applying smoothing (stencil): ("
+           << this->m_Opt->m_Sigma[0]
+           << ", " << this->m_Opt->m_Sigma[1]
+           << ", " << this->m_Opt->m_Sigma[2] << ")";
+        ierr = DbgMsg(ss.str()); CHKERRQ(ierr);
+        ss.clear(); ss.str(std::string());
+    }
+
+    // nothing to smooth
+    if (nghost == 0) {
+        if (x != xs) {
+            ierr = VecCopy(x, xs); CHKERRQ(ierr);
+        }
+        this->m_Opt->Exit(__func__);
+        PetscFunctionReturn(ierr);
+    }
+
+    // allocate buffers for scalar field padded with ghost points
+    nalloc = accfft_ghost_xyz_local_size_dft_r2c(this->m_Opt->m_FFT.plan, nghost, isize_g, istart_g);
+    if (nalloc > this->m_nAllocGhost) {
+        if (this->m_GhostData != NULL) {
+            accfft_free(this->m_GhostData);
+            this->m_GhostData = NULL;
+        }
+        if (this->m_GhostWork != NULL) {
+            accfft_free(this->m_GhostWork);
+            this->m_GhostWork = NULL;
+        }
+        this->m_nAllocGhost = nalloc;
+    }
+    if (this->m_GhostData == NULL) {
+        this->m_GhostData = reinterpret_cast<ScalarType*>(accfft_alloc(this->m_nAllocGhost));
+    }
+    if (this->m_GhostWork == NULL) {
+        this->m_GhostWork = reinterpret_cast<ScalarType*>(accfft_alloc(this->m_nAllocGhost));
+    }
+
+    for (IntType k = 0; k < nc; ++k) {
+        // get ghost points from neighbors (periodic)
+        ierr = VecGetArray(x, &p_x); CHKERRQ(ierr);
+        accfft_get_ghost_xyz(this->m_Opt->m_FFT.plan, nghost, isize_g, p_x + k*nl, this->m_GhostData);
+        ierr = VecRestoreArray(x, &p_x); CHKERRQ(ierr);
+
+        // convolution along x1; output is padded in x2 and x3
+#pragma omp parallel
+{
+        ScalarType val;
+        const int nr = this->m_SmoothRadius[0];
+        const ScalarType* w = &this->m_SmoothKernel[0][nr];
+#pragma omp for
+        for (int i1 = 0; i1 < isize[0]; ++i1) {
+            for (int i2 = 0; i2 < isize_g[1]; ++i2) {
+                for (int i3 = 0; i3 < isize_g[2]; ++i3) {
+                    val = 0.0;
+                    for (int j = -nr; j <= nr; ++j) {
+                        val += w[j]*this->m_GhostData[(static_cast<IntType>(i1 + nghost + j)*isize_g[1] + i2)*isize_g[2] + i3];
+                    }
+                    this->m_GhostWork[(static_cast<IntType>(i1)*isize_g[1] + i2)*isize_g[2] + i3] = val;
+                }  // i3
+            }  // i2
+        }  // i1
+}  // pragma omp parallel
+
+        // convolution along x2; output is padded in x3
+#pragma omp parallel
+{
+        ScalarType val;
+        const int nr = this->m_SmoothRadius[1];
+        const ScalarType* w = &this->m_SmoothKernel[1][nr];
+#pragma omp for
+        for (int i1 = 0; i1 < isize[0]; ++i1) {
+            for (int i2 = 0; i2 < isize[1]; ++i2) {
+                for (int i3 = 0; i3 < isize_g[2]; ++i3) {
+                    val = 0.0;
+                    for (int j = -nr; j <= nr; ++j) {
+                        val += w[j]*this->m_GhostWork[(static_cast<IntType>(i1)*isize_g[1] + i2 + nghost + j)*isize_g[2] + i3];
+                    }
+                    this->m_GhostData[(static_cast<IntType>(i1)*isize[1] + i2)*isize_g[2] + i3] = val;
+                }  // i3
+            }  // i2
+        }  // i1
+}  // pragma omp parallel
+
+        // convolution along x3 (locally owned)
+        ierr = VecGetArray(xs, &p_xs); CHKERRQ(ierr);
+#pragma omp parallel
+{
+        ScalarType val;
+        const int nr = this->m_SmoothRadius[2];
+        const ScalarType* w = &this->m_SmoothKernel[2][nr];
+        ScalarType* p_xsk = p_xs + k*nl;
+#pragma omp for
+        for (int i1 = 0; i1 < isize[0]; ++i1) {
+            for (int i2 = 0; i2 < isize[1]; ++i2) {
+                for (int i3 = 0; i3 < isize[2]; ++i3) {
+                    val = 0.0;
+                    for (int j = -nr; j <= nr; ++j) {
+                        val += w[j]*this->m_GhostData[(static_cast<IntType>(i1)*isize[1] + i2)*isize_g[2] + i3 + nghost + j];
+                    }
+                    p_xsk[(static_cast<IntType>(i1)*isize[1] + i2)*isize[2] + i3] = val;
+                }  // i3
+            }  // i2
+        }  // i1
+}  // pragma omp parallel
+        ierr = VecRestoreArray(xs, &p_xs); CHKERRQ(ierr);
+    }
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
 }  // namespace reg
 
 
@@ -23,7 +23,17 @@
 
 
 
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include "ReadWriteReg.hpp"
+#include "BlockGzip.hpp"
 
 
 
@@ -73,6 +83,7 @@ PetscErrorCode ReadWriteReg::Initialize() {
 
     this->m_Opt = NULL;
     this->m_Data = NULL;
+    this->m_NormalizeOnRead = false;
 
 #ifdef REG_HAS_NIFTI
     this->m_ReferenceImage.data = NULL;
@@ -113,6 +124,10 @@ PetscErrorCode ReadWriteReg::Initialize() {
     this->m_nx[1] = -1;
     this->m_nx[2] = -1;
 
+    this->m_AsyncBytes = 0;
+    this->m_AsyncErrors = 0;
+    this->m_AsyncStop = false;
+
     PetscFunctionReturn(ierr);
 }
 
@@ -126,6 +141,9 @@ PetscErrorCode ReadWriteReg::ClearMemory() {
     PetscErrorCode ierr = 0;
     PetscFunctionBegin;
 
+    // write pending output
+    ierr = this->StopAsyncWriter(); CHKERRQ(ierr);
+
     if (this->m_Data != NULL) {
         delete [] this->m_Data;
         this->m_Data = NULL;
@@ -168,18 +186,236 @@ PetscErrorCode ReadWriteReg::ClearMemory() {
 
 
 /********************************************************************
- * @brief collect data distribution sizes and collect them on master
+ * @brief write segments of job to file (called by background
+ * thread; no petsc or mpi calls); returns false on failure
+ *******************************************************************/
+static bool WriteSegments(const std::string& filename, const char* data,
+                          const std::vector<off_t>& offset, size_t seglength) {
+    int fd;
+    size_t done;
+    ssize_t nbytes;
+
+    fd = open(filename.c_str(), O_WRONLY);
+    if (fd == -1) return false;
+
+    for (size_t k = 0; k < offset.size(); ++k) {
+        done = 0;
+        while (done < seglength) {
+            nbytes = pwrite(fd, data + k*seglength + done, seglength - done, offset[k] + done);
+            if (nbytes <= 0) {
+                close(fd);
+                return false;
+            }
+            done += static_cast<size_t>(nbytes);
+        }
+    }
+
+    return close(fd) == 0;
+}
+
+
+
+
+/********************************************************************
+ * @brief background thread for output; the job at the front of the
+ * queue stays in the queue until it has been written (an empty
+ * queue means that all output has been written)
+ *******************************************************************/
+void ReadWriteReg::AsyncWriter() {
+    AsyncWriteJob* job = NULL;
+    bool success;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(this->m_AsyncMutex);
+            while (!this->m_AsyncStop && this->m_AsyncQueue.empty()) {
+                this->m_AsyncCondition.wait(lock);
+            }
+            if (this->m_AsyncQueue.empty()) break;
+            job = this->m_AsyncQueue.front();
+        }
+
+        success = WriteSegments(job->filename, job->data.data(), job->offset, job->seglength);
+
+        {
+            std::unique_lock<std::mutex> lock(this->m_AsyncMutex);
+            this->m_AsyncQueue.pop_front();
+            this->m_AsyncBytes -= job->data.size();
+            if (!success) this->m_AsyncErrors++;
+        }
+        this->m_AsyncCondition.notify_all();
+
+        delete job; job = NULL;
+    }
+}
+
+
+
+
+/********************************************************************
+ * @brief hand snapshot of local data to background thread; if the
+ * pending output exceeds the memory bound, we wait until enough
+ * output has been written
+ *******************************************************************/
+PetscErrorCode ReadWriteReg::EnqueueWrite(AsyncWriteJob* job) {
+    PetscErrorCode ierr = 0;
+    size_t maxbytes;
+    int nerrors;
+
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    // start background thread
+    if (!this->m_AsyncThread.joinable()) {
+        this->m_AsyncStop = false;
+        try {this->m_AsyncThread = std::thread(&ReadWriteReg::AsyncWriter, this);}
+        catch (std::exception& err) {
+            ierr = ThrowError(err); CHKERRQ(ierr);
+        }
+    }
+
+    maxbytes = static_cast<size_t>(this->m_Opt->m_ReadWriteFlags.asynciomem)*1024*1024;
+    {
+        std::unique_lock<std::mutex> lock(this->m_AsyncMutex);
+        while (!this->m_AsyncQueue.empty() && (this->m_AsyncBytes + job->data.size() > maxbytes)) {
+            this->m_AsyncCondition.wait(lock);
+        }
+        this->m_AsyncQueue.push_back(job);
+        this->m_AsyncBytes += job->data.size();
+        nerrors = this->m_AsyncErrors;
+    }
+    this->m_AsyncCondition.notify_all();
+
+    ierr = Assert(nerrors == 0, "asynchronous output failed"); CHKERRQ(ierr);
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief wait until all asynchronous output has been written
+ *******************************************************************/
+PetscErrorCode ReadWriteReg::Flush() {
+    PetscErrorCode ierr = 0;
+    int nerrors;
+
+    PetscFunctionBegin;
+
+    {
+        std::unique_lock<std::mutex> lock(this->m_AsyncMutex);
+        while (!this->m_AsyncQueue.empty()) {
+            this->m_AsyncCondition.wait(lock);
+        }
+        nerrors = this->m_AsyncErrors;
+        this->m_AsyncErrors = 0;
+    }
+
+    ierr = Assert(nerrors == 0, "asynchronous output failed"); CHKERRQ(ierr);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief wait until pending asynchronous output to the given file has
+ * been written on all ranks (collective); has to be called before a
+ * file is created or truncated, since the file names of outputs are
+ * reused (e.g., iterates) and other ranks might still be writing
+ *******************************************************************/
+PetscErrorCode ReadWriteReg::FlushPending(std::string filename) {
+    PetscErrorCode ierr = 0;
+    int pending = 0, rval;
+
+    PetscFunctionBegin;
+
+    {
+        std::unique_lock<std::mutex> lock(this->m_AsyncMutex);
+        for (size_t k = 0; k < this->m_AsyncQueue.size(); ++k) {
+            if (this->m_AsyncQueue[k]->filename == filename) {
+                pending = 1;
+                break;
+            }
+        }
+    }
+
+    rval = MPI_Allreduce(MPI_IN_PLACE, &pending, 1, MPI_INT, MPI_MAX, PETSC_COMM_WORLD);
+    ierr = MPIERRQ(rval); CHKERRQ(ierr);
+
+    if (pending) {
+        ierr = this->Flush(); CHKERRQ(ierr);
+        rval = MPI_Barrier(PETSC_COMM_WORLD);
+        ierr = MPIERRQ(rval); CHKERRQ(ierr);
+    }
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief create file (if it does not exist) without truncating it and
+ * set its size explicitly (master rank; called before the header is
+ * written with "r+b")
+ *******************************************************************/
+static bool CreateOutputFile(const std::string& filename, off_t size) {
+    int fd;
+    bool success;
+
+    fd = open(filename.c_str(), O_WRONLY | O_CREAT, 0644);
+    if (fd == -1) return false;
+
+    success = (ftruncate(fd, size) == 0);
+
+    return (close(fd) == 0) && success;
+}
+
+
+
+
+/********************************************************************
+ * @brief write pending output and stop background thread
+ *******************************************************************/
+PetscErrorCode ReadWriteReg::StopAsyncWriter() {
+    PetscErrorCode ierr = 0;
+    PetscFunctionBegin;
+
+    if (this->m_AsyncThread.joinable()) {
+        {
+            std::unique_lock<std::mutex> lock(this->m_AsyncMutex);
+            this->m_AsyncStop = true;
+        }
+        this->m_AsyncCondition.notify_all();
+        this->m_AsyncThread.join();
+        ierr = Assert(this->m_AsyncErrors == 0, "asynchronous output failed"); CHKERRQ(ierr);
+    }
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief collect data distribution sizes on all ranks (any rank can
+ * read data and distribute it; see ReadNII)
  *******************************************************************/
 PetscErrorCode ReadWriteReg::CollectSizes() {
     PetscErrorCode ierr = 0;
-    int nprocs, rank, rval;
+    int nprocs, rval;
     IntType isize[3], istart[3], offset, nsend;
 
     PetscFunctionBegin;
 
     this->m_Opt->Enter(__func__);
 
-    MPI_Comm_rank(PETSC_COMM_WORLD, &rank);
     MPI_Comm_size(PETSC_COMM_WORLD, &nprocs);
 
     this->m_NumProcs = nprocs;
@@ -192,20 +428,17 @@ PetscErrorCode ReadWriteReg::CollectSizes() {
     istart[1] = this->m_Opt->m_Domain.istart[1];
     istart[2] = this->m_Opt->m_Domain.istart[2];
 
-    // read data only on master rank
-    if (rank == 0) {
-        // get all the sizes to read and assign data correctly
-        if (this->m_iSizeC == NULL) {
-            try {this->m_iSizeC = new IntType[3*nprocs];}
-            catch (std::bad_alloc&) {
-                ierr = ThrowError("allocation failed"); CHKERRQ(ierr);
-            }
+    // get all the sizes to read and assign data correctly
+    if (this->m_iSizeC == NULL) {
+        try {this->m_iSizeC = new IntType[3*nprocs];}
+        catch (std::bad_alloc&) {
+            ierr = ThrowError("allocation failed"); CHKERRQ(ierr);
         }
-        if (this->m_iStartC == NULL) {
-            try {this->m_iStartC = new IntType[3*nprocs];}
-            catch (std::bad_alloc&) {
-                ierr = ThrowError("allocation failed"); CHKERRQ(ierr);
-            }
+    }
+    if (this->m_iStartC == NULL) {
+        try {this->m_iStartC = new IntType[3*nprocs];}
+        catch (std::bad_alloc&) {
+            ierr = ThrowError("allocation failed"); CHKERRQ(ierr);
         }
     }
 
@@ -222,26 +455,24 @@ PetscErrorCode ReadWriteReg::CollectSizes() {
         }
     }
 
-    // gather isize and istart on master rank
-    rval = MPI_Gather(isize, 3, MPIU_INT, this->m_iSizeC, 3, MPIU_INT, 0, PETSC_COMM_WORLD);
+    // gather isize and istart on all ranks
+    rval = MPI_Allgather(isize, 3, MPIU_INT, this->m_iSizeC, 3, MPIU_INT, PETSC_COMM_WORLD);
     ierr = MPIERRQ(rval); CHKERRQ(ierr);
 
-    rval = MPI_Gather(istart, 3, MPIU_INT, this->m_iStartC, 3, MPIU_INT, 0, PETSC_COMM_WORLD);
+    rval = MPI_Allgather(istart, 3, MPIU_INT, this->m_iStartC, 3, MPIU_INT, PETSC_COMM_WORLD);
     ierr = MPIERRQ(rval); CHKERRQ(ierr);
 
     // compute offset and number of entries to send
-    if (rank == 0) {
-        offset = 0;
-        for (int p = 0; p < nprocs; ++p) {
-            nsend = 1;
-            for (int i = 0; i < 3; ++i) {
-               nsend *= this->m_iSizeC[p*3+i];
-            }
-            this->m_nSend[p] = static_cast<int>(nsend);
-            this->m_nOffset[p] = offset;
-            offset += nsend;
+    offset = 0;
+    for (int p = 0; p < nprocs; ++p) {
+        nsend = 1;
+        for (int i = 0; i < 3; ++i) {
+           nsend *= this->m_iSizeC[p*3+i];
         }
-    }  // on master rank
+        this->m_nSend[p] = static_cast<int>(nsend);
+        this->m_nOffset[p] = offset;
+        offset += nsend;
+    }
 
     this->m_Opt->Exit(__func__);
 
@@ -251,6 +482,88 @@ PetscErrorCode ReadWriteReg::CollectSizes() {
 
 
 
+/********************************************************************
+ * @brief store intensity range of components that have been read
+ * (and rescaled); the range is stored as [-min_0,...,max_0,...]; if
+ * only the root has read the data, we reduce the range first
+ *******************************************************************/
+PetscErrorCode ReadWriteReg::AddIntensityRange(std::vector<ScalarType>& range, bool reduce) {
+    PetscErrorCode ierr = 0;
+    IntType n;
+    int rval;
+
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    n = static_cast<IntType>(range.size()/2);
+    if (reduce) {
+        rval = MPI_Allreduce(MPI_IN_PLACE, range.data(), static_cast<int>(2*n), MPIU_REAL, MPI_MAX, PETSC_COMM_WORLD);
+        ierr = MPIERRQ(rval); CHKERRQ(ierr);
+    }
+
+    for (IntType k = 0; k < n; ++k) {
+        this->m_IntensityMin.push_back(-range[k]);
+        this->m_IntensityMax.push_back(range[n+k]);
+    }
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief rescale intensities to [0,1] after reading; if the data has
+ * been rescaled while it was read (nifti images), we only evaluate
+ * the range of the original data; otherwise we compute the range of
+ * all components (single reduction) and rescale the data in one pass
+ *******************************************************************/
+PetscErrorCode ReadWriteReg::ApplyNormalization(Vec x, ScalarType& minval, ScalarType& maxval) {
+    PetscErrorCode ierr = 0;
+    IntType nc;
+    std::stringstream ss;
+
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    nc = this->m_Opt->m_Domain.nc;
+
+    if (static_cast<IntType>(this->m_IntensityMin.size()) != nc) {
+        try {
+            this->m_IntensityMin.resize(nc);
+            this->m_IntensityMax.resize(nc);
+        } catch (std::bad_alloc& err) {
+            ierr = ThrowError(err); CHKERRQ(ierr);
+        }
+        ierr = ComputeRange(x, nc, this->m_IntensityMin.data(), this->m_IntensityMax.data()); CHKERRQ(ierr);
+        ierr = Normalize(x, nc, this->m_IntensityMin.data(), this->m_IntensityMax.data()); CHKERRQ(ierr);
+    }
+
+    minval = std::numeric_limits<ScalarType>::max();
+    maxval = std::numeric_limits<ScalarType>::lowest();
+    for (IntType k = 0; k < nc; ++k) {
+        if (this->m_IntensityMin[k] < 0.0) {
+            ss << "negative values in input data detected "
+               << this->m_IntensityMin[k] << " (setting to zero)";
+            ierr = WrngMsg(ss.str()); CHKERRQ(ierr);
+            ss.clear(); ss.str(std::string());
+        }
+        minval = std::min(minval, this->m_IntensityMin[k]);
+        maxval = std::max(maxval, this->m_IntensityMax[k]);
+    }
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
 /********************************************************************
  * @brief read reference image from filename
  *******************************************************************/
@@ -269,12 +582,24 @@ PetscErrorCode ReadWriteReg::ReadR(Vec* x, std::vector< std::string > filenames)
 #endif
     this->m_ReferenceImage.read = true;
 
+    // rescale intensities to [0,1] while converting the data
+    this->m_NormalizeOnRead = this->m_Opt->m_RegFlags.applyrescaling
+                           && this->m_Opt->m_ReadWriteFlags.rescaleonread;
+    this->m_IntensityMin.clear();
+    this->m_IntensityMax.clear();
+
     ierr = this->Read(x, filenames); CHKERRQ(ierr);
 
     this->m_ReferenceImage.read = false;
 
-    ierr = VecMin(*x, NULL, &minval); CHKERRQ(ierr);
-    ierr = VecMax(*x, NULL, &maxval); CHKERRQ(ierr);
+    if (this->m_NormalizeOnRead) {
+        ierr = this->ApplyNormalization(*x, minval, maxval); CHKERRQ(ierr);
+        this->m_Opt->m_ReadWriteFlags.normalizedref = true;
+    } else {
+        ierr = VecMin(*x, NULL, &minval); CHKERRQ(ierr);
+        ierr = VecMax(*x, NULL, &maxval); CHKERRQ(ierr);
+    }
+    this->m_NormalizeOnRead = false;
     this->m_ReferenceImage.minval = minval;
     this->m_ReferenceImage.maxval = maxval;
 
@@ -304,12 +629,24 @@ PetscErrorCode ReadWriteReg::ReadT(Vec* x, std::vector< std::string > filenames)
 #endif
     this->m_TemplateImage.read = true;
 
+    // rescale intensities to [0,1] while converting the data
+    this->m_NormalizeOnRead = this->m_Opt->m_RegFlags.applyrescaling
+                           && this->m_Opt->m_ReadWriteFlags.rescaleonread;
+    this->m_IntensityMin.clear();
+    this->m_IntensityMax.clear();
+
     ierr = this->Read(x, filenames); CHKERRQ(ierr);
 
     this->m_TemplateImage.read = false;
 
-    ierr = VecMin(*x, NULL, &minval); CHKERRQ(ierr);
-    ierr = VecMax(*x, NULL, &maxval); CHKERRQ(ierr);
+    if (this->m_NormalizeOnRead) {
+        ierr = this->ApplyNormalization(*x, minval, maxval); CHKERRQ(ierr);
+        this->m_Opt->m_ReadWriteFlags.normalizedtemp = true;
+    } else {
+        ierr = VecMin(*x, NULL, &minval); CHKERRQ(ierr);
+        ierr = VecMax(*x, NULL, &maxval); CHKERRQ(ierr);
+    }
+    this->m_NormalizeOnRead = false;
     this->m_TemplateImage.minval = minval;
     this->m_TemplateImage.maxval = maxval;
 
@@ -327,30 +664,63 @@ PetscErrorCode ReadWriteReg::ReadT(Vec* x, std::vector< std::string > filenames)
 PetscErrorCode ReadWriteReg::Read(Vec* x, std::vector< std::string > filenames) {
     PetscErrorCode ierr = 0;
     std::string file, filename;
-    IntType nc, nl, ng;
+    IntType nc, nl, ng, nfiles, nlx;
+    bool readnii;
     std::stringstream ss;
     Vec xk = NULL;
     ScalarType *p_x = NULL, *p_xk = NULL;
+    bool normalize;
     PetscFunctionBegin;
 
     this->m_Opt->Enter(__func__);
 
     //ierr = Assert(!filename.empty(), "filename not set"); CHKERRQ(ierr);
 
+    // a single file may hold all components (4D nifti image)
     nc = this->m_Opt->m_Domain.nc;
-    ierr = Assert(filenames.size() == static_cast<unsigned int>(nc), "size mismatch"); CHKERRQ(ierr);
+    nfiles = static_cast<IntType>(filenames.size());
+    ierr = Assert(nfiles == nc || nfiles == 1, "size mismatch"); CHKERRQ(ierr);
+
+    // check if all components are nifti images; if so, we read
+    // all components at once (concurrently)
+    readnii = nfiles > 1;
+    for (IntType k = 0; k < nfiles; ++k) {
+        ss << "file " << filenames[k] << " does not exist";
+        ierr = Assert(FileExists(filenames[k]), ss.str()); CHKERRQ(ierr);
+        ss.clear(); ss.str(std::string());
+        if (filenames[k].find(".nii") == std::string::npos
+            && filenames[k].find(".hdr") == std::string::npos) {
+            readnii = false;
+        }
+    }
+#ifndef REG_HAS_NIFTI
+    readnii = false;
+#endif
 
-    for (IntType k = 0; k < nc; ++k) {
+    if (readnii) {
+#ifdef REG_HAS_NIFTI
+        if (this->m_Opt->m_Verbosity > 2) {
+            ss << "reading " << nfiles << " components";
+            ierr = DbgMsg(ss.str()); CHKERRQ(ierr);
+            ss.clear(); ss.str(std::string());
+        }
+        ierr = this->ReadNII(x, filenames); CHKERRQ(ierr);
+#endif
+    }
+
+    // components are read one by one (possibly in different
+    // formats); they are rescaled at once after reading
+    normalize = this->m_NormalizeOnRead;
+    if (nfiles > 1 && !readnii) {
+        this->m_NormalizeOnRead = false;
+    }
+
+    for (IntType k = 0; k < nfiles && !readnii; ++k) {
         filename = filenames[k];
 
         // get file name without path
         ierr = GetFileName(file, filename); CHKERRQ(ierr);
 
-        // check if file exists
-        ss << "file " << file << " does not exist";
-        ierr = Assert(FileExists(filename), ss.str()); CHKERRQ(ierr);
-        ss.clear(); ss.str(std::string());
-
         // display what we are doing
         if (this->m_Opt->m_Verbosity > 2) {
             ss << "reading " << file;
@@ -371,6 +741,22 @@ PetscErrorCode ReadWriteReg::Read(Vec* x, std::vector< std::string > filenames)
         nl = this->m_Opt->m_Domain.nl;
         ng = this->m_Opt->m_Domain.ng;
 
+        // single file: we keep the vector we have read (no copy;
+        // this keeps memory mapped raw data mapped); the file has
+        // to hold all components
+        if (nfiles == 1) {
+            ierr = VecGetLocalSize(xk, &nlx); CHKERRQ(ierr);
+            ss << "number of volumes in " << file << " (" << nlx / nl
+               << ") does not match number of components (" << this->m_Opt->m_Domain.nc << ")";
+            ierr = Assert(nlx == this->m_Opt->m_Domain.nc*nl, ss.str()); CHKERRQ(ierr);
+            ss.clear(); ss.str(std::string());
+            if (*x != NULL) {
+                ierr = VecDestroy(x); CHKERRQ(ierr); *x = NULL;
+            }
+            *x = xk; xk = NULL;
+            continue;
+        }
+
         if (*x == NULL) {
             ierr = VecCreate(*x, nc*nl, nc*ng); CHKERRQ(ierr);
         }
@@ -391,6 +777,15 @@ PetscErrorCode ReadWriteReg::Read(Vec* x, std::vector< std::string > filenames)
         }
     }
 
+    this->m_NormalizeOnRead = normalize;
+
+    // check size (number of components might have been set by image)
+    ierr = VecGetLocalSize(*x, &nlx); CHKERRQ(ierr);
+    ss << "number of components does not match (" << nlx / this->m_Opt->m_Domain.nl
+       << " != " << this->m_Opt->m_Domain.nc << ")";
+    ierr = Assert(nlx == this->m_Opt->m_Domain.nc*this->m_Opt->m_Domain.nl, ss.str()); CHKERRQ(ierr);
+    ss.clear(); ss.str(std::string());
+
     this->m_Opt->Exit(__func__);
 
     PetscFunctionReturn(ierr);
@@ -463,6 +858,8 @@ PetscErrorCode ReadWriteReg::Read(Vec* x) {
 #else
         ierr = ThrowError("install nifit library/enable nifti support"); CHKERRQ(ierr);
 #endif
+    } else if (this->m_FileName.find(".craw") != std::string::npos) {
+        ierr = this->ReadRAW(x); CHKERRQ(ierr);
     } else if (this->m_FileName.find(".bin") != std::string::npos) {
         ierr = this->ReadBIN(x); CHKERRQ(ierr);
     } else if (this->m_FileName.find(".nc") != std::string::npos) {
@@ -484,7 +881,8 @@ PetscErrorCode ReadWriteReg::Read(Vec* x) {
 
 
 /********************************************************************
- * @brief read data from file
+ * @brief read data from file (if the first file is a container,
+ * all components are read from this file)
  *******************************************************************/
 PetscErrorCode ReadWriteReg::Read(VecField* v, std::string fnx1,
                                                std::string fnx2,
@@ -496,12 +894,55 @@ PetscErrorCode ReadWriteReg::Read(VecField* v, std::string fnx1,
 
     ierr = Assert(v != NULL, "null pointer"); CHKERRQ(ierr);
     ierr = Assert(!fnx1.empty(), "filename not set"); CHKERRQ(ierr);
-    ierr = Assert(!fnx2.empty(), "filename not set"); CHKERRQ(ierr);
-    ierr = Assert(!fnx3.empty(), "filename not set"); CHKERRQ(ierr);
 
-    ierr = this->Read(&v->m_X1, fnx1); CHKERRQ(ierr);
-    ierr = this->Read(&v->m_X2, fnx2); CHKERRQ(ierr);
-    ierr = this->Read(&v->m_X3, fnx3); CHKERRQ(ierr);
+    if (fnx1.find(".cvel") != std::string::npos) {
+        ierr = this->Read(v, fnx1); CHKERRQ(ierr);
+    } else {
+        ierr = Assert(!fnx2.empty(), "filename not set"); CHKERRQ(ierr);
+        ierr = Assert(!fnx3.empty(), "filename not set"); CHKERRQ(ierr);
+
+        ierr = this->Read(&v->m_X1, fnx1); CHKERRQ(ierr);
+        ierr = this->Read(&v->m_X2, fnx2); CHKERRQ(ierr);
+        ierr = this->Read(&v->m_X3, fnx3); CHKERRQ(ierr);
+    }
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief read vector field from container (*.cvel); the components
+ * of v are allocated if necessary
+ *******************************************************************/
+PetscErrorCode ReadWriteReg::Read(VecField* v, std::string filename) {
+    PetscErrorCode ierr = 0;
+    std::string file, msg;
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    ierr = Assert(v != NULL, "null pointer"); CHKERRQ(ierr);
+    ierr = Assert(!filename.empty(), "filename not set"); CHKERRQ(ierr);
+    ierr = Assert(filename.find(".cvel") != std::string::npos, "not a vector field container"); CHKERRQ(ierr);
+
+    // get file name without path
+    ierr = GetFileName(file, filename); CHKERRQ(ierr);
+
+    // check if file exists
+    msg = "file " + file + " does not exist";
+    ierr = Assert(FileExists(filename), msg); CHKERRQ(ierr);
+
+    // display what we are doing
+    if (this->m_Opt->m_Verbosity > 2) {
+        msg = "reading " + file;
+        ierr = DbgMsg(msg); CHKERRQ(ierr);
+    }
+    this->m_FileName = filename;
+    ierr = this->ReadCVEL(v); CHKERRQ(ierr);
 
     this->m_Opt->Exit(__func__);
 
@@ -713,6 +1154,9 @@ PetscErrorCode ReadWriteReg::Write(Vec x) {
     ierr = Assert(x != NULL, "null pointer"); CHKERRQ(ierr);
     ierr = Assert(!this->m_FileName.empty(), "filename not set"); CHKERRQ(ierr);
 
+    // file is (re)created below
+    ierr = this->FlushPending(this->m_FileName); CHKERRQ(ierr);
+
     if (this->m_FileName.find(".nii") != std::string::npos) {
 #ifdef REG_HAS_NIFTI
         ierr = this->WriteNII(x); CHKERRQ(ierr);
@@ -731,6 +1175,8 @@ PetscErrorCode ReadWriteReg::Write(Vec x) {
 #else
         ierr = ThrowError("install nifit library/enable nifti support"); CHKERRQ(ierr);
 #endif
+    } else if (this->m_FileName.find(".craw") != std::string::npos) {
+        ierr = this->WriteRAW(x); CHKERRQ(ierr);
     } else if (this->m_FileName.find(".bin") != std::string::npos) {
         ierr = this->WriteBIN(x); CHKERRQ(ierr);
     } else if (this->m_FileName.find(".nc") != std::string::npos) {
@@ -765,19 +1211,111 @@ PetscErrorCode ReadWriteReg::Write(VecField* v, std::string filename) {
     ierr = Assert(!filename.empty(), "filename not set"); CHKERRQ(ierr);
 
     ierr = GetFileName(path, file, ext, filename); CHKERRQ(ierr);
-    if (path.empty()) {
-        fnx1 = file + "-x1" + ext;
-        fnx2 = file + "-x2" + ext;
-        fnx3 = file + "-x3" + ext;
+
+    // all components are written to a single container
+    if (ext == ".cvel") {
+        if (this->m_Opt->m_Verbosity > 2) {
+            ierr = DbgMsg("writing " + file + ext); CHKERRQ(ierr);
+        }
+        this->m_FileName = this->m_Opt->m_FileNames.xfolder + filename;
+        ierr = this->FlushPending(this->m_FileName); CHKERRQ(ierr);
+        ierr = this->WriteCVEL(v); CHKERRQ(ierr);
+    } else {
+        if (path.empty()) {
+            fnx1 = file + "-x1" + ext;
+            fnx2 = file + "-x2" + ext;
+            fnx3 = file + "-x3" + ext;
+        } else {
+            fnx1 = path + "/" + file + "-x1" + ext;
+            fnx2 = path + "/" + file + "-x2" + ext;
+            fnx3 = path + "/" + file + "-x3" + ext;
+        }
+
+        ierr = this->Write(v->m_X1, fnx1); CHKERRQ(ierr);
+        ierr = this->Write(v->m_X2, fnx2); CHKERRQ(ierr);
+        ierr = this->Write(v->m_X3, fnx3); CHKERRQ(ierr);
+    }
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief write time series to a single file; x holds nr records
+ * (time points) that are stored one after another (each record may
+ * consist of several components); the records are written at
+ * j0,...,j0+nr-1; the file is created for j0 = 0 and extended
+ * otherwise (unlimited time dimension)
+ *******************************************************************/
+PetscErrorCode ReadWriteReg::WriteTimeSeries(Vec x, std::string filename, IntType nr, IntType j0) {
+    PetscErrorCode ierr = 0;
+    std::string msg, file, path, ext;
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    ierr = Assert(!filename.empty(), "filename not set"); CHKERRQ(ierr);
+    ierr = Assert(x != NULL, "null pointer"); CHKERRQ(ierr);
+    ierr = Assert(nr > 0 && j0 >= 0, "invalid record"); CHKERRQ(ierr);
+
+    ierr = GetFileName(path, file, ext, filename); CHKERRQ(ierr);
+    ierr = Assert(ext == ".nc", "time series are only supported for netcdf files"); CHKERRQ(ierr);
+
+    // display what we are doing
+    if (this->m_Opt->m_Verbosity > 2) {
+        msg = "writing records " + std::to_string(static_cast<long long>(j0)) + "-"
+            + std::to_string(static_cast<long long>(j0 + nr - 1)) + " of " + file + ext;
+        ierr = DbgMsg(msg); CHKERRQ(ierr);
+    }
+
+    this->m_FileName = this->m_Opt->m_FileNames.xfolder + filename;
+    ierr = this->FlushPending(this->m_FileName); CHKERRQ(ierr);
+#ifdef REG_HAS_PNETCDF
+    ierr = this->WriteTimeSeriesNC(x, nr, j0); CHKERRQ(ierr);
+#else
+    ierr = ThrowError("install pnetcdf library/enable pnetcdf support"); CHKERRQ(ierr);
+#endif
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief write record j0 of time series of vector field (one file
+ * per component)
+ *******************************************************************/
+PetscErrorCode ReadWriteReg::WriteTimeSeries(VecField* v, std::string filename, IntType j0) {
+    PetscErrorCode ierr = 0;
+    std::string fnx1, fnx2, fnx3, path, file, ext;
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    ierr = Assert(v != NULL, "null pointer"); CHKERRQ(ierr);
+    ierr = Assert(!filename.empty(), "filename not set"); CHKERRQ(ierr);
+
+    ierr = GetFileName(path, file, ext, filename); CHKERRQ(ierr);
+    if (path.empty()) {
+        fnx1 = file + "-x1" + ext;
+        fnx2 = file + "-x2" + ext;
+        fnx3 = file + "-x3" + ext;
     } else {
         fnx1 = path + "/" + file + "-x1" + ext;
         fnx2 = path + "/" + file + "-x2" + ext;
         fnx3 = path + "/" + file + "-x3" + ext;
     }
 
-    ierr = this->Write(v->m_X1, fnx1); CHKERRQ(ierr);
-    ierr = this->Write(v->m_X2, fnx2); CHKERRQ(ierr);
-    ierr = this->Write(v->m_X3, fnx3); CHKERRQ(ierr);
+    ierr = this->WriteTimeSeries(v->m_X1, fnx1, 1, j0); CHKERRQ(ierr);
+    ierr = this->WriteTimeSeries(v->m_X2, fnx2, 1, j0); CHKERRQ(ierr);
+    ierr = this->WriteTimeSeries(v->m_X3, fnx3, 1, j0); CHKERRQ(ierr);
 
     this->m_Opt->Exit(__func__);
 
@@ -788,40 +1326,377 @@ PetscErrorCode ReadWriteReg::Write(VecField* v, std::string filename) {
 
 
 /********************************************************************
- * @brief read nifty image
+ * @brief weights for resampling a periodic grid with n points to a
+ * grid with nl points (target point i is located at source point
+ * i*n/nl); for downsampling we apply a gaussian (anti-aliasing)
+ * filter with standard deviation (s-1)/2, s = n/nl; otherwise we use
+ * linear interpolation; each target point has nw weights
  *******************************************************************/
+static void ComputeResamplingWeights(IntType n, IntType nl, IntType& nw,
+                                     std::vector<IntType>& index,
+                                     std::vector<ScalarType>& weight) {
+    double s, sigma, p, w, sum;
+    IntType r, j, j0;
+
+    s = static_cast<double>(n)/static_cast<double>(nl);
+    sigma = 0.5*(s - 1.0);
+    r = sigma > 0.25 ? static_cast<IntType>(std::ceil(3.0*sigma)) : 0;
+    nw = 2*r + 2;
+
+    index.resize(nl*nw);
+    weight.resize(nl*nw);
+    for (IntType i = 0; i < nl; ++i) {
+        p = static_cast<double>(i)*s;
+        j0 = static_cast<IntType>(std::floor(p));
+        sum = 0.0;
+        for (IntType m = 0; m < nw; ++m) {
+            j = j0 - r + m;
+            if (r > 0) {
+                w = std::exp(-0.5*(j - p)*(j - p)/(sigma*sigma));
+            } else {
+                w = (m == 0) ? 1.0 - (p - j0) : p - j0;
+            }
+            index[i*nw + m] = ((j % n) + n) % n;
+            weight[i*nw + m] = static_cast<ScalarType>(w);
+            sum += w;
+        }
+        for (IntType m = 0; m < nw; ++m) {
+            weight[i*nw + m] /= static_cast<ScalarType>(sum);
+        }
+    }
+}
+
+
+
+
+/********************************************************************
+ * @brief convert raw image data to scalar type
+ *******************************************************************/
+template <typename T> static void ConvertBuffer(const char* buffer, ScalarType* x, IntType n) {
+    const T* data = reinterpret_cast<const T*>(buffer);
+    for (IntType i = 0; i < n; ++i) {
+        x[i] = static_cast<ScalarType>(data[i]);
+    }
+}
+
+
+
+
+/********************************************************************
+ * @brief resample uncompressed nifti image without holding the image
+ * in memory; the image is processed in z-slabs: every rank computes
+ * a contiguous range of target slices, reads the source slices it
+ * needs (slab plus filter overlap), filters and decimates them in x
+ * and y, and writes each target slice as soon as it is complete;
+ * filtered source slices are cached, so that overlapping slabs are
+ * read only once; memory is bounded by a few slices
+ * @param[in] ifilename input image (*.nii)
+ * @param[in] ofilename output image (*.nii)
+ * @param[in,out] nxl grid size of output (set if scale > 0)
+ * @param[in] scale scale for grid size (ignored if <= 0)
+ *******************************************************************/
+PetscErrorCode ReadWriteReg::Resample(std::string ifilename, std::string ofilename, IntType* nxl, ScalarType scale) {
+    PetscErrorCode ierr = 0;
 #ifdef REG_HAS_NIFTI
-PetscErrorCode ReadWriteReg::ReadNII(Vec* x) {
+    int rank, nprocs, rval, master = 0;
+    long long offset = 0;
+    bool success = true;
+    IntType nx[3], n2, nl2, nwx, nwy, nwz, kz0, kz1, nbyper;
+    std::string path, file, ext;
+    std::stringstream ss;
+    nifti_image *image = NULL, *oimage = NULL;
+    std::vector<IntType> ix, iy, iz;
+    std::vector<ScalarType> wx, wy, wz, source, tmp, target;
+    std::vector<char> buffer;
+    std::map<IntType, std::vector<ScalarType> > cache;
+    MPI_File ifile, ofile;
+    MPI_Status status;
+    double h[3];
+#endif
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+#ifdef REG_HAS_NIFTI
+    MPI_Comm_rank(PETSC_COMM_WORLD, &rank);
+    MPI_Comm_size(PETSC_COMM_WORLD, &nprocs);
+
+    // we need random access to the slices of the image
+    ierr = GetFileName(path, file, ext, ifilename); CHKERRQ(ierr);
+    ierr = Assert(ext == ".nii", "streamed resampling requires uncompressed nifti input (*.nii)"); CHKERRQ(ierr);
+    ierr = GetFileName(path, file, ext, ofilename); CHKERRQ(ierr);
+    ierr = Assert(ext == ".nii", "streamed resampling requires uncompressed nifti output (*.nii)"); CHKERRQ(ierr);
+
+    // read header (all ranks)
+    image = nifti_image_read(ifilename.c_str(), false);
+    ss << "could not read image " << ifilename;
+    ierr = Assert(image != NULL, ss.str()); CHKERRQ(ierr);
+    ss.clear(); ss.str(std::string());
+    ierr = Assert(image->nifti_type == NIFTI_FTYPE_NIFTI1_1, "single file nifti image required"); CHKERRQ(ierr);
+    ierr = Assert(image->nt*image->nu*image->nv*image->nw == 1, "multi-volume images not supported"); CHKERRQ(ierr);
+
+    nx[2] = static_cast<IntType>(image->nx);
+    nx[1] = static_cast<IntType>(image->ny);
+    nx[0] = static_cast<IntType>(image->nz);
+    nbyper = static_cast<IntType>(image->nbyper);
+    for (int i = 0; i < 3; ++i) {
+        if (scale > 0) {
+            nxl[i] = static_cast<IntType>(std::ceil(scale*static_cast<ScalarType>(nx[i])));
+        }
+        ierr = Assert(nxl[i] > 0, "invalid grid size"); CHKERRQ(ierr);
+        h[i] = static_cast<double>(nx[i])/static_cast<double>(nxl[i]);
+    }
+    n2  = nx[1]*nx[2];
+    nl2 = nxl[1]*nxl[2];
+
+    if (this->m_Opt->m_Verbosity > 1) {
+        ss << "streamed resampling: (" << nx[0] << "," << nx[1] << "," << nx[2] << ")"
+           << " -> (" << nxl[0] << "," << nxl[1] << "," << nxl[2] << ")";
+        ierr = DbgMsg(ss.str()); CHKERRQ(ierr);
+        ss.clear(); ss.str(std::string());
+    }
+
+    // weights for all directions (x3 is the fastest index)
+    ComputeResamplingWeights(nx[2], nxl[2], nwx, ix, wx);
+    ComputeResamplingWeights(nx[1], nxl[1], nwy, iy, wy);
+    ComputeResamplingWeights(nx[0], nxl[0], nwz, iz, wz);
+
+    // write header of output image on master rank
+    ierr = this->FlushPending(ofilename); CHKERRQ(ierr);
+    if (rank == master) {
+        oimage = nifti_copy_nim_info(image);
+        oimage->dim[1] = oimage->nx = static_cast<int>(nxl[2]);
+        oimage->dim[2] = oimage->ny = static_cast<int>(nxl[1]);
+        oimage->dim[3] = oimage->nz = static_cast<int>(nxl[0]);
+        oimage->pixdim[1] = oimage->dx = static_cast<float>(image->dx*h[2]);
+        oimage->pixdim[2] = oimage->dy = static_cast<float>(image->dy*h[1]);
+        oimage->pixdim[3] = oimage->dz = static_cast<float>(image->dz*h[0]);
+        for (int i = 0; i < 3; ++i) {
+            oimage->sto_xyz.m[i][0] *= static_cast<float>(h[2]);
+            oimage->sto_xyz.m[i][1] *= static_cast<float>(h[1]);
+            oimage->sto_xyz.m[i][2] *= static_cast<float>(h[0]);
+        }
+#if defined(PETSC_USE_REAL_SINGLE)
+        oimage->datatype = NIFTI_TYPE_FLOAT32;
+#else
+        oimage->datatype = NIFTI_TYPE_FLOAT64;
+#endif
+        oimage->nbyper = sizeof(ScalarType);
+        oimage->nvox = static_cast<size_t>(nxl[0]*nl2);
+        oimage->data = NULL;
+        if (nifti_set_filenames(oimage, ofilename.c_str(), 0, 1) != 0) {
+            ierr = ThrowError("could not set file name " + ofilename); CHKERRQ(ierr);
+        }
+        nifti_set_iname_offset(oimage);
+        offset = static_cast<long long>(oimage->iname_offset);
+        success = CreateOutputFile(ofilename, static_cast<off_t>(offset)
+                                 + static_cast<off_t>(oimage->nvox*oimage->nbyper));
+        if (success) nifti_image_write_hdr_img(oimage, 0, "r+b");
+        nifti_image_free(oimage); oimage = NULL;
+        ierr = Assert(success, "could not create file " + ofilename); CHKERRQ(ierr);
+    }
+    rval = MPI_Bcast(&offset, 1, MPI_LONG_LONG, master, PETSC_COMM_WORLD);
+    ierr = MPIERRQ(rval); CHKERRQ(ierr);
+
+    rval = MPI_File_open(PETSC_COMM_WORLD, image->iname, MPI_MODE_RDONLY, MPI_INFO_NULL, &ifile);
+    ierr = Assert(rval == MPI_SUCCESS, "could not open file " + ifilename); CHKERRQ(ierr);
+    rval = MPI_File_open(PETSC_COMM_WORLD, ofilename.c_str(), MPI_MODE_WRONLY, MPI_INFO_NULL, &ofile);
+    ierr = Assert(rval == MPI_SUCCESS, "could not open file " + ofilename); CHKERRQ(ierr);
+
+    // allocate buffers (a few slices)
+    try {
+        buffer.resize(n2*nbyper);
+        source.resize(n2);
+        tmp.resize(nx[1]*nxl[2]);
+        target.resize(nl2);
+    } catch (std::bad_alloc& err) {
+        ierr = reg::ThrowError(err); CHKERRQ(ierr);
+    }
+
+    // target slices of this rank
+    kz0 = (nxl[0]*rank)/nprocs;
+    kz1 = (nxl[0]*(rank + 1))/nprocs;
+    for (IntType kz = kz0; kz < kz1; ++kz) {
+        const IntType* jz = &iz[kz*nwz];
+
+        // drop filtered source slices we do not need anymore
+        for (std::map<IntType, std::vector<ScalarType> >::iterator it = cache.begin(); it != cache.end();) {
+            if (std::find(jz, jz + nwz, it->first) == jz + nwz) {
+                cache.erase(it++);
+            } else {
+                ++it;
+            }
+        }
+
+        // read and filter source slices (x and y direction)
+        for (IntType m = 0; m < nwz; ++m) {
+            if (cache.count(jz[m]) != 0) continue;
+
+            rval = MPI_File_read_at(ifile, static_cast<MPI_Offset>(image->iname_offset) + static_cast<MPI_Offset>(jz[m]*n2*nbyper),
+                                    buffer.data(), static_cast<int>(n2*nbyper), MPI_BYTE, &status);
+            ierr = MPIERRQ(rval); CHKERRQ(ierr);
+            if ((nbyper > 1) && (image->byteorder != nifti_short_order())) {
+                nifti_swap_Nbytes(static_cast<size_t>(n2), static_cast<int>(nbyper), buffer.data());
+            }
+            switch (image->datatype) {
+                case NIFTI_TYPE_UINT8:   ConvertBuffer<unsigned char>(buffer.data(), source.data(), n2); break;
+                case NIFTI_TYPE_INT8:    ConvertBuffer<char>(buffer.data(), source.data(), n2); break;
+                case NIFTI_TYPE_UINT16:  ConvertBuffer<unsigned short>(buffer.data(), source.data(), n2); break;
+                case NIFTI_TYPE_INT16:   ConvertBuffer<short>(buffer.data(), source.data(), n2); break;
+                case NIFTI_TYPE_UINT32:  ConvertBuffer<unsigned int>(buffer.data(), source.data(), n2); break;
+                case NIFTI_TYPE_INT32:   ConvertBuffer<int>(buffer.data(), source.data(), n2); break;
+                case NIFTI_TYPE_FLOAT32: ConvertBuffer<float>(buffer.data(), source.data(), n2); break;
+                case NIFTI_TYPE_FLOAT64: ConvertBuffer<double>(buffer.data(), source.data(), n2); break;
+                default:
+                {
+                    ierr = ThrowError("image data not supported"); CHKERRQ(ierr);
+                    break;
+                }
+            }
+
+            std::vector<ScalarType>& filtered = cache[jz[m]];
+            try {filtered.resize(nl2);}
+            catch (std::bad_alloc& err) {
+                ierr = reg::ThrowError(err); CHKERRQ(ierr);
+            }
+
+#pragma omp parallel for
+            for (IntType j = 0; j < nx[1]; ++j) {
+                for (IntType i = 0; i < nxl[2]; ++i) {
+                    ScalarType value = 0.0;
+                    for (IntType q = 0; q < nwx; ++q) {
+                        value += wx[i*nwx + q]*source[j*nx[2] + ix[i*nwx + q]];
+                    }
+                    tmp[j*nxl[2] + i] = value;
+                }
+            }
+#pragma omp parallel for
+            for (IntType j = 0; j < nxl[1]; ++j) {
+                for (IntType i = 0; i < nxl[2]; ++i) {
+                    ScalarType value = 0.0;
+                    for (IntType q = 0; q < nwy; ++q) {
+                        value += wy[j*nwy + q]*tmp[iy[j*nwy + q]*nxl[2] + i];
+                    }
+                    filtered[j*nxl[2] + i] = value;
+                }
+            }
+        }
+
+        // filter in z direction
+        std::fill(target.begin(), target.end(), 0.0);
+        for (IntType m = 0; m < nwz; ++m) {
+            const ScalarType w = wz[kz*nwz + m];
+            const ScalarType* p_s = cache[jz[m]].data();
+#pragma omp parallel for
+            for (IntType l = 0; l < nl2; ++l) {
+                target[l] += w*p_s[l];
+            }
+        }
+
+        // write target slice
+        rval = MPI_File_write_at(ofile, static_cast<MPI_Offset>(offset) + static_cast<MPI_Offset>(kz*nl2*sizeof(ScalarType)),
+                                 target.data(), static_cast<int>(nl2), MPIU_SCALAR, &status);
+        ierr = MPIERRQ(rval); CHKERRQ(ierr);
+    }
+
+    rval = MPI_File_close(&ifile);
+    ierr = MPIERRQ(rval); CHKERRQ(ierr);
+    rval = MPI_File_close(&ofile);
+    ierr = MPIERRQ(rval); CHKERRQ(ierr);
+
+    nifti_image_free(image); image = NULL;
+#else
+    ierr = ThrowError("install nifit library/enable nifti support"); CHKERRQ(ierr);
+#endif
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief hints for parallel (mpi-io) output; we enable collective
+ * buffering (data is aggregated on a subset of ranks before it is
+ * written) and set the striping of the file (only used when the file
+ * is created; one aggregator per stripe)
+ *******************************************************************/
+PetscErrorCode ReadWriteReg::GetIOHints(MPI_Info* info) {
+    PetscErrorCode ierr = 0;
+    int rval;
+    IntType nstripes, stripesize;
+    std::string value;
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    nstripes = this->m_Opt->m_ReadWriteFlags.iostripes;
+    stripesize = this->m_Opt->m_ReadWriteFlags.iostripesize*1024*1024;
+
+    rval = MPI_Info_create(info);
+    ierr = MPIERRQ(rval); CHKERRQ(ierr);
+
+    // collective buffering
+    MPI_Info_set(*info, "romio_cb_write", "enable");
+    MPI_Info_set(*info, "romio_cb_read", "enable");
+    MPI_Info_set(*info, "romio_ds_write", "disable");
+
+    // striping
+    if (nstripes > 0) {
+        value = std::to_string(static_cast<long long>(nstripes));
+        MPI_Info_set(*info, "striping_factor", value.c_str());
+        MPI_Info_set(*info, "cb_nodes", value.c_str());
+    }
+    if (stripesize > 0) {
+        value = std::to_string(static_cast<long long>(stripesize));
+        MPI_Info_set(*info, "striping_unit", value.c_str());
+        MPI_Info_set(*info, "cb_buffer_size", value.c_str());
+        // align variables with stripes (pnetcdf)
+        MPI_Info_set(*info, "nc_var_align_size", value.c_str());
+    }
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief read header of nifty image (on all ranks), check the grid
+ * size and do the setup (if necessary); the header of the first
+ * reference/template image is kept (used for output)
+ *******************************************************************/
+#ifdef REG_HAS_NIFTI
+PetscErrorCode ReadWriteReg::ReadNIIHeader(nifti_image** image, std::string filename) {
     PetscErrorCode ierr = 0;
     std::string file;
     std::stringstream ss;
-    int rank, rval;
-    IntType ng, nl, nglobal, nx[3];
-    ScalarType *p_x = NULL;
-    nifti_image *image = NULL;
+    IntType ng, nglobal, nx[3];
 
     PetscFunctionBegin;
 
     this->m_Opt->Enter(__func__);
 
-    MPI_Comm_rank(PETSC_COMM_WORLD, &rank);
-
     // get file name without path
-    ierr = GetFileName(file, this->m_FileName); CHKERRQ(ierr);
+    ierr = GetFileName(file, filename); CHKERRQ(ierr);
 
     // read header file
-    image = nifti_image_read(this->m_FileName.c_str(), false);
+    *image = nifti_image_read(filename.c_str(), false);
     ss << "could not read image " + file;
-    ierr = Assert(image != NULL, ss.str()); CHKERRQ(ierr);
+    ierr = Assert(*image != NULL, ss.str()); CHKERRQ(ierr);
     ss.clear(); ss.str(std::string());
 
     // get number of grid points
-//    nx[0] = static_cast<IntType>(image->nx);
-//    nx[1] = static_cast<IntType>(image->ny);
-//    nx[2] = static_cast<IntType>(image->nz);
-    nx[2] = static_cast<IntType>(image->nx);
-    nx[1] = static_cast<IntType>(image->ny);
-    nx[0] = static_cast<IntType>(image->nz);
+//    nx[0] = static_cast<IntType>((*image)->nx);
+//    nx[1] = static_cast<IntType>((*image)->ny);
+//    nx[2] = static_cast<IntType>((*image)->nz);
+    nx[2] = static_cast<IntType>((*image)->nx);
+    nx[1] = static_cast<IntType>((*image)->ny);
+    nx[0] = static_cast<IntType>((*image)->nz);
 
     if (this->m_ReferenceImage.read) {
         if (this->m_Opt->m_Verbosity > 2) {
@@ -830,7 +1705,7 @@ PetscErrorCode ReadWriteReg::ReadNII(Vec* x) {
             ss.clear(); ss.str(std::string());
         }
         if (this->m_ReferenceImage.data == NULL) {
-            this->m_ReferenceImage.data = image;
+            this->m_ReferenceImage.data = *image;
             this->m_ReferenceImage.nx[0] = nx[0];
             this->m_ReferenceImage.nx[1] = nx[1];
             this->m_ReferenceImage.nx[2] = nx[2];
@@ -847,7 +1722,7 @@ PetscErrorCode ReadWriteReg::ReadNII(Vec* x) {
         }
 
         if (this->m_TemplateImage.data == NULL) {
-            this->m_TemplateImage.data = image;
+            this->m_TemplateImage.data = *image;
             this->m_TemplateImage.nx[0] = nx[0];
             this->m_TemplateImage.nx[1] = nx[1];
             this->m_TemplateImage.nx[2] = nx[2];
@@ -890,44 +1765,37 @@ PetscErrorCode ReadWriteReg::ReadNII(Vec* x) {
         ierr = this->m_Opt->DoSetup(); CHKERRQ(ierr);
     }
 
-    // get local size
-    nl = this->m_Opt->m_Domain.nl;
-    ng = this->m_Opt->m_Domain.ng;
-
     //check global size
+    ng = this->m_Opt->m_Domain.ng;
     nglobal = 1;
     for (int i = 0; i < 3; ++i) {
         nglobal *= nx[i];
     }
     ierr = Assert(ng == nglobal, "problem in setup"); CHKERRQ(ierr);
 
-    // allocate vector
-    if (*x != NULL) {
-        ierr = VecDestroy(x); CHKERRQ(ierr); *x = NULL;
-    }
-    ierr = VecCreate(*x, nl, ng); CHKERRQ(ierr);
+    this->m_Opt->Exit(__func__);
 
-    // compute offset and number of entries to send
-    ierr = this->CollectSizes(); CHKERRQ(ierr);
+    PetscFunctionReturn(ierr);
+}
+#endif
 
-    // read the image data
-    if (rank == 0) {
-        ierr = this->ReadNII(image); CHKERRQ(ierr);
-    }
 
-    ierr = VecGetArray(*x, &p_x); CHKERRQ(ierr);
-    rval = MPI_Scatterv(this->m_Data, this->m_nSend, this->m_nOffset, MPIU_SCALAR, p_x, nl, MPIU_SCALAR, 0, PETSC_COMM_WORLD);
-    ierr = MPIERRQ(rval); CHKERRQ(ierr);
-    ierr = VecRestoreArray(*x, &p_x); CHKERRQ(ierr);
 
-    if (!this->m_ReferenceImage.read && !this->m_TemplateImage.read) {
-        if (image != NULL) {
-            nifti_image_free(image); image = NULL;
+
+/********************************************************************
+ * @brief free header of nifty image (unless we keep it for output)
+ *******************************************************************/
+#ifdef REG_HAS_NIFTI
+PetscErrorCode ReadWriteReg::FreeNIIHeader(nifti_image** image) {
+    PetscFunctionBegin;
+
+    if (*image != NULL) {
+        if ((*image != this->m_ReferenceImage.data) && (*image != this->m_TemplateImage.data)) {
+            nifti_image_free(*image);
         }
+        *image = NULL;
     }
 
-    this->m_Opt->Exit(__func__);
-
     PetscFunctionReturn(0);
 }
 #endif
@@ -936,32 +1804,243 @@ PetscErrorCode ReadWriteReg::ReadNII(Vec* x) {
 
 
 /********************************************************************
- * @brief read nifty image with right component type
+ * @brief check if nifty image can be read collectively (uncompressed
+ * single file images); every rank reads its own part of the image
  *******************************************************************/
 #ifdef REG_HAS_NIFTI
-PetscErrorCode ReadWriteReg::ReadNII(nifti_image* image) {
-    PetscErrorCode ierr;
-    DataType datatype = DOUBLE;
-    std::string msg;
-    int rank;
+bool ReadWriteReg::IsParallelReadable(nifti_image* image) {
+    return (image->nifti_type == NIFTI_FTYPE_NIFTI1_1)
+        && (nifti_is_gzfile(image->iname) == 0);
+}
+#endif
+
+
+
+
+/********************************************************************
+ * @brief read nifty image; the image may hold several volumes (4D
+ * image; one volume per component)
+ *******************************************************************/
+#ifdef REG_HAS_NIFTI
+PetscErrorCode ReadWriteReg::ReadNII(Vec* x) {
+    PetscErrorCode ierr = 0;
+    std::stringstream ss;
+    int rank, rval;
+    IntType ng, nl, nvol;
+    ScalarType *p_x = NULL;
+    nifti_image *image = NULL;
+    std::vector<ScalarType> range;
+    bool reduce = false;
 
     PetscFunctionBegin;
 
     this->m_Opt->Enter(__func__);
 
     MPI_Comm_rank(PETSC_COMM_WORLD, &rank);
-    msg = "should only be called on master/root rank";
-    ierr = Assert(rank == 0, msg); CHKERRQ(ierr);
 
-    switch (image->datatype) {
-        case NIFTI_TYPE_UINT8:
-        {
-            if (this->m_Opt->m_Verbosity > 2) {
-                ierr = DbgMsg("reading data of type uint8 (uchar)"); CHKERRQ(ierr);
-            }
-            datatype = UCHAR;
-            ierr = this->ReadNII<unsigned char>(image); CHKERRQ(ierr);
-            break;
+    ierr = this->ReadNIIHeader(&image, this->m_FileName); CHKERRQ(ierr);
+
+    // get local size
+    nl = this->m_Opt->m_Domain.nl;
+    ng = this->m_Opt->m_Domain.ng;
+
+    // number of volumes (components)
+    nvol = static_cast<IntType>(image->nt*image->nu*image->nv*image->nw);
+    if (nvol > 1) {
+        if (this->m_Opt->m_Domain.nc == 1) {
+            this->m_Opt->m_Domain.nc = nvol;
+        }
+        ss << "number of volumes in image (" << nvol << ") does not match number of components";
+        ierr = Assert(this->m_Opt->m_Domain.nc == nvol, ss.str()); CHKERRQ(ierr);
+        ss.clear(); ss.str(std::string());
+    }
+
+    // allocate vector
+    if (*x != NULL) {
+        ierr = VecDestroy(x); CHKERRQ(ierr); *x = NULL;
+    }
+    ierr = VecCreate(*x, nvol*nl, nvol*ng); CHKERRQ(ierr);
+
+    // intensity range of all volumes (see AddIntensityRange)
+    try {range.assign(2*nvol, std::numeric_limits<ScalarType>::lowest());}
+    catch (std::bad_alloc& err) {
+        ierr = reg::ThrowError(err); CHKERRQ(ierr);
+    }
+
+    // uncompressed single file nifti images are read in parallel; every
+    // rank reads its own part of the image; all other formats are read
+    // on the master rank and distributed
+    if (this->IsParallelReadable(image)) {
+        ierr = this->ReadNIIParallel(image, *x, range.data()); CHKERRQ(ierr);
+    } else {
+        // compute offset and number of entries to send
+        ierr = this->CollectSizes(); CHKERRQ(ierr);
+
+        // read the image data
+        if (rank == 0) {
+            ierr = this->ReadNII(image, range.data()); CHKERRQ(ierr);
+        }
+        reduce = true;
+
+        ierr = VecGetArray(*x, &p_x); CHKERRQ(ierr);
+        for (IntType k = 0; k < nvol; ++k) {
+            rval = MPI_Scatterv(rank == 0 ? this->m_Data + k*ng : NULL, this->m_nSend, this->m_nOffset, MPIU_SCALAR,
+                                p_x + k*nl, nl, MPIU_SCALAR, 0, PETSC_COMM_WORLD);
+            ierr = MPIERRQ(rval); CHKERRQ(ierr);
+        }
+        ierr = VecRestoreArray(*x, &p_x); CHKERRQ(ierr);
+
+        // buffer is larger than a single volume
+        if ((nvol > 1) && (this->m_Data != NULL)) {
+            delete [] this->m_Data; this->m_Data = NULL;
+        }
+    }
+
+    if (this->m_NormalizeOnRead) {
+        ierr = this->AddIntensityRange(range, reduce); CHKERRQ(ierr);
+    }
+
+    ierr = this->FreeNIIHeader(&image); CHKERRQ(ierr);
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(0);
+}
+#endif
+
+
+
+
+/********************************************************************
+ * @brief read multi-component image (one file per component); the
+ * components that cannot be read collectively are read by different
+ * ranks (component k is read by rank k mod nprocs) and distributed
+ * with nonblocking scatters, so that the files are read concurrently
+ *******************************************************************/
+#ifdef REG_HAS_NIFTI
+PetscErrorCode ReadWriteReg::ReadNII(Vec* x, std::vector<std::string> filenames) {
+    PetscErrorCode ierr = 0;
+    int rank, nprocs, rval, root;
+    IntType ng, nl, nc;
+    ScalarType *p_x = NULL, *p_xk = NULL, rangek[2] = {0.0, 0.0};
+    Vec xk = NULL;
+    std::vector<nifti_image*> images;
+    std::vector<ScalarType*> buffers;
+    std::vector<ScalarType> range;
+    std::vector<MPI_Request> requests;
+
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    MPI_Comm_rank(PETSC_COMM_WORLD, &rank);
+    MPI_Comm_size(PETSC_COMM_WORLD, &nprocs);
+
+    nc = static_cast<IntType>(filenames.size());
+    try {
+        images.assign(nc, NULL);
+        buffers.assign(nc, NULL);
+        range.assign(2*nc, std::numeric_limits<ScalarType>::lowest());
+        requests.assign(nc, MPI_REQUEST_NULL);
+    } catch (std::bad_alloc& err) {
+        ierr = reg::ThrowError(err); CHKERRQ(ierr);
+    }
+
+    // read headers (all ranks)
+    for (IntType k = 0; k < nc; ++k) {
+        ierr = this->ReadNIIHeader(&images[k], filenames[k]); CHKERRQ(ierr);
+        ierr = Assert(images[k]->nt*images[k]->nu*images[k]->nv*images[k]->nw == 1,
+                      "multi-volume images not supported for multi-component input"); CHKERRQ(ierr);
+    }
+
+    nl = this->m_Opt->m_Domain.nl;
+    ng = this->m_Opt->m_Domain.ng;
+
+    // allocate vector
+    if (*x != NULL) {
+        ierr = VecDestroy(x); CHKERRQ(ierr); *x = NULL;
+    }
+    ierr = VecCreate(*x, nc*nl, nc*ng); CHKERRQ(ierr);
+
+    // compute offset and number of entries to send
+    ierr = this->CollectSizes(); CHKERRQ(ierr);
+
+    ierr = VecGetArray(*x, &p_x); CHKERRQ(ierr);
+    for (IntType k = 0; k < nc; ++k) {
+        if (this->IsParallelReadable(images[k])) {
+            // collective read
+            ierr = VecCreate(xk, nl, ng); CHKERRQ(ierr);
+            this->m_FileName = filenames[k];
+            ierr = this->ReadNIIParallel(images[k], xk, rangek); CHKERRQ(ierr);
+            range[k] = rangek[0]; range[nc + k] = rangek[1];
+            ierr = VecGetArray(xk, &p_xk); CHKERRQ(ierr);
+            try {std::copy(p_xk, p_xk+nl, p_x+k*nl);}
+            catch (std::exception& err) {
+                ierr = ThrowError(err); CHKERRQ(ierr);
+            }
+            ierr = VecRestoreArray(xk, &p_xk); CHKERRQ(ierr);
+            ierr = VecDestroy(&xk); CHKERRQ(ierr); xk = NULL;
+        } else {
+            // read on root rank of this component and distribute
+            root = static_cast<int>(k % nprocs);
+            if (rank == root) {
+                this->m_FileName = filenames[k];
+                ierr = this->ReadNII(images[k], rangek); CHKERRQ(ierr);
+                range[k] = rangek[0]; range[nc + k] = rangek[1];
+                buffers[k] = this->m_Data; this->m_Data = NULL;
+            }
+            rval = MPI_Iscatterv(buffers[k], this->m_nSend, this->m_nOffset, MPIU_SCALAR,
+                                 p_x + k*nl, nl, MPIU_SCALAR, root, PETSC_COMM_WORLD, &requests[k]);
+            ierr = MPIERRQ(rval); CHKERRQ(ierr);
+        }
+    }
+    rval = MPI_Waitall(static_cast<int>(nc), requests.data(), MPI_STATUSES_IGNORE);
+    ierr = MPIERRQ(rval); CHKERRQ(ierr);
+    ierr = VecRestoreArray(*x, &p_x); CHKERRQ(ierr);
+
+    // the range of a component is only known on its root rank
+    if (this->m_NormalizeOnRead) {
+        ierr = this->AddIntensityRange(range, true); CHKERRQ(ierr);
+    }
+
+    // clean up
+    for (IntType k = 0; k < nc; ++k) {
+        if (buffers[k] != NULL) {delete [] buffers[k]; buffers[k] = NULL;}
+        ierr = this->FreeNIIHeader(&images[k]); CHKERRQ(ierr);
+    }
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+#endif
+
+
+
+
+/********************************************************************
+ * @brief read nifty image with right component type (the entire
+ * image is read by the calling rank)
+ *******************************************************************/
+#ifdef REG_HAS_NIFTI
+PetscErrorCode ReadWriteReg::ReadNII(nifti_image* image, ScalarType* range) {
+    PetscErrorCode ierr;
+    DataType datatype = DOUBLE;
+    std::string msg;
+
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    switch (image->datatype) {
+        case NIFTI_TYPE_UINT8:
+        {
+            if (this->m_Opt->m_Verbosity > 2) {
+                ierr = DbgMsg("reading data of type uint8 (uchar)"); CHKERRQ(ierr);
+            }
+            datatype = UCHAR;
+            ierr = this->ReadNII<unsigned char>(image, range); CHKERRQ(ierr);
+            break;
         }
         case NIFTI_TYPE_INT8:
         {
@@ -969,7 +2048,7 @@ PetscErrorCode ReadWriteReg::ReadNII(nifti_image* image) {
                 ierr = DbgMsg("reading data of type int8 (char)"); CHKERRQ(ierr);
             }
             datatype = CHAR;
-            ierr = this->ReadNII<char>(image); CHKERRQ(ierr);
+            ierr = this->ReadNII<char>(image, range); CHKERRQ(ierr);
             break;
         }
         case NIFTI_TYPE_UINT16:
@@ -978,7 +2057,7 @@ PetscErrorCode ReadWriteReg::ReadNII(nifti_image* image) {
                 ierr = DbgMsg("reading data of type uint16 (unsigned short)"); CHKERRQ(ierr);
             }
             datatype = USHORT;
-            ierr = this->ReadNII<unsigned short>(image); CHKERRQ(ierr);
+            ierr = this->ReadNII<unsigned short>(image, range); CHKERRQ(ierr);
             break;
         }
         case NIFTI_TYPE_INT16:
@@ -987,7 +2066,7 @@ PetscErrorCode ReadWriteReg::ReadNII(nifti_image* image) {
                 ierr = DbgMsg("reading data of type int16 (short)"); CHKERRQ(ierr);
             }
             datatype = SHORT;
-            ierr = this->ReadNII<short>(image); CHKERRQ(ierr);
+            ierr = this->ReadNII<short>(image, range); CHKERRQ(ierr);
             break;
         }
         case NIFTI_TYPE_UINT32:
@@ -996,7 +2075,7 @@ PetscErrorCode ReadWriteReg::ReadNII(nifti_image* image) {
                 ierr = DbgMsg("reading data of type uint32 (unsigned int)"); CHKERRQ(ierr);
             }
             datatype = UINT;
-            ierr = this->ReadNII<unsigned int>(image); CHKERRQ(ierr);
+            ierr = this->ReadNII<unsigned int>(image, range); CHKERRQ(ierr);
             break;
         }
         case NIFTI_TYPE_INT32:
@@ -1005,7 +2084,7 @@ PetscErrorCode ReadWriteReg::ReadNII(nifti_image* image) {
                 ierr = DbgMsg("reading data of type int32 (int)"); CHKERRQ(ierr);
             }
             datatype = INT;
-            ierr = this->ReadNII<int>(image); CHKERRQ(ierr);
+            ierr = this->ReadNII<int>(image, range); CHKERRQ(ierr);
             break;
         }
         case NIFTI_TYPE_FLOAT32:
@@ -1014,7 +2093,7 @@ PetscErrorCode ReadWriteReg::ReadNII(nifti_image* image) {
                 ierr = DbgMsg("reading data of type float32 (float)"); CHKERRQ(ierr);
             }
             datatype = FLOAT;
-            ierr = this->ReadNII<float>(image); CHKERRQ(ierr);
+            ierr = this->ReadNII<float>(image, range); CHKERRQ(ierr);
             break;
         }
         case NIFTI_TYPE_FLOAT64:
@@ -1023,7 +2102,7 @@ PetscErrorCode ReadWriteReg::ReadNII(nifti_image* image) {
                 ierr = DbgMsg("reading data of type float64 (double)"); CHKERRQ(ierr);
             }
             datatype = DOUBLE;
-            ierr = this->ReadNII<double>(image); CHKERRQ(ierr);
+            ierr = this->ReadNII<double>(image, range); CHKERRQ(ierr);
             break;
         }
         default:
@@ -1053,44 +2132,89 @@ PetscErrorCode ReadWriteReg::ReadNII(nifti_image* image) {
 
 
 /********************************************************************
- * @brief get component type of NII images
+ * @brief compute range of raw intensities (before conversion)
+ *******************************************************************/
+#ifdef REG_HAS_NIFTI
+template <typename T> static void GetLocalRange(const T* data, IntType n, ScalarType& xmin, ScalarType& xmax) {
+    ScalarType lo = std::numeric_limits<ScalarType>::max();
+    ScalarType hi = std::numeric_limits<ScalarType>::lowest();
+#pragma omp parallel for reduction(min:lo) reduction(max:hi)
+    for (IntType i = 0; i < n; ++i) {
+        ScalarType value = static_cast<ScalarType>(data[i]);
+        if (value < lo) lo = value;
+        if (value > hi) hi = value;
+    }
+    xmin = lo; xmax = hi;
+}
+#endif
+
+
+
+
+/********************************************************************
+ * @brief read nifty image on current rank; the data is reordered
+ * according to the data distribution; if requested, the intensities
+ * are rescaled to [0,1] during the conversion (the range of each
+ * volume is stored in range as [-min_0,...,-min_n,max_0,...,max_n])
  *******************************************************************/
 #ifdef REG_HAS_NIFTI
-template <typename T> PetscErrorCode ReadWriteReg::ReadNII(nifti_image* image) {
+template <typename T> PetscErrorCode ReadWriteReg::ReadNII(nifti_image* image, ScalarType* range) {
     PetscErrorCode ierr = 0;
     T *data = NULL;
+    char *buffer = NULL;
+    size_t nbytes = 0;
+    bool isbgzf = false;
     std::string msg;
-    IntType ng, nx[3];
-    int rank, master = 0;
+    IntType ng, nvol, nx[3];
+    ScalarType xmin = 0.0, xmax = 1.0;
     std::stringstream ss;
 
     PetscFunctionBegin;
 
     this->m_Opt->Enter(__func__);
 
-    MPI_Comm_rank(PETSC_COMM_WORLD, &rank);
-    msg = "should only be called on master/root rank";
-    ierr = Assert(rank == master, msg); CHKERRQ(ierr);
-
-    // get number of grid points
+    // get number of grid points and number of volumes
     ng = this->m_Opt->m_Domain.ng;
+    nvol = static_cast<IntType>(image->nt*image->nu*image->nv*image->nw);
 
-    // allocate data buffer
+    // allocate data buffer (buffer for a single volume is kept)
+    if ((nvol > 1) && (this->m_Data != NULL)) {
+        delete [] this->m_Data; this->m_Data = NULL;
+    }
     if (this->m_Data == NULL) {
-        try {this->m_Data = new ScalarType[ng];}
+        try {this->m_Data = new ScalarType[nvol*ng];}
         catch (std::bad_alloc&) {
             ierr = ThrowError("allocation failed"); CHKERRQ(ierr);
         }
     }
 
-    // load the image
-    if (nifti_image_load(image) == -1) {
+    // block compressed images are decompressed in parallel;
+    // all other images are loaded by the nifti library
+    if (nifti_is_gzfile(image->iname)) {
+        ierr = IsBlockGzipFile(image->iname, isbgzf); CHKERRQ(ierr);
+    }
+
+    if (isbgzf) {
+        if (this->m_Opt->m_Verbosity > 2) {
+            ierr = DbgMsg("decompressing block compressed image"); CHKERRQ(ierr);
+        }
+        ierr = ReadBlockGzip(image->iname, &buffer, nbytes); CHKERRQ(ierr);
         msg = "could not read image " + this->m_FileName;
-        ierr = ThrowError(msg); CHKERRQ(ierr);
+        ierr = Assert(nbytes >= static_cast<size_t>(image->iname_offset) + image->nvox*sizeof(T), msg); CHKERRQ(ierr);
+        data = reinterpret_cast<T*>(buffer + image->iname_offset);
+        if ((sizeof(T) > 1) && (image->byteorder != nifti_short_order())) {
+            nifti_swap_Nbytes(image->nvox, sizeof(T), data);
+        }
+    } else {
+        // load the image
+        if (nifti_image_load(image) == -1) {
+            msg = "could not read image " + this->m_FileName;
+            ierr = ThrowError(msg); CHKERRQ(ierr);
+        }
+        data = static_cast<T*>(image->data);
     }
 
     // assign data
-    data = static_cast<T*>(image->data);
     ierr = Assert(data != NULL, "null pointer"); CHKERRQ(ierr);
 
     // get global number of points
@@ -1099,20 +2223,33 @@ template <typename T> PetscErrorCode ReadWriteReg::ReadNII(nifti_image* image) {
     nx[1] = this->m_Opt->m_Domain.nx[1];
     nx[2] = this->m_Opt->m_Domain.nx[2];
 
-    IntType k = 0;
-    for (int p = 0; p < this->m_NumProcs; ++p) {
-        for (IntType i1 = 0; i1 < this->m_iSizeC[3*p+0]; ++i1) {  // x1
-            for (IntType i2 = 0; i2 < this->m_iSizeC[3*p+1]; ++i2) {  // x2
-                for (IntType i3 = 0; i3 < this->m_iSizeC[3*p+2]; ++i3) {  // x3
-                    IntType j1 = i1 + this->m_iStartC[3*p+0];
-                    IntType j2 = i2 + this->m_iStartC[3*p+1];
-                    IntType j3 = i3 + this->m_iStartC[3*p+2];
-                    IntType l = GetLinearIndex(j1, j2, j3, nx);
-                    this->m_Data[k++] = static_cast<ScalarType>(data[l]);
-                }  // for i1
-            }  // for i2
-        }  // for i3
-    }  // for all procs
+    // reorder data according to data distribution (for each volume)
+    for (IntType v = 0; v < nvol; ++v) {
+        IntType k = v*ng;
+        if (this->m_NormalizeOnRead) {
+            GetLocalRange(&data[v*ng], ng, xmin, xmax);
+            range[v] = -xmin; range[nvol+v] = xmax;
+        }
+        for (int p = 0; p < this->m_NumProcs; ++p) {
+            for (IntType i1 = 0; i1 < this->m_iSizeC[3*p+0]; ++i1) {  // x1
+                for (IntType i2 = 0; i2 < this->m_iSizeC[3*p+1]; ++i2) {  // x2
+                    for (IntType i3 = 0; i3 < this->m_iSizeC[3*p+2]; ++i3) {  // x3
+                        IntType j1 = i1 + this->m_iStartC[3*p+0];
+                        IntType j2 = i2 + this->m_iStartC[3*p+1];
+                        IntType j3 = i3 + this->m_iStartC[3*p+2];
+                        IntType l = GetLinearIndex(j1, j2, j3, nx);
+                        ScalarType value = static_cast<ScalarType>(data[v*ng + l]);
+                        if (this->m_NormalizeOnRead) {
+                            value = NormalizeValue(value, xmin, xmax);
+                        }
+                        this->m_Data[k++] = value;
+                    }  // for i1
+                }  // for i2
+            }  // for i3
+        }  // for all procs
+    }  // for all volumes
+
+    if (buffer != NULL) {delete [] buffer; buffer = NULL;}
 
     this->m_Opt->Exit(__func__);
 
@@ -1124,85 +2261,283 @@ template <typename T> PetscErrorCode ReadWriteReg::ReadNII(nifti_image* image) {
 
 
 /********************************************************************
- * @brief write buffer to nii files
+ * @brief read nifty image in parallel (collective; uncompressed
+ * single file images only); the header has been read on all ranks
  *******************************************************************/
 #ifdef REG_HAS_NIFTI
-PetscErrorCode ReadWriteReg::WriteNII(Vec x) {
-    PetscErrorCode ierr;
-    nifti_image* image = NULL;
+PetscErrorCode ReadWriteReg::ReadNIIParallel(nifti_image* image, Vec x, ScalarType* range) {
+    PetscErrorCode ierr = 0;
+    DataType datatype = DOUBLE;
+
     PetscFunctionBegin;
 
     this->m_Opt->Enter(__func__);
 
-    // if we write the template or refernence image to file,
-    // we'll use the data we have read in; if this data has not
-    // been read, we'll pass a NULL pointer resulting in an image
-    // being allocated
-    if (this->m_TemplateImage.write) {
-        image = this->m_TemplateImage.data;
-    } else if (this->m_ReferenceImage.write) {
-        image = this->m_ReferenceImage.data;
-    } else {
-        // now we have to deal with the case that a reference
-        // image might have been read, so we want to use
-        // all the information within its header (including the
-        // orientation), but write out the data using the
-        // datatype we have used for our computations
-        if (this->m_ImageData == NULL) {   // only do this once
-            // if we have read the reference image
-            // note: the following will only be true
-            // on the master rank, because we allocate
-            // image data only there
-            if (this->m_ReferenceImage.data != NULL) {
-                this->m_ImageData = nifti_copy_nim_info(this->m_ReferenceImage.data);
-            } else {
-                if (this->m_TemplateImage.data != NULL) {
-                    this->m_ImageData = nifti_copy_nim_info(this->m_TemplateImage.data);
-                }
-            }
-            if (this->m_ImageData != NULL) {
-                // switch precision in io
-#if defined(PETSC_USE_REAL_SINGLE)
-                this->m_ImageData->datatype = NIFTI_TYPE_FLOAT32; // single precision
-#else
-                this->m_ImageData->datatype = NIFTI_TYPE_FLOAT64; // double precision
-#endif
-                this->m_ImageData->nbyper = sizeof(ScalarType);
-                // allocate image buffer
-                try {this->m_ImageData->data = new ScalarType[this->m_ImageData->nvox];}
-                catch (std::bad_alloc&) {
-                    ierr = ThrowError("allocation failed"); CHKERRQ(ierr);
-                }
-            }
+    switch (image->datatype) {
+        case NIFTI_TYPE_UINT8:
+        {
+            datatype = UCHAR;
+            ierr = this->ReadNIIParallel<unsigned char>(image, x, MPI_UNSIGNED_CHAR, range); CHKERRQ(ierr);
+            break;
+        }
+        case NIFTI_TYPE_INT8:
+        {
+            datatype = CHAR;
+            ierr = this->ReadNIIParallel<char>(image, x, MPI_SIGNED_CHAR, range); CHKERRQ(ierr);
+            break;
+        }
+        case NIFTI_TYPE_UINT16:
+        {
+            datatype = USHORT;
+            ierr = this->ReadNIIParallel<unsigned short>(image, x, MPI_UNSIGNED_SHORT, range); CHKERRQ(ierr);
+            break;
+        }
+        case NIFTI_TYPE_INT16:
+        {
+            datatype = SHORT;
+            ierr = this->ReadNIIParallel<short>(image, x, MPI_SHORT, range); CHKERRQ(ierr);
+            break;
+        }
+        case NIFTI_TYPE_UINT32:
+        {
+            datatype = UINT;
+            ierr = this->ReadNIIParallel<unsigned int>(image, x, MPI_UNSIGNED, range); CHKERRQ(ierr);
+            break;
+        }
+        case NIFTI_TYPE_INT32:
+        {
+            datatype = INT;
+            ierr = this->ReadNIIParallel<int>(image, x, MPI_INT, range); CHKERRQ(ierr);
+            break;
+        }
+        case NIFTI_TYPE_FLOAT32:
+        {
+            datatype = FLOAT;
+            ierr = this->ReadNIIParallel<float>(image, x, MPI_FLOAT, range); CHKERRQ(ierr);
+            break;
+        }
+        case NIFTI_TYPE_FLOAT64:
+        {
+            datatype = DOUBLE;
+            ierr = this->ReadNIIParallel<double>(image, x, MPI_DOUBLE, range); CHKERRQ(ierr);
+            break;
+        }
+        default:
+        {
+            ierr = ThrowError("image data not supported"); CHKERRQ(ierr);
+            break;
         }
-        image = this->m_ImageData;
     }
 
-    // if nifty image is null pointer default to double
-    if (image == NULL) {
-        ierr = this->WriteNII<ScalarType>(&image, x); CHKERRQ(ierr);
-    } else {
-        switch (image->datatype) {
-            case NIFTI_TYPE_UINT8:
-            {
-                ierr = this->WriteNII<unsigned char>(&image, x); CHKERRQ(ierr);
-                break;
-            }
-            case NIFTI_TYPE_INT8:
-            {
-                ierr = this->WriteNII<char>(&image, x); CHKERRQ(ierr);
-                break;
-            }
-            case NIFTI_TYPE_UINT16:
-            {
-                ierr = this->WriteNII<unsigned short>(&image, x); CHKERRQ(ierr);
-                break;
-            }
-            case NIFTI_TYPE_INT16:
-            {
-                ierr = this->WriteNII<short>(&image, x); CHKERRQ(ierr);
-                break;
-            }
+    // if we read the reference image and the template
+    // image we have to remember the data type
+    if (this->m_ReferenceImage.read) {
+        this->m_ReferenceImage.datatype = datatype;
+    }
+
+    if (this->m_TemplateImage.read) {
+        this->m_TemplateImage.datatype = datatype;
+    }
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+#endif
+
+
+
+
+/********************************************************************
+ * @brief read local part of nifty image with MPI-IO; the voxels
+ * are stored with x fastest, i.e., the file is a row major array of
+ * size (nz,ny,nx) = (nx[0],nx[1],nx[2]), which is the layout of the
+ * (pencil) decomposition; we read the local block of the array
+ * with a subarray file view and convert the data locally; for 4D
+ * images, the volumes are read into consecutive blocks of x
+ *******************************************************************/
+#ifdef REG_HAS_NIFTI
+template <typename T> PetscErrorCode ReadWriteReg::ReadNIIParallel(nifti_image* image, Vec x, MPI_Datatype mpitype, ScalarType* range) {
+    PetscErrorCode ierr = 0;
+    T *data = NULL;
+    ScalarType *p_x = NULL;
+    IntType nl, nvol;
+    int rval, sizes[4], subsizes[4], starts[4];
+    std::vector<ScalarType> xrange;
+    MPI_Datatype filetype;
+    MPI_File fhandle;
+    MPI_Status status;
+    MPI_Offset offset;
+    std::string msg;
+
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    if (this->m_Opt->m_Verbosity > 2) {
+        ierr = DbgMsg("reading nifti image in parallel (mpi-io)"); CHKERRQ(ierr);
+    }
+
+    // volumes (components) are stored one after another
+    nl = this->m_Opt->m_Domain.nl;
+    nvol = static_cast<IntType>(image->nt*image->nu*image->nv*image->nw);
+    sizes[0] = static_cast<int>(nvol); subsizes[0] = sizes[0]; starts[0] = 0;
+    for (int i = 0; i < 3; ++i) {
+        sizes[i+1]    = static_cast<int>(this->m_Opt->m_Domain.nx[i]);
+        subsizes[i+1] = static_cast<int>(this->m_Opt->m_Domain.isize[i]);
+        starts[i+1]   = static_cast<int>(this->m_Opt->m_Domain.istart[i]);
+    }
+    ierr = Assert(static_cast<int>(sizeof(T)) == image->nbyper, "size mismatch"); CHKERRQ(ierr);
+
+    // allocate local buffer
+    try {data = new T[nvol*nl];}
+    catch (std::bad_alloc&) {
+        ierr = ThrowError("allocation failed"); CHKERRQ(ierr);
+    }
+
+    // local block of global array (for all volumes)
+    rval = MPI_Type_create_subarray(4, sizes, subsizes, starts, MPI_ORDER_C, mpitype, &filetype);
+    ierr = MPIERRQ(rval); CHKERRQ(ierr);
+    rval = MPI_Type_commit(&filetype);
+    ierr = MPIERRQ(rval); CHKERRQ(ierr);
+
+    // read data (collective)
+    rval = MPI_File_open(PETSC_COMM_WORLD, image->iname, MPI_MODE_RDONLY, MPI_INFO_NULL, &fhandle);
+    msg = "could not open file " + std::string(image->iname);
+    ierr = Assert(rval == MPI_SUCCESS, msg); CHKERRQ(ierr);
+
+    offset = static_cast<MPI_Offset>(image->iname_offset);
+    rval = MPI_File_set_view(fhandle, offset, mpitype, filetype, "native", MPI_INFO_NULL);
+    ierr = MPIERRQ(rval); CHKERRQ(ierr);
+
+    rval = MPI_File_read_all(fhandle, data, static_cast<int>(nvol*nl), mpitype, &status);
+    ierr = MPIERRQ(rval); CHKERRQ(ierr);
+
+    rval = MPI_File_close(&fhandle);
+    ierr = MPIERRQ(rval); CHKERRQ(ierr);
+    rval = MPI_Type_free(&filetype);
+    ierr = MPIERRQ(rval); CHKERRQ(ierr);
+
+    // data has been written on a machine with different endianness
+    if ((sizeof(T) > 1) && (image->byteorder != nifti_short_order())) {
+        nifti_swap_Nbytes(static_cast<size_t>(nvol*nl), sizeof(T), data);
+    }
+
+    // global range of intensities of each volume (single reduction)
+    if (this->m_NormalizeOnRead) {
+        xrange.resize(2*nvol);
+        for (IntType v = 0; v < nvol; ++v) {
+            ScalarType xmin, xmax;
+            GetLocalRange(&data[v*nl], nl, xmin, xmax);
+            xrange[v] = -xmin; xrange[nvol+v] = xmax;
+        }
+        rval = MPI_Allreduce(MPI_IN_PLACE, xrange.data(), static_cast<int>(2*nvol), MPIU_REAL, MPI_MAX, PETSC_COMM_WORLD);
+        ierr = MPIERRQ(rval); CHKERRQ(ierr);
+        for (IntType v = 0; v < 2*nvol; ++v) range[v] = xrange[v];
+    }
+
+    // convert to scalar type (and rescale)
+    ierr = VecGetArray(x, &p_x); CHKERRQ(ierr);
+    if (this->m_NormalizeOnRead) {
+        for (IntType v = 0; v < nvol; ++v) {
+            ScalarType xmin = -xrange[v], xmax = xrange[nvol+v];
+#pragma omp parallel for
+            for (IntType i = v*nl; i < (v+1)*nl; ++i) {
+                p_x[i] = NormalizeValue(static_cast<ScalarType>(data[i]), xmin, xmax);
+            }
+        }
+    } else {
+        for (IntType i = 0; i < nvol*nl; ++i) {
+            p_x[i] = static_cast<ScalarType>(data[i]);
+        }
+    }
+    ierr = VecRestoreArray(x, &p_x); CHKERRQ(ierr);
+
+    if (data != NULL) {delete [] data; data = NULL;}
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+#endif
+
+
+
+
+/********************************************************************
+ * @brief write buffer to nii files
+ *******************************************************************/
+#ifdef REG_HAS_NIFTI
+PetscErrorCode ReadWriteReg::WriteNII(Vec x) {
+    PetscErrorCode ierr;
+    nifti_image* image = NULL;
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    // if we write the template or refernence image to file,
+    // we'll use the data we have read in; if this data has not
+    // been read, we'll pass a NULL pointer resulting in an image
+    // being allocated
+    if (this->m_TemplateImage.write) {
+        image = this->m_TemplateImage.data;
+    } else if (this->m_ReferenceImage.write) {
+        image = this->m_ReferenceImage.data;
+    } else {
+        // now we have to deal with the case that a reference
+        // image might have been read, so we want to use
+        // all the information within its header (including the
+        // orientation), but write out the data using the
+        // datatype we have used for our computations
+        if (this->m_ImageData == NULL) {   // only do this once
+            // if we have read the reference image (the image
+            // buffer is allocated when we write the data)
+            if (this->m_ReferenceImage.data != NULL) {
+                this->m_ImageData = nifti_copy_nim_info(this->m_ReferenceImage.data);
+            } else {
+                if (this->m_TemplateImage.data != NULL) {
+                    this->m_ImageData = nifti_copy_nim_info(this->m_TemplateImage.data);
+                }
+            }
+            if (this->m_ImageData != NULL) {
+                // switch precision in io
+#if defined(PETSC_USE_REAL_SINGLE)
+                this->m_ImageData->datatype = NIFTI_TYPE_FLOAT32; // single precision
+#else
+                this->m_ImageData->datatype = NIFTI_TYPE_FLOAT64; // double precision
+#endif
+                this->m_ImageData->nbyper = sizeof(ScalarType);
+                this->m_ImageData->data = NULL;
+            }
+        }
+        image = this->m_ImageData;
+    }
+
+    // if nifty image is null pointer default to double
+    if (image == NULL) {
+        ierr = this->WriteNII<ScalarType>(&image, x); CHKERRQ(ierr);
+    } else {
+        switch (image->datatype) {
+            case NIFTI_TYPE_UINT8:
+            {
+                ierr = this->WriteNII<unsigned char>(&image, x); CHKERRQ(ierr);
+                break;
+            }
+            case NIFTI_TYPE_INT8:
+            {
+                ierr = this->WriteNII<char>(&image, x); CHKERRQ(ierr);
+                break;
+            }
+            case NIFTI_TYPE_UINT16:
+            {
+                ierr = this->WriteNII<unsigned short>(&image, x); CHKERRQ(ierr);
+                break;
+            }
+            case NIFTI_TYPE_INT16:
+            {
+                ierr = this->WriteNII<short>(&image, x); CHKERRQ(ierr);
+                break;
+            }
             case NIFTI_TYPE_UINT32:
             {
                 ierr = this->WriteNII<unsigned int>(&image, x); CHKERRQ(ierr);
@@ -1249,9 +2584,10 @@ PetscErrorCode ReadWriteReg::WriteNII(nifti_image** image, Vec x) {
     PetscErrorCode ierr;
     T* data = NULL;
     ScalarType *p_xc = NULL;
-    int nprocs, rank, rval, master = 0;
+    int nprocs, rank, rval, master = 0, parallelwrite = 0;
     IntType nx[3], ng, nl;
-    bool deleteimage = false;
+    long long offset = 0;
+    bool deleteimage = false, blockgzip = false, success;
     std::string msg;
 
     PetscFunctionBegin;
@@ -1310,52 +2646,93 @@ PetscErrorCode ReadWriteReg::WriteNII(nifti_image** image, Vec x) {
 
         (*image)->fname = nifti_makehdrname(bname.c_str(), (*image)->nifti_type, false, iscompressed);
         (*image)->iname = nifti_makeimgname(bname.c_str(), (*image)->nifti_type, false, iscompressed);
-    }
 
-    // allocate data buffer
-    if (this->m_Data == NULL) {
-        try {this->m_Data = new ScalarType[ng];}
-        catch (std::bad_alloc&) {
-            ierr = ThrowError("allocation failed"); CHKERRQ(ierr);
+        // compressed single file images are written as block compressed
+        // gzip files (compressed in parallel; extensions are not supported)
+        blockgzip = (ext == ".nii.gz") && ((*image)->num_ext == 0);
+
+        // for uncompressed single file images we only write the header
+        // on the master rank; the data is written collectively
+        if ((ext == ".nii") && (file.compare((*image)->iname) == 0)) {
+            parallelwrite = 1;
+            nifti_set_iname_offset(*image);
+            offset = static_cast<long long>((*image)->iname_offset);
+            // do not truncate the file (see FlushPending); the size
+            // is set explicitly
+            success = CreateOutputFile(file, static_cast<off_t>(offset) + static_cast<off_t>(ng*sizeof(T)));
+            ierr = Assert(success, "could not create file " + file); CHKERRQ(ierr);
+            nifti_image_write_hdr_img(*image, 0, "r+b");
         }
     }
 
-    // collect sizes and compute number of data to send
-    ierr = this->CollectSizes(); CHKERRQ(ierr);
-
-    // gather data on master rank
-    ierr = VecGetArray(x, &p_xc); CHKERRQ(ierr);
-    rval = MPI_Gatherv(p_xc, nl, MPIU_SCALAR, this->m_Data, this->m_nSend, this->m_nOffset, MPIU_SCALAR, master, PETSC_COMM_WORLD);
+    rval = MPI_Bcast(&parallelwrite, 1, MPI_INT, master, PETSC_COMM_WORLD);
     ierr = MPIERRQ(rval); CHKERRQ(ierr);
-    ierr = VecRestoreArray(x, &p_xc); CHKERRQ(ierr);
 
-    nx[0] = this->m_Opt->m_Domain.nx[0];
-    nx[1] = this->m_Opt->m_Domain.nx[1];
-    nx[2] = this->m_Opt->m_Domain.nx[2];
+    if (parallelwrite) {
+        rval = MPI_Bcast(&offset, 1, MPI_LONG_LONG, master, PETSC_COMM_WORLD);
+        ierr = MPIERRQ(rval); CHKERRQ(ierr);
+        if (this->m_Opt->m_ReadWriteFlags.asyncio) {
+            ierr = this->WriteNIIAsync<T>(x, static_cast<MPI_Offset>(offset)); CHKERRQ(ierr);
+        } else {
+            ierr = this->WriteNIIParallel<T>(x, static_cast<MPI_Offset>(offset)); CHKERRQ(ierr);
+        }
+    } else {
+        // allocate data buffer
+        if (this->m_Data == NULL) {
+            try {this->m_Data = new ScalarType[ng];}
+            catch (std::bad_alloc&) {
+                ierr = ThrowError("allocation failed"); CHKERRQ(ierr);
+            }
+        }
 
-    if (rank == master) {
-        // cast pointer of nifti image data
-        data = reinterpret_cast<T*>((*image)->data);
+        // collect sizes and compute number of data to send
+        ierr = this->CollectSizes(); CHKERRQ(ierr);
 
-        IntType k = 0;
-        for (int p = 0; p < nprocs; ++p) {
-            for (IntType i1 = 0; i1 < this->m_iSizeC[3*p+0]; ++i1) {  // x1
-                for (IntType i2 = 0; i2 < this->m_iSizeC[3*p+1]; ++i2) {  // x2
-                    for (IntType i3 = 0; i3 < this->m_iSizeC[3*p+2]; ++i3) {  // x3
-                        IntType j1 = i1 + this->m_iStartC[3*p+0];
-                        IntType j2 = i2 + this->m_iStartC[3*p+1];
-                        IntType j3 = i3 + this->m_iStartC[3*p+2];
-                        IntType l = GetLinearIndex(j1, j2, j3, nx);
-                        data[l] = static_cast<T>(this->m_Data[k++]);
-                    }  // for i1
-                }  // for i2
-            }  // for i3
-        }  // for all procs
+        // gather data on master rank
+        ierr = VecGetArray(x, &p_xc); CHKERRQ(ierr);
+        rval = MPI_Gatherv(p_xc, nl, MPIU_SCALAR, this->m_Data, this->m_nSend, this->m_nOffset, MPIU_SCALAR, master, PETSC_COMM_WORLD);
+        ierr = MPIERRQ(rval); CHKERRQ(ierr);
+        ierr = VecRestoreArray(x, &p_xc); CHKERRQ(ierr);
+
+        nx[0] = this->m_Opt->m_Domain.nx[0];
+        nx[1] = this->m_Opt->m_Domain.nx[1];
+        nx[2] = this->m_Opt->m_Domain.nx[2];
 
-        // write image to file
-        nifti_image_write(*image);
-    }  // if on master
+        if (rank == master) {
+            // allocate image buffer (header only images)
+            if ((*image)->data == NULL) {
+                try {(*image)->data = new T[(*image)->nvox];}
+                catch (std::bad_alloc&) {
+                    ierr = ThrowError("allocation failed"); CHKERRQ(ierr);
+                }
+            }
 
+            // cast pointer of nifti image data
+            data = reinterpret_cast<T*>((*image)->data);
+
+            IntType k = 0;
+            for (int p = 0; p < nprocs; ++p) {
+                for (IntType i1 = 0; i1 < this->m_iSizeC[3*p+0]; ++i1) {  // x1
+                    for (IntType i2 = 0; i2 < this->m_iSizeC[3*p+1]; ++i2) {  // x2
+                        for (IntType i3 = 0; i3 < this->m_iSizeC[3*p+2]; ++i3) {  // x3
+                            IntType j1 = i1 + this->m_iStartC[3*p+0];
+                            IntType j2 = i2 + this->m_iStartC[3*p+1];
+                            IntType j3 = i3 + this->m_iStartC[3*p+2];
+                            IntType l = GetLinearIndex(j1, j2, j3, nx);
+                            data[l] = static_cast<T>(this->m_Data[k++]);
+                        }  // for i1
+                    }  // for i2
+                }  // for i3
+            }  // for all procs
+
+            // write image to file
+            if (blockgzip) {
+                ierr = this->WriteNIIBlockGzip(*image); CHKERRQ(ierr);
+            } else {
+                nifti_image_write(*image);
+            }
+        }  // if on master
+    }
 
     if (deleteimage) {
         if (this->m_Opt->m_Verbosity > 2) {
@@ -1364,168 +2741,1188 @@ PetscErrorCode ReadWriteReg::WriteNII(nifti_image** image, Vec x) {
         nifti_image_free(*image); *image = NULL;
     }
 
-    this->m_Opt->Exit(__func__);
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(0);
+}
+#endif
+
+
+
+/********************************************************************
+ * @brief write local part of data to nifty image in the background;
+ * the header has been written on the master rank; we take a snapshot
+ * of the local data (converted to the output type); the local data
+ * is written row by row (contiguous in the file)
+ *******************************************************************/
+#ifdef REG_HAS_NIFTI
+template <typename T>
+PetscErrorCode ReadWriteReg::WriteNIIAsync(Vec x, MPI_Offset offset) {
+    PetscErrorCode ierr = 0;
+    AsyncWriteJob* job = NULL;
+    const ScalarType *p_x = NULL;
+    T *data = NULL;
+    IntType nl, nx[3], isize[3], istart[3], l;
+
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    nl = this->m_Opt->m_Domain.nl;
+    for (int i = 0; i < 3; ++i) {
+        nx[i]     = this->m_Opt->m_Domain.nx[i];
+        isize[i]  = this->m_Opt->m_Domain.isize[i];
+        istart[i] = this->m_Opt->m_Domain.istart[i];
+    }
+
+    try {job = new AsyncWriteJob;}
+    catch (std::bad_alloc& err) {
+        ierr = reg::ThrowError(err); CHKERRQ(ierr);
+    }
+    try {
+        job->data.resize(nl*sizeof(T));
+        job->offset.resize(isize[0]*isize[1]);
+    } catch (std::bad_alloc& err) {
+        ierr = reg::ThrowError(err); CHKERRQ(ierr);
+    }
+    job->filename = this->m_FileName;
+    job->seglength = isize[2]*sizeof(T);
+
+    // snapshot of local data
+    data = reinterpret_cast<T*>(job->data.data());
+    ierr = VecGetArrayRead(x, &p_x); CHKERRQ(ierr);
+    for (IntType i = 0; i < nl; ++i) {
+        data[i] = static_cast<T>(p_x[i]);
+    }
+    ierr = VecRestoreArrayRead(x, &p_x); CHKERRQ(ierr);
+
+    // file offsets of rows
+    l = 0;
+    for (IntType i1 = 0; i1 < isize[0]; ++i1) {
+        for (IntType i2 = 0; i2 < isize[1]; ++i2) {
+            IntType k = GetLinearIndex(i1 + istart[0], i2 + istart[1], istart[2], nx);
+            job->offset[l++] = static_cast<off_t>(offset) + static_cast<off_t>(k*sizeof(T));
+        }
+    }
+
+    ierr = this->EnqueueWrite(job); CHKERRQ(ierr);
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+#endif
+
+
+
+
+/********************************************************************
+ * @brief write nifty image (single file) as block compressed gzip
+ * file; the header is followed by an empty extension and the data
+ *******************************************************************/
+#ifdef REG_HAS_NIFTI
+PetscErrorCode ReadWriteReg::WriteNIIBlockGzip(nifti_image* image) {
+    PetscErrorCode ierr = 0;
+    nifti_1_header header;
+    std::vector<char> buffer;
+
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    if (this->m_Opt->m_Verbosity > 2) {
+        ierr = DbgMsg("writing block compressed image"); CHKERRQ(ierr);
+    }
+
+    // header, extender (no extensions) and padding up to the data
+    nifti_set_iname_offset(image);
+    header = nifti_convert_nim2nhdr(image);
+    ierr = Assert(image->iname_offset >= static_cast<int>(sizeof(header)), "header size mismatch"); CHKERRQ(ierr);
+    buffer.assign(image->iname_offset, 0);
+    std::memcpy(buffer.data(), &header, sizeof(header));
+
+    ierr = WriteBlockGzip(image->iname, buffer.data(), buffer.size(),
+                          reinterpret_cast<const char*>(image->data),
+                          image->nvox*image->nbyper); CHKERRQ(ierr);
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+#endif
+
+
+
+
+/********************************************************************
+ * @brief write local part of data to nifty image with MPI-IO; the
+ * header has been written on the master rank; the data starts at the
+ * given offset and is stored as row major array of size (nz,ny,nx),
+ * which is the layout of the (pencil) decomposition
+ *******************************************************************/
+#ifdef REG_HAS_NIFTI
+template <typename T>
+PetscErrorCode ReadWriteReg::WriteNIIParallel(Vec x, MPI_Offset offset) {
+    PetscErrorCode ierr = 0;
+    T *data = NULL;
+    const ScalarType *p_x = NULL;
+    IntType nl;
+    int rval, sizes[3], subsizes[3], starts[3];
+    MPI_Datatype elemtype, filetype;
+    MPI_File fhandle;
+    MPI_Status status;
+    std::string msg;
+
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    if (this->m_Opt->m_Verbosity > 2) {
+        ierr = DbgMsg("writing nifti image in parallel (mpi-io)"); CHKERRQ(ierr);
+    }
+
+    nl = this->m_Opt->m_Domain.nl;
+    for (int i = 0; i < 3; ++i) {
+        sizes[i]    = static_cast<int>(this->m_Opt->m_Domain.nx[i]);
+        subsizes[i] = static_cast<int>(this->m_Opt->m_Domain.isize[i]);
+        starts[i]   = static_cast<int>(this->m_Opt->m_Domain.istart[i]);
+    }
+
+    // convert local data to output type
+    try {data = new T[nl];}
+    catch (std::bad_alloc&) {
+        ierr = ThrowError("allocation failed"); CHKERRQ(ierr);
+    }
+    ierr = VecGetArrayRead(x, &p_x); CHKERRQ(ierr);
+    for (IntType i = 0; i < nl; ++i) {
+        data[i] = static_cast<T>(p_x[i]);
+    }
+    ierr = VecRestoreArrayRead(x, &p_x); CHKERRQ(ierr);
+
+    // nifti data is stored in native byte order; write raw bytes
+    rval = MPI_Type_contiguous(static_cast<int>(sizeof(T)), MPI_BYTE, &elemtype);
+    ierr = MPIERRQ(rval); CHKERRQ(ierr);
+    rval = MPI_Type_commit(&elemtype);
+    ierr = MPIERRQ(rval); CHKERRQ(ierr);
+
+    // local block of global array
+    rval = MPI_Type_create_subarray(3, sizes, subsizes, starts, MPI_ORDER_C, elemtype, &filetype);
+    ierr = MPIERRQ(rval); CHKERRQ(ierr);
+    rval = MPI_Type_commit(&filetype);
+    ierr = MPIERRQ(rval); CHKERRQ(ierr);
+
+    // write data (collective); file has been created by master rank
+    rval = MPI_File_open(PETSC_COMM_WORLD, this->m_FileName.c_str(), MPI_MODE_WRONLY, MPI_INFO_NULL, &fhandle);
+    msg = "could not open file " + this->m_FileName;
+    ierr = Assert(rval == MPI_SUCCESS, msg); CHKERRQ(ierr);
+
+    rval = MPI_File_set_view(fhandle, offset, elemtype, filetype, "native", MPI_INFO_NULL);
+    ierr = MPIERRQ(rval); CHKERRQ(ierr);
+
+    rval = MPI_File_write_all(fhandle, data, static_cast<int>(nl), elemtype, &status);
+    ierr = MPIERRQ(rval); CHKERRQ(ierr);
+
+    rval = MPI_File_close(&fhandle);
+    ierr = MPIERRQ(rval); CHKERRQ(ierr);
+
+    rval = MPI_Type_free(&filetype);
+    ierr = MPIERRQ(rval); CHKERRQ(ierr);
+    rval = MPI_Type_free(&elemtype);
+    ierr = MPIERRQ(rval); CHKERRQ(ierr);
+
+    if (data != NULL) {delete [] data; data = NULL;}
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+#endif
+
+
+
+
+/********************************************************************
+ * @brief allocate buffer for nifty image
+ *******************************************************************/
+#ifdef REG_HAS_NIFTI
+PetscErrorCode ReadWriteReg::AllocateImage(nifti_image** image, Vec x) {
+    PetscErrorCode ierr = 0;
+    IntType n, nl;
+    int rank;
+
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    // get rank
+    MPI_Comm_rank(PETSC_COMM_WORLD, &rank);
+
+    nl = this->m_Opt->m_Domain.nl;
+
+    // init nifty image
+    *image = nifti_simple_init_nim();
+
+    // dimensionalty of data: default is 5 (space, time, components)
+    (*image)->dim[0] = (*image)->ndim = 5;
+
+    ierr = VecGetLocalSize(x, &n); CHKERRQ(ierr);
+    (*image)->dim[1] = (*image)->nx = this->m_Opt->m_Domain.nx[2];
+    (*image)->dim[2] = (*image)->ny = this->m_Opt->m_Domain.nx[1];
+    (*image)->dim[3] = (*image)->nz = this->m_Opt->m_Domain.nx[0];
+
+//    (*image)->dim[1] = (*image)->nx = this->m_Opt->m_Domain.nx[0];
+//    (*image)->dim[2] = (*image)->ny = this->m_Opt->m_Domain.nx[1];
+//    (*image)->dim[3] = (*image)->nz = this->m_Opt->m_Domain.nx[2];
+
+    (*image)->pixdim[1] = static_cast<float>(this->m_Opt->m_Domain.hx[0]);  // x direction
+    (*image)->pixdim[2] = static_cast<float>(this->m_Opt->m_Domain.hx[1]);  // y direction
+    (*image)->pixdim[3] = static_cast<float>(this->m_Opt->m_Domain.hx[2]);  // z direction
+
+    // TODO: add temporal support
+    if (n == nl) {  // scalar field
+        (*image)->dim[4] = (*image)->nt = 1;
+        (*image)->dim[5] = (*image)->nu = 1;
+
+        // temporal step size
+        (*image)->pixdim[4] = 1.0;
+    } else if (n == 2*nl) {  // 2D vector field
+        (*image)->dim[4] = (*image)->nt = 1;
+        (*image)->dim[5] = (*image)->nu = 2;
+
+        // temporal step size
+        (*image)->pixdim[4] = 1.0;
+
+        // step size (vector field)
+        (*image)->pixdim[5] = (*image)->du = static_cast<float>(this->m_Opt->m_Domain.hx[0]);
+        (*image)->pixdim[6] = (*image)->dv = static_cast<float>(this->m_Opt->m_Domain.hx[1]);
+    } else if (n == 3*nl) {  // 3D vector field
+        (*image)->dim[4] = (*image)->nt = 1;
+        (*image)->dim[5] = (*image)->nu = 3;
+
+        // temporal step size
+        (*image)->pixdim[4] = 1.0;
+
+        // step size (vector field)
+        (*image)->pixdim[5] = (*image)->du = static_cast<float>(this->m_Opt->m_Domain.hx[0]);
+        (*image)->pixdim[6] = (*image)->dv = static_cast<float>(this->m_Opt->m_Domain.hx[1]);
+        (*image)->pixdim[7] = (*image)->dw = static_cast<float>(this->m_Opt->m_Domain.hx[2]);
+    }
+
+    // switch precision in io
+#if defined(PETSC_USE_REAL_SINGLE)
+    (*image)->datatype = NIFTI_TYPE_FLOAT32; // single precision
+#else
+    (*image)->datatype = NIFTI_TYPE_FLOAT64; // double precision
+#endif
+    (*image)->nbyper = sizeof(ScalarType);
+    // compute number of voxels (space and time)
+    (*image)->nvox = 1;
+    for (int i = 1; i <= 4; ++i) {
+        (*image)->nvox *= (*image)->dim[i];
+    }
+    (*image)->nvox *= (*image)->nu;
+
+    // the image buffer is only allocated on the master rank if
+    // the data is gathered there (see WriteNII)
+    (*image)->data = NULL;
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(0);
+}
+#endif
+
+
+
+
+/********************************************************************
+ * @brief write binary data set to file
+ *******************************************************************/
+PetscErrorCode ReadWriteReg::ReadBIN(Vec* x) {
+    PetscErrorCode ierr = 0;
+    IntType nl, ng;
+    PetscViewer viewer = NULL;
+    PetscFunctionBegin;
+
+    if (*x != NULL) {
+        ierr = VecDestroy(x); CHKERRQ(ierr);
+        *x = NULL;
+    }
+
+    if (!this->m_Opt->m_SetupDone) {
+        ierr = this->m_Opt->DoSetup(); CHKERRQ(ierr);
+    }
+    nl = this->m_Opt->m_Domain.nl;
+    ng = this->m_Opt->m_Domain.ng;
+    ierr = VecCreate(*x, nl, ng); CHKERRQ(ierr);
+
+    ierr = PetscViewerBinaryOpen(PETSC_COMM_WORLD, this->m_FileName.c_str(), FILE_MODE_READ, &viewer); CHKERRQ(ierr);
+    ierr = Assert(viewer != NULL, "could not read binary file"); CHKERRQ(ierr);
+    ierr = PetscViewerBinarySetFlowControl(viewer, 2); CHKERRQ(ierr);
+    ierr = VecLoad(*x, viewer); CHKERRQ(ierr);
+
+    // clean up
+    if (viewer != NULL) {
+        ierr = PetscViewerDestroy(&viewer); CHKERRQ(ierr);
+        viewer = NULL;
+    }
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief write bin to file
+ *******************************************************************/
+PetscErrorCode ReadWriteReg::WriteBIN(Vec x) {
+    PetscErrorCode ierr = 0;
+    PetscViewer viewer = NULL;
+    PetscFunctionBegin;
+
+    ierr = PetscViewerBinaryOpen(PETSC_COMM_WORLD, this->m_FileName.c_str(), FILE_MODE_WRITE, &viewer); CHKERRQ(ierr);
+    ierr = Assert(viewer != NULL, "could not write binary file"); CHKERRQ(ierr);
+    ierr = VecView(x, viewer); CHKERRQ(ierr);
+
+    // clean up
+    if (viewer != NULL) {
+        ierr = PetscViewerDestroy(&viewer); CHKERRQ(ierr);
+        viewer = NULL;
+    }
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief header of the raw format (.craw); the header is followed
+ * by a table with the local size, the start index and the byte offset
+ * of the data of each rank (seven 64 bit integers per rank); the data
+ * of each rank is stored contiguously (ScalarType; memory layout of
+ * the pencil decomposition) and aligned to RAWAlignment, so that it
+ * can be memory mapped
+ *******************************************************************/
+struct RawFileHeader {
+    char magic[16];         ///< "CLAIRE RAW"
+    int64_t version;        ///< format version
+    int64_t scalarsize;     ///< sizeof(ScalarType)
+    int64_t nx[3];          ///< global grid size
+    int64_t nprocs;         ///< number of ranks the data was written for
+    int64_t griddims[2];    ///< processor grid the data was written for
+};
+
+static const char RAWMagic[16] = "CLAIRE RAW";
+static const int64_t RAWVersion = 1;
+static const int64_t RAWAlignment = 65536;  ///< multiple of the page size
+static const int RAWTableEntrySize = 7;
+
+/*! memory mapping of local data (unmapped when vector is destroyed) */
+struct RawMapping {
+    void* addr;
+    size_t length;
+};
+
+static PetscErrorCode UnmapRawData(void* ctx) {
+    RawMapping* map = static_cast<RawMapping*>(ctx);
+    if (map != NULL) {
+        munmap(map->addr, map->length);
+        delete map;
+    }
+    return 0;
+}
+
+static inline int64_t AlignRawOffset(int64_t n) {
+    return ((n + RAWAlignment - 1)/RAWAlignment)*RAWAlignment;
+}
+
+
+
+
+/********************************************************************
+ * @brief read raw data (.craw); the local data of each rank is
+ * mapped into memory and wrapped into a vector (no copy; copy on
+ * write, i.e., changes to the vector are not written to the file);
+ * images that are rescaled after reading are read into a regular
+ * vector; the file has to be written for the same processor grid
+ *******************************************************************/
+PetscErrorCode ReadWriteReg::ReadRAW(Vec* x) {
+    PetscErrorCode ierr = 0;
+    RawFileHeader header;
+    int64_t entry[RAWTableEntrySize];
+    IntType nl, ng, nx[3];
+    int rank, nprocs, fd;
+    void* addr = NULL;
+    size_t length;
+    bool mapdata;
+    std::stringstream ss;
+
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    MPI_Comm_rank(PETSC_COMM_WORLD, &rank);
+    MPI_Comm_size(PETSC_COMM_WORLD, &nprocs);
+
+    if (*x != NULL) {
+        ierr = VecDestroy(x); CHKERRQ(ierr); *x = NULL;
+    }
+
+    fd = open(this->m_FileName.c_str(), O_RDONLY);
+    ss << "could not open file " << this->m_FileName;
+    ierr = Assert(fd != -1, ss.str()); CHKERRQ(ierr);
+    ss.clear(); ss.str(std::string());
+
+    // read header and table entry of this rank
+    ierr = Assert(pread(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)), "could not read header"); CHKERRQ(ierr);
+    ierr = Assert(strncmp(header.magic, RAWMagic, sizeof(RAWMagic)) == 0, "not a raw file"); CHKERRQ(ierr);
+    ierr = Assert(header.version == RAWVersion, "version of raw file not supported"); CHKERRQ(ierr);
+    ierr = Assert(header.scalarsize == static_cast<int64_t>(sizeof(ScalarType)), "precision of raw file does not match"); CHKERRQ(ierr);
+
+    ss << "raw file was written for " << header.nprocs << " tasks (grid "
+       << header.griddims[0] << "x" << header.griddims[1]
+       << "); convert data for this processor grid (clairetools -convert 2raw)";
+    ierr = Assert(header.nprocs == nprocs, ss.str()); CHKERRQ(ierr);
+
+    ierr = Assert(pread(fd, entry, sizeof(entry), sizeof(header) + rank*sizeof(entry)) == static_cast<ssize_t>(sizeof(entry)), "could not read header"); CHKERRQ(ierr);
+
+    nx[0] = static_cast<IntType>(header.nx[0]);
+    nx[1] = static_cast<IntType>(header.nx[1]);
+    nx[2] = static_cast<IntType>(header.nx[2]);
+
+    // if we read images, we want to make sure that they have the same size
+    if ((this->m_nx[0] == -1) && (this->m_nx[1] == -1) && (this->m_nx[2] == -1)) {
+        for (int i = 0; i < 3; ++i) {
+            this->m_nx[i] = nx[i];
+        }
+    } else {
+        for (int i = 0; i < 3; ++i) {
+            ierr = Assert(this->m_nx[i] == nx[i], "grid size of input images varies"); CHKERRQ(ierr);
+        }
+    }
+    for (int i = 0; i < 3; ++i) {
+        this->m_Opt->m_Domain.nx[i] = nx[i];
+    }
+
+    if (!this->m_Opt->m_SetupDone) {
+        ierr = this->m_Opt->DoSetup(); CHKERRQ(ierr);
+    }
+    nl = this->m_Opt->m_Domain.nl;
+    ng = this->m_Opt->m_Domain.ng;
+
+    // make sure the decomposition matches
+    for (int i = 0; i < 3; ++i) {
+        ierr = Assert(entry[i]   == static_cast<int64_t>(this->m_Opt->m_Domain.isize[i]), ss.str()); CHKERRQ(ierr);
+        ierr = Assert(entry[3+i] == static_cast<int64_t>(this->m_Opt->m_Domain.istart[i]), ss.str()); CHKERRQ(ierr);
+    }
+    ss.clear(); ss.str(std::string());
+
+    length = static_cast<size_t>(nl)*sizeof(ScalarType);
+
+    // images are rescaled in place after reading (on read or when they
+    // are passed to the solver); with a private mapping this would copy
+    // every page; we read the data into a regular vector instead
+    mapdata = !(this->m_Opt->m_RegFlags.applyrescaling
+             && (this->m_ReferenceImage.read || this->m_TemplateImage.read));
+#ifdef REG_HAS_CUDA
+    mapdata = false;  // data has to reside on the device
+#endif
+
+    if (!mapdata) {
+        ScalarType* p_x = NULL;
+        char* p_buf = NULL;
+        size_t nread = 0;
+        ssize_t nbytes;
+
+        ierr = VecCreate(*x, nl, ng); CHKERRQ(ierr);
+        ierr = VecGetArray(*x, &p_x); CHKERRQ(ierr);
+        p_buf = reinterpret_cast<char*>(p_x);
+        while (nread < length) {
+            nbytes = pread(fd, p_buf + nread, length - nread, static_cast<off_t>(entry[6]) + static_cast<off_t>(nread));
+            if (nbytes <= 0) break;
+            nread += static_cast<size_t>(nbytes);
+        }
+        ierr = VecRestoreArray(*x, &p_x); CHKERRQ(ierr);
+        close(fd);
+        ierr = Assert(nread == length, "could not read raw file"); CHKERRQ(ierr);
+    } else {
+        RawMapping* map = NULL;
+        PetscContainer container = NULL;
+
+        // map local data
+        addr = mmap(NULL, length > 0 ? length : 1, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, static_cast<off_t>(entry[6]));
+        close(fd);
+        ierr = Assert(addr != MAP_FAILED, "could not map raw file"); CHKERRQ(ierr);
+
+        ierr = VecCreateMPIWithArray(PETSC_COMM_WORLD, 1, nl, ng, static_cast<ScalarType*>(addr), x); CHKERRQ(ierr);
+
+        // unmap data when the vector is destroyed
+        try {map = new RawMapping;}
+        catch (std::bad_alloc& err) {
+            ierr = reg::ThrowError(err); CHKERRQ(ierr);
+        }
+        map->addr = addr;
+        map->length = length > 0 ? length : 1;
+        ierr = PetscContainerCreate(PETSC_COMM_SELF, &container); CHKERRQ(ierr);
+        ierr = PetscContainerSetPointer(container, map); CHKERRQ(ierr);
+        ierr = PetscContainerSetUserDestroy(container, UnmapRawData); CHKERRQ(ierr);
+        ierr = PetscObjectCompose(reinterpret_cast<PetscObject>(*x), "RawMapping", reinterpret_cast<PetscObject>(container)); CHKERRQ(ierr);
+        ierr = PetscContainerDestroy(&container); CHKERRQ(ierr);
+    }
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief write raw data (.craw); see ReadRAW; the master rank writes
+ * the header, every rank writes its local data (MPI-IO)
+ *******************************************************************/
+PetscErrorCode ReadWriteReg::WriteRAW(Vec x) {
+    PetscErrorCode ierr = 0;
+    RawFileHeader header;
+    std::vector<int64_t> table;
+    int64_t local[RAWTableEntrySize], offset, filesize;
+    const ScalarType* p_x = NULL;
+    AsyncWriteJob* job = NULL;
+    IntType nl, n;
+    int rank, nprocs, rval;
+    MPI_File fhandle;
+    MPI_Status status;
+    std::string msg;
+
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    MPI_Comm_rank(PETSC_COMM_WORLD, &rank);
+    MPI_Comm_size(PETSC_COMM_WORLD, &nprocs);
+
+    nl = this->m_Opt->m_Domain.nl;
+    ierr = VecGetLocalSize(x, &n); CHKERRQ(ierr);
+    ierr = Assert(n == nl, "raw format only supports scalar fields"); CHKERRQ(ierr);
+
+    // header
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, RAWMagic, sizeof(RAWMagic));
+    header.version = RAWVersion;
+    header.scalarsize = static_cast<int64_t>(sizeof(ScalarType));
+    for (int i = 0; i < 3; ++i) {
+        header.nx[i] = static_cast<int64_t>(this->m_Opt->m_Domain.nx[i]);
+    }
+    header.nprocs = nprocs;
+    header.griddims[0] = this->m_Opt->m_CartGridDims[0];
+    header.griddims[1] = this->m_Opt->m_CartGridDims[1];
+
+    // collect table of local sizes and start indices
+    for (int i = 0; i < 3; ++i) {
+        local[i]   = static_cast<int64_t>(this->m_Opt->m_Domain.isize[i]);
+        local[3+i] = static_cast<int64_t>(this->m_Opt->m_Domain.istart[i]);
+    }
+    local[6] = 0;
+    try {table.resize(RAWTableEntrySize*nprocs);}
+    catch (std::bad_alloc& err) {
+        ierr = reg::ThrowError(err); CHKERRQ(ierr);
+    }
+    rval = MPI_Allgather(local, RAWTableEntrySize, MPI_INT64_T, table.data(), RAWTableEntrySize, MPI_INT64_T, PETSC_COMM_WORLD);
+    ierr = MPIERRQ(rval); CHKERRQ(ierr);
+
+    // compute (aligned) offsets of local data
+    offset = AlignRawOffset(sizeof(header) + table.size()*sizeof(int64_t));
+    for (int p = 0; p < nprocs; ++p) {
+        int64_t *e = &table[RAWTableEntrySize*p];
+        table[RAWTableEntrySize*p + 6] = offset;
+        offset += AlignRawOffset(e[0]*e[1]*e[2]*header.scalarsize);
+    }
+    filesize = offset;
+
+    rval = MPI_File_open(PETSC_COMM_WORLD, this->m_FileName.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &fhandle);
+    msg = "could not open file " + this->m_FileName;
+    ierr = Assert(rval == MPI_SUCCESS, msg); CHKERRQ(ierr);
+    rval = MPI_File_set_size(fhandle, static_cast<MPI_Offset>(filesize));
+    ierr = MPIERRQ(rval); CHKERRQ(ierr);
+
+    if (rank == 0) {
+        rval = MPI_File_write_at(fhandle, 0, &header, sizeof(header), MPI_BYTE, &status);
+        ierr = MPIERRQ(rval); CHKERRQ(ierr);
+        rval = MPI_File_write_at(fhandle, sizeof(header), table.data(), static_cast<int>(table.size()), MPI_INT64_T, &status);
+        ierr = MPIERRQ(rval); CHKERRQ(ierr);
+    }
+
+    if (this->m_Opt->m_ReadWriteFlags.asyncio) {
+        rval = MPI_File_close(&fhandle);
+        ierr = MPIERRQ(rval); CHKERRQ(ierr);
+
+        // snapshot of local data (written in the background)
+        try {job = new AsyncWriteJob;}
+        catch (std::bad_alloc& err) {
+            ierr = reg::ThrowError(err); CHKERRQ(ierr);
+        }
+        try {job->data.resize(nl*sizeof(ScalarType));}
+        catch (std::bad_alloc& err) {
+            ierr = reg::ThrowError(err); CHKERRQ(ierr);
+        }
+        job->filename = this->m_FileName;
+        job->seglength = job->data.size();
+        job->offset.assign(1, static_cast<off_t>(table[RAWTableEntrySize*rank + 6]));
+
+        ierr = VecGetArrayRead(x, &p_x); CHKERRQ(ierr);
+        std::memcpy(job->data.data(), p_x, job->seglength);
+        ierr = VecRestoreArrayRead(x, &p_x); CHKERRQ(ierr);
+
+        ierr = this->EnqueueWrite(job); CHKERRQ(ierr);
+    } else {
+        ierr = VecGetArrayRead(x, &p_x); CHKERRQ(ierr);
+        rval = MPI_File_write_at_all(fhandle, static_cast<MPI_Offset>(table[RAWTableEntrySize*rank + 6]),
+                                     p_x, static_cast<int>(nl), MPIU_SCALAR, &status);
+        ierr = MPIERRQ(rval); CHKERRQ(ierr);
+        ierr = VecRestoreArrayRead(x, &p_x); CHKERRQ(ierr);
+
+        rval = MPI_File_close(&fhandle);
+        ierr = MPIERRQ(rval); CHKERRQ(ierr);
+    }
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief header of the vector field container (.cvel); the header is
+ * followed by the data of the three components (one block per
+ * component); the encoding determines the content of the blocks:
+ * full       values (global row major array of size nx; scalarsize
+ *            bytes per value)
+ * spectral   fourier coefficients (scaled by 1/ng) with wave numbers
+ *            below the cutoff (global row major array of size
+ *            (2*nk[0]-1,2*nk[1]-1,nk[2]); negative wave numbers are
+ *            stored after the positive ones; pairs of values)
+ * quantized  unsigned integers q; the values are offset + q*step
+ *            (global row major array of size nx)
+ * the data does not depend on the processor grid
+ *******************************************************************/
+struct VelocityFileHeader {
+    char magic[16];         ///< "CLAIRE CVEL"
+    int64_t version;        ///< format version
+    int64_t encoding;       ///< VELFULL, VELSPECTRAL or VELQUANTIZED
+    int64_t scalarsize;     ///< number of bytes of a stored value
+    int64_t nx[3];          ///< global grid size
+    int64_t nk[3];          ///< number of retained wave numbers (spectral)
+    double offset[3];       ///< offset of each component (quantized)
+    double step[3];         ///< quantization step of each component (quantized)
+};
+
+static const char CVELMagic[16] = "CLAIRE CVEL";
+static const int64_t CVELVersion = 1;
+
+/*! values are offset + step*data[i] (full precision: offset = 0, step = 1) */
+template <typename T> static void DecodeValues(const char* buffer, ScalarType* x, IntType n,
+                                               double offset, double step) {
+    const T* data = reinterpret_cast<const T*>(buffer);
+#pragma omp parallel for
+    for (IntType i = 0; i < n; ++i) {
+        x[i] = static_cast<ScalarType>(offset + step*static_cast<double>(data[i]));
+    }
+}
+
+/*! round to nearest quantization level (error at most step/2) */
+template <typename T> static void EncodeValues(const ScalarType* x, char* buffer, IntType n,
+                                               double offset, double step) {
+    T* data = reinterpret_cast<T*>(buffer);
+#pragma omp parallel for
+    for (IntType i = 0; i < n; ++i) {
+        data[i] = static_cast<T>(std::floor((static_cast<double>(x[i]) - offset)/step + 0.5));
+    }
+}
 
-    PetscFunctionReturn(0);
+/*! mpi type of stored values */
+static MPI_Datatype GetCVELType(int64_t encoding, int64_t scalarsize) {
+    if (encoding == VELQUANTIZED) {
+        if (scalarsize == 1) return MPI_UNSIGNED_CHAR;
+        if (scalarsize == 2) return MPI_UNSIGNED_SHORT;
+        if (scalarsize == 4) return MPI_UNSIGNED;
+    } else {
+        if (scalarsize == 4) return MPI_FLOAT;
+        if (scalarsize == 8) return MPI_DOUBLE;
+    }
+    return MPI_DATATYPE_NULL;
 }
-#endif
+
 
 
 
 /********************************************************************
- * @brief allocate buffer for nifty image
+ * @brief get local part of block of fourier coefficients with wave
+ * numbers |k_i| < nk[i]; li are the local (linear) indices of the
+ * coefficients, blocklen and displ describe their position in the
+ * block (runs along x3; the order of li matches the order in the
+ * block)
  *******************************************************************/
-#ifdef REG_HAS_NIFTI
-PetscErrorCode ReadWriteReg::AllocateImage(nifti_image** image, Vec x) {
+PetscErrorCode ReadWriteReg::GetCoefficientBlock(IntType* nk, std::vector<IntType>& li,
+                                                 std::vector<int>& blocklen, std::vector<int>& displ) {
     PetscErrorCode ierr = 0;
-    IntType n, nl;
-    int rank;
+    IntType nx[3], osize[3], ostart[3], m[3], g0, g1, p0, p1, j0, j1;
 
     PetscFunctionBegin;
 
     this->m_Opt->Enter(__func__);
 
-    // get rank
-    MPI_Comm_rank(PETSC_COMM_WORLD, &rank);
-
-    nl = this->m_Opt->m_Domain.nl;
+    for (int i = 0; i < 3; ++i) {
+        nx[i]     = this->m_Opt->m_Domain.nx[i];
+        osize[i]  = this->m_Opt->m_FFT.osize[i];
+        ostart[i] = this->m_Opt->m_FFT.ostart[i];
+    }
+    m[0] = 2*nk[0] - 1;
+    m[1] = 2*nk[1] - 1;
+    m[2] = nk[2];
+
+    li.clear(); blocklen.clear(); displ.clear();
+
+    // retained coefficients along x3 (contiguous)
+    j0 = ostart[2];
+    j1 = std::min(ostart[2] + osize[2], nk[2]);
+
+    for (IntType i1 = 0; i1 < osize[0] && j1 > j0; ++i1) {  // x1
+        g0 = i1 + ostart[0];
+        if (g0 >= nk[0] && g0 <= nx[0] - nk[0]) continue;
+        p0 = g0 < nk[0] ? g0 : g0 - nx[0] + m[0];
+        for (IntType i2 = 0; i2 < osize[1]; ++i2) {  // x2
+            g1 = i2 + ostart[1];
+            if (g1 >= nk[1] && g1 <= nx[1] - nk[1]) continue;
+            p1 = g1 < nk[1] ? g1 : g1 - nx[1] + m[1];
+
+            blocklen.push_back(static_cast<int>(j1 - j0));
+            displ.push_back(static_cast<int>((p0*m[1] + p1)*m[2] + j0));
+            for (IntType i3 = j0 - ostart[2]; i3 < j1 - ostart[2]; ++i3) {  // x3
+                li.push_back(GetLinearIndex(i1, i2, i3, osize));
+            }
+        }  // i2
+    }  // i1
 
-    // init nifty image
-    *image = nifti_simple_init_nim();
+    this->m_Opt->Exit(__func__);
 
-    // dimensionalty of data: default is 5 (space, time, components)
-    (*image)->dim[0] = (*image)->ndim = 5;
+    PetscFunctionReturn(ierr);
+}
 
-    ierr = VecGetLocalSize(x, &n); CHKERRQ(ierr);
-    (*image)->dim[1] = (*image)->nx = this->m_Opt->m_Domain.nx[2];
-    (*image)->dim[2] = (*image)->ny = this->m_Opt->m_Domain.nx[1];
-    (*image)->dim[3] = (*image)->nz = this->m_Opt->m_Domain.nx[0];
 
-//    (*image)->dim[1] = (*image)->nx = this->m_Opt->m_Domain.nx[0];
-//    (*image)->dim[2] = (*image)->ny = this->m_Opt->m_Domain.nx[1];
-//    (*image)->dim[3] = (*image)->nz = this->m_Opt->m_Domain.nx[2];
 
-    (*image)->pixdim[1] = static_cast<float>(this->m_Opt->m_Domain.hx[0]);  // x direction
-    (*image)->pixdim[2] = static_cast<float>(this->m_Opt->m_Domain.hx[1]);  // y direction
-    (*image)->pixdim[3] = static_cast<float>(this->m_Opt->m_Domain.hx[2]);  // z direction
 
-    // TODO: add temporal support
-    if (n == nl) {  // scalar field
-        (*image)->dim[4] = (*image)->nt = 1;
-        (*image)->dim[5] = (*image)->nu = 1;
+/********************************************************************
+ * @brief read vector field container (.cvel); see WriteCVEL; the
+ * values are read with MPI-IO (collective; any processor grid)
+ *******************************************************************/
+PetscErrorCode ReadWriteReg::ReadCVEL(VecField* v) {
+    PetscErrorCode ierr = 0;
+    VelocityFileHeader header;
+    Vec x[3];
+    ScalarType *p_x = NULL;
+    ComplexType *xhat = NULL;
+    IntType nl, ng, nc, nk[3], nalloc;
+    MPI_Offset offset, nbytes;
+    MPI_Datatype etype, ctype, filetype;
+    MPI_File fhandle;
+    MPI_Status status;
+    std::vector<char> buffer;
+    std::vector<ScalarType> coeff;
+    std::vector<IntType> li;
+    std::vector<int> blocklen, displ;
+    int rval, sizes[3], subsizes[3], starts[3];
+    double timer[NFFTTIMERS] = {0};
+    std::stringstream ss;
 
-        // temporal step size
-        (*image)->pixdim[4] = 1.0;
-    } else if (n == 2*nl) {  // 2D vector field
-        (*image)->dim[4] = (*image)->nt = 1;
-        (*image)->dim[5] = (*image)->nu = 2;
+    PetscFunctionBegin;
 
-        // temporal step size
-        (*image)->pixdim[4] = 1.0;
+    this->m_Opt->Enter(__func__);
 
-        // step size (vector field)
-        (*image)->pixdim[5] = (*image)->du = static_cast<float>(this->m_Opt->m_Domain.hx[0]);
-        (*image)->pixdim[6] = (*image)->dv = static_cast<float>(this->m_Opt->m_Domain.hx[1]);
-    } else if (n == 3*nl) {  // 3D vector field
-        (*image)->dim[4] = (*image)->nt = 1;
-        (*image)->dim[5] = (*image)->nu = 3;
+    rval = MPI_File_open(PETSC_COMM_WORLD, this->m_FileName.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &fhandle);
+    ss << "could not open file " << this->m_FileName;
+    ierr = Assert(rval == MPI_SUCCESS, ss.str()); CHKERRQ(ierr);
+    ss.clear(); ss.str(std::string());
 
-        // temporal step size
-        (*image)->pixdim[4] = 1.0;
+    rval = MPI_File_read_all(fhandle, &header, sizeof(header), MPI_BYTE, &status);
+    ierr = MPIERRQ(rval); CHKERRQ(ierr);
+    ierr = Assert(strncmp(header.magic, CVELMagic, sizeof(CVELMagic)) == 0, "not a vector field container"); CHKERRQ(ierr);
+    ierr = Assert(header.version == CVELVersion, "version of vector field container not supported"); CHKERRQ(ierr);
+    etype = GetCVELType(header.encoding, header.scalarsize);
+    ierr = Assert(etype != MPI_DATATYPE_NULL, "encoding of vector field container not supported"); CHKERRQ(ierr);
 
-        // step size (vector field)
-        (*image)->pixdim[5] = (*image)->du = static_cast<float>(this->m_Opt->m_Domain.hx[0]);
-        (*image)->pixdim[6] = (*image)->dv = static_cast<float>(this->m_Opt->m_Domain.hx[1]);
-        (*image)->pixdim[7] = (*image)->dw = static_cast<float>(this->m_Opt->m_Domain.hx[2]);
+    // set up grid (if we read images, they have to have the same size)
+    if (!this->m_Opt->m_SetupDone) {
+        for (int i = 0; i < 3; ++i) {
+            this->m_Opt->m_Domain.nx[i] = static_cast<IntType>(header.nx[i]);
+        }
+        ierr = this->m_Opt->DoSetup(); CHKERRQ(ierr);
     }
-
-    // switch precision in io
-#if defined(PETSC_USE_REAL_SINGLE)
-    (*image)->datatype = NIFTI_TYPE_FLOAT32; // single precision
-#else
-    (*image)->datatype = NIFTI_TYPE_FLOAT64; // double precision
-#endif
-    (*image)->nbyper = sizeof(ScalarType);
-    // compute number of voxels (space and time)
-    (*image)->nvox = 1;
-    for (int i = 1; i <= 4; ++i) {
-        (*image)->nvox *= (*image)->dim[i];
+    for (int i = 0; i < 3; ++i) {
+        ss << "grid size of vector field (" << header.nx[0] << "," << header.nx[1] << "," << header.nx[2]
+           << ") does not match";
+        ierr = Assert(header.nx[i] == static_cast<int64_t>(this->m_Opt->m_Domain.nx[i]), ss.str()); CHKERRQ(ierr);
+        ss.clear(); ss.str(std::string());
     }
-    (*image)->nvox *= (*image)->nu;
+    nl = this->m_Opt->m_Domain.nl;
+    ng = this->m_Opt->m_Domain.ng;
 
-    // only allocate image buffer on root
-    if (rank == 0) {
-        try {(*image)->data = new ScalarType[(*image)->nvox];}
-        catch (std::bad_alloc&) {
-            ierr = ThrowError("allocation failed"); CHKERRQ(ierr);
+    if (v->m_X1 == NULL) {ierr = VecCreate(v->m_X1, nl, ng); CHKERRQ(ierr);}
+    if (v->m_X2 == NULL) {ierr = VecCreate(v->m_X2, nl, ng); CHKERRQ(ierr);}
+    if (v->m_X3 == NULL) {ierr = VecCreate(v->m_X3, nl, ng); CHKERRQ(ierr);}
+    x[0] = v->m_X1; x[1] = v->m_X2; x[2] = v->m_X3;
+
+    offset = static_cast<MPI_Offset>(sizeof(header));
+
+    if (header.encoding == VELSPECTRAL) {
+        // local part of block of coefficients (pairs of values)
+        for (int i = 0; i < 3; ++i) nk[i] = static_cast<IntType>(header.nk[i]);
+        ierr = this->GetCoefficientBlock(nk, li, blocklen, displ); CHKERRQ(ierr);
+        nc = static_cast<IntType>(li.size());
+        nbytes = static_cast<MPI_Offset>((2*nk[0]-1)*(2*nk[1]-1)*nk[2]*2*header.scalarsize);
+
+        rval = MPI_Type_contiguous(2, etype, &ctype);
+        ierr = MPIERRQ(rval); CHKERRQ(ierr);
+        rval = MPI_Type_commit(&ctype);
+        ierr = MPIERRQ(rval); CHKERRQ(ierr);
+        if (nc > 0) {
+            rval = MPI_Type_indexed(static_cast<int>(displ.size()), blocklen.data(), displ.data(), ctype, &filetype);
+        } else {
+            rval = MPI_Type_dup(ctype, &filetype);
+        }
+        ierr = MPIERRQ(rval); CHKERRQ(ierr);
+        rval = MPI_Type_commit(&filetype);
+        ierr = MPIERRQ(rval); CHKERRQ(ierr);
+
+        try {
+            buffer.resize(2*nc*header.scalarsize + 1);
+            coeff.resize(2*nc + 1);
+        } catch (std::bad_alloc& err) {
+            ierr = reg::ThrowError(err); CHKERRQ(ierr);
+        }
+
+        for (int k = 0; k < 3; ++k) {
+            rval = MPI_File_set_view(fhandle, offset + k*nbytes, ctype, filetype, "native", MPI_INFO_NULL);
+            ierr = MPIERRQ(rval); CHKERRQ(ierr);
+            rval = MPI_File_read_all(fhandle, buffer.data(), static_cast<int>(nc), ctype, &status);
+            ierr = MPIERRQ(rval); CHKERRQ(ierr);
+            if (header.scalarsize == 4) {
+                DecodeValues<float>(buffer.data(), coeff.data(), 2*nc, 0.0, 1.0);
+            } else {
+                DecodeValues<double>(buffer.data(), coeff.data(), 2*nc, 0.0, 1.0);
+            }
+
+            // all other coefficients are zero
+            if (xhat == NULL) {
+                ierr = this->m_Opt->GetSpectralWorkspace(&xhat); CHKERRQ(ierr);
+            }
+            nalloc = this->m_Opt->m_FFT.osize[0]*this->m_Opt->m_FFT.osize[1]*this->m_Opt->m_FFT.osize[2];
+#pragma omp parallel for
+            for (IntType i = 0; i < nalloc; ++i) {
+                xhat[i][0] = 0.0;
+                xhat[i][1] = 0.0;
+            }
+#pragma omp parallel for
+            for (IntType i = 0; i < nc; ++i) {
+                xhat[li[i]][0] = coeff[2*i+0];
+                xhat[li[i]][1] = coeff[2*i+1];
+            }
+
+            ierr = VecGetArray(x[k], &p_x); CHKERRQ(ierr);
+            accfft_execute_c2r(this->m_Opt->m_FFT.plan, xhat, p_x, timer);
+            ierr = VecRestoreArray(x[k], &p_x); CHKERRQ(ierr);
+        }
+        ierr = this->m_Opt->ReleaseSpectralWorkspace(&xhat); CHKERRQ(ierr);
+        this->m_Opt->IncreaseFFTTimers(timer);
+        this->m_Opt->IncrementCounter(FFT, 3);
+
+        rval = MPI_Type_free(&filetype);
+        ierr = MPIERRQ(rval); CHKERRQ(ierr);
+        rval = MPI_Type_free(&ctype);
+        ierr = MPIERRQ(rval); CHKERRQ(ierr);
+    } else {
+        // local block of global array
+        for (int i = 0; i < 3; ++i) {
+            sizes[i]    = static_cast<int>(this->m_Opt->m_Domain.nx[i]);
+            subsizes[i] = static_cast<int>(this->m_Opt->m_Domain.isize[i]);
+            starts[i]   = static_cast<int>(this->m_Opt->m_Domain.istart[i]);
         }
+        rval = MPI_Type_create_subarray(3, sizes, subsizes, starts, MPI_ORDER_C, etype, &filetype);
+        ierr = MPIERRQ(rval); CHKERRQ(ierr);
+        rval = MPI_Type_commit(&filetype);
+        ierr = MPIERRQ(rval); CHKERRQ(ierr);
+        nbytes = static_cast<MPI_Offset>(ng*header.scalarsize);
+
+        try {buffer.resize(nl*header.scalarsize + 1);}
+        catch (std::bad_alloc& err) {
+            ierr = reg::ThrowError(err); CHKERRQ(ierr);
+        }
+
+        for (int k = 0; k < 3; ++k) {
+            rval = MPI_File_set_view(fhandle, offset + k*nbytes, etype, filetype, "native", MPI_INFO_NULL);
+            ierr = MPIERRQ(rval); CHKERRQ(ierr);
+            rval = MPI_File_read_all(fhandle, buffer.data(), static_cast<int>(nl), etype, &status);
+            ierr = MPIERRQ(rval); CHKERRQ(ierr);
+
+            ierr = VecGetArray(x[k], &p_x); CHKERRQ(ierr);
+            if (header.encoding == VELQUANTIZED) {
+                switch (header.scalarsize) {
+                    case 1:  DecodeValues<unsigned char>(buffer.data(), p_x, nl, header.offset[k], header.step[k]); break;
+                    case 2:  DecodeValues<unsigned short>(buffer.data(), p_x, nl, header.offset[k], header.step[k]); break;
+                    default: DecodeValues<unsigned int>(buffer.data(), p_x, nl, header.offset[k], header.step[k]); break;
+                }
+            } else {
+                if (header.scalarsize == 4) {
+                    DecodeValues<float>(buffer.data(), p_x, nl, 0.0, 1.0);
+                } else {
+                    DecodeValues<double>(buffer.data(), p_x, nl, 0.0, 1.0);
+                }
+            }
+            ierr = VecRestoreArray(x[k], &p_x); CHKERRQ(ierr);
+        }
+
+        rval = MPI_Type_free(&filetype);
+        ierr = MPIERRQ(rval); CHKERRQ(ierr);
     }
 
+    rval = MPI_File_close(&fhandle);
+    ierr = MPIERRQ(rval); CHKERRQ(ierr);
+
     this->m_Opt->Exit(__func__);
 
-    PetscFunctionReturn(0);
+    PetscFunctionReturn(ierr);
 }
-#endif
 
 
 
 
 /********************************************************************
- * @brief write binary data set to file
+ * @brief write vector field container (.cvel); see ReadCVEL; the
+ * encoding is set by the user (m_ReadWriteFlags.velencoding):
+ * full       values in full precision
+ * spectral   fourier coefficients below the cutoff frequency (smooth
+ *            velocities are represented by few coefficients)
+ * quantized  values are quantized with error bound tol*max|v_i|; we
+ *            use the smallest integer type that covers all levels
  *******************************************************************/
-PetscErrorCode ReadWriteReg::ReadBIN(Vec* x) {
+PetscErrorCode ReadWriteReg::WriteCVEL(VecField* v) {
     PetscErrorCode ierr = 0;
-    IntType nl, ng;
-    PetscViewer viewer = NULL;
+    VelocityFileHeader header;
+    Vec x[3];
+    ScalarType *p_x = NULL, scale, tol, pct;
+    ComplexType *xhat = NULL;
+    IntType nl, ng, nc, nk[3];
+    MPI_Offset offset, nbytes, filesize;
+    MPI_Datatype etype, ctype, filetype;
+    MPI_File fhandle;
+    MPI_Status status;
+    MPI_Info info;
+    std::vector<char> buffer;
+    std::vector<ScalarType> coeff;
+    std::vector<IntType> li;
+    std::vector<int> blocklen, displ;
+    ScalarType range[6];
+    double levels, amplitude;
+    int rank, rval, sizes[3], subsizes[3], starts[3];
+    double timer[NFFTTIMERS] = {0};
+    std::stringstream ss;
+
     PetscFunctionBegin;
 
-    if (*x != NULL) {
-        ierr = VecDestroy(x); CHKERRQ(ierr);
-        *x = NULL;
-    }
+    this->m_Opt->Enter(__func__);
+
+    ierr = Assert(v != NULL, "null pointer"); CHKERRQ(ierr);
+
+    MPI_Comm_rank(PETSC_COMM_WORLD, &rank);
 
-    if (!this->m_Opt->m_SetupDone) {
-        ierr = this->m_Opt->DoSetup(); CHKERRQ(ierr);
-    }
     nl = this->m_Opt->m_Domain.nl;
     ng = this->m_Opt->m_Domain.ng;
-    ierr = VecCreate(*x, nl, ng); CHKERRQ(ierr);
+    x[0] = v->m_X1; x[1] = v->m_X2; x[2] = v->m_X3;
+
+    // header
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, CVELMagic, sizeof(CVELMagic));
+    header.version = CVELVersion;
+    header.encoding = this->m_Opt->m_ReadWriteFlags.velencoding;
+    if (header.encoding == VELNONE) header.encoding = VELFULL;
+    header.scalarsize = static_cast<int64_t>(sizeof(ScalarType));
+    for (int i = 0; i < 3; ++i) {
+        header.nx[i] = static_cast<int64_t>(this->m_Opt->m_Domain.nx[i]);
+    }
 
-    ierr = PetscViewerBinaryOpen(PETSC_COMM_WORLD, this->m_FileName.c_str(), FILE_MODE_READ, &viewer); CHKERRQ(ierr);
-    ierr = Assert(viewer != NULL, "could not read binary file"); CHKERRQ(ierr);
-    ierr = PetscViewerBinarySetFlowControl(viewer, 2); CHKERRQ(ierr);
-    ierr = VecLoad(*x, viewer); CHKERRQ(ierr);
+    if (header.encoding == VELSPECTRAL) {
+        // number of retained wave numbers (we never keep the nyquist
+        // frequency, so that the data remains real)
+        pct = this->m_Opt->m_ReadWriteFlags.velcutoff;
+        ierr = Assert(pct > 0.0 && pct <= 1.0, "cutoff has to be in (0,1]"); CHKERRQ(ierr);
+        for (int i = 0; i < 3; ++i) {
+            nk[i] = static_cast<IntType>(pct*static_cast<ScalarType>(header.nx[i]/2));
+            nk[i] = std::max(nk[i], static_cast<IntType>(1));
+            nk[i] = std::min(nk[i], std::max(static_cast<IntType>(header.nx[i]/2), static_cast<IntType>(1)));
+            header.nk[i] = static_cast<int64_t>(nk[i]);
+        }
+        nbytes = static_cast<MPI_Offset>((2*nk[0]-1)*(2*nk[1]-1)*nk[2]*2*header.scalarsize);
+    } else if (header.encoding == VELQUANTIZED) {
+        tol = this->m_Opt->m_ReadWriteFlags.veltolerance;
+        ierr = Assert(tol > 0.0, "tolerance has to be positive"); CHKERRQ(ierr);
+
+        // range of all components (single reduction)
+        for (int k = 0; k < 3; ++k) {
+            const ScalarType* p_xk = NULL;
+            ScalarType xlow = std::numeric_limits<ScalarType>::max();
+            ScalarType xhigh = std::numeric_limits<ScalarType>::lowest();
+            ierr = VecGetArrayRead(x[k], &p_xk); CHKERRQ(ierr);
+#pragma omp parallel for reduction(min:xlow) reduction(max:xhigh)
+            for (IntType i = 0; i < nl; ++i) {
+                if (p_xk[i] < xlow) xlow = p_xk[i];
+                if (p_xk[i] > xhigh) xhigh = p_xk[i];
+            }
+            ierr = VecRestoreArrayRead(x[k], &p_xk); CHKERRQ(ierr);
+            range[k] = -xlow; range[3+k] = xhigh;
+        }
+        rval = MPI_Allreduce(MPI_IN_PLACE, range, 6, MPIU_REAL, MPI_MAX, PETSC_COMM_WORLD);
+        ierr = MPIERRQ(rval); CHKERRQ(ierr);
+
+        // quantization step (max error is step/2) and number of levels
+        levels = 1.0;
+        for (int k = 0; k < 3; ++k) {
+            amplitude = std::max(std::abs(static_cast<double>(range[k])), std::abs(static_cast<double>(range[3+k])));
+            header.offset[k] = -static_cast<double>(range[k]);
+            header.step[k] = amplitude > 0.0 ? 2.0*tol*amplitude : 1.0;
+            levels = std::max(levels, std::floor((range[3+k] + range[k])/header.step[k] + 0.5) + 1.0);
+        }
+        ierr = Assert(levels <= 4294967296.0, "tolerance too small for quantization"); CHKERRQ(ierr);
+        header.scalarsize = levels <= 256.0 ? 1 : (levels <= 65536.0 ? 2 : 4);
+        nbytes = static_cast<MPI_Offset>(ng*header.scalarsize);
+    } else {
+        nbytes = static_cast<MPI_Offset>(ng*header.scalarsize);
+    }
+    etype = GetCVELType(header.encoding, header.scalarsize);
+    offset = static_cast<MPI_Offset>(sizeof(header));
+    filesize = offset + 3*nbytes;
+
+    ierr = this->GetIOHints(&info); CHKERRQ(ierr);
+    rval = MPI_File_open(PETSC_COMM_WORLD, this->m_FileName.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY, info, &fhandle);
+    MPI_Info_free(&info);
+    ss << "could not open file " << this->m_FileName;
+    ierr = Assert(rval == MPI_SUCCESS, ss.str()); CHKERRQ(ierr);
+    ss.clear(); ss.str(std::string());
+    rval = MPI_File_set_size(fhandle, filesize);
+    ierr = MPIERRQ(rval); CHKERRQ(ierr);
 
-    // clean up
-    if (viewer != NULL) {
-        ierr = PetscViewerDestroy(&viewer); CHKERRQ(ierr);
-        viewer = NULL;
+    if (rank == 0) {
+        rval = MPI_File_write_at(fhandle, 0, &header, sizeof(header), MPI_BYTE, &status);
+        ierr = MPIERRQ(rval); CHKERRQ(ierr);
     }
 
-    PetscFunctionReturn(ierr);
-}
+    if (header.encoding == VELSPECTRAL) {
+        // local part of block of coefficients (pairs of values)
+        ierr = this->GetCoefficientBlock(nk, li, blocklen, displ); CHKERRQ(ierr);
+        nc = static_cast<IntType>(li.size());
+
+        rval = MPI_Type_contiguous(2, etype, &ctype);
+        ierr = MPIERRQ(rval); CHKERRQ(ierr);
+        rval = MPI_Type_commit(&ctype);
+        ierr = MPIERRQ(rval); CHKERRQ(ierr);
+        if (nc > 0) {
+            rval = MPI_Type_indexed(static_cast<int>(displ.size()), blocklen.data(), displ.data(), ctype, &filetype);
+        } else {
+            rval = MPI_Type_dup(ctype, &filetype);
+        }
+        ierr = MPIERRQ(rval); CHKERRQ(ierr);
+        rval = MPI_Type_commit(&filetype);
+        ierr = MPIERRQ(rval); CHKERRQ(ierr);
 
+        try {coeff.resize(2*nc + 1);}
+        catch (std::bad_alloc& err) {
+            ierr = reg::ThrowError(err); CHKERRQ(ierr);
+        }
 
+        scale = this->m_Opt->ComputeFFTScale();
+        ierr = this->m_Opt->GetSpectralWorkspace(&xhat); CHKERRQ(ierr);
+        for (int k = 0; k < 3; ++k) {
+            ierr = VecGetArray(x[k], &p_x); CHKERRQ(ierr);
+            accfft_execute_r2c(this->m_Opt->m_FFT.plan, p_x, xhat, timer);
+            ierr = VecRestoreArray(x[k], &p_x); CHKERRQ(ierr);
+
+#pragma omp parallel for
+            for (IntType i = 0; i < nc; ++i) {
+                coeff[2*i+0] = scale*xhat[li[i]][0];
+                coeff[2*i+1] = scale*xhat[li[i]][1];
+            }
 
+            rval = MPI_File_set_view(fhandle, offset + k*nbytes, ctype, filetype, "native", MPI_INFO_NULL);
+            ierr = MPIERRQ(rval); CHKERRQ(ierr);
+            rval = MPI_File_write_all(fhandle, coeff.data(), static_cast<int>(nc), ctype, &status);
+            ierr = MPIERRQ(rval); CHKERRQ(ierr);
+        }
+        ierr = this->m_Opt->ReleaseSpectralWorkspace(&xhat); CHKERRQ(ierr);
+        this->m_Opt->IncreaseFFTTimers(timer);
+        this->m_Opt->IncrementCounter(FFT, 3);
+
+        rval = MPI_Type_free(&filetype);
+        ierr = MPIERRQ(rval); CHKERRQ(ierr);
+        rval = MPI_Type_free(&ctype);
+        ierr = MPIERRQ(rval); CHKERRQ(ierr);
+    } else {
+        // local block of global array
+        for (int i = 0; i < 3; ++i) {
+            sizes[i]    = static_cast<int>(this->m_Opt->m_Domain.nx[i]);
+            subsizes[i] = static_cast<int>(this->m_Opt->m_Domain.isize[i]);
+            starts[i]   = static_cast<int>(this->m_Opt->m_Domain.istart[i]);
+        }
+        rval = MPI_Type_create_subarray(3, sizes, subsizes, starts, MPI_ORDER_C, etype, &filetype);
+        ierr = MPIERRQ(rval); CHKERRQ(ierr);
+        rval = MPI_Type_commit(&filetype);
+        ierr = MPIERRQ(rval); CHKERRQ(ierr);
+
+        if (header.encoding == VELQUANTIZED) {
+            try {buffer.resize(nl*header.scalarsize + 1);}
+            catch (std::bad_alloc& err) {
+                ierr = reg::ThrowError(err); CHKERRQ(ierr);
+            }
+        }
 
-/********************************************************************
- * @brief write bin to file
- *******************************************************************/
-PetscErrorCode ReadWriteReg::WriteBIN(Vec x) {
-    PetscErrorCode ierr = 0;
-    PetscViewer viewer = NULL;
-    PetscFunctionBegin;
+        for (int k = 0; k < 3; ++k) {
+            rval = MPI_File_set_view(fhandle, offset + k*nbytes, etype, filetype, "native", MPI_INFO_NULL);
+            ierr = MPIERRQ(rval); CHKERRQ(ierr);
 
-    ierr = PetscViewerBinaryOpen(PETSC_COMM_WORLD, this->m_FileName.c_str(), FILE_MODE_WRITE, &viewer); CHKERRQ(ierr);
-    ierr = Assert(viewer != NULL, "could not write binary file"); CHKERRQ(ierr);
-    ierr = VecView(x, viewer); CHKERRQ(ierr);
+            ierr = VecGetArray(x[k], &p_x); CHKERRQ(ierr);
+            if (header.encoding == VELQUANTIZED) {
+                switch (header.scalarsize) {
+                    case 1:  EncodeValues<unsigned char>(p_x, buffer.data(), nl, header.offset[k], header.step[k]); break;
+                    case 2:  EncodeValues<unsigned short>(p_x, buffer.data(), nl, header.offset[k], header.step[k]); break;
+                    default: EncodeValues<unsigned int>(p_x, buffer.data(), nl, header.offset[k], header.step[k]); break;
+                }
+                rval = MPI_File_write_all(fhandle, buffer.data(), static_cast<int>(nl), etype, &status);
+            } else {
+                rval = MPI_File_write_all(fhandle, p_x, static_cast<int>(nl), etype, &status);
+            }
+            ierr = MPIERRQ(rval); CHKERRQ(ierr);
+            ierr = VecRestoreArray(x[k], &p_x); CHKERRQ(ierr);
+        }
 
-    // clean up
-    if (viewer != NULL) {
-        ierr = PetscViewerDestroy(&viewer); CHKERRQ(ierr);
-        viewer = NULL;
+        rval = MPI_Type_free(&filetype);
+        ierr = MPIERRQ(rval); CHKERRQ(ierr);
+    }
+
+    rval = MPI_File_close(&fhandle);
+    ierr = MPIERRQ(rval); CHKERRQ(ierr);
+
+    if (this->m_Opt->m_Verbosity > 1) {
+        ss << "vector field container: " << filesize << " bytes (compression ratio "
+           << std::fixed << std::setprecision(1)
+           << static_cast<double>(3*ng*sizeof(ScalarType))/static_cast<double>(filesize) << ")";
+        ierr = DbgMsg(ss.str()); CHKERRQ(ierr);
+        ss.clear(); ss.str(std::string());
     }
 
+    this->m_Opt->Exit(__func__);
+
     PetscFunctionReturn(ierr);
 }
 
@@ -1542,6 +3939,7 @@ PetscErrorCode ReadWriteReg::ReadNC(Vec* x) {
     IntType nl, ng;
     ScalarType *p_x = NULL;
     MPI_Offset istart[3], isize[3];
+    MPI_Info info;
     PetscFunctionBegin;
 
     MPI_Comm_rank(PETSC_COMM_WORLD, &rank);
@@ -1556,8 +3954,10 @@ PetscErrorCode ReadWriteReg::ReadNC(Vec* x) {
     ierr = VecCreate(*x, nl, ng); CHKERRQ(ierr);
 
     // open file
-    ncerr = ncmpi_open(PETSC_COMM_WORLD,this->m_FileName.c_str(), NC_NOWRITE, MPI_INFO_NULL, &fileid);
+    ierr = this->GetIOHints(&info); CHKERRQ(ierr);
+    ncerr = ncmpi_open(PETSC_COMM_WORLD,this->m_FileName.c_str(), NC_NOWRITE, info, &fileid);
     ierr = NCERRQ(ncerr); CHKERRQ(ierr);
+    MPI_Info_free(&info);
 
     // query info about field named "data"
     ncerr = ncmpi_inq(fileid, &ndims, &nvars, &ngatts, &unlimited);
@@ -1597,6 +3997,7 @@ PetscErrorCode ReadWriteReg::WriteNC(Vec x) {
     int nl;
     MPI_Offset istart[3], isize[3];
     MPI_Comm c_comm;
+    MPI_Info info;
     ScalarType *p_x = NULL;
     bool usecdf5 = false;   // CDF-5 is mandatory for large files (>= 2x10^9 cells)
 
@@ -1615,8 +4016,10 @@ PetscErrorCode ReadWriteReg::WriteNC(Vec x) {
     c_comm = this->m_Opt->m_FFT.mpicomm;
 
     // create netcdf file
-    ncerr = ncmpi_create(c_comm, this->m_FileName.c_str(), mode, MPI_INFO_NULL, &fileid);
+    ierr = this->GetIOHints(&info); CHKERRQ(ierr);
+    ncerr = ncmpi_create(c_comm, this->m_FileName.c_str(), mode, info, &fileid);
     ierr = NCERRQ(ncerr); CHKERRQ(ierr);
+    MPI_Info_free(&info);
 
     nx[0] = static_cast<int>(this->m_Opt->m_Domain.nx[0]);
     nx[1] = static_cast<int>(this->m_Opt->m_Domain.nx[1]);
@@ -1673,6 +4076,135 @@ PetscErrorCode ReadWriteReg::WriteNC(Vec x) {
 
 
 
+/********************************************************************
+ * @brief write time series to netcdf file; the time dimension is
+ * unlimited (records can be appended); all records (and components)
+ * are posted as nonblocking requests and written at once, so that
+ * pnetcdf can aggregate them into a single collective write
+ *******************************************************************/
+#ifdef REG_HAS_PNETCDF
+PetscErrorCode ReadWriteReg::WriteTimeSeriesNC(Vec x, IntType nr, IntType j0) {
+    PetscErrorCode ierr = 0;
+    int ncerr, rval, mode, fileid, varid, ndims, nvardims, dims[5], nreq;
+    IntType nl, ng, nlx, nc;
+    MPI_Offset start[5], count[5];
+    MPI_Info info;
+    ScalarType *p_x = NULL;
+    std::vector<int> requests, statuses;
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    ierr = Assert(x != NULL, "null pointer"); CHKERRQ(ierr);
+
+    nl = this->m_Opt->m_Domain.nl;
+    ng = this->m_Opt->m_Domain.ng;
+
+    // number of components of each record
+    ierr = VecGetLocalSize(x, &nlx); CHKERRQ(ierr);
+    ierr = Assert(nlx % (nr*nl) == 0, "size mismatch"); CHKERRQ(ierr);
+    nc = nlx / (nr*nl);
+    ndims = nc > 1 ? 5 : 4;
+
+    ierr = this->GetIOHints(&info); CHKERRQ(ierr);
+
+    if (j0 == 0) {
+        // CDF-5 is mandatory if a record exceeds 4GB
+        if (static_cast<double>(nc*ng)*sizeof(ScalarType) >= 4294967296.0) {
+            mode = NC_CLOBBER | NC_64BIT_DATA;
+        } else {
+            mode = NC_CLOBBER | NC_64BIT_OFFSET;
+        }
+
+        // create netcdf file
+        ncerr = ncmpi_create(PETSC_COMM_WORLD, this->m_FileName.c_str(), mode, info, &fileid);
+        ierr = NCERRQ(ncerr); CHKERRQ(ierr);
+
+        // set size
+        ncerr = ncmpi_def_dim(fileid, "time", NC_UNLIMITED, &dims[0]);
+        ierr = NCERRQ(ncerr); CHKERRQ(ierr);
+        if (nc > 1) {
+            ncerr = ncmpi_def_dim(fileid, "component", nc, &dims[1]);
+            ierr = NCERRQ(ncerr); CHKERRQ(ierr);
+        }
+        ncerr = ncmpi_def_dim(fileid, "x", this->m_Opt->m_Domain.nx[0], &dims[ndims-3]);
+        ierr = NCERRQ(ncerr); CHKERRQ(ierr);
+        ncerr = ncmpi_def_dim(fileid, "y", this->m_Opt->m_Domain.nx[1], &dims[ndims-2]);
+        ierr = NCERRQ(ncerr); CHKERRQ(ierr);
+        ncerr = ncmpi_def_dim(fileid, "z", this->m_Opt->m_Domain.nx[2], &dims[ndims-1]);
+        ierr = NCERRQ(ncerr); CHKERRQ(ierr);
+
+        // define name for output field
+#if defined(PETSC_USE_REAL_SINGLE)
+        ncerr = ncmpi_def_var(fileid, "data", NC_FLOAT, ndims, dims, &varid);
+#else
+        ncerr = ncmpi_def_var(fileid, "data", NC_DOUBLE, ndims, dims, &varid);
+#endif
+        ierr = NCERRQ(ncerr); CHKERRQ(ierr);
+        ncerr = ncmpi_enddef(fileid);
+        ierr = NCERRQ(ncerr); CHKERRQ(ierr);
+    } else {
+        // append to existing file
+        ncerr = ncmpi_open(PETSC_COMM_WORLD, this->m_FileName.c_str(), NC_WRITE, info, &fileid);
+        ierr = NCERRQ(ncerr); CHKERRQ(ierr);
+        ncerr = ncmpi_inq_varid(fileid, "data", &varid);
+        ierr = NCERRQ(ncerr); CHKERRQ(ierr);
+        ncerr = ncmpi_inq_varndims(fileid, varid, &nvardims);
+        ierr = NCERRQ(ncerr); CHKERRQ(ierr);
+        ierr = Assert(nvardims == ndims, "number of components does not match"); CHKERRQ(ierr);
+    }
+
+    rval = MPI_Info_free(&info);
+    ierr = MPIERRQ(rval); CHKERRQ(ierr);
+
+    // local block of each record
+    for (int i = 0; i < 3; ++i) {
+        start[ndims-3+i] = static_cast<MPI_Offset>(this->m_Opt->m_Domain.istart[i]);
+        count[ndims-3+i] = static_cast<MPI_Offset>(this->m_Opt->m_Domain.isize[i]);
+    }
+    count[0] = 1; count[1] = 1;
+
+    nreq = static_cast<int>(nr*nc);
+    try {
+        requests.assign(nreq, NC_REQ_NULL);
+        statuses.assign(nreq, NC_NOERR);
+    } catch (std::bad_alloc& err) {
+        ierr = reg::ThrowError(err); CHKERRQ(ierr);
+    }
+
+    // post nonblocking writes for all records and components
+    ierr = VecGetArray(x, &p_x); CHKERRQ(ierr);
+    for (IntType j = 0; j < nr; ++j) {
+        for (IntType k = 0; k < nc; ++k) {
+            start[0] = static_cast<MPI_Offset>(j0 + j);
+            if (nc > 1) start[1] = static_cast<MPI_Offset>(k);
+            ncerr = ncmpi_iput_vara(fileid, varid, start, count, p_x + (j*nc + k)*nl,
+                                    nl, MPIU_SCALAR, &requests[j*nc + k]);
+            ierr = NCERRQ(ncerr); CHKERRQ(ierr);
+        }
+    }
+
+    // write data (collective)
+    ncerr = ncmpi_wait_all(fileid, nreq, requests.data(), statuses.data());
+    ierr = NCERRQ(ncerr); CHKERRQ(ierr);
+    ierr = VecRestoreArray(x, &p_x); CHKERRQ(ierr);
+    for (int i = 0; i < nreq; ++i) {
+        ierr = NCERRQ(statuses[i]); CHKERRQ(ierr);
+    }
+
+    // close file
+    ncerr = ncmpi_close(fileid);
+    ierr = NCERRQ(ncerr); CHKERRQ(ierr);
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+#endif
+
+
+
+
 }  // namespace reg
 
 
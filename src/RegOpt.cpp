@@ -80,6 +80,9 @@ void RegOpt::Copy(const RegOpt& opt) {
     this->m_FFT.ostart[1] = opt.m_FFT.ostart[1];
     this->m_FFT.ostart[2] = opt.m_FFT.ostart[2];
 
+    this->m_FFT.usewisdom = opt.m_FFT.usewisdom;
+    this->m_FFT.wisdompath = opt.m_FFT.wisdompath;
+
     this->m_Domain.nl = opt.m_Domain.nl;
     this->m_Domain.ng = opt.m_Domain.ng;
     this->m_Domain.isize[0] = opt.m_Domain.isize[0];
@@ -108,6 +111,8 @@ void RegOpt::Copy(const RegOpt& opt) {
     this->m_RegNorm.beta[1] = opt.m_RegNorm.beta[1];  // weight for identity operator in regularization norms (constant)
     this->m_RegNorm.beta[2] = opt.m_RegNorm.beta[2];  // weight for regularization operator A[div(v)] (incompressibility)
     this->m_RegNorm.beta[3] = opt.m_RegNorm.beta[3];  // former regularization weight (for monitor)
+    this->m_RegNorm.pcgtol = opt.m_RegNorm.pcgtol;
+    this->m_RegNorm.pcgmaxit = opt.m_RegNorm.pcgmaxit;
 
     this->m_PDESolver.type = opt.m_PDESolver.type;
     this->m_PDESolver.rkorder = opt.m_PDESolver.rkorder;
@@ -123,6 +128,7 @@ void RegOpt::Copy(const RegOpt& opt) {
     this->m_Sigma[0] = opt.m_Sigma[0];
     this->m_Sigma[1] = opt.m_Sigma[1];
     this->m_Sigma[2] = opt.m_Sigma[2];
+    this->m_SmoothType = opt.m_SmoothType;
 
     this->m_KrylovMethod.tol[0] = opt.m_KrylovMethod.tol[0];
     this->m_KrylovMethod.tol[1] = opt.m_KrylovMethod.tol[1];
@@ -136,6 +142,16 @@ void RegOpt::Copy(const RegOpt& opt) {
     this->m_KrylovMethod.matvectype = opt.m_KrylovMethod.matvectype;
     this->m_KrylovMethod.checkhesssymmetry = opt.m_KrylovMethod.checkhesssymmetry;
     this->m_KrylovMethod.hessshift = opt.m_KrylovMethod.hessshift;
+    this->m_KrylovMethod.nrecycle = opt.m_KrylovMethod.nrecycle;
+    this->m_KrylovMethod.lrrank = opt.m_KrylovMethod.lrrank;
+    this->m_KrylovMethod.lroversample = opt.m_KrylovMethod.lroversample;
+    this->m_KrylovMethod.lrreuse = opt.m_KrylovMethod.lrreuse;
+    this->m_KrylovMethod.mglevels = opt.m_KrylovMethod.mglevels;
+    this->m_KrylovMethod.mgcycle = opt.m_KrylovMethod.mgcycle;
+    this->m_KrylovMethod.mgsmooth = opt.m_KrylovMethod.mgsmooth;
+    this->m_KrylovMethod.mgcoarsetol = opt.m_KrylovMethod.mgcoarsetol;
+    this->m_KrylovMethod.hessblocksize = opt.m_KrylovMethod.hessblocksize;
+    this->m_KrylovMethod.hessmaxstride = opt.m_KrylovMethod.hessmaxstride;
 
     this->m_OptPara.maxiter = opt.m_OptPara.maxiter;
     this->m_OptPara.miniter = opt.m_OptPara.miniter;
@@ -160,6 +176,9 @@ void RegOpt::Copy(const RegOpt& opt) {
     // flags
     this->m_ReadWriteFlags.readfiles = opt.m_ReadWriteFlags.readfiles;
     this->m_ReadWriteFlags.readvelocity = opt.m_ReadWriteFlags.readvelocity;
+    this->m_ReadWriteFlags.rescaleonread = opt.m_ReadWriteFlags.rescaleonread;
+    this->m_ReadWriteFlags.normalizedref = opt.m_ReadWriteFlags.normalizedref;
+    this->m_ReadWriteFlags.normalizedtemp = opt.m_ReadWriteFlags.normalizedtemp;
 
     this->m_ReadWriteFlags.templateim = opt.m_ReadWriteFlags.templateim;
     this->m_ReadWriteFlags.referenceim = opt.m_ReadWriteFlags.referenceim;
@@ -174,10 +193,18 @@ void RegOpt::Copy(const RegOpt& opt) {
     this->m_ReadWriteFlags.invresidual = opt.m_ReadWriteFlags.invresidual;
     this->m_ReadWriteFlags.velnorm = opt.m_ReadWriteFlags.velnorm;
     this->m_ReadWriteFlags.deftemplate = opt.m_ReadWriteFlags.deftemplate;
+    this->m_ReadWriteFlags.asyncio = opt.m_ReadWriteFlags.asyncio;
+    this->m_ReadWriteFlags.asynciomem = opt.m_ReadWriteFlags.asynciomem;
+    this->m_ReadWriteFlags.iostripes = opt.m_ReadWriteFlags.iostripes;
+    this->m_ReadWriteFlags.iostripesize = opt.m_ReadWriteFlags.iostripesize;
+    this->m_ReadWriteFlags.velencoding = opt.m_ReadWriteFlags.velencoding;
+    this->m_ReadWriteFlags.velcutoff = opt.m_ReadWriteFlags.velcutoff;
+    this->m_ReadWriteFlags.veltolerance = opt.m_ReadWriteFlags.veltolerance;
 
     this->m_FileNames.mr = opt.m_FileNames.mr;
     this->m_FileNames.mt = opt.m_FileNames.mt;
     this->m_FileNames.mask = opt.m_FileNames.mask;
+    this->m_FileNames.regweight = opt.m_FileNames.regweight;
     this->m_FileNames.iv1 = opt.m_FileNames.iv1;
     this->m_FileNames.iv2 = opt.m_FileNames.iv2;
     this->m_FileNames.iv3 = opt.m_FileNames.iv3;
@@ -323,6 +350,19 @@ PetscErrorCode RegOpt::ParseArguments(int argc, char** argv) {
                 ierr = this->Usage(true); CHKERRQ(ierr);
             }
             values.clear();
+        } else if (strcmp(argv[1], "-smoothtype") == 0) {
+            argc--; argv++;
+            if (strcmp(argv[1], "auto") == 0) {
+                this->m_SmoothType = AUTOSMOOTH;
+            } else if (strcmp(argv[1], "fft") == 0) {
+                this->m_SmoothType = SPECTRALSMOOTH;
+            } else if (strcmp(argv[1], "stencil") == 0) {
+                this->m_SmoothType = STENCILSMOOTH;
+            } else {
+                msg = "\n\x1b[31m smoothing method not defined: %s\x1b[0m\n";
+                ierr = PetscPrintf(PETSC_COMM_WORLD, msg.c_str(), argv[1]); CHKERRQ(ierr);
+                ierr = this->Usage(true); CHKERRQ(ierr);
+            }
         } else if (strcmp(argv[1], "-disablesmoothing") == 0) {
             this->m_RegFlags.applysmoothing = false;
         } else if (strcmp(argv[1], "-disablerescaling") == 0) {
@@ -353,6 +393,10 @@ PetscErrorCode RegOpt::ParseArguments(int argc, char** argv) {
                 ierr = this->Usage(true); CHKERRQ(ierr);
             }
             values.clear();
+        } else if (strcmp(argv[1], "-fftwisdom") == 0) {
+            argc--; argv++;
+            this->m_FFT.wisdompath = argv[1];
+            this->m_FFT.usewisdom = true;
         } else if (strcmp(argv[1], "-mr") == 0) {
             argc--; argv++;
             this->m_FileNames.mr.push_back(argv[1]);
@@ -388,6 +432,9 @@ PetscErrorCode RegOpt::ParseArguments(int argc, char** argv) {
         } else if (strcmp(argv[1], "-mask") == 0) {
             argc--; argv++;
             this->m_FileNames.mask = argv[1];
+        } else if (strcmp(argv[1], "-regweight") == 0) {
+            argc--; argv++;
+            this->m_FileNames.regweight = argv[1];
         } else if (strcmp(argv[1], "-v1") == 0) {
             argc--; argv++;
             this->m_FileNames.iv1 = argv[1];
@@ -397,6 +444,11 @@ PetscErrorCode RegOpt::ParseArguments(int argc, char** argv) {
         } else if (strcmp(argv[1], "-v3") == 0) {
             argc--; argv++;
             this->m_FileNames.iv3 = argv[1];
+        } else if (strcmp(argv[1], "-v") == 0) {
+            argc--; argv++;
+            this->m_FileNames.iv1 = argv[1];
+            this->m_FileNames.iv2 = argv[1];
+            this->m_FileNames.iv3 = argv[1];
         } else if (strcmp(argv[1], "-x") == 0) {
             argc--; argv++;
             this->m_FileNames.xfolder = argv[1];
@@ -409,6 +461,10 @@ PetscErrorCode RegOpt::ParseArguments(int argc, char** argv) {
                 this->m_FileNames.extension = ".nc";
             } else if (strcmp(argv[1], "nifti") == 0) {
                 this->m_FileNames.extension = ".nii.gz";
+            } else if (strcmp(argv[1], "niftiuc") == 0) {
+                this->m_FileNames.extension = ".nii";
+            } else if (strcmp(argv[1], "raw") == 0) {
+                this->m_FileNames.extension = ".craw";
             } else if (strcmp(argv[1], "hdf5") == 0) {
                 this->m_FileNames.extension = ".hdf5";
             } else if (strcmp(argv[1], "binary") == 0) {
@@ -418,6 +474,23 @@ PetscErrorCode RegOpt::ParseArguments(int argc, char** argv) {
                 ierr = PetscPrintf(PETSC_COMM_WORLD, msg.c_str(), argv[1]); CHKERRQ(ierr);
                 ierr = this->Usage(true); CHKERRQ(ierr);
             }
+        } else if (strcmp(argv[1], "-velformat") == 0) {
+            argc--; argv++;
+            if (strcmp(argv[1], "full") == 0) {
+                this->m_ReadWriteFlags.velencoding = VELFULL;
+            } else if (strcmp(argv[1], "spectral") == 0) {
+                this->m_ReadWriteFlags.velencoding = VELSPECTRAL;
+                argc--; argv++;
+                this->m_ReadWriteFlags.velcutoff = static_cast<ScalarType>(atof(argv[1]));
+            } else if (strcmp(argv[1], "quantized") == 0) {
+                this->m_ReadWriteFlags.velencoding = VELQUANTIZED;
+                argc--; argv++;
+                this->m_ReadWriteFlags.veltolerance = static_cast<ScalarType>(atof(argv[1]));
+            } else {
+                msg = "\n\x1b[31m velocity format not supported: %s\x1b[0m\n";
+                ierr = PetscPrintf(PETSC_COMM_WORLD, msg.c_str(), argv[1]); CHKERRQ(ierr);
+                ierr = this->Usage(true); CHKERRQ(ierr);
+            }
         } else if (strcmp(argv[1], "-velocity") == 0) {
             this->m_ReadWriteFlags.velocity = true;
         } else if (strcmp(argv[1], "-deftemplate") == 0) {
@@ -442,6 +515,15 @@ PetscErrorCode RegOpt::ParseArguments(int argc, char** argv) {
             this->m_ReadWriteFlags.defmap = true;
         } else if (strcmp(argv[1], "-iterates") == 0) {
             this->m_ReadWriteFlags.iterates = true;
+        } else if (strcmp(argv[1], "-asyncio") == 0) {
+            argc--; argv++;
+            this->m_ReadWriteFlags.asyncio = true;
+            this->m_ReadWriteFlags.asynciomem = static_cast<IntType>(atoi(argv[1]));
+        } else if (strcmp(argv[1], "-iostripes") == 0) {
+            argc--; argv++;
+            this->m_ReadWriteFlags.iostripes = static_cast<IntType>(atoi(argv[1]));
+            argc--; argv++;
+            this->m_ReadWriteFlags.iostripesize = static_cast<IntType>(atoi(argv[1]));
         } else if (strcmp(argv[1], "-timeseries") == 0) {
             this->m_ReadWriteFlags.timeseries = true;
         } else if (strcmp(argv[1], "-checkpoints") == 0) {
@@ -487,6 +569,8 @@ PetscErrorCode RegOpt::ParseArguments(int argc, char** argv) {
                 this->m_OptPara.method = FULLNEWTON;
             } else if (strcmp(argv[1], "gn") == 0) {
                 this->m_OptPara.method = GAUSSNEWTON;
+            } else if (strcmp(argv[1], "lbfgs") == 0) {
+                this->m_OptPara.method = QUASINEWTON;
             } else {
                 msg = "\n\x1b[31m optimization method not defined: %s\x1b[0m\n";
                 ierr = PetscPrintf(PETSC_COMM_WORLD, msg.c_str(), argv[1]); CHKERRQ(ierr);
@@ -565,6 +649,9 @@ PetscErrorCode RegOpt::ParseArguments(int argc, char** argv) {
             } else if (strcmp(argv[1], "gmres") == 0) {
                 this->m_KrylovMethod.solver = GMRES;
                 this->m_KrylovMethod.name = "GMRES";
+            } else if (strcmp(argv[1], "pipecg") == 0) {
+                this->m_KrylovMethod.solver = PIPECG;
+                this->m_KrylovMethod.name = "PIPECG";
             } else {
                 msg = "\n\x1b[31m optimization method not defined: %s\x1b[0m\n";
                 ierr = PetscPrintf(PETSC_COMM_WORLD, msg.c_str(), argv[1]); CHKERRQ(ierr);
@@ -576,6 +663,9 @@ PetscErrorCode RegOpt::ParseArguments(int argc, char** argv) {
         } else if (strcmp(argv[1], "-krylovtol") == 0) {
             argc--; argv++;
             this->m_KrylovMethod.tol[0] = atof(argv[1]);
+        } else if (strcmp(argv[1], "-krylovrecycle") == 0) {
+            argc--; argv++;
+            this->m_KrylovMethod.nrecycle = atoi(argv[1]);
         } else if (strcmp(argv[1], "-krylovfseq") == 0) {
             argc--; argv++;
             if (strcmp(argv[1], "none") == 0) {
@@ -604,6 +694,13 @@ PetscErrorCode RegOpt::ParseArguments(int argc, char** argv) {
                 this->m_KrylovMethod.matvectype = PRECONDMATVECSYM;
                 this->m_GridCont.nxmin = 64;
 //                 this->m_KrylovMethod.matvectype = PRECONDMATVEC;
+            } else if (strcmp(argv[1], "lowrank") == 0) {
+                this->m_KrylovMethod.pctype = LOWRANK;
+                this->m_KrylovMethod.matvectype = PRECONDMATVECSYM;
+            } else if (strcmp(argv[1], "mg") == 0) {
+                this->m_KrylovMethod.pctype = MULTILEVEL;
+                this->m_KrylovMethod.matvectype = PRECONDMATVECSYM;
+                this->m_GridCont.nxmin = 64;
             } else {
                 msg = "\n\x1b[31m preconditioner not defined: %s\x1b[0m\n";
                 ierr = PetscPrintf(PETSC_COMM_WORLD, msg.c_str(), argv[1]); CHKERRQ(ierr);
@@ -612,6 +709,35 @@ PetscErrorCode RegOpt::ParseArguments(int argc, char** argv) {
         } else if (strcmp(argv[1], "-gridscale") == 0) {
             argc--; argv++;
             this->m_KrylovMethod.pcgridscale = atof(argv[1]);
+        } else if (strcmp(argv[1], "-lowrank") == 0) {
+            argc--; argv++;
+            this->m_KrylovMethod.lrrank = atoi(argv[1]);
+        } else if (strcmp(argv[1], "-lowrankoversample") == 0) {
+            argc--; argv++;
+            this->m_KrylovMethod.lroversample = atoi(argv[1]);
+        } else if (strcmp(argv[1], "-lowrankreuse") == 0) {
+            argc--; argv++;
+            this->m_KrylovMethod.lrreuse = atoi(argv[1]);
+        } else if (strcmp(argv[1], "-mglevels") == 0) {
+            argc--; argv++;
+            this->m_KrylovMethod.mglevels = atoi(argv[1]);
+        } else if (strcmp(argv[1], "-mgcycle") == 0) {
+            argc--; argv++;
+            if (strcmp(argv[1], "v") == 0) {
+                this->m_KrylovMethod.mgcycle = 1;
+            } else if (strcmp(argv[1], "w") == 0) {
+                this->m_KrylovMethod.mgcycle = 2;
+            } else {
+                msg = "\n\x1b[31m cycle type not defined: %s\x1b[0m\n";
+                ierr = PetscPrintf(PETSC_COMM_WORLD, msg.c_str(), argv[1]); CHKERRQ(ierr);
+                ierr = this->Usage(true); CHKERRQ(ierr);
+            }
+        } else if (strcmp(argv[1], "-mgsmooth") == 0) {
+            argc--; argv++;
+            this->m_KrylovMethod.mgsmooth = atoi(argv[1]);
+        } else if (strcmp(argv[1], "-mgcoarsetol") == 0) {
+            argc--; argv++;
+            this->m_KrylovMethod.mgcoarsetol = atof(argv[1]);
         } else if (strcmp(argv[1], "-pcsolver") == 0) {
             argc--; argv++;
             if (strcmp(argv[1], "pcg") == 0) {
@@ -629,6 +755,17 @@ PetscErrorCode RegOpt::ParseArguments(int argc, char** argv) {
                 ierr = PetscPrintf(PETSC_COMM_WORLD, msg.c_str(), argv[1]); CHKERRQ(ierr);
                 ierr = this->Usage(); CHKERRQ(ierr);
             }
+        } else if (strcmp(argv[1], "-pceigest") == 0) {
+            argc--; argv++;
+            if (strcmp(argv[1], "petsc") == 0) {
+                this->m_KrylovMethod.usepetsceigest = true;
+            } else if (strcmp(argv[1], "lanczos") == 0) {
+                this->m_KrylovMethod.usepetsceigest = false;
+            } else {
+                msg = "\n\x1b[31m eigenvalue estimator not defined: %s\x1b[0m\n";
+                ierr = PetscPrintf(PETSC_COMM_WORLD, msg.c_str(), argv[1]); CHKERRQ(ierr);
+                ierr = this->Usage(); CHKERRQ(ierr);
+            }
         } else if (strcmp(argv[1], "-reesteigvals") == 0) {
             argc--; argv++;
             if (strcmp(argv[1], "krylov") == 0) {
@@ -650,6 +787,12 @@ PetscErrorCode RegOpt::ParseArguments(int argc, char** argv) {
             this->m_KrylovMethod.pcmaxit = atoi(argv[1]);
         } else if (strcmp(argv[1], "-checksymmetry") == 0) {
             this->m_KrylovMethod.checkhesssymmetry = true;
+        } else if (strcmp(argv[1], "-hessblocksize") == 0) {
+            argc--; argv++;
+            this->m_KrylovMethod.hessblocksize = atoi(argv[1]);
+        } else if (strcmp(argv[1], "-inexacthess") == 0) {
+            argc--; argv++;
+            this->m_KrylovMethod.hessmaxstride = atoi(argv[1]);
         } else if (strcmp(argv[1], "-pdesolver") == 0) {
             argc--; argv++;
             if (strcmp(argv[1], "rk2") == 0) {
@@ -729,6 +872,12 @@ PetscErrorCode RegOpt::ParseArguments(int argc, char** argv) {
         } else if (strcmp(argv[1], "-beta-div") == 0) {
             argc--; argv++;
             this->m_RegNorm.beta[2] = atof(argv[1]);
+        } else if (strcmp(argv[1], "-regweighttol") == 0) {
+            argc--; argv++;
+            this->m_RegNorm.pcgtol = atof(argv[1]);
+        } else if (strcmp(argv[1], "-regweightmaxit") == 0) {
+            argc--; argv++;
+            this->m_RegNorm.pcgmaxit = atoi(argv[1]);
         } else if (strcmp(argv[1], "-train") == 0) {
             if (this->m_ParaCont.enabled) {
                 msg = "\n\x1b[31m you can't do training and continuation simultaneously\x1b[0m\n";
@@ -884,6 +1033,8 @@ PetscErrorCode RegOpt::DestroyFFT() {
     PetscErrorCode ierr = 0;
     PetscFunctionBegin;
 
+    ierr = this->ClearSpectralWorkspace(); CHKERRQ(ierr);
+
     if (this->m_FFT.plan != NULL) {
         accfft_destroy_plan(this->m_FFT.plan);
         accfft_cleanup();
@@ -906,6 +1057,7 @@ PetscErrorCode RegOpt::DestroyFFT() {
 PetscErrorCode RegOpt::InitializeFFT() {
     PetscErrorCode ierr = 0;
     int nx[3], isize[3], istart[3], osize[3], ostart[3], rank, nalloc, iporder;
+    IntType nallocold;
     std::stringstream ss;
     ScalarType *u = NULL;
     ScalarType fftsetuptime;
@@ -938,6 +1090,7 @@ PetscErrorCode RegOpt::InitializeFFT() {
     // get sizes (n is an integer, so it can overflow)
     nalloc = accfft_local_size_dft_r2c_t<ScalarType>(nx, isize, istart, osize, ostart, this->m_FFT.mpicomm);
     //ierr = Assert(nalloc > 0 && nalloc < std::numeric_limits<int>::max(), "allocation error"); CHKERRQ(ierr);
+    nallocold = this->m_FFT.nalloc;
     this->m_FFT.nalloc = static_cast<IntType>(nalloc);
 
     iporder = this->m_PDESolver.iporder;
@@ -969,12 +1122,8 @@ PetscErrorCode RegOpt::InitializeFFT() {
     u = reinterpret_cast<ScalarType*>(accfft_alloc(nalloc));
     ierr = Assert(u != NULL, "allocation failed"); CHKERRQ(ierr);
 
-    // set up the fft
-    if (this->m_Verbosity > 2) {
-        ss << " >> " << __func__ << ": allocation (size = " << nalloc << ")";
-        ierr = DbgMsg(ss.str()); CHKERRQ(ierr);
-        ss.clear(); ss.str(std::string());
-    }
+    // the plan is measured (ACCFFT_MEASURE), i.e., the arrays are
+    // overwritten; we do not use the shared spectral work arrays
     uk = reinterpret_cast<ComplexType*>(accfft_alloc(nalloc));
     ierr = Assert(uk != NULL, "allocation failed"); CHKERRQ(ierr);
 
@@ -984,16 +1133,23 @@ PetscErrorCode RegOpt::InitializeFFT() {
         }
         accfft_destroy_plan(this->m_FFT.plan);
         this->m_FFT.plan = NULL;
+
+        // spectral work arrays for previous grid
+        if (nallocold != this->m_FFT.nalloc) {
+            ierr = this->ClearSpectralWorkspace(nallocold); CHKERRQ(ierr);
+        }
     }
 
     if (this->m_Verbosity > 2) {
         ierr = DbgMsg("allocating fft plan"); CHKERRQ(ierr);
     }
     fftsetuptime = -MPI_Wtime();
+    ierr = this->ImportFFTWisdom(nx); CHKERRQ(ierr);
     this->m_FFT.plan = accfft_plan_dft_3d_r2c(nx, u, reinterpret_cast<ScalarType*>(uk),
                                               this->m_FFT.mpicomm, ACCFFT_MEASURE);
     fftsetuptime += MPI_Wtime();
     ierr = Assert(this->m_FFT.plan != NULL, "allocation failed"); CHKERRQ(ierr);
+    ierr = this->ExportFFTWisdom(nx); CHKERRQ(ierr);
 
     // set the fft setup time
     this->m_Timer[FFTSETUP][LOG] += fftsetuptime;
@@ -1026,6 +1182,361 @@ PetscErrorCode RegOpt::InitializeFFT() {
 
 
 
+/********************************************************************
+ * @brief lease spectral work array; all spectral kernels (regularization,
+ * preprocessing, grid change operators, spectral operators in the
+ * optimization problem) lease their complex arrays from this class
+ * instead of allocating their own; there is one pool per allocation
+ * size; arrays are handed back with ReleaseSpectralWorkspace and reused
+ * by the next lease of the same size; the pool of a size is freed when
+ * the fft plan for that size is destroyed (arrays leased at that point
+ * are freed as well, i.e., borrowers that keep their arrays have to
+ * lease them again after the grid changed)
+ * @param xhat pointer to spectral array
+ * @param nalloc allocation size (size of fft plan on current grid if
+ * not set)
+ *******************************************************************/
+PetscErrorCode RegOpt::GetSpectralWorkspace(ComplexType** xhat) {
+    PetscErrorCode ierr = 0;
+    PetscFunctionBegin;
+
+    ierr = Assert(this->m_FFT.nalloc > 0, "fft not initialized"); CHKERRQ(ierr);
+    ierr = this->GetSpectralWorkspace(xhat, this->m_FFT.nalloc); CHKERRQ(ierr);
+
+    PetscFunctionReturn(ierr);
+}
+PetscErrorCode RegOpt::GetSpectralWorkspace(ComplexType** xhat, IntType nalloc) {
+    PetscErrorCode ierr = 0;
+    std::stringstream ss;
+    PetscFunctionBegin;
+
+    this->Enter(__func__);
+
+    ierr = Assert(nalloc > 0, "invalid allocation size"); CHKERRQ(ierr);
+
+    // pool for given allocation size
+    std::vector<ComplexType*>& pool = this->m_FFT.workspace[nalloc];
+
+    if (pool.empty()) {
+        if (this->m_Verbosity > 2) {
+            ss << "allocating spectral work array (size = " << nalloc << ")";
+            ierr = DbgMsg(ss.str()); CHKERRQ(ierr);
+            ss.clear(); ss.str(std::string());
+        }
+        *xhat = reinterpret_cast<ComplexType*>(accfft_alloc(nalloc));
+        ierr = Assert(*xhat != NULL, "allocation failed"); CHKERRQ(ierr);
+    } else {
+        *xhat = pool.back();
+        pool.pop_back();
+    }
+    this->m_FFT.leases[*xhat] = nalloc;
+
+    this->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief hand leased spectral work array back to its pool
+ * @param xhat pointer to spectral array (set to NULL)
+ *******************************************************************/
+PetscErrorCode RegOpt::ReleaseSpectralWorkspace(ComplexType** xhat) {
+    PetscErrorCode ierr = 0;
+    std::map<ComplexType*, IntType>::iterator it;
+    PetscFunctionBegin;
+
+    if (*xhat == NULL) PetscFunctionReturn(ierr);
+
+    it = this->m_FFT.leases.find(*xhat);
+    if (it != this->m_FFT.leases.end()) {
+        this->m_FFT.workspace[it->second].push_back(*xhat);
+        this->m_FFT.leases.erase(it);
+    }
+    *xhat = NULL;
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief free spectral work arrays of given allocation size (called
+ * when the fft plan for this size is destroyed)
+ * @param nalloc allocation size
+ *******************************************************************/
+PetscErrorCode RegOpt::ClearSpectralWorkspace(IntType nalloc) {
+    PetscErrorCode ierr = 0;
+    std::map<IntType, std::vector<ComplexType*> >::iterator itpool;
+    std::map<ComplexType*, IntType>::iterator itlease;
+    PetscFunctionBegin;
+
+    itpool = this->m_FFT.workspace.find(nalloc);
+    if (itpool != this->m_FFT.workspace.end()) {
+        for (size_t i = 0; i < itpool->second.size(); ++i) {
+            accfft_free(itpool->second[i]);
+        }
+        this->m_FFT.workspace.erase(itpool);
+    }
+
+    itlease = this->m_FFT.leases.begin();
+    while (itlease != this->m_FFT.leases.end()) {
+        if (itlease->second == nalloc) {
+            accfft_free(itlease->first);
+            this->m_FFT.leases.erase(itlease++);
+        } else {
+            ++itlease;
+        }
+    }
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief free all spectral work arrays
+ *******************************************************************/
+PetscErrorCode RegOpt::ClearSpectralWorkspace() {
+    PetscErrorCode ierr = 0;
+    PetscFunctionBegin;
+
+    for (std::map<IntType, std::vector<ComplexType*> >::iterator it = this->m_FFT.workspace.begin();
+         it != this->m_FFT.workspace.end(); ++it) {
+        for (size_t i = 0; i < it->second.size(); ++i) {
+            accfft_free(it->second[i]);
+        }
+    }
+    this->m_FFT.workspace.clear();
+
+    for (std::map<ComplexType*, IntType>::iterator it = this->m_FFT.leases.begin();
+         it != this->m_FFT.leases.end(); ++it) {
+        accfft_free(it->first);
+    }
+    this->m_FFT.leases.clear();
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief get file name for fftw wisdom; the wisdom depends on the
+ * grid size, the processor layout (local pencil sizes), the number
+ * of threads and the precision, so all of these enter the key
+ * @param filename file name for wisdom
+ * @param nx grid size
+ *******************************************************************/
+PetscErrorCode RegOpt::GetFFTWisdomFileName(std::string& filename, int* nx) {
+    PetscErrorCode ierr = 0;
+    int nprocs;
+    std::stringstream ss;
+
+    PetscFunctionBegin;
+
+    MPI_Comm_size(PETSC_COMM_WORLD, &nprocs);
+
+    ss  << this->m_FFT.wisdompath << "fftw-wisdom"
+        << "-nx" << nx[0] << "x" << nx[1] << "x" << nx[2]
+        << "-np" << this->m_CartGridDims[0] << "x" << this->m_CartGridDims[1]
+        << "-nr" << nprocs
+        << "-nt" << this->m_NumThreads
+#if defined(PETSC_USE_REAL_SINGLE)
+        << "-single.wis";
+#else
+        << "-double.wis";
+#endif
+    filename = ss.str();
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief import fftw wisdom from file (if it exists); the file is
+ * read on the master rank and broadcasted to all other ranks;
+ * subsequent plans created with ACCFFT_MEASURE will then be set up
+ * at virtually no cost
+ * @param nx grid size
+ *******************************************************************/
+PetscErrorCode RegOpt::ImportFFTWisdom(int* nx) {
+    PetscErrorCode ierr = 0;
+    int rank, merr, success;
+    long long nchars = 0;
+    std::string filename, wisdom;
+    std::stringstream ss;
+    std::ifstream ifs;
+
+    PetscFunctionBegin;
+
+    if (!this->m_FFT.usewisdom) {
+        PetscFunctionReturn(ierr);
+    }
+
+    this->Enter(__func__);
+
+    MPI_Comm_rank(PETSC_COMM_WORLD, &rank);
+
+    ierr = this->GetFFTWisdomFileName(filename, nx); CHKERRQ(ierr);
+
+    // read wisdom on master rank
+    if (rank == 0) {
+        ifs.open(filename.c_str(), std::ios::in | std::ios::binary);
+        if (ifs.is_open()) {
+            ss << ifs.rdbuf();
+            wisdom = ss.str();
+            ss.clear(); ss.str(std::string());
+            ifs.close();
+        }
+        nchars = static_cast<long long>(wisdom.size());
+    }
+
+    merr = MPI_Bcast(&nchars, 1, MPI_LONG_LONG, 0, PETSC_COMM_WORLD);
+    ierr = MPIERRQ(merr); CHKERRQ(ierr);
+
+    // no wisdom found; plans will be measured and exported
+    if (nchars == 0) {
+        if (this->m_Verbosity > 1) {
+            ierr = DbgMsg("no fftw wisdom found (" + filename + ")"); CHKERRQ(ierr);
+        }
+        this->Exit(__func__);
+        PetscFunctionReturn(ierr);
+    }
+
+    wisdom.resize(static_cast<size_t>(nchars));
+    merr = MPI_Bcast(&wisdom[0], static_cast<int>(nchars), MPI_CHAR, 0, PETSC_COMM_WORLD);
+    ierr = MPIERRQ(merr); CHKERRQ(ierr);
+
+#if defined(PETSC_USE_REAL_SINGLE)
+    success = fftwf_import_wisdom_from_string(wisdom.c_str());
+#else
+    success = fftw_import_wisdom_from_string(wisdom.c_str());
+#endif
+    if (success == 0) {
+        ierr = WrngMsg("could not import fftw wisdom from " + filename); CHKERRQ(ierr);
+    } else if (this->m_Verbosity > 1) {
+        ierr = DbgMsg("imported fftw wisdom from " + filename); CHKERRQ(ierr);
+    }
+
+    this->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief export fftw wisdom to file; the local plans differ between
+ * ranks (pencil sizes), so we gather the wisdom of all ranks on the
+ * master rank, merge it and write it to file
+ * @param nx grid size
+ *******************************************************************/
+PetscErrorCode RegOpt::ExportFFTWisdom(int* nx) {
+    PetscErrorCode ierr = 0;
+    int rank, nprocs, merr, nlocal, *nchars = NULL, *offset = NULL;
+    char *lwisdom = NULL, *gwisdom = NULL, *mwisdom = NULL;
+    std::string filename;
+    std::ofstream ofs;
+
+    PetscFunctionBegin;
+
+    if (!this->m_FFT.usewisdom) {
+        PetscFunctionReturn(ierr);
+    }
+
+    this->Enter(__func__);
+
+    MPI_Comm_rank(PETSC_COMM_WORLD, &rank);
+    MPI_Comm_size(PETSC_COMM_WORLD, &nprocs);
+
+    // export local wisdom (includes null character)
+#if defined(PETSC_USE_REAL_SINGLE)
+    lwisdom = fftwf_export_wisdom_to_string();
+#else
+    lwisdom = fftw_export_wisdom_to_string();
+#endif
+    ierr = Assert(lwisdom != NULL, "export of fftw wisdom failed"); CHKERRQ(ierr);
+    nlocal = static_cast<int>(strlen(lwisdom)) + 1;
+
+    if (rank == 0) {
+        try {nchars = new int[nprocs];}
+        catch (std::bad_alloc& err) {
+            ierr = reg::ThrowError(err); CHKERRQ(ierr);
+        }
+        try {offset = new int[nprocs];}
+        catch (std::bad_alloc& err) {
+            ierr = reg::ThrowError(err); CHKERRQ(ierr);
+        }
+    }
+
+    merr = MPI_Gather(&nlocal, 1, MPI_INT, nchars, 1, MPI_INT, 0, PETSC_COMM_WORLD);
+    ierr = MPIERRQ(merr); CHKERRQ(ierr);
+
+    if (rank == 0) {
+        offset[0] = 0;
+        for (int p = 1; p < nprocs; ++p) {
+            offset[p] = offset[p-1] + nchars[p-1];
+        }
+        try {gwisdom = new char[offset[nprocs-1] + nchars[nprocs-1]];}
+        catch (std::bad_alloc& err) {
+            ierr = reg::ThrowError(err); CHKERRQ(ierr);
+        }
+    }
+
+    merr = MPI_Gatherv(lwisdom, nlocal, MPI_CHAR, gwisdom, nchars, offset,
+                       MPI_CHAR, 0, PETSC_COMM_WORLD);
+    ierr = MPIERRQ(merr); CHKERRQ(ierr);
+
+    if (rank == 0) {
+        // merge wisdom of all ranks (the wisdom of the
+        // master rank has already been accumulated)
+        for (int p = 1; p < nprocs; ++p) {
+#if defined(PETSC_USE_REAL_SINGLE)
+            fftwf_import_wisdom_from_string(&gwisdom[offset[p]]);
+#else
+            fftw_import_wisdom_from_string(&gwisdom[offset[p]]);
+#endif
+        }
+#if defined(PETSC_USE_REAL_SINGLE)
+        mwisdom = fftwf_export_wisdom_to_string();
+#else
+        mwisdom = fftw_export_wisdom_to_string();
+#endif
+        ierr = Assert(mwisdom != NULL, "export of fftw wisdom failed"); CHKERRQ(ierr);
+
+        ierr = this->GetFFTWisdomFileName(filename, nx); CHKERRQ(ierr);
+        ofs.open(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        if (ofs.is_open()) {
+            ofs << mwisdom;
+            ofs.close();
+        } else {
+            ierr = WrngMsg("could not write fftw wisdom to " + filename); CHKERRQ(ierr);
+        }
+    }
+
+    // clean up (strings are allocated by fftw with malloc)
+    if (lwisdom != NULL) {free(lwisdom); lwisdom = NULL;}
+    if (mwisdom != NULL) {free(mwisdom); mwisdom = NULL;}
+    if (gwisdom != NULL) {delete [] gwisdom; gwisdom = NULL;}
+    if (nchars != NULL) {delete [] nchars; nchars = NULL;}
+    if (offset != NULL) {delete [] offset; offset = NULL;}
+
+    this->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
 /********************************************************************
  * @brief initialize class variables
  *******************************************************************/
@@ -1045,6 +1556,11 @@ PetscErrorCode RegOpt::Initialize() {
     this->m_FFT.ostart[0] = 0;
     this->m_FFT.ostart[1] = 0;
     this->m_FFT.ostart[2] = 0;
+    this->m_FFT.nalloc = 0;
+    this->m_FFT.usewisdom = false;                  ///< do not import/export fftw wisdom
+    this->m_FFT.wisdompath.clear();
+    this->m_FFT.workspace.clear();
+    this->m_FFT.leases.clear();
 
     this->m_Domain = {};
     this->m_Domain.nl = 0;
@@ -1073,6 +1589,8 @@ PetscErrorCode RegOpt::Initialize() {
     this->m_RegNorm.beta[1] = 1E-4;                 ///< default regularization parameter for norm (idenity)
     this->m_RegNorm.beta[2] = 1E-4;                 ///< default regularization parameter for divergence of velocity
     this->m_RegNorm.beta[3] = 0;                    ///< not used
+    this->m_RegNorm.pcgtol = 1E-6;                  ///< tolerance for inversion of variable coefficient operator
+    this->m_RegNorm.pcgmaxit = 50;                  ///< max iterations for inversion of variable coefficient operator
 
     this->m_Distance = {};
     this->m_Distance.type = SL2;                        ///< default distance measure (squared l2 distance)
@@ -1092,6 +1610,7 @@ PetscErrorCode RegOpt::Initialize() {
     this->m_Sigma[0] = 1.0;
     this->m_Sigma[1] = 1.0;
     this->m_Sigma[2] = 1.0;
+    this->m_SmoothType = AUTOSMOOTH;   ///< select spectral or real space filter based on sigma
 
 //#if defined(PETSC_USE_REAL_SINGLE)
 //    this->m_KrylovMethod.tol[0] = 1E-9;     ///< relative tolerance
@@ -1139,8 +1658,25 @@ PetscErrorCode RegOpt::Initialize() {
 //    this->m_KrylovMethod.matvectype = PRECONDMATVECSYM;
     this->m_KrylovMethod.reesteigvals = 0;
     this->m_KrylovMethod.eigvalsestimated = false;
+    this->m_KrylovMethod.eigvals[0] = 0.0;
+    this->m_KrylovMethod.eigvals[1] = 0.0;
+    this->m_KrylovMethod.eigvalsbeta = -1.0;     ///< no eigenvalue estimates cached
     this->m_KrylovMethod.checkhesssymmetry = false;
     this->m_KrylovMethod.hessshift = 0.0;
+    this->m_KrylovMethod.nrecycle = 0;          ///< krylov recycling is disabled
+    this->m_KrylovMethod.lrrank = 20;           ///< rank of low-rank preconditioner
+    this->m_KrylovMethod.lroversample = 5;      ///< oversampling (randomized range finder)
+    this->m_KrylovMethod.lrreuse = 3;           ///< rebuild low-rank preconditioner every 3 newton iterations
+    this->m_KrylovMethod.mglevels = 3;          ///< fine grid and two coarse grids
+    this->m_KrylovMethod.mgcycle = 1;           ///< v-cycle
+    this->m_KrylovMethod.mgsmooth = 2;          ///< number of smoothing steps
+    this->m_KrylovMethod.mgcoarsetol = 1E-6;    ///< solve tightly on coarsest grid
+    this->m_KrylovMethod.hessblocksize = 4;     ///< max number of vectors in block hessian matvec
+    this->m_KrylovMethod.hessmaxstride = 1;     ///< inexact hessian matvecs are disabled
+    this->m_KrylovMethod.hessstride = 1;        ///< hessian matvecs use the time step of the pde solver
+    this->m_KrylovMethod.r0norm = 0.0;
+    this->m_KrylovMethod.rnorm0 = 0.0;
+    this->m_KrylovMethod.rtargetnorm = 0.0;
 
     // tolerances for optimization
     this->m_OptPara = {};
@@ -1180,6 +1716,9 @@ PetscErrorCode RegOpt::Initialize() {
     this->m_ReadWriteFlags.referenceim = false;     ///< read reference image from file
     this->m_ReadWriteFlags.readfiles = false;       ///< read images from file
     this->m_ReadWriteFlags.readvelocity = false;    ///< read velocity from file
+    this->m_ReadWriteFlags.rescaleonread = false;   ///< rescale images when they are read (registration only)
+    this->m_ReadWriteFlags.normalizedref = false;   ///< reference image has been rescaled when it was read
+    this->m_ReadWriteFlags.normalizedtemp = false;  ///< template image has been rescaled when it was read
     this->m_ReadWriteFlags.timeseries = false;      ///< write time series to file (time dependent variables; use with caution) to file
     this->m_ReadWriteFlags.iterates = false;        ///< write iterates (velocity field; use with caution) to file
     this->m_ReadWriteFlags.velocity = false;        ///< write results (velocity field) to file
@@ -1191,6 +1730,13 @@ PetscErrorCode RegOpt::Initialize() {
     this->m_ReadWriteFlags.deffield = false;        ///< write deformation field / displacement field to file
     this->m_ReadWriteFlags.velnorm = false;         ///< write norm of velocity field to file
     this->m_ReadWriteFlags.deftemplate = false;     ///< write deformed template image to file
+    this->m_ReadWriteFlags.asyncio = false;         ///< write output asynchronously
+    this->m_ReadWriteFlags.asynciomem = 1024;       ///< bound for memory of pending output (in MB)
+    this->m_ReadWriteFlags.iostripes = 0;           ///< number of stripes of output files (file system default)
+    this->m_ReadWriteFlags.iostripesize = 0;        ///< stripe size of output files (file system default)
+    this->m_ReadWriteFlags.velencoding = VELNONE;   ///< write velocity components to separate files
+    this->m_ReadWriteFlags.velcutoff = 0.5;         ///< cutoff for band-limited velocity (fraction of nyquist frequency)
+    this->m_ReadWriteFlags.veltolerance = 1E-3;     ///< error bound for quantized velocity (relative to max abs value)
 
     this->m_FileNames = {};
     this->m_FileNames.mr.clear();
@@ -1204,6 +1750,7 @@ PetscErrorCode RegOpt::Initialize() {
     this->m_FileNames.isc.clear();
     this->m_FileNames.xsc.clear();
     this->m_FileNames.mask.clear();
+    this->m_FileNames.regweight.clear();
     this->m_FileNames.xfolder.clear();
     this->m_FileNames.ifolder.clear();
     this->m_FileNames.extension.clear();
@@ -1315,6 +1862,7 @@ PetscErrorCode RegOpt::Usage(bool advanced) {
         std::cout << " -v1 <file>                  x1 component of velocity field (*.nii, *.nii.gz, *.hdr, *.nc)" << std::endl;
         std::cout << " -v2 <file>                  x2 component of velocity field (*.nii, *.nii.gz, *.hdr, *.nc)" << std::endl;
         std::cout << " -v3 <file>                  x3 component of velocity field (*.nii, *.nii.gz, *.hdr, *.nc)" << std::endl;
+        std::cout << " -v <file>                   velocity field container (*.cvel; see -velformat)" << std::endl;
         std::cout << " -mrc <int> <files>          list of reference images (*.nii, *.nii.gz, *.hdr), where <int>" << std::endl;
         std::cout << "                             is the number of images for (registration of vector valued data)" << std::endl;
         std::cout << " -mtc <int> <files>          list of template images (*.nii, *.nii.gz, *.hdr), where <int>" << std::endl;
@@ -1322,9 +1870,17 @@ PetscErrorCode RegOpt::Usage(bool advanced) {
         std::cout << " -mask <file>                file that contains an indicator function to mask the evaluation" << std::endl;
         std::cout << "                             of the distance measure; the mask should be smooth" << std::endl;
         std::cout << "                             (*.nii, *.nii.gz, *.hdr, *.nc)" << std::endl;
+        std::cout << " -regweight <file>           file that contains a (strictly positive) spatially varying weight" << std::endl;
+        std::cout << "                             for the regularization operator (only for h1 and h1-sn)" << std::endl;
+        std::cout << "                             (*.nii, *.nii.gz, *.hdr, *.nc)" << std::endl;
         std::cout << " -sigma <int>x<int>x<int>    size of gaussian smoothing kernel applied to input images" << std::endl;
         std::cout << "                             (e.g., 1x2x1; units: voxel size; if only one value is set" << std::endl;
         std::cout << "                             (i.e., -sigma 2) uniform smoothing is assumed; default: 1x1x1)" << std::endl;
+        std::cout << " -smoothtype <type>          method to apply gaussian smoothing" << std::endl;
+        std::cout << "                             <type> is one of the following" << std::endl;
+        std::cout << "                                 auto         stencil for small sigma, fft otherwise (default)" << std::endl;
+        std::cout << "                                 fft          filter in spectral domain" << std::endl;
+        std::cout << "                                 stencil      separable filter in real space" << std::endl;
         std::cout << " -nc <int>                   number of image components" << std::endl;
         std::cout << " -disablesmoothing           flag: switch off smoothing of image data" << std::endl;
         std::cout << " -disablerescaling           flag: switch off rescaling of intensities of image data to [0,1]" << std::endl;
@@ -1355,6 +1911,8 @@ PetscErrorCode RegOpt::Usage(bool advanced) {
         std::cout << "                             <type> is one of the following" << std::endl;
         std::cout << "                                 gn           Gauss-Newton (default)" << std::endl;
         std::cout << "                                 fn           full Newton" << std::endl;
+        std::cout << "                                 lbfgs        limited memory BFGS (no hessian matvecs;" << std::endl;
+        std::cout << "                                              fast mode for moderate accuracy)" << std::endl;
         std::cout << " -opttol <dbl>               tolerance for optimization (default: 1E-2)" << std::endl;
         std::cout << " -gabs <dbl>                 tolerance for optimization (default: 1E-6)" << std::endl;
         std::cout << "                                 lower bound for gradient" << std::endl;
@@ -1378,6 +1936,9 @@ PetscErrorCode RegOpt::Usage(bool advanced) {
         std::cout << "                                 fpcg         flexible preconditioned conjugate gradient method" << std::endl;
         std::cout << "                                 fgmres       flexible generalized minimal residual method" << std::endl;
         std::cout << "                                 gmres        generalized minimal residual method" << std::endl;
+        std::cout << "                                 pipecg       pipelined preconditioned conjugate gradient method" << std::endl;
+        std::cout << "                                              (one non-blocking reduction per iteration, overlapped" << std::endl;
+        std::cout << "                                              with preconditioner and hessian matvec; for many ranks)" << std::endl;
         std::cout << " -krylovmaxit <int>          maximum number of (inner) Krylov iterations (default: 50)" << std::endl;
         std::cout << " -krylovfseq <type>          forcing sequence for Krylov solver (tolerance for inner iterations)" << std::endl;
         std::cout << "                             <type> is one of the following" << std::endl;
@@ -1386,14 +1947,33 @@ PetscErrorCode RegOpt::Usage(bool advanced) {
         std::cout << "                                 none          exact solve (expensive)" << std::endl;
         std::cout << " -krylovtol <dbl>            relative tolerance for krylov method (default: 1E-12); forcing sequence" << std::endl;
         std::cout << "                             needs to be switched off (i.g., use with '-krylovfseq none')" << std::endl;
+        std::cout << " -krylovrecycle <int>        number of approximate eigenvectors of hessian recycled across krylov" << std::endl;
+        std::cout << "                             solves (newton iterations); used to deflate the hessian system" << std::endl;
+        std::cout << "                             (default: 0, i.e., off)" << std::endl;
         std::cout << " -precond <type>             preconditioner" << std::endl;
         std::cout << "                             <type> is one of the following" << std::endl;
         std::cout << "                                 none         no preconditioner (not recommended)" << std::endl;
         std::cout << "                                 invreg       inverse regularization operator (default)" << std::endl;
         std::cout << "                                 2level       2-level preconditioner" << std::endl;
-        std::cout << " -gridscale <dbl>            grid scale for 2-level preconditioner (default: 2)" << std::endl;
+        std::cout << "                                 lowrank      low-rank approximation of preconditioned hessian" << std::endl;
+        std::cout << "                                              (randomized eigendecomposition)" << std::endl;
+        std::cout << "                                 mg           multilevel preconditioner (v- or w-cycle)" << std::endl;
+        std::cout << " -gridscale <dbl>            grid scale for 2-level and low-rank preconditioner (default: 2);" << std::endl;
+        std::cout << "                             low-rank approximation is computed on fine grid if set to 1" << std::endl;
+        std::cout << " -lowrank <int>              rank of low-rank preconditioner (default: 20)" << std::endl;
+        std::cout << " -lowrankoversample <int>    oversampling for randomized range finder (default: 5)" << std::endl;
+        std::cout << " -lowrankreuse <int>         number of newton iterations the low-rank preconditioner is" << std::endl;
+        std::cout << "                             reused before it is recomputed (default: 3)" << std::endl;
+        std::cout << " -mglevels <int>             number of grids for multilevel preconditioner (including fine" << std::endl;
+        std::cout << "                             grid; coarsened by grid scale; default: 3)" << std::endl;
+        std::cout << " -mgcycle <type>             cycle for multilevel preconditioner" << std::endl;
+        std::cout << "                             <type> is one of the following" << std::endl;
+        std::cout << "                                 v            v-cycle (default)" << std::endl;
+        std::cout << "                                 w            w-cycle" << std::endl;
+        std::cout << " -mgsmooth <int>             number of pre- and post-smoothing steps (default: 2)" << std::endl;
+        std::cout << " -mgcoarsetol <dbl>          relative tolerance for solve on coarsest grid (default: 1E-6)" << std::endl;
         std::cout << " -pcsolver <type>            solver for inversion of preconditioner (in case" << std::endl;
-        std::cout << "                             the 2-level preconditioner is used)" << std::endl;
+        std::cout << "                             the 2-level preconditioner is used; multilevel: coarsest grid)" << std::endl;
         std::cout << "                             <type> is one of the following" << std::endl;
         std::cout << "                                 cheb         chebyshev method (default)" << std::endl;
         std::cout << "                                 pcg          preconditioned conjugate gradient method" << std::endl;
@@ -1402,6 +1982,12 @@ PetscErrorCode RegOpt::Usage(bool advanced) {
         std::cout << "                                 fgmres       flexible generalized minimal residual method" << std::endl;
         std::cout << " -pcsolvermaxit <int>        maximum number of iterations for inverting preconditioner; is" << std::endl;
         std::cout << "                             used for cheb, fgmres and fpcg; default: 10" << std::endl;
+        std::cout << " -pceigest <type>            estimator for eigenvalues of hessian operator (in case a chebyshev" << std::endl;
+        std::cout << "                             method is used to iteratively invert the preconditioner)" << std::endl;
+        std::cout << "                             <type> is one of the following" << std::endl;
+        std::cout << "                                 petsc        estimate inside chebyshev method (default)" << std::endl;
+        std::cout << "                                 lanczos      lanczos estimate; cached across newton iterations," << std::endl;
+        std::cout << "                                              continuation steps, and grid levels" << std::endl;
         std::cout << " -reesteigvals <flag>        re-estimate eigenvalues of hessian operator at every iteration" << std::endl;
         std::cout << "                             (in case a chebyshev method is used to iteratively invert the" << std::endl;
         std::cout << "                             preconditioner)" << std::endl;
@@ -1415,6 +2001,13 @@ PetscErrorCode RegOpt::Usage(bool advanced) {
         std::cout << "                             this is only recommended in case one want to solve more accurately" << std::endl;
         std::cout << "                             after a warm start (in general for debugging purposes only)" << std::endl;
         std::cout << " -checksymmetry              check symmetry of hessian operator" << std::endl;
+        std::cout << " -hessblocksize <int>        max number of vectors the hessian is applied to at once (shared" << std::endl;
+        std::cout << "                             pde sweeps; used by low-rank preconditioner; default: 4)" << std::endl;
+        std::cout << " -inexacthess <int>          max coarsening factor (power of two) of the time step in the" << std::endl;
+        std::cout << "                             hessian matvec (gauss-newton, semi-lagrangian); the factor is" << std::endl;
+        std::cout << "                             reduced as the krylov residual approaches the tolerance" << std::endl;
+        std::cout << "                             (default: 1, i.e., exact matvecs; pcg/gmres are replaced by" << std::endl;
+        std::cout << "                             fpcg/fgmres and the true residual is checked at convergence)" << std::endl;
         std::cout << " -derivativecheck            check gradient/derivative" << std::endl;
         std::cout << line << std::endl;
         std::cout << " distance measure" << std::endl;
@@ -1446,6 +2039,10 @@ PetscErrorCode RegOpt::Usage(bool advanced) {
         std::cout << "                             this parameter controls a penalty on divergence of the velocity, i.e.," << std::endl;
         std::cout << "                             the incompressibility; the penalty is enabled via '-regnorm h1-div'" << std::endl;
         std::cout << "                             option; details can be found above;" << std::endl;
+        std::cout << " -regweighttol <dbl>         relative tolerance for inverting the regularization operator with" << std::endl;
+        std::cout << "                             spatially varying weight (see '-regweight'; default: 1E-6)" << std::endl;
+        std::cout << " -regweightmaxit <int>       max number of iterations for inverting the regularization operator" << std::endl;
+        std::cout << "                             with spatially varying weight (see '-regweight'; default: 50)" << std::endl;
         std::cout << " -scalecont                  enable scale continuation (continuation in smoothness of images;" << std::endl;
         std::cout << "                             i.e., use a multi-scale scheme to solve optimization problem)" << std::endl;
         std::cout << " -gridcont                   enable grid continuation (continuation in resolution of images;" << std::endl;
@@ -1493,6 +2090,9 @@ PetscErrorCode RegOpt::Usage(bool advanced) {
         std::cout << " -nthreads <int>             number of threads (default: 1)" << std::endl;
         std::cout << " -np <int>x<int>             distribution of mpi tasks (cartesian grid) (example: -np 2x4 results" << std::endl;
         std::cout << "                             results in MPI distribution of size (nx1/2,nx2/4,nx3) for each mpi task)" << std::endl;
+        std::cout << " -fftwisdom <path>           import/export fftw plans (wisdom) from/to files with prefix <path>; files are" << std::endl;
+        std::cout << "                             keyed by grid size, processor layout, number of threads and precision" << std::endl;
+        std::cout << "                             (reduces setup time of fft in subsequent runs)" << std::endl;
         std::cout << line << std::endl;
         std::cout << " logging" << std::endl;
         std::cout << line << std::endl;
@@ -1507,13 +2107,26 @@ PetscErrorCode RegOpt::Usage(bool advanced) {
         std::cout << line << std::endl;
         std::cout << " -iterates                   store/write out iterates (deformed template image and velocity field)" << std::endl;
         std::cout << " -results                    store intermediate results/data (for scale, grid, and para continuation)" << std::endl;
-        std::cout << " -timeseries                 store time series (use with caution)" << std::endl;
+        std::cout << " -timeseries                 store time series (use with caution); for netcdf output, all time" << std::endl;
+        std::cout << "                             points are stored in a single file" << std::endl;
+        std::cout << " -asyncio <int>              write output in the background (uncompressed nifti and raw format);" << std::endl;
+        std::cout << "                             <int> bounds the memory for pending output (in MB)" << std::endl;
+        std::cout << " -iostripes <int> <int>      number of stripes and stripe size (in MB) of files written with mpi-io/netcdf" << std::endl;
+        std::cout << "                             (parallel file systems; 0 uses the file system default)" << std::endl;
         std::cout << " -nx <int>x<int>x<int>       grid size (e.g., 32x64x32); allows user to control grid size for synthetic" << std::endl;
         std::cout << "                             problems; assumed to be uniform if single integer is provided" << std::endl;
         std::cout << " -format <type>              specify the output format for the images/vector fields; default is NIFTI (*.nii.gz)" << std::endl;
         std::cout << "                                 nifti        NIFTI format (*.nii.gz; standard in medical imaging)" << std::endl;
+        std::cout << "                                 niftiuc      uncompressed NIFTI format (*.nii; written in parallel)" << std::endl;
         std::cout << "                                 netcdf       NETCDF format (*.nc; common in simulations/parallel computing)" << std::endl;
+        std::cout << "                                 raw          CLAIRE raw format (*.craw; memory mapped input)" << std::endl;
 //        std::cout << "                                 hdf5         HDF5 format (*.hdf5)" << std::endl;
+        std::cout << " -velformat <type>           write all components of the velocity field to a single container (*.cvel)" << std::endl;
+        std::cout << "                                 full         full precision" << std::endl;
+        std::cout << "                                 spectral <dbl>   fourier coefficients below cutoff <dbl> (fraction of" << std::endl;
+        std::cout << "                                              nyquist frequency in (0,1]; for smooth velocities)" << std::endl;
+        std::cout << "                                 quantized <dbl>  quantized values; max error is <dbl> times max abs" << std::endl;
+        std::cout << "                                              value of each component" << std::endl;
         std::cout << " -synthetic <int>            solve synthetic test problem; <int> ranges from 0 to 3 and defines" << std::endl;
         std::cout << "                             the type of synthetic test problem (use 3 for incompressible velocity)" << std::endl;
         std::cout << " -verbosity <int>            verbosity level (ranges from 0 to 2; default: 0)" << std::endl;
@@ -1628,6 +2241,71 @@ PetscErrorCode RegOpt::CheckArguments() {
         }
     }
 
+    if (!this->m_FileNames.regweight.empty()) {
+        if(!FileExists(this->m_FileNames.regweight)) {
+            msg = "\n\x1b[31m file '" + this->m_FileNames.regweight + "' does not exist\x1b[0m\n";
+            ierr = PetscPrintf(PETSC_COMM_WORLD, msg.c_str()); CHKERRQ(ierr);
+            ierr = this->Usage(true); CHKERRQ(ierr);
+        }
+        if (this->m_RegNorm.type != H1 && this->m_RegNorm.type != H1SN) {
+            msg = "\n\x1b[31m spatially varying regularization weight only supported for h1 and h1-sn\x1b[0m\n";
+            ierr = PetscPrintf(PETSC_COMM_WORLD, msg.c_str()); CHKERRQ(ierr);
+            ierr = this->Usage(true); CHKERRQ(ierr);
+        }
+    }
+
+    if (this->m_KrylovMethod.hessblocksize < 1) {
+        msg = "\n\x1b[31m block size for hessian matvec must be positive\x1b[0m\n";
+        ierr = PetscPrintf(PETSC_COMM_WORLD, msg.c_str()); CHKERRQ(ierr);
+        ierr = this->Usage(true); CHKERRQ(ierr);
+    }
+
+    if (this->m_KrylovMethod.hessmaxstride < 1
+        || (this->m_KrylovMethod.hessmaxstride & (this->m_KrylovMethod.hessmaxstride - 1)) != 0) {
+        msg = "\n\x1b[31m coarsening factor for inexact hessian must be a power of two\x1b[0m\n";
+        ierr = PetscPrintf(PETSC_COMM_WORLD, msg.c_str()); CHKERRQ(ierr);
+        ierr = this->Usage(true); CHKERRQ(ierr);
+    }
+
+    // the inexact hessian changes during the krylov solve; flexible
+    // methods do not make this exact (they only tolerate a varying
+    // preconditioner), but they are more robust to the loss of
+    // orthogonality; the true residual is checked at convergence
+    if (this->m_KrylovMethod.hessmaxstride > 1) {
+        if (this->m_KrylovMethod.solver == PCG || this->m_KrylovMethod.solver == PIPECG) {
+            ierr = WrngMsg("inexact hessian: switching to fpcg"); CHKERRQ(ierr);
+            this->m_KrylovMethod.solver = FCG;
+            this->m_KrylovMethod.name = "FCG";
+        } else if (this->m_KrylovMethod.solver == GMRES) {
+            ierr = WrngMsg("inexact hessian: switching to fgmres"); CHKERRQ(ierr);
+            this->m_KrylovMethod.solver = FGMRES;
+            this->m_KrylovMethod.name = "FGMRES";
+        }
+    }
+
+    if (this->m_KrylovMethod.pctype == LOWRANK) {
+        if (this->m_KrylovMethod.lrrank <= 0 || this->m_KrylovMethod.lroversample < 0
+            || this->m_KrylovMethod.lrreuse <= 0) {
+            msg = "\n\x1b[31m rank and reuse of low-rank preconditioner must be positive\x1b[0m\n";
+            ierr = PetscPrintf(PETSC_COMM_WORLD, msg.c_str()); CHKERRQ(ierr);
+            ierr = this->Usage(true); CHKERRQ(ierr);
+        }
+    }
+
+    if (this->m_KrylovMethod.pctype == MULTILEVEL) {
+        if (this->m_KrylovMethod.mglevels < 2 || this->m_KrylovMethod.mgsmooth < 0
+            || this->m_KrylovMethod.mgcoarsetol <= 0.0 || this->m_KrylovMethod.mgcoarsetol >= 1.0) {
+            msg = "\n\x1b[31m multilevel preconditioner: need at least 2 levels and tolerance in (0,1)\x1b[0m\n";
+            ierr = PetscPrintf(PETSC_COMM_WORLD, msg.c_str()); CHKERRQ(ierr);
+            ierr = this->Usage(true); CHKERRQ(ierr);
+        }
+        if (this->m_KrylovMethod.pcgridscale <= 1.0) {
+            msg = "\n\x1b[31m multilevel preconditioner: grid scale must be larger than 1\x1b[0m\n";
+            ierr = PetscPrintf(PETSC_COMM_WORLD, msg.c_str()); CHKERRQ(ierr);
+            ierr = this->Usage(true); CHKERRQ(ierr);
+        }
+    }
+
     if (this->m_ParaCont.strategy == PCONTINUATION) {
         betav = this->m_ParaCont.targetbeta;
         if (betav <= 0.0 || betav > 1.0) {
@@ -2229,6 +2907,11 @@ PetscErrorCode RegOpt::DisplayOptions() {
                 newtontype = true;
                 break;
             }
+            case QUASINEWTON:
+            {
+                std::cout << "limited memory bfgs method" << std::endl;
+                break;
+            }
             default:
             {
                 ierr = ThrowError("optimization method not implemented"); CHKERRQ(ierr);
@@ -2306,6 +2989,9 @@ PetscErrorCode RegOpt::DisplayOptions() {
                 case FGMRES:
                     this->m_KrylovMethod.name = "FGMRES";
                     break;
+                case PIPECG:
+                    this->m_KrylovMethod.name = "PIPECG";
+                    break;
                 default:
                     ierr = ThrowError("solver not defined"); CHKERRQ(ierr);
                     break;
@@ -2365,6 +3051,18 @@ PetscErrorCode RegOpt::DisplayOptions() {
                     twolevel = true;
                     break;
                 }
+                case LOWRANK:
+                {
+                    std::cout << "low-rank (rank " << this->m_KrylovMethod.lrrank << ")" << std::endl;
+                    break;
+                }
+                case MULTILEVEL:
+                {
+                    std::cout << this->m_KrylovMethod.mglevels << "-level multigrid ("
+                              << (this->m_KrylovMethod.mgcycle == 2 ? "w" : "v") << "-cycle)" << std::endl;
+                    twolevel = true;
+                    break;
+                }
                 case NOPC:
                 {
                     std::cout << "none" << std::endl;
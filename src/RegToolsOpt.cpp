@@ -106,6 +106,11 @@ PetscErrorCode RegToolsOpt::ParseArguments(int argc, char** argv) {
         } else if (strcmp(argv[1], "-v3") == 0) {
             argc--; argv++;
             this->m_FileNames.iv3 = argv[1];
+        } else if (strcmp(argv[1], "-v") == 0) {
+            argc--; argv++;
+            this->m_FileNames.iv1 = argv[1];
+            this->m_FileNames.iv2 = argv[1];
+            this->m_FileNames.iv3 = argv[1];
         } else if (strcmp(argv[1], "-x") == 0) {
             argc--; argv++;
             this->m_FileNames.xfolder = argv[1];
@@ -186,6 +191,19 @@ PetscErrorCode RegToolsOpt::ParseArguments(int argc, char** argv) {
                 ierr = PetscPrintf(PETSC_COMM_WORLD, msg.c_str(), argv[1]); CHKERRQ(ierr);
                 ierr = this->Usage(); CHKERRQ(ierr);
             }
+        } else if (strcmp(argv[1], "-smoothtype") == 0) {
+            argc--; argv++;
+            if (strcmp(argv[1], "auto") == 0) {
+                this->m_SmoothType = AUTOSMOOTH;
+            } else if (strcmp(argv[1], "fft") == 0) {
+                this->m_SmoothType = SPECTRALSMOOTH;
+            } else if (strcmp(argv[1], "stencil") == 0) {
+                this->m_SmoothType = STENCILSMOOTH;
+            } else {
+                msg = "\n\x1b[31m smoothing method not defined: %s\x1b[0m\n";
+                ierr = PetscPrintf(PETSC_COMM_WORLD, msg.c_str(), argv[1]); CHKERRQ(ierr);
+                ierr = this->Usage(); CHKERRQ(ierr);
+            }
         } else if (strcmp(argv[1], "-disablesmoothing") == 0) {
             this->m_RegFlags.applysmoothing = false;
         } else if (strcmp(argv[1], "-nthreads") == 0) {
@@ -210,12 +228,18 @@ PetscErrorCode RegToolsOpt::ParseArguments(int argc, char** argv) {
                 ierr = PetscPrintf(PETSC_COMM_WORLD, msg.c_str(), argv[1]); CHKERRQ(ierr);
                 ierr = this->Usage(); CHKERRQ(ierr);
             }
+        } else if (strcmp(argv[1], "-fftwisdom") == 0) {
+            argc--; argv++;
+            this->m_FFT.wisdompath = argv[1];
+            this->m_FFT.usewisdom = true;
         } else if (strcmp(argv[1], "-convert") == 0) {
             argc--; argv++;
             if (strcmp(argv[1], "2nii") == 0) {
                 this->m_FileNames.extension = ".nii.gz";
             } else if (strcmp(argv[1], "2nc") == 0) {
                 this->m_FileNames.extension = ".nc";
+            } else if (strcmp(argv[1], "2raw") == 0) {
+                this->m_FileNames.extension = ".craw";
             }
             this->m_RegToolFlags.convert = true;
         } else if (strcmp(argv[1], "-usenc") == 0) {
@@ -301,6 +325,8 @@ PetscErrorCode RegToolsOpt::ParseArguments(int argc, char** argv) {
             }
         } else if (strcmp(argv[1], "-resample") == 0) {
             this->m_RegToolFlags.resample = true;
+        } else if (strcmp(argv[1], "-streamed") == 0) {
+            this->m_ResamplingPara.streamed = true;
         } else if (strcmp(argv[1], "-verbosity") == 0) {
             argc--; argv++;
             this->m_Verbosity = std::min(atoi(argv[1]),2);
@@ -376,6 +402,7 @@ PetscErrorCode RegToolsOpt::Initialize() {
     this->m_ResamplingPara.nx[0] = -1.0;
     this->m_ResamplingPara.nx[1] = -1.0;
     this->m_ResamplingPara.nx[2] = -1.0;
+    this->m_ResamplingPara.streamed = false;
 
 //    this->m_NumLabels = -1;
 
@@ -412,6 +439,7 @@ PetscErrorCode RegToolsOpt::Usage(bool advanced) {
         std::cout << " -nthreads <int>             number of threads (default: 1)" << std::endl;
         std::cout << " -np <int>x<int>             distribution of mpi tasks (cartesian grid) (example: -np 2x4 results" << std::endl;
         std::cout << "                             results in MPI distribution of size (nx1/2,nx2/4,nx3) for each mpi task)" << std::endl;
+        std::cout << " -fftwisdom <path>           import/export fftw plans (wisdom) from/to files with prefix <path>" << std::endl;
         }
         // ####################### advanced options #######################
         std::cout << line << std::endl;
@@ -422,6 +450,7 @@ PetscErrorCode RegToolsOpt::Usage(bool advanced) {
         std::cout << " -v1 <file>                  x1-component of vector field (*.nii, *.nii.gz, *.hdr, *.nc)" << std::endl;
         std::cout << " -v2 <file>                  x2-component of vector field (*.nii, *.nii.gz, *.hdr, *.nc)" << std::endl;
         std::cout << " -v3 <file>                  x3-component of vector field (*.nii, *.nii.gz, *.hdr, *.nc)" << std::endl;
+        std::cout << " -v <file>                   vector field container (all components; *.cvel)" << std::endl;
         std::cout << " -ifile <filename>           input file (scalar field/image)" << std::endl;
         std::cout << " -xfile <filename>           output file (scalar field/image)" << std::endl;
         std::cout << " -i <path>                   input path (defines where registration results (i.e., velocity field, " << std::endl;
@@ -470,6 +499,10 @@ PetscErrorCode RegToolsOpt::Usage(bool advanced) {
         std::cout << " -sigma <int>x<int>x<int>    size of gaussian smoothing kernel applied to input images (e.g., 1x2x1;" << std::endl;
         std::cout << "                             units: voxel size; if only one parameter is set" << std::endl;
         std::cout << "                             uniform smoothing is assumed: default: 1x1x1)" << std::endl;
+        std::cout << " -smoothtype <type>          method to apply gaussian smoothing; <type> is one of the following" << std::endl;
+        std::cout << "                                 auto         stencil for small sigma, fft otherwise (default)" << std::endl;
+        std::cout << "                                 fft          filter in spectral domain" << std::endl;
+        std::cout << "                                 stencil      separable filter in real space" << std::endl;
         std::cout << " -disablesmoothing           disable smoothing" << std::endl;
         std::cout << line << std::endl;
         std::cout << " ### solver specific parameters (numerics)" << std::endl;
@@ -482,6 +515,8 @@ PetscErrorCode RegToolsOpt::Usage(bool advanced) {
         std::cout << "                             <type> is one of the following" << std::endl;
         std::cout << "                                 2nii         convert to nifti" << std::endl;
         std::cout << "                                 2nc          convert to netcdf" << std::endl;
+        std::cout << "                                 2raw         convert to raw format (memory mapped input; same" << std::endl;
+        std::cout << "                                              number of tasks required for reading)" << std::endl;
         std::cout << " -nt <int>                   number of time points (for time integration; default: 4)" << std::endl;
         std::cout << " -adapttimestep              vary number of time steps according to defined number" << std::endl;
         std::cout << " -cflnumber <dbl>            set cfl number" << std::endl;
@@ -495,6 +530,8 @@ PetscErrorCode RegToolsOpt::Usage(bool advanced) {
         std::cout << "                             output is resampled_input.ext)" << std::endl;
         std::cout << " -scale                      scale for resampling (multiplier applied to number of grid points)" << std::endl;
         std::cout << " -nxnew                      number of grid points for output" << std::endl;
+        std::cout << " -streamed                   resample in z-slabs (for images that do not fit into memory; requires" << std::endl;
+        std::cout << "                             uncompressed nifti input and output; anti-aliasing filter for downsampling)" << std::endl;
         std::cout << line << std::endl;
         std::cout << " ### other parameters/debugging" << std::endl;
         std::cout << line << std::endl;
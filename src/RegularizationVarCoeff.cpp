@@ -0,0 +1,530 @@
+/*************************************************************************
+ *  Copyright (c) 2016.
+ *  All rights reserved.
+ *  This file is part of the CLAIRE library.
+ *
+ *  CLAIRE is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  CLAIRE is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with CLAIRE.  If not, see <http://www.gnu.org/licenses/>.
+ ************************************************************************/
+
+#ifndef _REGULARIZATIONVARCOEFF_CPP_
+#define _REGULARIZATIONVARCOEFF_CPP_
+
+#include "RegularizationVarCoeff.hpp"
+
+
+
+
+namespace reg {
+
+
+
+
+/********************************************************************
+ * @brief default constructor
+ *******************************************************************/
+RegularizationVarCoeff::RegularizationVarCoeff() : SuperClass() {
+    this->Initialize();
+}
+
+
+
+
+/********************************************************************
+ * @brief default destructor
+ *******************************************************************/
+RegularizationVarCoeff::~RegularizationVarCoeff(void) {
+    this->ClearMemory();
+}
+
+
+
+
+/********************************************************************
+ * @brief constructor
+ *******************************************************************/
+RegularizationVarCoeff::RegularizationVarCoeff(RegOpt* opt) : SuperClass(opt) {
+    this->Initialize();
+}
+
+
+
+
+/********************************************************************
+ * @brief init variables
+ *******************************************************************/
+PetscErrorCode RegularizationVarCoeff::Initialize(void) {
+    PetscFunctionBegin;
+
+    this->m_ConstCoeffReg = NULL;
+    this->m_Weight = NULL;
+
+    this->m_GradV = NULL;
+    this->m_PCGr = NULL;
+    this->m_PCGz = NULL;
+    this->m_PCGp = NULL;
+    this->m_PCGq = NULL;
+
+    PetscFunctionReturn(0);
+}
+
+
+
+
+/********************************************************************
+ * @brief clean up
+ *******************************************************************/
+PetscErrorCode RegularizationVarCoeff::ClearMemory(void) {
+    PetscFunctionBegin;
+
+    if (this->m_ConstCoeffReg != NULL) {
+        delete this->m_ConstCoeffReg;
+        this->m_ConstCoeffReg = NULL;
+    }
+
+    if (this->m_GradV != NULL) {delete this->m_GradV; this->m_GradV = NULL;}
+    if (this->m_PCGr != NULL) {delete this->m_PCGr; this->m_PCGr = NULL;}
+    if (this->m_PCGz != NULL) {delete this->m_PCGz; this->m_PCGz = NULL;}
+    if (this->m_PCGp != NULL) {delete this->m_PCGp; this->m_PCGp = NULL;}
+    if (this->m_PCGq != NULL) {delete this->m_PCGq; this->m_PCGq = NULL;}
+
+    PetscFunctionReturn(0);
+}
+
+
+
+
+/********************************************************************
+ * @brief set spatially varying weight; the weight has to be
+ * strictly positive
+ *******************************************************************/
+PetscErrorCode RegularizationVarCoeff::SetWeight(Vec w) {
+    PetscErrorCode ierr = 0;
+    ScalarType wmin;
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    ierr = Assert(w != NULL, "null pointer"); CHKERRQ(ierr);
+    ierr = VecMin(w, NULL, &wmin); CHKERRQ(ierr);
+    ierr = Assert(wmin > 0.0, "regularization weight has to be positive"); CHKERRQ(ierr);
+
+    this->m_Weight = w;
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief set constant coefficient operator; we take ownership
+ *******************************************************************/
+PetscErrorCode RegularizationVarCoeff::SetPreconditioner(Regularization* reg) {
+    PetscErrorCode ierr = 0;
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    ierr = Assert(reg != NULL, "null pointer"); CHKERRQ(ierr);
+    if (this->m_Opt->m_RegNorm.type != H1 && this->m_Opt->m_RegNorm.type != H1SN) {
+        ierr = ThrowError("variable coefficient regularization only supported for H1 and H1SN"); CHKERRQ(ierr);
+    }
+
+    if (this->m_ConstCoeffReg != NULL && this->m_ConstCoeffReg != reg) {
+        delete this->m_ConstCoeffReg;
+    }
+    this->m_ConstCoeffReg = reg;
+
+    // share spectral data and work vector field
+    if (this->m_v1hat != NULL) {
+        ierr = this->m_ConstCoeffReg->SetSpectralData(this->m_v1hat, this->m_v2hat, this->m_v3hat); CHKERRQ(ierr);
+    }
+    if (this->m_WorkVecField != NULL) {
+        ierr = this->m_ConstCoeffReg->SetWorkVecField(this->m_WorkVecField); CHKERRQ(ierr);
+    }
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief inner product of two vector fields
+ *******************************************************************/
+PetscErrorCode RegularizationVarCoeff::InnerProduct(ScalarType& value, VecField* x, VecField* y) {
+    PetscErrorCode ierr = 0;
+    ScalarType v1, v2, v3;
+    PetscFunctionBegin;
+
+    ierr = VecTDot(x->m_X1, y->m_X1, &v1); CHKERRQ(ierr);
+    ierr = VecTDot(x->m_X2, y->m_X2, &v2); CHKERRQ(ierr);
+    ierr = VecTDot(x->m_X3, y->m_X3, &v3); CHKERRQ(ierr);
+
+    value = v1 + v2 + v3;
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief apply beta_0 (-div(w grad v) + beta_1 v) to v; the
+ * second term is only added for the H1 norm; if addnullspace is
+ * set we add beta_0 times the mean of v (H1SN) to mirror the
+ * treatment of the zero frequency in the spectral inverse
+ *******************************************************************/
+PetscErrorCode RegularizationVarCoeff::ApplyOperator(VecField* Av, VecField* v, bool addnullspace) {
+    PetscErrorCode ierr = 0;
+    ScalarType *p_v[3] = {NULL, NULL, NULL}, *p_av[3] = {NULL, NULL, NULL},
+                *p_gv1 = NULL, *p_gv2 = NULL, *p_gv3 = NULL;
+    Vec av[3], vc[3];
+    ScalarType beta[2], value, ng;
+    std::bitset<3> xyz = 0; xyz[0] = 1; xyz[1] = 1; xyz[2] = 1;
+    double timer[NFFTTIMERS] = {0};
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    ierr = Assert(v != NULL, "null pointer"); CHKERRQ(ierr);
+    ierr = Assert(Av != NULL, "null pointer"); CHKERRQ(ierr);
+    ierr = Assert(Av != v, "input and output have to differ"); CHKERRQ(ierr);
+    ierr = Assert(this->m_Weight != NULL, "null pointer"); CHKERRQ(ierr);
+
+    beta[0] = this->m_Opt->m_RegNorm.beta[0];
+    beta[1] = this->m_Opt->m_RegNorm.type == H1 ? this->m_Opt->m_RegNorm.beta[1] : 0.0;
+
+    if (this->m_GradV == NULL) {
+        try {this->m_GradV = new VecField(this->m_Opt);}
+        catch (std::bad_alloc&) {
+            ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
+        }
+    }
+
+    vc[0] = v->m_X1; vc[1] = v->m_X2; vc[2] = v->m_X3;
+    av[0] = Av->m_X1; av[1] = Av->m_X2; av[2] = Av->m_X3;
+
+    ierr = v->GetArrays(p_v[0], p_v[1], p_v[2]); CHKERRQ(ierr);
+    for (int k = 0; k < 3; ++k) {
+        // gradient of k-th component
+        ierr = this->m_GradV->GetArrays(p_gv1, p_gv2, p_gv3); CHKERRQ(ierr);
+        this->m_Opt->StartTimer(FFTSELFEXEC);
+        accfft_grad_t(p_gv1, p_gv2, p_gv3, p_v[k], this->m_Opt->m_FFT.plan, &xyz, timer);
+        this->m_Opt->StopTimer(FFTSELFEXEC);
+        ierr = this->m_GradV->RestoreArrays(p_gv1, p_gv2, p_gv3); CHKERRQ(ierr);
+        this->m_Opt->IncrementCounter(FFT, FFTGRAD);
+
+        // apply pointwise weight
+        ierr = this->m_GradV->Scale(this->m_Weight); CHKERRQ(ierr);
+
+        // divergence of weighted gradient
+        ierr = VecGetArray(av[k], &p_av[k]); CHKERRQ(ierr);
+        ierr = this->m_GradV->GetArrays(p_gv1, p_gv2, p_gv3); CHKERRQ(ierr);
+        this->m_Opt->StartTimer(FFTSELFEXEC);
+        accfft_divergence_t(p_av[k], p_gv1, p_gv2, p_gv3, this->m_Opt->m_FFT.plan, timer);
+        this->m_Opt->StopTimer(FFTSELFEXEC);
+        ierr = this->m_GradV->RestoreArrays(p_gv1, p_gv2, p_gv3); CHKERRQ(ierr);
+        ierr = VecRestoreArray(av[k], &p_av[k]); CHKERRQ(ierr);
+        this->m_Opt->IncrementCounter(FFT, FFTDIV);
+    }
+    ierr = v->RestoreArrays(p_v[0], p_v[1], p_v[2]); CHKERRQ(ierr);
+
+    // Av = beta_0 (-div(w grad v) + beta_1 v)
+    for (int k = 0; k < 3; ++k) {
+        ierr = VecAXPBY(av[k], beta[0]*beta[1], -beta[0], vc[k]); CHKERRQ(ierr);
+    }
+
+    if (addnullspace && this->m_Opt->m_RegNorm.type == H1SN) {
+        ng = static_cast<ScalarType>(this->m_Opt->m_Domain.ng);
+        for (int k = 0; k < 3; ++k) {
+            ierr = VecSum(vc[k], &value); CHKERRQ(ierr);
+            ierr = VecShift(av[k], beta[0]*value/ng); CHKERRQ(ierr);
+        }
+    }
+
+    // increment fft timer
+    this->m_Opt->IncreaseFFTTimers(timer);
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief evaluates the functional; we use that the gradient
+ * operator is self-adjoint, i.e., R = 0.5 <v, A[v]>
+ *******************************************************************/
+PetscErrorCode RegularizationVarCoeff::EvaluateFunctional(ScalarType* R, VecField* v) {
+    PetscErrorCode ierr = 0;
+    ScalarType beta, hd, value;
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    ierr = Assert(v != NULL, "null pointer"); CHKERRQ(ierr);
+
+    beta = this->m_Opt->m_RegNorm.beta[0];
+    hd  = this->m_Opt->GetLebesgueMeasure();
+
+    *R = 0.0;
+
+    // if regularization weight is zero, do noting
+    if (beta != 0.0) {
+        if (this->m_PCGq == NULL) {
+            try {this->m_PCGq = new VecField(this->m_Opt);}
+            catch (std::bad_alloc&) {
+                ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
+            }
+        }
+        ierr = this->ApplyOperator(this->m_PCGq, v); CHKERRQ(ierr);
+        ierr = this->InnerProduct(value, v, this->m_PCGq); CHKERRQ(ierr);
+        *R = 0.5*hd*value;
+    }
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief evaluates first variation of regularization norm
+ *******************************************************************/
+PetscErrorCode RegularizationVarCoeff::EvaluateGradient(VecField* dvR, VecField* v) {
+    PetscErrorCode ierr = 0;
+    ScalarType beta, hd;
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    ierr = Assert(v != NULL, "null pointer"); CHKERRQ(ierr);
+    ierr = Assert(dvR != NULL, "null pointer"); CHKERRQ(ierr);
+
+    beta = this->m_Opt->m_RegNorm.beta[0];
+    hd  = this->m_Opt->GetLebesgueMeasure();
+
+    // if regularization weight is zero, do noting
+    if (beta == 0.0) {
+        ierr = dvR->SetValue(0.0); CHKERRQ(ierr);
+    } else {
+        ierr = this->ApplyOperator(dvR, v); CHKERRQ(ierr);
+        ierr = dvR->Scale(hd); CHKERRQ(ierr);
+    }
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief applies second variation of regularization norm to
+ * a vector
+ *******************************************************************/
+PetscErrorCode RegularizationVarCoeff::HessianMatVec(VecField* dvvR, VecField* vtilde) {
+    PetscErrorCode ierr = 0;
+    ScalarType beta;
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    ierr = Assert(vtilde != NULL, "null pointer"); CHKERRQ(ierr);
+    ierr = Assert(dvvR != NULL, "null pointer"); CHKERRQ(ierr);
+
+    beta = this->m_Opt->m_RegNorm.beta[0];
+
+    // if regularization weight is zero, do noting
+    if (beta == 0.0) {
+        ierr = dvvR->SetValue(0.0); CHKERRQ(ierr);
+    } else {
+        ierr = this->EvaluateGradient(dvvR, vtilde); CHKERRQ(ierr);
+    }
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief apply the inverse of the regularization operator; the
+ * operator can not be inverted analytically; we solve A[x] = b
+ * iteratively (PCG) using the constant coefficient (spectral)
+ * inverse as a preconditioner; the square root is not available
+ * for the variable coefficient operator, so we fall back to the
+ * constant coefficient operator
+ *******************************************************************/
+PetscErrorCode RegularizationVarCoeff::ApplyInverse(VecField* Ainvx, VecField* x, bool applysqrt) {
+    PetscErrorCode ierr = 0;
+    ScalarType beta, rz, rznew, pq, alpha, rnorm, bnorm, tol;
+    IntType k, maxit;
+    std::stringstream ss;
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    ierr = Assert(x != NULL, "null pointer"); CHKERRQ(ierr);
+    ierr = Assert(Ainvx != NULL, "null pointer"); CHKERRQ(ierr);
+    ierr = Assert(this->m_ConstCoeffReg != NULL, "null pointer"); CHKERRQ(ierr);
+
+    beta = this->m_Opt->m_RegNorm.beta[0];
+
+    // if regularization weight is zero, do noting
+    if (beta == 0.0 || applysqrt) {
+        ierr = this->m_ConstCoeffReg->ApplyInverse(Ainvx, x, applysqrt); CHKERRQ(ierr);
+        this->m_Opt->Exit(__func__);
+        PetscFunctionReturn(ierr);
+    }
+
+    if (this->m_PCGr == NULL) {
+        try {this->m_PCGr = new VecField(this->m_Opt);}
+        catch (std::bad_alloc&) {
+            ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
+        }
+    }
+    if (this->m_PCGz == NULL) {
+        try {this->m_PCGz = new VecField(this->m_Opt);}
+        catch (std::bad_alloc&) {
+            ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
+        }
+    }
+    if (this->m_PCGp == NULL) {
+        try {this->m_PCGp = new VecField(this->m_Opt);}
+        catch (std::bad_alloc&) {
+            ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
+        }
+    }
+    if (this->m_PCGq == NULL) {
+        try {this->m_PCGq = new VecField(this->m_Opt);}
+        catch (std::bad_alloc&) {
+            ierr = reg::ThrowError("allocation failed"); CHKERRQ(ierr);
+        }
+    }
+
+    tol = this->m_Opt->m_RegNorm.pcgtol;
+    maxit = this->m_Opt->m_RegNorm.pcgmaxit;
+
+    ierr = x->Norm(bnorm); CHKERRQ(ierr);
+    if (bnorm == 0.0) {
+        ierr = Ainvx->SetValue(0.0); CHKERRQ(ierr);
+        this->m_Opt->Exit(__func__);
+        PetscFunctionReturn(ierr);
+    }
+
+    // initial guess: constant coefficient inverse
+    ierr = this->m_ConstCoeffReg->ApplyInverse(Ainvx, x); CHKERRQ(ierr);
+
+    // r = b - A[x]
+    ierr = this->ApplyOperator(this->m_PCGq, Ainvx, true); CHKERRQ(ierr);
+    ierr = this->m_PCGr->WAXPY(-1.0, this->m_PCGq, x); CHKERRQ(ierr);
+
+    // z = M^{-1} r, p = z
+    ierr = this->m_ConstCoeffReg->ApplyInverse(this->m_PCGz, this->m_PCGr); CHKERRQ(ierr);
+    ierr = this->m_PCGp->Copy(this->m_PCGz); CHKERRQ(ierr);
+    ierr = this->InnerProduct(rz, this->m_PCGr, this->m_PCGz); CHKERRQ(ierr);
+    ierr = this->m_PCGr->Norm(rnorm); CHKERRQ(ierr);
+
+    k = 0;
+    while (rnorm > tol*bnorm && k < maxit) {
+        ierr = this->ApplyOperator(this->m_PCGq, this->m_PCGp, true); CHKERRQ(ierr);
+        ierr = this->InnerProduct(pq, this->m_PCGp, this->m_PCGq); CHKERRQ(ierr);
+        if (pq <= 0.0) {
+            ierr = WrngMsg("variable coefficient regularization: operator not positive definite"); CHKERRQ(ierr);
+            break;
+        }
+        alpha = rz/pq;
+
+        // x = x + alpha p, r = r - alpha q
+        ierr = Ainvx->AXPY(alpha, this->m_PCGp); CHKERRQ(ierr);
+        ierr = this->m_PCGr->AXPY(-alpha, this->m_PCGq); CHKERRQ(ierr);
+        ierr = this->m_PCGr->Norm(rnorm); CHKERRQ(ierr);
+        ++k;
+
+        if (rnorm <= tol*bnorm) break;
+
+        // z = M^{-1} r, p = z + (r'z)_{k+1}/(r'z)_k p
+        ierr = this->m_ConstCoeffReg->ApplyInverse(this->m_PCGz, this->m_PCGr); CHKERRQ(ierr);
+        ierr = this->InnerProduct(rznew, this->m_PCGr, this->m_PCGz); CHKERRQ(ierr);
+        ierr = this->m_PCGp->Scale(rznew/rz); CHKERRQ(ierr);
+        ierr = this->m_PCGp->AXPY(1.0, this->m_PCGz); CHKERRQ(ierr);
+        rz = rznew;
+    }
+
+    if (this->m_Opt->m_Verbosity > 2) {
+        ss << "pcg (variable coefficient regularization): iterations " << k
+           << ", relative residual " << std::scientific << rnorm/bnorm;
+        ierr = DbgMsg(ss.str()); CHKERRQ(ierr);
+        ss.clear(); ss.str(std::string());
+    }
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief computes the largest and smallest eigenvalue of
+ * the inverse regularization operator; we bound the spectrum
+ * by the constant coefficient operator scaled by the range of
+ * the weight
+ *******************************************************************/
+PetscErrorCode RegularizationVarCoeff::GetExtremeEigValsInvOp(ScalarType& emin, ScalarType& emax) {
+    PetscErrorCode ierr = 0;
+    ScalarType wmin, wmax;
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    ierr = Assert(this->m_ConstCoeffReg != NULL, "null pointer"); CHKERRQ(ierr);
+    ierr = Assert(this->m_Weight != NULL, "null pointer"); CHKERRQ(ierr);
+
+    ierr = this->m_ConstCoeffReg->GetExtremeEigValsInvOp(emin, emax); CHKERRQ(ierr);
+
+    ierr = VecMin(this->m_Weight, NULL, &wmin); CHKERRQ(ierr);
+    ierr = VecMax(this->m_Weight, NULL, &wmax); CHKERRQ(ierr);
+
+    emin /= std::max(wmax, static_cast<ScalarType>(1.0));
+    emax /= std::min(wmin, static_cast<ScalarType>(1.0));
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+}  // end of name space
+
+
+
+
+#endif  // _REGULARIZATIONVARCOEFF_CPP_
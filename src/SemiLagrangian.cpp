@@ -20,6 +20,7 @@
 #ifndef _SEMILAGRANGIAN_CPP_
 #define _SEMILAGRANGIAN_CPP_
 
+#include <algorithm>
 #include "SemiLagrangian.hpp"
 
 
@@ -46,6 +47,12 @@ SemiLagrangian::SemiLagrangian() {
 SemiLagrangian::SemiLagrangian(RegOpt* opt) {
     this->Initialize();
     this->m_Opt = opt;
+
+    // add plan versions for interpolating blocks of scalar
+    // fields (block hessian matvec)
+    for (int i = 2; i <= this->m_Opt->m_KrylovMethod.hessblocksize; ++i) {
+        if (i != 3) this->m_Dofs.push_back(i);
+    }
 }
 
 
@@ -69,6 +76,10 @@ PetscErrorCode SemiLagrangian::Initialize() {
     PetscFunctionBegin;
 
     this->m_X = NULL;
+    this->m_XBlock = NULL;
+    this->m_TrajectoryVelocity = NULL;
+    this->m_TrajectoryIsCached[0] = false;
+    this->m_TrajectoryIsCached[1] = false;
     this->m_WorkVecField1 = NULL;
     this->m_WorkVecField2 = NULL;
 
@@ -77,10 +88,13 @@ PetscErrorCode SemiLagrangian::Initialize() {
 
     this->m_ScaFieldGhost = NULL;
     this->m_VecFieldGhost = NULL;
+    this->m_BlockFieldGhost = NULL;
 
     this->m_Opt = NULL;
-    this->m_Dofs[0] = 1;
-    this->m_Dofs[1] = 3;
+    this->m_TimeStepScale = 1.0;
+    this->m_Dofs.clear();
+    this->m_Dofs.push_back(1);
+    this->m_Dofs.push_back(3);
 
     PetscFunctionReturn(ierr);
 }
@@ -99,6 +113,10 @@ PetscErrorCode SemiLagrangian::ClearMemory() {
         delete [] this->m_X;
         this->m_X = NULL;
     }
+    if (this->m_XBlock != NULL) {
+        delete [] this->m_XBlock;
+        this->m_XBlock = NULL;
+    }
 
     if (this->m_AdjointPlan != NULL) {
         delete this->m_AdjointPlan;
@@ -119,11 +137,23 @@ PetscErrorCode SemiLagrangian::ClearMemory() {
         this->m_VecFieldGhost = NULL;
     }
 
+    if (this->m_BlockFieldGhost != NULL) {
+        accfft_free(this->m_BlockFieldGhost);
+        this->m_BlockFieldGhost = NULL;
+    }
+
     if (this->m_WorkVecField2 != NULL) {
         delete this->m_WorkVecField2;
         this->m_WorkVecField2 = NULL;
     }
 
+    if (this->m_TrajectoryVelocity != NULL) {
+        delete this->m_TrajectoryVelocity;
+        this->m_TrajectoryVelocity = NULL;
+    }
+    this->m_TrajectoryIsCached[0] = false;
+    this->m_TrajectoryIsCached[1] = false;
+
     PetscFunctionReturn(ierr);
 }
 
@@ -146,6 +176,73 @@ PetscErrorCode SemiLagrangian::SetWorkVecField(VecField* x) {
 
 
 
+/********************************************************************
+ * @brief check if the characteristic for the given flag (0: state,
+ * 1: adjoint) was computed for the velocity v; if the velocity
+ * changed, all cached characteristics are invalidated and v is kept
+ * as the new reference
+ *******************************************************************/
+PetscErrorCode SemiLagrangian::IsTrajectoryCached(bool& cached, VecField* v, int k) {
+    PetscErrorCode ierr = 0;
+    PetscBool equal1 = PETSC_FALSE, equal2 = PETSC_FALSE, equal3 = PETSC_FALSE;
+    PetscFunctionBegin;
+
+    cached = false;
+    ierr = Assert(v != NULL, "null pointer"); CHKERRQ(ierr);
+
+    if (this->m_TrajectoryVelocity == NULL) {
+        try {this->m_TrajectoryVelocity = new VecField(this->m_Opt);}
+        catch (std::bad_alloc& err) {
+            ierr = reg::ThrowError(err); CHKERRQ(ierr);
+        }
+        this->m_TrajectoryIsCached[0] = false;
+        this->m_TrajectoryIsCached[1] = false;
+    } else if (this->m_TrajectoryIsCached[0] || this->m_TrajectoryIsCached[1]) {
+        ierr = VecEqual(v->m_X1, this->m_TrajectoryVelocity->m_X1, &equal1); CHKERRQ(ierr);
+        ierr = VecEqual(v->m_X2, this->m_TrajectoryVelocity->m_X2, &equal2); CHKERRQ(ierr);
+        ierr = VecEqual(v->m_X3, this->m_TrajectoryVelocity->m_X3, &equal3); CHKERRQ(ierr);
+        if (equal1 && equal2 && equal3) {
+            cached = this->m_TrajectoryIsCached[k];
+            if (this->m_Opt->m_Verbosity > 2 && cached) {
+                ierr = DbgMsg("trajectory cached for current velocity"); CHKERRQ(ierr);
+            }
+            PetscFunctionReturn(ierr);
+        }
+        this->m_TrajectoryIsCached[0] = false;
+        this->m_TrajectoryIsCached[1] = false;
+    }
+
+    ierr = this->m_TrajectoryVelocity->Copy(v); CHKERRQ(ierr);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/********************************************************************
+ * @brief set scale for time step used to compute the trajectory
+ * (a scale larger than one yields the characteristic for a coarser
+ * time grid; used for inexact hessian matvecs)
+ *******************************************************************/
+PetscErrorCode SemiLagrangian::SetTimeStepScale(ScalarType scale) {
+    PetscErrorCode ierr = 0;
+    PetscFunctionBegin;
+
+    ierr = Assert(scale > 0.0, "time step scale must be positive"); CHKERRQ(ierr);
+    if (this->m_TimeStepScale != scale) {
+        // characteristics were computed for another time step
+        this->m_TrajectoryIsCached[0] = false;
+        this->m_TrajectoryIsCached[1] = false;
+    }
+    this->m_TimeStepScale = scale;
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
 /********************************************************************
  * @brief compute the trajectory from the velocity field based
  * on an rk2 scheme (todo: make the velocity field a const vector)
@@ -153,12 +250,30 @@ PetscErrorCode SemiLagrangian::SetWorkVecField(VecField* x) {
 PetscErrorCode SemiLagrangian::ComputeTrajectory(VecField* v, std::string flag) {
     PetscErrorCode ierr = 0;
     IntType nl;
+    int k = 0;
+    bool cached = false;
     PetscFunctionBegin;
 
     this->m_Opt->Enter(__func__);
 
     nl = this->m_Opt->m_Domain.nl;
 
+    if (strcmp(flag.c_str(), "state") == 0) {
+        k = 0;
+    } else if (strcmp(flag.c_str(), "adjoint") == 0) {
+        k = 1;
+    } else {
+        ierr = ThrowError("flag wrong"); CHKERRQ(ierr);
+    }
+
+    // the characteristic only depends on the velocity; skip the
+    // computation if it has not changed since the last call
+    ierr = this->IsTrajectoryCached(cached, v, k); CHKERRQ(ierr);
+    if (cached) {
+        this->m_Opt->Exit(__func__);
+        PetscFunctionReturn(ierr);
+    }
+
     // if trajectory has not yet been allocated, allocate
     if (this->m_X == NULL) {
         try {this->m_X = new ScalarType[3*nl];}
@@ -176,6 +291,7 @@ PetscErrorCode SemiLagrangian::ComputeTrajectory(VecField* v, std::string flag)
     } else {
         ierr = ThrowError("rk order not implemented"); CHKERRQ(ierr);
     }
+    this->m_TrajectoryIsCached[k] = true;
 
     this->m_Opt->Exit(__func__);
 
@@ -203,7 +319,7 @@ PetscErrorCode SemiLagrangian::ComputeTrajectoryRK2(VecField* v, std::string fla
 
     ierr = Assert(this->m_WorkVecField1 != NULL, "null pointer"); CHKERRQ(ierr);
 
-    ht = this->m_Opt->GetTimeStepSize();
+    ht = this->m_TimeStepScale*this->m_Opt->GetTimeStepSize();
     hthalf = 0.5*ht;
     
     if (this->m_Opt->m_Verbosity > 2) {
@@ -315,7 +431,7 @@ PetscErrorCode SemiLagrangian::ComputeTrajectoryRK4(VecField* v, std::string fla
         }
     }
 
-    ht = this->m_Opt->GetTimeStepSize();
+    ht = this->m_TimeStepScale*this->m_Opt->GetTimeStepSize();
     hthalf = 0.5*ht;
 
     // switch between state and adjoint variable
@@ -361,6 +477,13 @@ PetscErrorCode SemiLagrangian::ComputeTrajectoryRK4(VecField* v, std::string fla
     }  // i3
     ierr = v->RestoreArraysRead(p_v1, p_v2, p_v3); CHKERRQ(ierr);
 
+    // query points no longer correspond to a characteristic
+    if (strcmp(flag.c_str(), "state") == 0) {
+        this->m_TrajectoryIsCached[0] = false;
+    } else if (strcmp(flag.c_str(), "adjoint") == 0) {
+        this->m_TrajectoryIsCached[1] = false;
+    }
+
     // evaluate right hand side
     ierr = this->CommunicateCoord(flag); CHKERRQ(ierr);
     ierr = this->Interpolate(this->m_WorkVecField1, v, flag); CHKERRQ(ierr);
@@ -730,6 +853,113 @@ PetscErrorCode SemiLagrangian::Interpolate(ScalarType* wx1, ScalarType* wx2, Sca
 
 
 
+/********************************************************************
+ * @brief interpolate a block of scalar fields; the ghost points and
+ * the interpolated values of all fields in a block are communicated
+ * at once (the number of fields per block is limited by the
+ * versions of the interpolation plan)
+ * @param xo interpolated scalar fields (n pointers)
+ * @param xi input scalar fields (n pointers; can equal xo)
+ * @param n number of scalar fields
+ *******************************************************************/
+PetscErrorCode SemiLagrangian::Interpolate(ScalarType** xo, ScalarType** xi, int n, std::string flag) {
+    PetscErrorCode ierr = 0;
+    int nx[3], isize_g[3], isize[3], istart_g[3], istart[3], c_dims[2], nghost, order,
+        nmax, nb, version;
+    double timers[4] = {0, 0, 0, 0};
+    IntType nl, nlghost, nalloc;
+    Interp3_Plan* plan = NULL;
+
+    PetscFunctionBegin;
+
+    this->m_Opt->Enter(__func__);
+
+    ierr = Assert(xi != NULL, "null pointer"); CHKERRQ(ierr);
+    ierr = Assert(xo != NULL, "null pointer"); CHKERRQ(ierr);
+
+    nl = this->m_Opt->m_Domain.nl;
+    order = this->m_Opt->m_PDESolver.iporder;
+    nghost = order;
+
+    for (int i = 0; i < 3; ++i) {
+        nx[i] = static_cast<int>(this->m_Opt->m_Domain.nx[i]);
+        isize[i] = static_cast<int>(this->m_Opt->m_Domain.isize[i]);
+        istart[i] = static_cast<int>(this->m_Opt->m_Domain.istart[i]);
+    }
+
+    // get network dimensions
+    c_dims[0] = this->m_Opt->m_CartGridDims[0];
+    c_dims[1] = this->m_Opt->m_CartGridDims[1];
+
+    if (strcmp(flag.c_str(), "state") == 0) {
+        plan = this->m_StatePlan;
+    } else if (strcmp(flag.c_str(), "adjoint") == 0) {
+        plan = this->m_AdjointPlan;
+    } else {
+        ierr = ThrowError("flag wrong"); CHKERRQ(ierr);
+    }
+    ierr = Assert(plan != NULL, "null pointer"); CHKERRQ(ierr);
+
+    // max number of fields we can interpolate at once
+    nmax = *std::max_element(this->m_Dofs.begin(), this->m_Dofs.end());
+
+    // get ghost sizes
+    nalloc = accfft_ghost_xyz_local_size_dft_r2c(this->m_Opt->m_FFT.plan, nghost, isize_g, istart_g);
+    nlghost = 1;
+    for (int i = 0; i < 3; ++i) {
+        nlghost *= static_cast<IntType>(isize_g[i]);
+    }
+
+    if (this->m_BlockFieldGhost == NULL) {
+        this->m_BlockFieldGhost = reinterpret_cast<ScalarType*>(accfft_alloc(nmax*nalloc));
+    }
+    if (this->m_XBlock == NULL) {
+        try {this->m_XBlock = new ScalarType [nmax*nl];}
+        catch (std::bad_alloc& err) {
+            ierr = reg::ThrowError(err); CHKERRQ(ierr);
+        }
+    }
+
+    for (int j = 0; j < n; j += nb) {
+        nb = std::min(nmax, n - j);
+
+        // find version of plan
+        version = static_cast<int>(std::find(this->m_Dofs.begin(), this->m_Dofs.end(), nb)
+                                   - this->m_Dofs.begin());
+        ierr = Assert(version < static_cast<int>(this->m_Dofs.size()), "plan not available"); CHKERRQ(ierr);
+
+        ierr = this->m_Opt->StartTimer(IPSELFEXEC); CHKERRQ(ierr);
+
+        // do the communication for the ghost points
+        for (int k = 0; k < nb; ++k) {
+            ierr = Assert(xi[j+k] != NULL, "null pointer"); CHKERRQ(ierr);
+            accfft_get_ghost_xyz(this->m_Opt->m_FFT.plan, nghost, isize_g, xi[j+k],
+                                 &this->m_BlockFieldGhost[k*nlghost]);
+        }
+
+        plan->interpolate(this->m_BlockFieldGhost, nx, isize, istart,
+                          nl, nghost, this->m_XBlock, c_dims, this->m_Opt->m_FFT.mpicomm, timers, version);
+
+        ierr = this->m_Opt->StopTimer(IPSELFEXEC); CHKERRQ(ierr);
+
+        for (int k = 0; k < nb; ++k) {
+            ierr = Assert(xo[j+k] != NULL, "null pointer"); CHKERRQ(ierr);
+            std::copy(this->m_XBlock + k*nl, this->m_XBlock + (k+1)*nl, xo[j+k]);
+        }
+
+        this->m_Opt->IncrementCounter(IP);
+    }
+
+    this->m_Opt->IncreaseInterpTimers(timers);
+
+    this->m_Opt->Exit(__func__);
+
+    PetscFunctionReturn(0);
+}
+
+
+
+
 /********************************************************************
  * @brief communicate the coordinate vector (query points)
  * @param flag to switch between forward and adjoint solves
@@ -773,7 +1003,7 @@ PetscErrorCode SemiLagrangian::CommunicateCoord(std::string flag) {
             catch (std::bad_alloc& err) {
                 ierr = reg::ThrowError(err); CHKERRQ(ierr);
             }
-            this->m_StatePlan->allocate(nl, this->m_Dofs, 2);
+            this->m_StatePlan->allocate(nl, this->m_Dofs.data(), static_cast<int>(this->m_Dofs.size()));
         }
 
         // scatter
@@ -791,7 +1021,7 @@ PetscErrorCode SemiLagrangian::CommunicateCoord(std::string flag) {
             catch (std::bad_alloc& err) {
                 ierr = reg::ThrowError(err); CHKERRQ(ierr);
             }
-            this->m_AdjointPlan->allocate(nl, this->m_Dofs, 2);
+            this->m_AdjointPlan->allocate(nl, this->m_Dofs.data(), static_cast<int>(this->m_Dofs.size()));
         }
 
         // communicate coordinates
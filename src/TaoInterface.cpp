@@ -150,6 +150,11 @@ PetscErrorCode HessianMatVec(Mat H, Vec x, Vec Hx) {
     // apply hessian
     ierr = optprob->HessianMatVec(Hx, x); CHKERRQ(ierr);
 
+    // keep matvec for krylov recycling
+    if (optprob->GetKrylovRecycler() != NULL) {
+        ierr = optprob->GetKrylovRecycler()->Record(x, Hx); CHKERRQ(ierr);
+    }
+
     PetscFunctionReturn(ierr);
 }
 
@@ -180,6 +185,60 @@ PetscErrorCode PrecondMatVec(PC Hpre, Vec x, Vec Hprex) {
 
 
 
+/****************************************************************************
+ * @brief applies the preconditioner followed by the deflation projector
+ * of the recycled krylov basis
+ ****************************************************************************/
+PetscErrorCode DeflatedPrecondMatVec(PC Hpre, Vec x, Vec Hprex) {
+    PetscErrorCode ierr = 0;
+    void* ptr;
+    KrylovRecycler *recycler = NULL;
+
+    PetscFunctionBegin;
+
+    ierr = PCShellGetContext(Hpre, &ptr); CHKERRQ(ierr);
+
+    recycler = reinterpret_cast<KrylovRecycler*>(ptr);
+    ierr = Assert(recycler != NULL, "null pointer"); CHKERRQ(ierr);
+
+    // apply preconditioner and deflation
+    ierr = recycler->ApplyPreconditioner(Hprex, x); CHKERRQ(ierr);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
+/****************************************************************************
+ * @brief applies the inverse of the initial hessian of the limited memory
+ * bfgs method; we seed the quasi-newton approximation with the
+ * regularization operator, i.e., we apply its inverse (sobolev gradient)
+ ****************************************************************************/
+PetscErrorCode InitialHessianMatVec(PC Hpre, Vec x, Vec Hprex) {
+    PetscErrorCode ierr = 0;
+    void* ptr;
+    OptimizationProblem *optprob = NULL;
+
+    PetscFunctionBegin;
+
+    ierr = PCShellGetContext(Hpre, &ptr); CHKERRQ(ierr);
+
+    optprob = reinterpret_cast<OptimizationProblem*>(ptr);
+    ierr = Assert(optprob != NULL, "null pointer"); CHKERRQ(ierr);
+
+    // time and count as preconditioner matvec (workload log)
+    ierr = optprob->GetOptions()->StartTimer(PMVEXEC); CHKERRQ(ierr);
+    ierr = optprob->ApplyInvRegularizationOperator(Hprex, x, false); CHKERRQ(ierr);
+    ierr = optprob->GetOptions()->StopTimer(PMVEXEC); CHKERRQ(ierr);
+    optprob->GetOptions()->IncrementCounter(PCMATVEC);
+
+    PetscFunctionReturn(ierr);
+}
+
+
+
+
 /****************************************************************************
  * @brief convergence test for optimization
  * @param tao pointer to tao solver
@@ -559,6 +618,11 @@ PetscErrorCode OptimizationMonitor(Tao tao, void* ptr) {
     // remember current iterate
     optprob->IncrementIterations();
 
+    // newton update has been accepted; recycled H W is outdated
+    if (iter > 0 && optprob->GetKrylovRecycler() != NULL) {
+        optprob->GetKrylovRecycler()->SetHessianChanged();
+    }
+
     // tao: display convergence reason
     if (optprob->GetOptions()->m_Verbosity > 0) {
         ierr = GetSolverStatus(convreason, statusmsg); CHKERRQ(ierr);